@@ -80,10 +80,7 @@
 typedef struct app_receive_result_t {
   void *hdr_ptr;          /* 0x00: Pointer to packet header */
   void *data_ptr;         /* 0x04: Pointer to packet data */
-  uint32_t src_uid_high;  /* 0x08: Source UID high word */
-  uint32_t src_uid_low;   /* 0x0C: Source UID low word */
-  uint32_t dest_uid_high; /* 0x10: Destination UID high word */
-  uint32_t dest_uid_low;  /* 0x14: Destination UID low word */
+  uint32_t data_bufs[4];  /* 0x08: Data page buffers, as PKT_$DUMP_DATA takes them */
   uint32_t src_node;      /* 0x18: Source node ID */
   uint32_t dest_node;     /* 0x1C: Destination node ID */
   uint32_t routing_key;   /* 0x20: Routing key */
@@ -29,8 +29,8 @@ void APP_$RECEIVE(uint16_t sock_num, void *result, status_$t *status_ret)
     uint16_t local_sock;
     uint8_t local_flags;
 
-    /* Stack space for UIDs */
-    uint32_t uid_data[4];  /* For src/dest UIDs */
+    /* Data page buffers */
+    uint32_t data_bufs[4];
 
     *status_ret = status_$ok;
     holding_lock = 0;
@@ -44,11 +44,11 @@ void APP_$RECEIVE(uint16_t sock_num, void *result, status_$t *status_ret)
         return;
     }
 
-    /* Copy UID data from local stack to result */
-    res->src_uid_high = uid_data[0];
-    res->src_uid_low = uid_data[1];
-    res->dest_uid_high = uid_data[2];
-    res->dest_uid_low = uid_data[3];
+    /* Copy the data buffer list from local stack to result */
+    res->data_bufs[0] = data_bufs[0];
+    res->data_bufs[1] = data_bufs[1];
+    res->data_bufs[2] = data_bufs[2];
+    res->data_bufs[3] = data_bufs[3];
 
     /* Get socket entry and extract flags */
     sock_entry = (uint8_t *)(*(uint32_t *)((uint8_t *)&SOCK_$TABLE_BASE + sock_num * 4));
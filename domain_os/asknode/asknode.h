@@ -29,6 +29,8 @@
 #define status_$network_conflict_with_another_node_listing        0x00110019
 #define status_$network_quit_fault_during_node_listing            0x0011001A
 #define status_$network_waited_too_long_for_more_node_responses   0x0011001B
+#define status_$network_too_many_node_queries                     0x00110022
+#define status_$network_bad_node_query                            0x00110023
 
 /*
  * ============================================================================
@@ -222,4 +224,119 @@ void ASKNODE_$WHO_REMOTE(int32_t *node_id, int32_t *port,
                          int32_t *node_list, int16_t *max_count,
                          uint16_t *count, status_$t *status);
 
+/*
+ * ============================================================================
+ * Node Queries
+ * ============================================================================
+ *
+ * ASKNODE_$QUERY_* put one request to a list of nodes (typically from
+ * ASKNODE_$WHO) with several requests outstanding at once, and hand back
+ * each node's answer as it arrives instead of after the slowest node.
+ * Nodes that recently failed to respond fail at once; the rest get a
+ * timeout from their measured round trip time and one retry.
+ *
+ * Answers to requests for static information (node and root UIDs, build
+ * time, system, volume and disk information) are kept for about ten
+ * minutes, both here and in ASKNODE_$INTERNET_INFO.
+ *
+ * Only requests answered by a response template alone can be queried:
+ * not ASKNODE_REQ_LOG_READ, ASKNODE_REQ_NETWORK_DIAG or the WHO requests.
+ */
+#define ASKNODE_QUERY_WINDOW        8       /* Default requests outstanding */
+#define ASKNODE_QUERY_WINDOW_MAX    16
+#define ASKNODE_QUERY_MAX           2       /* Queries in progress, system-wide */
+
+/*
+ * ASKNODE_$QUERY_START - Start putting a request to a list of nodes
+ *
+ * The node list is not copied and must stay valid until
+ * ASKNODE_$QUERY_END.  A query belongs to the calling process.
+ *
+ * @param req_type      Pointer to request type code
+ * @param param         Request-specific parameter, the same for every node
+ * @param node_list     Nodes to ask (NODE_$ME or 0 is answered locally)
+ * @param n_nodes       Pointer to number of nodes in node_list
+ * @param window        Pointer to requests outstanding at once (0 for
+ *                      ASKNODE_QUERY_WINDOW)
+ * @param handle        Output: query handle
+ * @param status        Output status code
+ */
+void ASKNODE_$QUERY_START(uint16_t *req_type, uid_t *param,
+                          uint32_t *node_list, uint16_t *n_nodes,
+                          uint16_t *window, uint16_t *handle,
+                          status_$t *status);
+
+/*
+ * ASKNODE_$QUERY_NEXT - Get the next node's answer
+ *
+ * Waits until some node has answered or given up.  The result is laid
+ * out as for ASKNODE_$INTERNET_INFO; node_status is what that call would
+ * have returned for the node.
+ *
+ * @param handle        Pointer to query handle
+ * @param node_id       Output: node the result is for
+ * @param resp_len      Pointer to size of result
+ * @param result        Output buffer for the node's result
+ * @param node_status   Output: status of the request to node_id
+ * @param status        Output status code (quit fault or bad handle)
+ *
+ * Returns:
+ *   Negative if a result was returned, 0 when every node has been
+ *   reported or on error
+ */
+int8_t ASKNODE_$QUERY_NEXT(uint16_t *handle, uint32_t *node_id,
+                           uint16_t *resp_len, uint32_t *result,
+                           status_$t *node_status, status_$t *status);
+
+/*
+ * ASKNODE_$QUERY_END - Finish a query, whether or not every node reported
+ *
+ * @param handle        Pointer to query handle
+ */
+void ASKNODE_$QUERY_END(uint16_t *handle);
+
+/*
+ * ASKNODE_$QUERY_CNTL - ASKNODE_$QUERY_* as one system call
+ *
+ * The form a sweep such as lcnode's uses: one request per command, each
+ * in five arguments.
+ *
+ *   ASKNODE_QUERY_CMD_START: param is an asknode_$query_start_t and
+ *       buffer the node list; handle receives the query handle
+ *   ASKNODE_QUERY_CMD_NEXT: param is an asknode_$query_next_t and buffer
+ *       receives the node's result
+ *   ASKNODE_QUERY_CMD_END: param and buffer are not used
+ *
+ * @param cmd           Pointer to ASKNODE_QUERY_CMD_*
+ * @param handle        Pointer to query handle
+ * @param param         Command's parameter block
+ * @param buffer        Node list or result buffer
+ * @param status        Output status code; status_$network_bad_node_query
+ *                      for an unknown command or a node list outside
+ *                      user space
+ */
+#define ASKNODE_QUERY_CMD_START     0
+#define ASKNODE_QUERY_CMD_NEXT      1
+#define ASKNODE_QUERY_CMD_END       2
+
+typedef struct asknode_$query_start_t {
+  uint16_t req_type;     /* 0x00: Request type code */
+  uint16_t n_nodes;      /* 0x02: Nodes in the node list */
+  uint16_t window;       /* 0x04: Requests outstanding (0 for default) */
+  uint16_t pad;          /* 0x06 */
+  uid_t param;           /* 0x08: Request-specific parameter */
+} asknode_$query_start_t;
+
+typedef struct asknode_$query_next_t {
+  uint32_t node_id;      /* 0x00: Output: node the result is for */
+  status_$t node_status; /* 0x04: Output: status of the request to it */
+  uint16_t resp_len;     /* 0x08: Size of the result buffer */
+  int8_t more;           /* 0x0A: Output: negative if a result was
+                          * returned, 0 when every node is reported */
+  uint8_t pad;           /* 0x0B */
+} asknode_$query_next_t;
+
+void ASKNODE_$QUERY_CNTL(uint16_t *cmd, uint16_t *handle, void *param,
+                         uint32_t *buffer, status_$t *status);
+
 #endif /* ASKNODE_H */
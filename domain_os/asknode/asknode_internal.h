@@ -18,6 +18,7 @@
 #include "hint/hint.h"
 #include "log/log.h"
 #include "misc/misc.h"
+#include "ml/ml.h"
 #include "mmap/mmap.h"
 #include "name/name.h"
 #include "netbuf/netbuf.h"
@@ -106,6 +107,113 @@ typedef struct asknode_who_response_t {
   uint32_t time_low;      /* 0x14: Time low word */
 } asknode_who_response_t;
 
+/*
+ * ============================================================================
+ * Node Information Cache
+ * ============================================================================
+ *
+ * Responses to requests for information that only changes when a node
+ * is reconfigured, keyed on node, request type and the first parameter
+ * word.  Entries expire after ASKNODE_CACHE_TTL ticks of TIME_$CLOCKH, and
+ * a node's entries are dropped when it fails to respond (it may be
+ * coming back with different software or disks).
+ */
+#define ASKNODE_CACHE_WAYS      4
+#define ASKNODE_CACHE_SETS      64      /* Power of two */
+#define ASKNODE_CACHE_DATA_MAX  0x70    /* Largest response kept */
+#define ASKNODE_CACHE_TTL       2400    /* ~10 minutes */
+
+typedef struct asknode_$cache_entry_t {
+  uint32_t node;         /* 0x00: Node ID, 0 if free */
+  uint32_t param;        /* 0x04: First parameter word as sent */
+  uint32_t expires;      /* 0x08: TIME_$CLOCKH */
+  uint16_t req_type;     /* 0x0C: Request type */
+  uint16_t len;          /* 0x0E: Bytes of response */
+  uint32_t data[ASKNODE_CACHE_DATA_MAX / 4]; /* 0x10: Response template */
+} asknode_$cache_entry_t;
+
+/*
+ * ============================================================================
+ * Node Queries (ASKNODE_$QUERY_*)
+ * ============================================================================
+ */
+
+/* Times a request is sent before the node is given up */
+#define ASKNODE_QUERY_TRIES     2
+
+/* A query not asked for a result for this long may be reclaimed */
+#define ASKNODE_QUERY_IDLE      240     /* ~1 minute of TIME_$CLOCKH */
+
+#define ASKNODE_SLOT_FREE       0
+#define ASKNODE_SLOT_SENT       1       /* Waiting for the node */
+#define ASKNODE_SLOT_READY      2       /* Result not yet handed back */
+
+typedef struct asknode_$query_slot_t {
+  uint32_t node;         /* 0x00: Node asked */
+  uint32_t port;         /* 0x04: Routing from the hints */
+  uint32_t deadline;     /* 0x08: TIME_$CLOCKH to resend or give up */
+  uint32_t sent;         /* 0x0C: PKT_$RTT_STAMP of the first send */
+  status_$t status;      /* 0x10: Result of the request */
+  uint16_t len;          /* 0x14: Bytes in resp */
+  int16_t id;            /* 0x16: Packet ID of the request */
+  uint8_t state;         /* 0x18: ASKNODE_SLOT_* */
+  uint8_t tries;         /* 0x19: Times sent */
+  uint16_t pad;          /* 0x1A */
+  uint32_t resp[ASKNODE_MAX_RESPONSE_LEN / 4]; /* 0x1C: Response template */
+} asknode_$query_slot_t;
+
+typedef struct asknode_$query_t {
+  int8_t in_use;         /* Negative if allocated */
+  uint8_t window;        /* Requests outstanding at most */
+  uint16_t as_id;        /* Owning address space */
+  uint16_t sock;         /* Socket the replies come to */
+  uint16_t req_type;     /* Request type */
+  uint16_t n_nodes;      /* Nodes in nodes */
+  uint16_t next;         /* Next node to ask */
+  uint16_t busy;         /* Slots not free */
+  uint16_t pad;
+  uint32_t last_used;    /* TIME_$CLOCKH of the last call */
+  uid_t param;           /* Request parameter; high word keys the cache */
+  uint32_t *nodes;       /* Caller's node list */
+  uint16_t req_buf[ASKNODE_REQUEST_LEN / 2];
+  uint32_t pkt_info[8];
+  asknode_$query_slot_t slots[ASKNODE_QUERY_WINDOW_MAX];
+} asknode_$query_t;
+
+/*
+ * ============================================================================
+ * Internal Functions
+ * ============================================================================
+ */
+
+/*
+ * asknode_$pack_request - Build the request template for a remote request
+ *
+ * Returns:
+ *   Bytes of data expected with the response
+ */
+uint16_t asknode_$pack_request(uint16_t request, uid_t *param,
+                               uint16_t *req_buf);
+
+/* Negative if responses to the request can be cached */
+int8_t asknode_$cacheable(uint16_t request);
+
+/*
+ * asknode_$cache_lookup - Copy a cached response into result
+ *
+ * Returns:
+ *   Negative on a hit, with *len set to the bytes copied
+ */
+int8_t asknode_$cache_lookup(uint32_t node, uint16_t request, uint32_t param,
+                             uint32_t *result, uint16_t max_len,
+                             uint16_t *len);
+
+void asknode_$cache_store(uint32_t node, uint16_t request, uint32_t param,
+                          uint32_t *result, uint16_t len);
+
+/* Drop everything cached for a node */
+void asknode_$cache_forget(uint32_t node);
+
 /*
  * ============================================================================
  * Network Failure Record
@@ -0,0 +1,129 @@
+/*
+ * ASKNODE node information cache
+ *
+ * Sweeping a network for the software revision or disk layout of every
+ * node asks each node the same question again and again, though the
+ * answer only changes when the node is rebuilt or reconfigured.  Responses
+ * to such requests are kept here for ASKNODE_CACHE_TTL, set-associative on
+ * node, request type and first parameter word.  A set that is full gives
+ * up its entry closest to expiry.
+ */
+
+#include "asknode/asknode_internal.h"
+
+static asknode_$cache_entry_t asknode_$cache[ASKNODE_CACHE_SETS][ASKNODE_CACHE_WAYS];
+
+static uint16_t asknode_$cache_lock;
+
+int8_t asknode_$cacheable(uint16_t request)
+{
+    switch (request) {
+    case ASKNODE_REQ_NODE_UID:
+    case ASKNODE_REQ_VOLUME_INFO:
+    case ASKNODE_REQ_ROOT_UID:
+    case ASKNODE_REQ_BUILD_TIME:
+    case ASKNODE_REQ_SYSTEM_INFO:
+    case ASKNODE_REQ_DISK_INFO:
+        return -1;
+    default:
+        return 0;
+    }
+}
+
+static asknode_$cache_entry_t *asknode_$cache_set(uint32_t node,
+                                                  uint16_t request,
+                                                  uint32_t param)
+{
+    uint32_t h;
+
+    h = node ^ (node >> 6) ^ ((uint32_t)request << 2) ^ param;
+    return asknode_$cache[h & (ASKNODE_CACHE_SETS - 1)];
+}
+
+int8_t asknode_$cache_lookup(uint32_t node, uint16_t request, uint32_t param,
+                             uint32_t *result, uint16_t max_len,
+                             uint16_t *len)
+{
+    asknode_$cache_entry_t *set;
+    asknode_$cache_entry_t *e;
+    ml_$spin_token_t token;
+    int8_t hit = 0;
+    int16_t i;
+
+    set = asknode_$cache_set(node, request, param);
+
+    token = ML_$SPIN_LOCK(&asknode_$cache_lock);
+    for (i = 0; i < ASKNODE_CACHE_WAYS; i++) {
+        e = &set[i];
+        if (e->node != node || e->req_type != request || e->param != param) {
+            continue;
+        }
+        if ((int32_t)(TIME_$CLOCKH - e->expires) >= 0) {
+            e->node = 0;
+            break;
+        }
+        *len = (e->len < max_len) ? e->len : max_len;
+        OS_$DATA_COPY((char *)e->data, (char *)result, *len);
+        hit = -1;
+        break;
+    }
+    ML_$SPIN_UNLOCK(&asknode_$cache_lock, token);
+
+    return hit;
+}
+
+void asknode_$cache_store(uint32_t node, uint16_t request, uint32_t param,
+                          uint32_t *result, uint16_t len)
+{
+    asknode_$cache_entry_t *set;
+    asknode_$cache_entry_t *e;
+    asknode_$cache_entry_t *victim;
+    ml_$spin_token_t token;
+    int16_t i;
+
+    if (len > ASKNODE_CACHE_DATA_MAX || node == 0) {
+        return;
+    }
+
+    set = asknode_$cache_set(node, request, param);
+
+    token = ML_$SPIN_LOCK(&asknode_$cache_lock);
+    victim = &set[0];
+    for (i = 0; i < ASKNODE_CACHE_WAYS; i++) {
+        e = &set[i];
+        if (e->node == node && e->req_type == request && e->param == param) {
+            victim = e;
+            break;
+        }
+        if (e->node == 0) {
+            victim = e;
+        } else if (victim->node != 0 &&
+                   (int32_t)(e->expires - victim->expires) < 0) {
+            victim = e;
+        }
+    }
+
+    victim->node = node;
+    victim->param = param;
+    victim->req_type = request;
+    victim->len = len;
+    victim->expires = TIME_$CLOCKH + ASKNODE_CACHE_TTL;
+    OS_$DATA_COPY((char *)result, (char *)victim->data, len);
+    ML_$SPIN_UNLOCK(&asknode_$cache_lock, token);
+}
+
+void asknode_$cache_forget(uint32_t node)
+{
+    asknode_$cache_entry_t *e;
+    ml_$spin_token_t token;
+    int16_t i;
+
+    token = ML_$SPIN_LOCK(&asknode_$cache_lock);
+    e = &asknode_$cache[0][0];
+    for (i = 0; i < ASKNODE_CACHE_SETS * ASKNODE_CACHE_WAYS; i++, e++) {
+        if (e->node == node) {
+            e->node = 0;
+        }
+    }
+    ML_$SPIN_UNLOCK(&asknode_$cache_lock, token);
+}
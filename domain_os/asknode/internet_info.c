@@ -231,6 +231,85 @@ static uint32_t handle_local_request(uint16_t req_type, uid_t *param,
     return ret_val;
 }
 
+/*
+ * Build the request template for a remote request
+ */
+uint16_t asknode_$pack_request(uint16_t request, uid_t *param,
+                               uint16_t *req_buf)
+{
+    uint16_t data_len = 0;
+
+    /* Initialize request */
+    req_buf[0] = 3;         /* Protocol version */
+    req_buf[1] = request;   /* Request type */
+    req_buf[2] = 0;         /* Reserved */
+
+    /* Copy parameter based on request type */
+    switch (request) {
+    case 0x2B:
+    case 0x23:
+    case 0x14:
+    case 0x4B:
+        /* Copy 8-byte UID */
+        *(uint32_t *)&req_buf[4] = param->high;
+        *(uint32_t *)&req_buf[6] = param->low;
+        break;
+
+    case 0x16:
+        /* Copy 12 bytes */
+        {
+            uint8_t *src = (uint8_t *)param;
+            uint8_t *dst = (uint8_t *)&req_buf[4];
+            int i;
+            for (i = 0; i < 12; i++) *dst++ = *src++;
+        }
+        break;
+
+    case 0x25:
+        /* Copy 10 bytes */
+        *(uint32_t *)&req_buf[4] = param->high;
+        *(uint32_t *)&req_buf[6] = param->low;
+        *(uint32_t *)&req_buf[8] = param[1].high;
+        req_buf[10] = *(uint16_t *)&param[1].low;
+        break;
+
+    case 0x35:
+        /* Copy 16 bytes */
+        {
+            uint8_t *src = (uint8_t *)param;
+            uint8_t *dst = (uint8_t *)&req_buf[4];
+            int i;
+            for (i = 0; i < 16; i++) *dst++ = *src++;
+        }
+        break;
+
+    case 0x5B:
+    case 0x3D:
+    case 0x3B:
+        /* Copy high word and partial low */
+        *(uint32_t *)&req_buf[4] = param->high;
+        req_buf[6] = *(uint16_t *)&param->low;
+        break;
+
+    case 0x31:
+        /* Log read request */
+        *(uint32_t *)&req_buf[4] = param->high;
+        if ((param->high & 0x10000) == 0) {
+            data_len = *(uint16_t *)&param->high;
+            if (data_len > 0x400) data_len = 0x400;
+        } else {
+            data_len = 0x400;
+        }
+        break;
+
+    default:
+        *(uint32_t *)&req_buf[4] = param->high;
+        break;
+    }
+
+    return data_len;
+}
+
 /*
  * Main ASKNODE_$INTERNET_INFO function
  */
@@ -317,78 +396,20 @@ uint32_t ASKNODE_$INTERNET_INFO(uint16_t *req_type, uint32_t *node_id,
         /* Build request packet */
         uint16_t req_buf[12];   /* Request buffer (0x18 bytes) */
         uint32_t pkt_info[8];   /* Packet info block */
-        uint8_t temp1[2], temp2[4];
-        uint16_t data_len = 0;
+        uint16_t tpl_len;
+        uint16_t data_len;
         uint32_t routing = *node_id;
         int32_t port = *req_len;
         int8_t retry_flag = 0;
 
-        /* Initialize request */
-        req_buf[0] = 3;         /* Protocol version */
-        req_buf[1] = request;   /* Request type */
-        req_buf[2] = 0;         /* Reserved */
-
-        /* Copy parameter based on request type */
-        switch (request) {
-        case 0x2B:
-        case 0x23:
-        case 0x14:
-        case 0x4B:
-            /* Copy 8-byte UID */
-            *(uint32_t *)&req_buf[4] = param->high;
-            *(uint32_t *)&req_buf[6] = param->low;
-            break;
-
-        case 0x16:
-            /* Copy 12 bytes */
-            {
-                uint8_t *src = (uint8_t *)param;
-                uint8_t *dst = (uint8_t *)&req_buf[4];
-                int i;
-                for (i = 0; i < 12; i++) *dst++ = *src++;
-            }
-            break;
-
-        case 0x25:
-            /* Copy 10 bytes */
-            *(uint32_t *)&req_buf[4] = param->high;
-            *(uint32_t *)&req_buf[6] = param->low;
-            *(uint32_t *)&req_buf[8] = param[1].high;
-            req_buf[10] = *(uint16_t *)&param[1].low;
-            break;
-
-        case 0x35:
-            /* Copy 16 bytes */
-            {
-                uint8_t *src = (uint8_t *)param;
-                uint8_t *dst = (uint8_t *)&req_buf[4];
-                int i;
-                for (i = 0; i < 16; i++) *dst++ = *src++;
-            }
-            break;
-
-        case 0x5B:
-        case 0x3D:
-        case 0x3B:
-            /* Copy high word and partial low */
-            *(uint32_t *)&req_buf[4] = param->high;
-            req_buf[6] = *(uint16_t *)&param->low;
-            break;
-
-        case 0x31:
-            /* Log read request */
-            *(uint32_t *)&req_buf[4] = param->high;
-            if ((param->high & 0x10000) == 0) {
-                data_len = *(uint16_t *)&param->high;
-                if (data_len > 0x400) data_len = 0x400;
-            } else {
-                data_len = 0x400;
-            }
-            break;
+        data_len = asknode_$pack_request(request, param, req_buf);
 
-        default:
-            *(uint32_t *)&req_buf[4] = param->high;
-            break;
+        /* Static information another call asked for recently */
+        if (asknode_$cacheable(request) < 0 &&
+            asknode_$cache_lookup(*node_id, request, param->high, result,
+                                  *resp_len, &tpl_len) < 0) {
+            *status = status_$ok;
+            return ret_val;
         }
 
         /* If port is -1, use hint system to find routing */
@@ -419,7 +440,7 @@ uint32_t ASKNODE_$INTERNET_INFO(uint16_t *req_type, uint32_t *node_id,
                               req_buf, 0x18,
                               &ASKNODE_$EMPTY_DATA, 0,  /* No request data */
                               NULL, (char *)result, *resp_len,
-                              temp1, (uint16_t *)((char *)result + 10), data_len,
+                              &tpl_len, (uint16_t *)((char *)result + 10), data_len,
                               &resp_data_len, status);
 
             if ((*status != status_$network_transmit_failed &&
@@ -435,6 +456,9 @@ uint32_t ASKNODE_$INTERNET_INFO(uint16_t *req_type, uint32_t *node_id,
 
         /* Check response */
         if (*status != 0) {
+            if (*status == status_$network_remote_node_failed_to_respond) {
+                asknode_$cache_forget(*node_id);
+            }
             /* Set high bit to indicate remote error */
             *(uint8_t *)status |= 0x80;
             return *status;
@@ -466,6 +490,10 @@ uint32_t ASKNODE_$INTERNET_INFO(uint16_t *req_type, uint32_t *node_id,
                 response_uid.low = result[3];
                 HINT_$ADDI(&response_uid, (uint32_t *)&port);
             }
+            if (asknode_$cacheable(request) < 0) {
+                asknode_$cache_store(*node_id, request, param->high,
+                                     result, tpl_len);
+            }
         }
 
         /* Special handling for log read response */
@@ -0,0 +1,512 @@
+/*
+ * ASKNODE_$QUERY_* - Put one request to many nodes at once
+ *
+ * Asking every node on a large network for something one
+ * ASKNODE_$INTERNET_INFO at a time takes as long as all the round trips
+ * put together, and a node that is down holds everything up for the
+ * whole of PKT_$SAR_INTERNET's retries.  A query instead keeps up to its
+ * window of requests outstanding from one socket of its own, matches
+ * replies to nodes by packet ID, and hands back each result as soon as
+ * it is in, so a sweep takes about as long as its slowest node.
+ *
+ * Each outstanding request has a slot.  ASKNODE_$QUERY_NEXT fills free
+ * slots from the node list, receives whatever has arrived, resends or
+ * gives up on requests past their deadline, and returns the first slot
+ * with a result; it waits only when there is none.  Cached answers, the
+ * local node and nodes PKT already knows to be missing never go on the
+ * wire.
+ *
+ * Only the owning process uses a query once it is allocated, so the
+ * lock covers just the table.
+ *
+ * User programs reach all of this through ASKNODE_$QUERY_CNTL.
+ */
+
+#include "asknode/asknode_internal.h"
+#include "svc/svc.h"
+
+/* Status codes as ASKNODE_$INTERNET_INFO reports them */
+#define status_$network_unexpected_reply_type        0x00110020
+#define status_$network_bad_asknode_version_number   0x00110021
+
+static asknode_$query_t asknode_$queries[ASKNODE_QUERY_MAX];
+
+static uint16_t asknode_$query_lock;
+
+/*
+ * Find the caller's query from its handle
+ */
+static asknode_$query_t *asknode_$query_find(uint16_t handle)
+{
+    asknode_$query_t *q;
+
+    if (handle == 0 || handle > ASKNODE_QUERY_MAX) {
+        return NULL;
+    }
+    q = &asknode_$queries[handle - 1];
+    if (q->in_use >= 0 || q->as_id != PROC1_$AS_ID) {
+        return NULL;
+    }
+    return q;
+}
+
+static void asknode_$query_free(asknode_$query_t *q)
+{
+    ml_$spin_token_t token;
+
+    SOCK_$CLOSE(q->sock);
+
+    token = ML_$SPIN_LOCK(&asknode_$query_lock);
+    q->in_use = 0;
+    ML_$SPIN_UNLOCK(&asknode_$query_lock, token);
+}
+
+/*
+ * A slot's request is finished, one way or another
+ */
+static void asknode_$query_done(asknode_$query_slot_t *s, status_$t status)
+{
+    s->status = status;
+    s->state = ASKNODE_SLOT_READY;
+}
+
+static void asknode_$query_send(asknode_$query_t *q, asknode_$query_slot_t *s)
+{
+    uint16_t len_out[2];
+    status_$t status;
+
+    if (s->tries == 0) {
+        s->sent = PKT_$RTT_STAMP();
+    }
+    s->tries++;
+
+    PKT_$SEND_INTERNET(s->port, s->node, ASKNODE_PKT_TYPE,
+                       (int32_t)-1, NODE_$ME, q->sock,
+                       q->pkt_info, s->id,
+                       q->req_buf, ASKNODE_REQUEST_LEN,
+                       &ASKNODE_$EMPTY_DATA, 0,
+                       &len_out[1], &len_out[0], &status);
+    if (status != status_$ok) {
+        asknode_$query_done(s, status | 0x80000000);
+        return;
+    }
+
+    s->state = ASKNODE_SLOT_SENT;
+    s->deadline = TIME_$CLOCKH + PKT_$RTT_TIMEOUT(s->node) + len_out[0];
+}
+
+/*
+ * Start the next node's request in a free slot
+ */
+static void asknode_$query_fill(asknode_$query_t *q, asknode_$query_slot_t *s)
+{
+    uid_t hint_uid;
+    int32_t hints[10];
+    uid_t param;
+    int32_t port;
+    uint16_t resp_len;
+    status_$t status;
+
+    s->node = q->nodes[q->next++];
+    s->tries = 0;
+    s->len = 0;
+    q->busy++;
+
+    /* The local node answers at once */
+    if (s->node == NODE_$ME || s->node == 0) {
+        param = q->param;
+        port = -1;
+        resp_len = ASKNODE_MAX_RESPONSE_LEN;
+        s->resp[0] = (uint32_t)3 << 16;     /* Version in the high half */
+        ASKNODE_$INTERNET_INFO(&q->req_type, &s->node, &port, &param,
+                               &resp_len, s->resp, &status);
+        s->len = resp_len;
+        asknode_$query_done(s, (status != status_$ok) ? status :
+                               (status_$t)s->resp[1]);
+        return;
+    }
+
+    if (asknode_$cacheable(q->req_type) < 0 &&
+        asknode_$cache_lookup(s->node, q->req_type, q->param.high, s->resp,
+                              ASKNODE_MAX_RESPONSE_LEN, &s->len) < 0) {
+        asknode_$query_done(s, status_$ok);
+        return;
+    }
+
+    /* Not worth waiting for */
+    if (PKT_$RECENTLY_MISSING(s->node) < 0) {
+        asknode_$query_done(s, status_$network_remote_node_failed_to_respond |
+                               0x80000000);
+        return;
+    }
+
+    hint_uid.high = UID_$NIL.high;
+    hint_uid.low = (UID_$NIL.low & 0xFFF00000) | s->node;
+    HINT_$GET_HINTS(&hint_uid, (uint32_t *)hints);
+    s->port = hints[0];
+    s->id = PKT_$NEXT_ID();
+
+    asknode_$query_send(q, s);
+}
+
+/*
+ * Check a node's response as ASKNODE_$INTERNET_INFO does
+ */
+static void asknode_$query_answered(asknode_$query_t *q,
+                                    asknode_$query_slot_t *s)
+{
+    uint16_t version;
+    uid_t response_uid;
+
+    /* A sample from a resent request could be for either send */
+    if (s->tries == 1) {
+        PKT_$RTT_SAMPLE(s->node, s->sent);
+    }
+    PKT_$NOTE_VISIBLE(s->node, (int8_t)0xFF);
+
+    /* Version, then reply type, in the first longword */
+    version = (uint16_t)(s->resp[0] >> 16);
+    if ((uint16_t)s->resp[0] != q->req_type + 1) {
+        asknode_$query_done(s, status_$network_unexpected_reply_type);
+        return;
+    }
+    if (version != 3 && version != 2 && ASKNODE_$PROTOCOL_VERSION != 3) {
+        asknode_$query_done(s, status_$network_bad_asknode_version_number);
+        return;
+    }
+    if (s->resp[1] != status_$ok) {
+        asknode_$query_done(s, s->resp[1]);
+        return;
+    }
+
+    if (q->req_type == ASKNODE_REQ_VOLUME_INFO ||
+        q->req_type == ASKNODE_REQ_NODE_UID ||
+        q->req_type == ASKNODE_REQ_ROOT_UID) {
+        response_uid.high = s->resp[2];
+        response_uid.low = s->resp[3];
+        HINT_$ADDI(&response_uid, &s->port);
+    }
+    if (asknode_$cacheable(q->req_type) < 0) {
+        asknode_$cache_store(s->node, q->req_type, q->param.high, s->resp,
+                             s->len);
+    }
+
+    asknode_$query_done(s, status_$ok);
+}
+
+/*
+ * Take everything queued on the query's socket
+ */
+static void asknode_$query_receive(asknode_$query_t *q)
+{
+    asknode_$query_slot_t *s;
+    pkt_$recv_t recv;
+    status_$t status;
+    uint32_t recv_ppn;
+    uint16_t tpl_len;
+    uint16_t data_len;
+    int16_t recv_id;
+    int16_t i;
+
+    for (;;) {
+        APP_$RECEIVE(q->sock, &recv, &status);
+        if (status != status_$ok) {
+            return;
+        }
+
+        /* Everything needed from the header, before it goes back */
+        recv_id = *(int16_t *)(recv.hdr_ptr + 6);
+        tpl_len = *(uint16_t *)(recv.hdr_ptr + 2);
+        data_len = *(uint16_t *)(recv.hdr_ptr + 4);
+        if (tpl_len > ASKNODE_MAX_RESPONSE_LEN) {
+            tpl_len = ASKNODE_MAX_RESPONSE_LEN;
+        }
+
+        /* Late duplicates of a resent request find no slot */
+        s = NULL;
+        for (i = 0; i < q->window; i++) {
+            if (q->slots[i].state == ASKNODE_SLOT_SENT &&
+                q->slots[i].id == recv_id) {
+                s = &q->slots[i];
+                break;
+            }
+        }
+        if (s != NULL) {
+            OS_$DATA_COPY(recv.data_ptr, (char *)s->resp, (uint32_t)tpl_len);
+            s->len = tpl_len;
+        }
+
+        recv_ppn = (uint32_t)recv.data_ptr & 0xFFFFFC00;
+        NETBUF_$RTN_HDR(&recv_ppn);
+        if (recv.data_bufs[0] != 0) {
+            PKT_$DUMP_DATA(recv.data_bufs, data_len);
+        }
+
+        if (s != NULL) {
+            asknode_$query_answered(q, s);
+        }
+    }
+}
+
+/*
+ * Resend or give up requests past their deadline
+ *
+ * Returns:
+ *   The earliest deadline still outstanding
+ */
+static uint32_t asknode_$query_expire(asknode_$query_t *q)
+{
+    asknode_$query_slot_t *s;
+    uint32_t now;
+    uint32_t next;
+    int16_t i;
+
+    now = TIME_$CLOCKH;
+    next = now + PKT_RTT_MAX_TICKS;
+
+    for (i = 0; i < q->window; i++) {
+        s = &q->slots[i];
+        if (s->state != ASKNODE_SLOT_SENT) {
+            continue;
+        }
+
+        if ((int32_t)(now - s->deadline) >= 0) {
+            PKT_$RTT_NOTE_TIMEOUT(s->node);
+            if (s->tries < ASKNODE_QUERY_TRIES) {
+                asknode_$query_send(q, s);
+            } else {
+                PKT_$NOTE_VISIBLE(s->node, 0);
+                asknode_$cache_forget(s->node);
+                asknode_$query_done(s,
+                    status_$network_remote_node_failed_to_respond | 0x80000000);
+                continue;
+            }
+        }
+
+        if (s->state == ASKNODE_SLOT_SENT &&
+            (int32_t)(s->deadline - next) < 0) {
+            next = s->deadline;
+        }
+    }
+
+    return next;
+}
+
+void ASKNODE_$QUERY_START(uint16_t *req_type, uid_t *param,
+                          uint32_t *node_list, uint16_t *n_nodes,
+                          uint16_t *window, uint16_t *handle,
+                          status_$t *status)
+{
+    asknode_$query_t *q;
+    ml_$spin_token_t token;
+    uint16_t request;
+    uint16_t sock;
+    uint8_t depth;
+    int16_t stale;
+    int16_t i;
+
+    *handle = 0;
+    request = *req_type;
+
+    switch (request) {
+    case ASKNODE_REQ_NETWORK_DIAG:
+    case ASKNODE_REQ_LOG_READ:
+    case ASKNODE_REQ_WHO:
+    case ASKNODE_REQ_WHO_REMOTE:
+        *status = status_$network_bad_node_query;
+        return;
+    }
+
+    if ((NETWORK_$CAPABLE_FLAGS & 1) == 0) {
+        *status = status_$network_request_denied_by_local_node;
+        return;
+    }
+
+    if (*window == 0) {
+        depth = ASKNODE_QUERY_WINDOW;
+    } else if (*window > ASKNODE_QUERY_WINDOW_MAX) {
+        depth = ASKNODE_QUERY_WINDOW_MAX;
+    } else {
+        depth = (uint8_t)*window;
+    }
+
+    /* Room on the socket for a reply to every request outstanding */
+    if (SOCK_$ALLOCATE(&sock, ((uint32_t)depth << 16) | 1, 0x10400) >= 0) {
+        *status = status_$network_no_more_free_sockets;
+        return;
+    }
+
+    /* A free query, or one its owner has stopped asking about */
+    q = NULL;
+    stale = -1;
+    token = ML_$SPIN_LOCK(&asknode_$query_lock);
+    for (i = 0; i < ASKNODE_QUERY_MAX; i++) {
+        if (asknode_$queries[i].in_use >= 0) {
+            q = &asknode_$queries[i];
+            break;
+        }
+    }
+    if (q == NULL) {
+        for (i = 0; i < ASKNODE_QUERY_MAX; i++) {
+            if ((int32_t)(TIME_$CLOCKH - asknode_$queries[i].last_used) >=
+                ASKNODE_QUERY_IDLE) {
+                q = &asknode_$queries[i];
+                stale = q->sock;
+                break;
+            }
+        }
+    }
+    if (q != NULL) {
+        q->in_use = -1;
+        q->as_id = PROC1_$AS_ID;
+        q->last_used = TIME_$CLOCKH;
+    }
+    ML_$SPIN_UNLOCK(&asknode_$query_lock, token);
+
+    if (stale >= 0) {
+        SOCK_$CLOSE(stale);
+    }
+    if (q == NULL) {
+        SOCK_$CLOSE(sock);
+        *status = status_$network_too_many_node_queries;
+        return;
+    }
+
+    q->sock = sock;
+    q->req_type = request;
+    q->param = *param;
+    q->nodes = node_list;
+    q->n_nodes = *n_nodes;
+    q->next = 0;
+    q->busy = 0;
+
+    q->window = depth;
+    for (i = 0; i < ASKNODE_QUERY_WINDOW_MAX; i++) {
+        q->slots[i].state = ASKNODE_SLOT_FREE;
+    }
+
+    asknode_$pack_request(request, param, q->req_buf);
+    for (i = 0; i < 8; i++) {
+        q->pkt_info[i] = PKT_$DEFAULT_INFO[i];
+    }
+
+    *handle = (uint16_t)(q - asknode_$queries) + 1;
+    *status = status_$ok;
+}
+
+int8_t ASKNODE_$QUERY_NEXT(uint16_t *handle, uint32_t *node_id,
+                           uint16_t *resp_len, uint32_t *result,
+                           status_$t *node_status, status_$t *status)
+{
+    asknode_$query_t *q;
+    asknode_$query_slot_t *s;
+    ec_$eventcount_t *sock_ec;
+    ec_$eventcount_t *ecs[3];
+    int32_t wait_vals[3];
+    uint16_t len;
+    int16_t i;
+
+    q = asknode_$query_find(*handle);
+    if (q == NULL) {
+        *status = status_$network_bad_node_query;
+        return 0;
+    }
+    q->last_used = TIME_$CLOCKH;
+
+    sock_ec = SOCK_$EVENT_COUNTERS[q->sock];
+    ecs[0] = sock_ec;
+    ecs[1] = (ec_$eventcount_t *)&TIME_$CLOCKH;
+    ecs[2] = &FIM_$QUIT_EC[PROC1_$AS_ID];
+    wait_vals[2] = FIM_$QUIT_VALUE[PROC1_$AS_ID] + 1;
+
+    for (;;) {
+        for (i = 0; i < q->window && q->next < q->n_nodes; i++) {
+            if (q->slots[i].state == ASKNODE_SLOT_FREE) {
+                asknode_$query_fill(q, &q->slots[i]);
+            }
+        }
+
+        /* Taken before receiving, so a later arrival ends the wait */
+        wait_vals[0] = sock_ec->value + 1;
+        asknode_$query_receive(q);
+        wait_vals[1] = asknode_$query_expire(q);
+
+        for (i = 0; i < q->window; i++) {
+            s = &q->slots[i];
+            if (s->state != ASKNODE_SLOT_READY) {
+                continue;
+            }
+
+            len = (s->len < *resp_len) ? s->len : *resp_len;
+            OS_$DATA_COPY((char *)s->resp, (char *)result, (uint32_t)len);
+            *node_id = s->node;
+            *node_status = s->status;
+            s->state = ASKNODE_SLOT_FREE;
+            q->busy--;
+
+            *status = status_$ok;
+            return -1;
+        }
+
+        if (q->busy == 0) {
+            *status = status_$ok;
+            return 0;
+        }
+
+        if (EC_$WAITN(ecs, wait_vals, 3) == 3) {
+            FIM_$QUIT_VALUE[PROC1_$AS_ID] = FIM_$QUIT_EC[PROC1_$AS_ID].count;
+            *status = status_$network_quit_fault_during_node_listing;
+            return 0;
+        }
+    }
+}
+
+void ASKNODE_$QUERY_END(uint16_t *handle)
+{
+    asknode_$query_t *q;
+
+    q = asknode_$query_find(*handle);
+    if (q != NULL) {
+        asknode_$query_free(q);
+    }
+    *handle = 0;
+}
+
+void ASKNODE_$QUERY_CNTL(uint16_t *cmd, uint16_t *handle, void *param,
+                         uint32_t *buffer, status_$t *status)
+{
+    asknode_$query_start_t *start;
+    asknode_$query_next_t *next;
+
+    switch (*cmd) {
+    case ASKNODE_QUERY_CMD_START:
+        start = (asknode_$query_start_t *)param;
+
+        /* The query reads the list as it goes; all of it must be the caller's */
+        if ((uint32_t)(uintptr_t)buffer + (uint32_t)start->n_nodes * 4 >
+            SVC_USER_SPACE_LIMIT) {
+            *handle = 0;
+            *status = status_$network_bad_node_query;
+            return;
+        }
+        ASKNODE_$QUERY_START(&start->req_type, &start->param, buffer,
+                             &start->n_nodes, &start->window, handle, status);
+        break;
+
+    case ASKNODE_QUERY_CMD_NEXT:
+        next = (asknode_$query_next_t *)param;
+        next->more = ASKNODE_$QUERY_NEXT(handle, &next->node_id,
+                                         &next->resp_len, buffer,
+                                         &next->node_status, status);
+        break;
+
+    case ASKNODE_QUERY_CMD_END:
+        ASKNODE_$QUERY_END(handle);
+        *status = status_$ok;
+        break;
+
+    default:
+        *status = status_$network_bad_node_query;
+        break;
+    }
+}
@@ -0,0 +1,740 @@
+/*
+ * Unit tests for ASKNODE_$QUERY_START / _NEXT / _END
+ *
+ * Tests that every node is reported once, that no more requests are
+ * outstanding than the window and the socket has room for all their
+ * replies, and that retries, missing nodes, the local node, quits and the
+ * cache behave, also through ASKNODE_$QUERY_CNTL, and that a reply's
+ * header is read before it is given back.  Linked against query.c and
+ * cache.c; the socket, packet,
+ * hint and event count calls are mocked by a small simulated network in
+ * which each node answers after its own latency, or not at all, and the
+ * clock only moves when the query waits.
+ *
+ * Packet header addresses are kept in 32 bits, so the tests map the
+ * headers at a fixed low address (TEST_HDR_MAP) before use, and the node
+ * list passed to ASKNODE_$QUERY_CNTL in user space (TEST_LIST_MAP).
+ */
+
+#include "asknode/asknode_internal.h"
+#include "svc/svc.h"
+
+#define TEST_LIST_MAP   0x00A00000
+#define TEST_HDR_MAP    0x32000000
+#define TEST_HDR_SIZE   1024
+#define TEST_HDRS       64
+
+/*
+ * Host mmap; <sys/mman.h> clashes with base.h's size_t.  Flags are the
+ * Linux values (PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_FIXED|MAP_ANONYMOUS).
+ */
+extern void *mmap(void *addr, unsigned long len, int prot, int flags,
+                  int fd, long off);
+#define TEST_PROT_RW    0x03
+#define TEST_MAP_FLAGS  0x32
+
+#define TEST_NODES      256
+#define TEST_PENDING    256
+#define TEST_ME         0x1234
+#define TEST_MS_PER_TICK 250    /* TIME_$CLOCKH */
+#define TEST_FAILED     (status_$network_remote_node_failed_to_respond | 0x80000000)
+
+/* Storage normally defined in the network, proc1, fim and sock data files */
+uint16_t PROC1_$AS_ID;
+uint32_t NODE_$ME;
+uint32_t TIME_$CLOCKH;
+uid_t UID_$NIL;
+ec_$eventcount_t FIM_$QUIT_EC[8];
+uint32_t FIM_$QUIT_VALUE[8];
+ec_$eventcount_t *SOCK_$EVENT_COUNTERS[64];
+uint8_t NETWORK_$CAPABLE_FLAGS;
+uint16_t ASKNODE_$PROTOCOL_VERSION;
+uint8_t ASKNODE_$EMPTY_DATA;
+uint32_t PKT_$DEFAULT_INFO[8];
+
+/* Mock state tracking */
+static struct {
+    int32_t latency_ms;         /* -1: down */
+    int drop_first;             /* Ignore the first request */
+    int missing;                /* PKT_$RECENTLY_MISSING */
+    int requests;
+    int samples;
+    int timeouts;
+} mock_node[TEST_NODES];
+
+static struct {
+    uint32_t at_ms;
+    uint32_t node;
+    uint16_t sock;
+    int16_t id;
+    uint16_t req_type;
+} mock_pending[TEST_PENDING];
+static int mock_n_pending;
+
+static ec_$eventcount_t mock_sock_ec[64];
+static int mock_sock_open[64];
+static uint16_t mock_sock_depth;    /* Queue depth of the last socket */
+static uint32_t mock_ms;
+static int mock_sends;
+static int mock_answered;           /* Replies received */
+static int mock_in_flight;          /* Sent to live nodes, not received */
+static int mock_max_in_flight;
+static int mock_hdrs_out;           /* Headers received not yet returned */
+static uint16_t mock_data_len;      /* Data bytes each reply carries */
+static int mock_dumps;
+static int16_t mock_dump_len;       /* Length given to PKT_$DUMP_DATA */
+static int16_t mock_next_id = 1;
+static int mock_quit_at_wait;
+static int mock_waits;
+static uid_t mock_info_param;       /* Last parameter to INTERNET_INFO */
+
+ml_$spin_token_t ML_$SPIN_LOCK(void *lockp) { (void)lockp; return 0; }
+void ML_$SPIN_UNLOCK(void *lockp, ml_$spin_token_t token) { (void)lockp; (void)token; }
+void OS_$DATA_COPY(const void *src, void *dst, uint32_t len) { memcpy(dst, src, len); }
+
+int8_t SOCK_$ALLOCATE(uint16_t *sock_ret, uint32_t proto_bufpages, uint32_t max_queue)
+{
+    uint16_t i;
+
+    (void)max_queue;
+    for (i = 32; i < 64; i++) {
+        if (!mock_sock_open[i]) {
+            mock_sock_open[i] = 1;
+            SOCK_$EVENT_COUNTERS[i] = &mock_sock_ec[i];
+            mock_sock_depth = (uint16_t)(proto_bufpages >> 16);
+            *sock_ret = i;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void SOCK_$CLOSE(uint16_t sock_num) { mock_sock_open[sock_num] = 0; }
+
+int16_t PKT_$NEXT_ID(void) { return mock_next_id++; }
+uint32_t PKT_$RTT_STAMP(void) { return mock_ms; }
+void PKT_$RTT_SAMPLE(uint32_t node_id, uint32_t sent_stamp) { (void)sent_stamp; mock_node[node_id % TEST_NODES].samples++; }
+void PKT_$RTT_NOTE_TIMEOUT(uint32_t node_id) { mock_node[node_id % TEST_NODES].timeouts++; }
+uint16_t PKT_$RTT_TIMEOUT(uint32_t node_id) { (void)node_id; return 4; }
+int8_t PKT_$RECENTLY_MISSING(uint32_t node_id) { return mock_node[node_id % TEST_NODES].missing ? -1 : 0; }
+
+void PKT_$NOTE_VISIBLE(uint32_t node_id, int8_t is_visible)
+{
+    if (is_visible >= 0) {
+        mock_node[node_id % TEST_NODES].missing = 1;
+    }
+}
+
+int16_t HINT_$GET_HINTS(uid_t *file_uid, uint32_t *addresses)
+{
+    (void)file_uid;
+    addresses[0] = 0;
+    return 1;
+}
+
+void HINT_$ADDI(uid_t *uid_ptr, uint32_t *addresses) { (void)uid_ptr; (void)addresses; }
+
+void PKT_$SEND_INTERNET(uint32_t routing_key, uint32_t dest_node, uint16_t dest_sock,
+                        int32_t src_node_or, uint32_t src_node, uint16_t src_sock,
+                        void *pkt_info, uint16_t request_id,
+                        void *template, uint16_t template_len,
+                        void *data, int16_t data_len,
+                        uint16_t *len_out, void *extra, status_$t *status_ret)
+{
+    int n = dest_node % TEST_NODES;
+
+    (void)routing_key; (void)dest_sock; (void)src_node_or; (void)src_node;
+    (void)pkt_info; (void)template_len; (void)data; (void)data_len;
+
+    mock_sends++;
+    mock_node[n].requests++;
+    *len_out = 1;
+    *(uint16_t *)extra = 0;
+    *status_ret = status_$ok;
+
+    if (mock_node[n].latency_ms < 0 ||
+        (mock_node[n].drop_first && mock_node[n].requests == 1)) {
+        return;
+    }
+    mock_pending[mock_n_pending].at_ms = mock_ms + mock_node[n].latency_ms;
+    mock_pending[mock_n_pending].node = dest_node;
+    mock_pending[mock_n_pending].sock = src_sock;
+    mock_pending[mock_n_pending].id = (int16_t)request_id;
+    mock_pending[mock_n_pending].req_type = ((uint16_t *)template)[1];
+    mock_n_pending++;
+    if (++mock_in_flight > mock_max_in_flight) {
+        mock_max_in_flight = mock_in_flight;
+    }
+}
+
+/* Each receive gets a header buffer of its own in the mapped area */
+void APP_$RECEIVE(uint16_t sock_num, void *result, status_$t *status_ret)
+{
+    pkt_$recv_t *recv = result;
+    uint8_t *hdr;
+    uint32_t *tpl;
+    int i;
+
+    for (i = 0; i < mock_n_pending; i++) {
+        if (mock_pending[i].sock == sock_num && mock_pending[i].at_ms <= mock_ms) {
+            break;
+        }
+    }
+    if (i == mock_n_pending) {
+        *status_ret = 0x00110006;
+        return;
+    }
+
+    hdr = (uint8_t *)(uintptr_t)TEST_HDR_MAP +
+          (mock_hdrs_out++ % TEST_HDRS) * TEST_HDR_SIZE;
+    memset(hdr, 0, TEST_HDR_SIZE);
+    *(uint16_t *)(hdr + 2) = 0x20;
+    *(uint16_t *)(hdr + 4) = mock_data_len;
+    *(int16_t *)(hdr + 6) = mock_pending[i].id;
+    tpl = (uint32_t *)(hdr + 0x100);
+    tpl[0] = ((uint32_t)3 << 16) | (uint16_t)(mock_pending[i].req_type + 1);
+    tpl[1] = status_$ok;
+    tpl[2] = mock_pending[i].node ^ 0x5A5A0000;
+    tpl[3] = mock_pending[i].req_type;
+
+    recv->hdr_ptr = (uint32_t)(uintptr_t)hdr;
+    recv->data_ptr = (char *)tpl;
+    memset(recv->data_bufs, 0, sizeof(recv->data_bufs));
+    if (mock_data_len != 0) {
+        recv->data_bufs[0] = 0x1000;
+    }
+
+    mock_pending[i] = mock_pending[--mock_n_pending];
+    mock_answered++;
+    mock_in_flight--;
+    *status_ret = status_$ok;
+}
+
+void PKT_$DUMP_DATA(uint32_t *buffers, int16_t len) { (void)buffers; mock_dumps++; mock_dump_len = len; }
+
+void NETBUF_$RTN_HDR(uint32_t *va_ptr)
+{
+    mock_hdrs_out--;
+    /* Anything still to be read from it is gone */
+    memset((void *)(uintptr_t)*va_ptr, 0xA5, TEST_HDR_SIZE);
+}
+
+uint16_t EC_$WAITN(ec_$eventcount_t **ecs, int32_t *wait_val, int16_t num_ecs)
+{
+    uint32_t next_ms;
+    int i;
+
+    (void)num_ecs;
+    if (mock_waits++ == mock_quit_at_wait) {
+        ecs[2]->value = wait_val[2];
+    }
+    if (ecs[2]->value >= wait_val[2]) {
+        return 3;
+    }
+
+    /* Move the clock to the next arrival or the timer, whichever is first */
+    next_ms = (uint32_t)wait_val[1] * TEST_MS_PER_TICK;
+    for (i = 0; i < mock_n_pending; i++) {
+        if (mock_pending[i].at_ms < next_ms) {
+            next_ms = mock_pending[i].at_ms;
+        }
+    }
+    if (next_ms > mock_ms) {
+        mock_ms = next_ms;
+    }
+    TIME_$CLOCKH = mock_ms / TEST_MS_PER_TICK;
+    for (i = 0; i < mock_n_pending; i++) {
+        if (mock_pending[i].at_ms <= mock_ms) {
+            ecs[0]->value++;
+            return 1;
+        }
+    }
+    return 2;
+}
+
+uint32_t ASKNODE_$INTERNET_INFO(uint16_t *req_type, uint32_t *node_id,
+                                int32_t *req_len, uid_t *param,
+                                uint16_t *resp_len, uint32_t *result,
+                                status_$t *status)
+{
+    (void)req_len;
+    mock_info_param = *param;
+    result[0] = (result[0] & 0xFFFF0000) | (uint16_t)(*req_type + 1);
+    result[1] = status_$ok;
+    result[2] = *node_id ^ 0x5A5A0000;
+    *resp_len = 0x20;
+    *status = status_$ok;
+    return 0;
+}
+
+uint16_t asknode_$pack_request(uint16_t request, uid_t *param, uint16_t *req_buf)
+{
+    memset(req_buf, 0, ASKNODE_REQUEST_LEN);
+    req_buf[0] = 3;
+    req_buf[1] = request;
+    req_buf[4] = (uint16_t)(param->high >> 16);
+    req_buf[5] = (uint16_t)param->high;
+    return 0;
+}
+
+static uint32_t test_nodes[TEST_NODES];
+static status_$t got_status[TEST_NODES];
+static int got_count[TEST_NODES];
+
+static void reset_mocks(void)
+{
+    static int mapped;
+    int i;
+
+    if (!mapped) {
+        mmap((void *)TEST_HDR_MAP, TEST_HDRS * TEST_HDR_SIZE, TEST_PROT_RW,
+             TEST_MAP_FLAGS, -1, 0);
+        mmap((void *)TEST_LIST_MAP, TEST_NODES * 4, TEST_PROT_RW,
+             TEST_MAP_FLAGS, -1, 0);
+        mapped = 1;
+    }
+    memset(mock_node, 0, sizeof(mock_node));
+    memset(got_count, 0, sizeof(got_count));
+    for (i = 0; i < TEST_NODES; i++) {
+        asknode_$cache_forget(i);
+    }
+    mock_n_pending = 0;
+    mock_ms = 0;
+    mock_sends = 0;
+    mock_answered = 0;
+    mock_in_flight = 0;
+    mock_max_in_flight = 0;
+    mock_hdrs_out = 0;
+    mock_data_len = 0;
+    mock_dumps = 0;
+    mock_dump_len = -1;
+    mock_sock_depth = 0;
+    mock_quit_at_wait = -1;
+    mock_waits = 0;
+    TIME_$CLOCKH = 0;
+    NODE_$ME = TEST_ME;
+    NETWORK_$CAPABLE_FLAGS = 1;
+    PROC1_$AS_ID = 3;
+    FIM_$QUIT_EC[PROC1_$AS_ID].value = 0;
+    FIM_$QUIT_VALUE[PROC1_$AS_ID] = 0;
+}
+
+/* Nodes 1..n, latencies 5-80 ms, every down'th node down */
+static uint16_t make_network(uint16_t n, int down)
+{
+    uint16_t i;
+
+    for (i = 0; i < n; i++) {
+        test_nodes[i] = i + 1;
+        mock_node[i + 1].latency_ms = 5 + (i * 37) % 76;
+        if (down != 0 && (i % down) == down - 1) {
+            mock_node[i + 1].latency_ms = -1;
+        }
+    }
+    return n;
+}
+
+/* Query every node; returns the number reported, or -1 on a bad result */
+static int sweep(uint16_t req_type, uint16_t n, uint16_t window, uid_t *param)
+{
+    uint16_t handle;
+    uint32_t result[ASKNODE_MAX_RESPONSE_LEN / 4];
+    uint16_t resp_len = sizeof(result);
+    uint32_t node;
+    status_$t node_status;
+    status_$t status;
+    int reported = 0;
+
+    ASKNODE_$QUERY_START(&req_type, param, test_nodes, &n, &window, &handle, &status);
+    if (status != status_$ok) {
+        return -1;
+    }
+    while (ASKNODE_$QUERY_NEXT(&handle, &node, &resp_len, result,
+                               &node_status, &status) < 0) {
+        got_count[node % TEST_NODES]++;
+        got_status[node % TEST_NODES] = node_status;
+        if (node_status == status_$ok && result[2] != (node ^ 0x5A5A0000)) {
+            return -1;
+        }
+        reported++;
+    }
+    ASKNODE_$QUERY_END(&handle);
+    return (status == status_$ok) ? reported : -1;
+}
+
+static uid_t no_param = { 0, 0 };
+
+/*
+ * Test: Sweep of 200 nodes, 10 of them down
+ * Expected: Every node reported exactly once; live nodes asked once and
+ * down nodes ASKNODE_QUERY_TRIES times before failing; every header
+ * buffer returned
+ */
+void test_query_all_reported_once(void)
+{
+    uint16_t n;
+    int i;
+
+    reset_mocks();
+    n = make_network(200, 20);
+
+    ASSERT_EQ(sweep(ASKNODE_REQ_STATS, n, 0, &no_param), 200);
+    for (i = 1; i <= 200; i++) {
+        ASSERT_EQ(got_count[i], 1);
+        if (mock_node[i].latency_ms < 0) {
+            ASSERT_EQ(got_status[i], TEST_FAILED);
+            ASSERT_EQ(mock_node[i].requests, ASKNODE_QUERY_TRIES);
+        } else {
+            ASSERT_EQ(got_status[i], status_$ok);
+            ASSERT_EQ(mock_node[i].requests, 1);
+        }
+    }
+    ASSERT_EQ(mock_hdrs_out, 0);
+}
+
+/*
+ * Test: Window
+ * Expected: No more requests outstanding than the window, clamped to
+ * ASKNODE_QUERY_WINDOW_MAX, and the socket queue holds a reply to each
+ */
+void test_query_window_respected(void)
+{
+    uint16_t n;
+
+    reset_mocks();
+    n = make_network(100, 0);
+    ASSERT_EQ(sweep(ASKNODE_REQ_STATS, n, 5, &no_param), 100);
+    ASSERT_EQ(mock_max_in_flight, 5);
+    ASSERT_EQ(mock_sock_depth, 5);
+
+    reset_mocks();
+    n = make_network(100, 0);
+    ASSERT_EQ(sweep(ASKNODE_REQ_STATS, n, 0, &no_param), 100);
+    ASSERT_EQ(mock_max_in_flight <= ASKNODE_QUERY_WINDOW, 1);
+    ASSERT_EQ(mock_sock_depth, ASKNODE_QUERY_WINDOW);
+
+    reset_mocks();
+    n = make_network(100, 0);
+    ASSERT_EQ(sweep(ASKNODE_REQ_STATS, n, 100, &no_param), 100);
+    ASSERT_EQ(mock_max_in_flight <= ASKNODE_QUERY_WINDOW_MAX, 1);
+    ASSERT_EQ(mock_sock_depth, ASKNODE_QUERY_WINDOW_MAX);
+}
+
+/*
+ * Test: A lost request
+ * Expected: Resent once and answered; the timeout is noted and the
+ * ambiguous round trip is not sampled
+ */
+void test_query_retry_then_answer(void)
+{
+    reset_mocks();
+    make_network(3, 0);
+    mock_node[2].drop_first = 1;
+
+    ASSERT_EQ(sweep(ASKNODE_REQ_STATS, 3, 0, &no_param), 3);
+    ASSERT_EQ(got_status[2], status_$ok);
+    ASSERT_EQ(mock_node[2].requests, 2);
+    ASSERT_EQ(mock_node[2].timeouts, 1);
+    ASSERT_EQ(mock_node[2].samples, 0);
+    ASSERT_EQ(mock_node[1].samples, 1);
+}
+
+/*
+ * Test: A node PKT knows to be missing
+ * Expected: Failed without going on the wire
+ */
+void test_query_missing_fails_fast(void)
+{
+    reset_mocks();
+    make_network(4, 0);
+    mock_node[3].missing = 1;
+
+    ASSERT_EQ(sweep(ASKNODE_REQ_STATS, 4, 0, &no_param), 4);
+    ASSERT_EQ(mock_node[3].requests, 0);
+    ASSERT_EQ(got_status[3], TEST_FAILED);
+}
+
+/*
+ * Test: The local node in the list
+ * Expected: Answered by ASKNODE_$INTERNET_INFO with the caller's whole
+ * parameter, without going on the wire
+ */
+void test_query_local_node(void)
+{
+    uid_t param = { 0x00012345, 0x00000077 };
+
+    reset_mocks();
+    make_network(3, 0);
+    test_nodes[1] = TEST_ME;
+
+    ASSERT_EQ(sweep(ASKNODE_REQ_STATS, 3, 0, &param), 3);
+    ASSERT_EQ(got_count[TEST_ME % TEST_NODES], 1);
+    ASSERT_EQ(got_status[TEST_ME % TEST_NODES], status_$ok);
+    ASSERT_EQ(mock_sends, 2);
+    ASSERT_EQ(mock_info_param.high, param.high);
+    ASSERT_EQ(mock_info_param.low, param.low);
+}
+
+/*
+ * Test: Cacheable request asked twice
+ * Expected: The second sweep is answered from the cache (down nodes are
+ * by then missing); uncacheable and expired answers go on the wire
+ */
+void test_query_cache_saves_requests(void)
+{
+    uint16_t n;
+
+    reset_mocks();
+    n = make_network(50, 10);
+    ASSERT_EQ(sweep(ASKNODE_REQ_BUILD_TIME, n, 0, &no_param), 50);
+    ASSERT_EQ(mock_sends, 45 + 5 * ASKNODE_QUERY_TRIES);
+
+    mock_sends = 0;
+    ASSERT_EQ(sweep(ASKNODE_REQ_BUILD_TIME, n, 0, &no_param), 50);
+    ASSERT_EQ(mock_sends, 0);
+    ASSERT_EQ(got_status[1], status_$ok);
+
+    /* Not cacheable */
+    ASSERT_EQ(sweep(ASKNODE_REQ_STATS, n, 0, &no_param), 50);
+    ASSERT_EQ(mock_sends, 45);
+
+    /* Expired */
+    mock_sends = 0;
+    mock_ms += (ASKNODE_CACHE_TTL + 1) * TEST_MS_PER_TICK;
+    TIME_$CLOCKH = mock_ms / TEST_MS_PER_TICK;
+    ASSERT_EQ(sweep(ASKNODE_REQ_BUILD_TIME, n, 0, &no_param), 50);
+    ASSERT_EQ(mock_sends, 45);
+}
+
+/*
+ * Test: Cache lookups and stores
+ * Expected: Hits need the same node, request and parameter; short
+ * buffers are not overrun; oversize answers are not kept; forgotten
+ * nodes miss; the most recent entries survive filling past capacity
+ */
+void test_query_cache_unit(void)
+{
+    uint32_t data[ASKNODE_CACHE_DATA_MAX / 4];
+    uint32_t out[ASKNODE_CACHE_DATA_MAX / 4];
+    uint16_t len;
+    uint32_t node;
+    int hits;
+
+    reset_mocks();
+    memset(data, 0xAB, sizeof(data));
+
+    asknode_$cache_store(7, ASKNODE_REQ_DISK_INFO, 1, data, 0x40);
+    ASSERT_EQ(asknode_$cache_lookup(7, ASKNODE_REQ_DISK_INFO, 1, out,
+                                    sizeof(out), &len) < 0, 1);
+    ASSERT_EQ(len, 0x40);
+    ASSERT_EQ(memcmp(out, data, 0x40), 0);
+    ASSERT_EQ(asknode_$cache_lookup(7, ASKNODE_REQ_DISK_INFO, 2, out,
+                                    sizeof(out), &len), 0);
+    ASSERT_EQ(asknode_$cache_lookup(7, ASKNODE_REQ_DISK_INFO, 1, out,
+                                    0x10, &len) < 0, 1);
+    ASSERT_EQ(len, 0x10);
+
+    asknode_$cache_store(8, ASKNODE_REQ_DISK_INFO, 1, data,
+                         ASKNODE_CACHE_DATA_MAX + 4);
+    ASSERT_EQ(asknode_$cache_lookup(8, ASKNODE_REQ_DISK_INFO, 1, out,
+                                    sizeof(out), &len), 0);
+
+    asknode_$cache_forget(7);
+    ASSERT_EQ(asknode_$cache_lookup(7, ASKNODE_REQ_DISK_INFO, 1, out,
+                                    sizeof(out), &len), 0);
+
+    for (node = 1; node <= 1000; node++) {
+        TIME_$CLOCKH = node;
+        asknode_$cache_store(node, ASKNODE_REQ_NODE_UID, 0, data, 0x20);
+    }
+    hits = 0;
+    for (node = 1000 - 99; node <= 1000; node++) {
+        if (asknode_$cache_lookup(node, ASKNODE_REQ_NODE_UID, 0, out,
+                                  sizeof(out), &len) < 0) {
+            hits++;
+        }
+    }
+    ASSERT_EQ(hits >= 90, 1);
+}
+
+/*
+ * Test: Quit while waiting
+ * Expected: QUERY_NEXT stops with the quit status, consumes the quit and
+ * END closes the socket
+ */
+void test_query_quit(void)
+{
+    uint16_t handle;
+    uint16_t req_type = ASKNODE_REQ_STATS;
+    uint16_t n;
+    uint16_t window = 0;
+    uint32_t result[ASKNODE_MAX_RESPONSE_LEN / 4];
+    uint16_t resp_len = sizeof(result);
+    uint32_t node;
+    status_$t node_status;
+    status_$t status;
+    int i;
+
+    reset_mocks();
+    n = make_network(50, 0);
+    mock_quit_at_wait = 2;
+
+    ASKNODE_$QUERY_START(&req_type, &no_param, test_nodes, &n, &window,
+                         &handle, &status);
+    ASSERT_EQ(status, status_$ok);
+    while (ASKNODE_$QUERY_NEXT(&handle, &node, &resp_len, result,
+                               &node_status, &status) < 0) {
+    }
+    ASSERT_EQ(status, status_$network_quit_fault_during_node_listing);
+    ASSERT_EQ(FIM_$QUIT_VALUE[PROC1_$AS_ID],
+              (uint32_t)FIM_$QUIT_EC[PROC1_$AS_ID].count);
+
+    ASKNODE_$QUERY_END(&handle);
+    for (i = 32; i < 64; i++) {
+        ASSERT_EQ(mock_sock_open[i], 0);
+    }
+}
+
+/*
+ * Test: Query handles
+ * Expected: Unsupported requests and a full table are refused; another
+ * process cannot use a handle; an idle query is reclaimed; no socket leaks
+ */
+void test_query_handles(void)
+{
+    uint16_t handle[3];
+    uint16_t req_type;
+    uint16_t n = 1;
+    uint16_t window = 0;
+    uint32_t result[8];
+    uint16_t resp_len = sizeof(result);
+    uint32_t node;
+    status_$t node_status;
+    status_$t status;
+    int i;
+
+    reset_mocks();
+    make_network(1, 0);
+
+    req_type = ASKNODE_REQ_LOG_READ;
+    ASKNODE_$QUERY_START(&req_type, &no_param, test_nodes, &n, &window,
+                         &handle[0], &status);
+    ASSERT_EQ(status, status_$network_bad_node_query);
+
+    req_type = ASKNODE_REQ_STATS;
+    for (i = 0; i < ASKNODE_QUERY_MAX; i++) {
+        ASKNODE_$QUERY_START(&req_type, &no_param, test_nodes, &n, &window,
+                             &handle[i], &status);
+        ASSERT_EQ(status, status_$ok);
+    }
+    ASKNODE_$QUERY_START(&req_type, &no_param, test_nodes, &n, &window,
+                         &handle[2], &status);
+    ASSERT_EQ(status, status_$network_too_many_node_queries);
+
+    PROC1_$AS_ID = 4;
+    ASSERT_EQ(ASKNODE_$QUERY_NEXT(&handle[0], &node, &resp_len, result,
+                                  &node_status, &status), 0);
+    ASSERT_EQ(status, status_$network_bad_node_query);
+    PROC1_$AS_ID = 3;
+
+    TIME_$CLOCKH += ASKNODE_QUERY_IDLE;
+    ASKNODE_$QUERY_START(&req_type, &no_param, test_nodes, &n, &window,
+                         &handle[2], &status);
+    ASSERT_EQ(status, status_$ok);
+
+    ASKNODE_$QUERY_END(&handle[1]);
+    ASKNODE_$QUERY_END(&handle[2]);
+    for (i = 32; i < 64; i++) {
+        ASSERT_EQ(mock_sock_open[i], 0);
+    }
+}
+
+/*
+ * Test: Replies carrying data pages
+ * Expected: Every node still reported, and the pages are dumped with the
+ * length the header gave, read before the header went back
+ */
+void test_query_reply_with_data(void)
+{
+    uint16_t n;
+
+    reset_mocks();
+    n = make_network(4, 0);
+    mock_data_len = 0x400;
+
+    ASSERT_EQ(sweep(ASKNODE_REQ_STATS, n, 0, &no_param), 4);
+    ASSERT_EQ(mock_dumps, 4);
+    ASSERT_EQ(mock_dump_len, 0x400);
+    ASSERT_EQ(mock_hdrs_out, 0);
+}
+
+/*
+ * Test: A sweep through ASKNODE_$QUERY_CNTL, then a command it does not
+ * know and a node list reaching past user space
+ * Expected: Every node reported once, as by the calls themselves; the
+ * others refused with status_$network_bad_node_query and no socket taken
+ */
+void test_query_cntl(void)
+{
+    uint32_t *list = (uint32_t *)(uintptr_t)TEST_LIST_MAP;
+    uint32_t result[ASKNODE_MAX_RESPONSE_LEN / 4];
+    asknode_$query_start_t start;
+    asknode_$query_next_t next;
+    uint16_t cmd;
+    uint16_t handle;
+    status_$t status;
+    int reported = 0;
+    uint16_t i;
+
+    reset_mocks();
+    make_network(50, 10);
+    for (i = 0; i < 50; i++) {
+        list[i] = test_nodes[i];
+    }
+
+    memset(&start, 0, sizeof(start));
+    start.req_type = ASKNODE_REQ_STATS;
+    start.n_nodes = 50;
+    cmd = ASKNODE_QUERY_CMD_START;
+    ASKNODE_$QUERY_CNTL(&cmd, &handle, &start, list, &status);
+    ASSERT_EQ(status, status_$ok);
+
+    cmd = ASKNODE_QUERY_CMD_NEXT;
+    for (;;) {
+        next.resp_len = sizeof(result);
+        ASKNODE_$QUERY_CNTL(&cmd, &handle, &next, result, &status);
+        if (next.more >= 0) {
+            break;
+        }
+        got_count[next.node_id % TEST_NODES]++;
+        if (next.node_status == status_$ok) {
+            ASSERT_EQ(result[2], next.node_id ^ 0x5A5A0000);
+        }
+        reported++;
+    }
+    ASSERT_EQ(status, status_$ok);
+    ASSERT_EQ(reported, 50);
+    for (i = 1; i <= 50; i++) {
+        ASSERT_EQ(got_count[i], 1);
+    }
+
+    cmd = ASKNODE_QUERY_CMD_END;
+    ASKNODE_$QUERY_CNTL(&cmd, &handle, NULL, NULL, &status);
+    ASSERT_EQ(status, status_$ok);
+    ASSERT_EQ(handle, 0);
+
+    cmd = 7;
+    ASKNODE_$QUERY_CNTL(&cmd, &handle, NULL, NULL, &status);
+    ASSERT_EQ(status, status_$network_bad_node_query);
+
+    cmd = ASKNODE_QUERY_CMD_START;
+    start.n_nodes = 8;
+    ASKNODE_$QUERY_CNTL(&cmd, &handle,
+                        &start, (uint32_t *)(uintptr_t)(SVC_USER_SPACE_LIMIT - 16),
+                        &status);
+    ASSERT_EQ(status, status_$network_bad_node_query);
+    ASSERT_EQ(handle, 0);
+    for (i = 32; i < 64; i++) {
+        ASSERT_EQ(mock_sock_open[i], 0);
+    }
+}
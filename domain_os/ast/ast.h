@@ -361,6 +361,38 @@ void AST_$SET_ATTR(uid_t *uid, int16_t attr_id, uint32_t value, uint8_t flags,
                    uint32_t *clock, status_$t *status);
 void AST_$GET_DTV(uid_t *uid, uint32_t unused, uint32_t *dtv,
                   status_$t *status);
+
+/*
+ * Vectored attribute updates
+ *
+ * AST_$SET_ATTRIBUTES applies a list of attribute changes, to one object
+ * or many, under a single AST lock acquisition with one clock reading.
+ * Each entry gets its own status; the call's status is the first failure.
+ *
+ * AST_$DEFER_ATTRIBUTE queues a timestamp change (DTM/DTU forms) for a
+ * local object.  Repeated changes to the same field of an object
+ * coalesce into one, and the queue is applied in a batch by AST_$UPDATE,
+ * when it fills, or before the object's attributes are read.  Each entry
+ * keeps the clock of the change that queued it.  An update that fails
+ * when the queue is applied is reported to the next AST_$DEFER_ATTRIBUTE
+ * or AST_$FLUSH_DEFERRED for that object.
+ */
+typedef struct ast_$attr_update_t {
+  uid_t uid;          /* 0x00: Object */
+  uint16_t attr_id;   /* 0x08: Attribute type */
+  uint16_t pad;       /* 0x0A */
+  uint32_t value[2];  /* 0x0C: Attribute value (up to 8 bytes) */
+  status_$t status;   /* 0x14: Per-entry result */
+  clock_t clock;      /* 0x18: Time of the change; zero for now */
+} ast_$attr_update_t;
+
+#define AST_DEFER_MAX 16 /* Pending timestamp updates */
+
+void AST_$SET_ATTRIBUTES(ast_$attr_update_t *updates, uint16_t count,
+                         status_$t *status);
+void AST_$DEFER_ATTRIBUTE(uid_t *uid, uint16_t attr_id, void *value,
+                          status_$t *status);
+void AST_$FLUSH_DEFERRED(uid_t *uid, status_$t *status);
 uint8_t AST_$SET_DTS(uint16_t flags, uid_t *uid, uint32_t *dtv,
                      uint32_t *access_time, status_$t *status);
 
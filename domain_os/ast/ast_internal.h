@@ -57,6 +57,11 @@ extern void AST_$DEACTIVATE_SEGMENT(aste_t *aste, uint32_t flags, status_$t *sta
 void AST_$SET_ATTR_DISPATCH(aote_t *aote, uint16_t attr_type, void *value,
                             int8_t wait_flag, clock_t *clock_info, status_$t *status);
 
+/* Locked part of the dispatch; caller holds AST_LOCK_ID throughout */
+int8_t ast_$apply_attr(aote_t *aote, uint16_t attr_type, void *value,
+                       clock_t *clock_info, uid_t *old_acl_out,
+                       uid_t *new_acl_out, status_$t *status);
+
 /*
  * Internal helper functions
  */
@@ -136,6 +141,9 @@ void ast_$set_attribute_internal(uid_t *uid, uint16_t attr_type, void *value,
                                  int8_t wait_flag, void *exsid_info,
                                  clock_t *clock_info, status_$t *status);
 
+/* Initialize the deferred timestamp queue (from AST_$INIT) */
+void ast_$defer_init(void);
+
 /* Validate UID and return status */
 status_$t ast_$validate_uid(uid_t *uid, uint32_t flags);
 
@@ -0,0 +1,271 @@
+/*
+ * AST_$DEFER_ATTRIBUTE / AST_$FLUSH_DEFERRED - Coalesced timestamp updates
+ *
+ * Every small write to a local file ends in a DTM (or DTU) update, and
+ * each one used to take the AST lock to store a few bytes in the AOTE
+ * that AST_$UPDATE would write back later anyway.  Those updates are now
+ * queued here instead: a later update to the same field of the same
+ * object replaces the queued one, and the queue is applied as a single
+ * AST_$SET_ATTRIBUTES batch.
+ *
+ * The queue is flushed by AST_$UPDATE and AST_$DISMOUNT, when it fills,
+ * and by the attribute readers when the object they read is queued, so
+ * nothing observes an older timestamp than before.  A flush empties the
+ * queue before applying it, so flushes are serialized and a reader that
+ * finds one in flight waits for it: its object may be in that batch.  Each entry carries
+ * the clock of the change that queued it, so the change time recorded
+ * is the write's, not the flush's.
+ *
+ * An update that still fails once the queue is applied is remembered
+ * for its object and returned by the next AST_$DEFER_ATTRIBUTE or
+ * AST_$FLUSH_DEFERRED naming it, the way a failed write-back surfaces
+ * on a later call.
+ */
+
+#include "ast/ast_internal.h"
+#include "time/time.h"
+
+/* Timestamp fields an attribute type updates */
+#define DEFER_FIELD_NONE 0
+#define DEFER_FIELD_DTM 1
+#define DEFER_FIELD_DTU 2
+
+static ast_$attr_update_t ast_$deferred[AST_DEFER_MAX];
+static uint16_t ast_$deferred_count;
+static uint16_t ast_$defer_lock;
+
+/* Held from taking a batch off the queue until it has been applied */
+static ml_$exclusion_t ast_$defer_flush_lock;
+
+/* Failed updates not yet reported; status_$ok marks a free slot */
+static ast_$attr_update_t ast_$defer_failed[AST_DEFER_MAX];
+static uint16_t ast_$defer_failed_next;
+
+static int8_t ast_$defer_field(uint16_t attr_id)
+{
+    switch (attr_id) {
+    case FILE_ATTR_DTM_OLD:
+    case FILE_ATTR_DTM_CURRENT:
+        return DEFER_FIELD_DTM;
+    case FILE_ATTR_DTU_FULL:
+        return DEFER_FIELD_DTU;
+    default:
+        return DEFER_FIELD_NONE;
+    }
+}
+
+/*
+ * Objects without the extended timestamp forms take the whole-second
+ * form instead, rounded up, as FILE_$SET_DTM_F and FILE_$SET_DTU_F do.
+ */
+static uint16_t ast_$defer_fallback(ast_$attr_update_t *u)
+{
+    if ((u->value[1] >> 16) != 0) {
+        u->value[0]++;
+    }
+    return (ast_$defer_field(u->attr_id) == DEFER_FIELD_DTU) ?
+           FILE_ATTR_DTU_AST : FILE_ATTR_DTM_AST;
+}
+
+/*
+ * Remember a failed update for its object, replacing an older failure
+ * for the same object.  When every slot is taken the oldest is lost.
+ */
+static void ast_$defer_fail(ast_$attr_update_t *u)
+{
+    ml_$spin_token_t token;
+    ast_$attr_update_t *f;
+    uint16_t i;
+
+    token = ML_$SPIN_LOCK(&ast_$defer_lock);
+    for (i = 0; i < AST_DEFER_MAX; i++) {
+        f = &ast_$defer_failed[i];
+        if (f->status != status_$ok && f->uid.high == u->uid.high &&
+            f->uid.low == u->uid.low) {
+            break;
+        }
+    }
+    if (i == AST_DEFER_MAX) {
+        f = &ast_$defer_failed[ast_$defer_failed_next];
+        ast_$defer_failed_next = (ast_$defer_failed_next + 1) % AST_DEFER_MAX;
+    }
+    *f = *u;
+    ML_$SPIN_UNLOCK(&ast_$defer_lock, token);
+}
+
+/* Take the unreported failure for an object, if there is one */
+static status_$t ast_$defer_take_failure(uid_t *uid)
+{
+    ml_$spin_token_t token;
+    ast_$attr_update_t *f;
+    status_$t status = status_$ok;
+    uint16_t i;
+
+    token = ML_$SPIN_LOCK(&ast_$defer_lock);
+    for (i = 0; i < AST_DEFER_MAX; i++) {
+        f = &ast_$defer_failed[i];
+        if (f->status != status_$ok && f->uid.high == uid->high &&
+            f->uid.low == uid->low) {
+            status = f->status;
+            f->status = status_$ok;
+            break;
+        }
+    }
+    ML_$SPIN_UNLOCK(&ast_$defer_lock, token);
+    return status;
+}
+
+void ast_$defer_init(void)
+{
+    ML_$EXCLUSION_INIT(&ast_$defer_flush_lock);
+}
+
+void AST_$DEFER_ATTRIBUTE(uid_t *uid, uint16_t attr_id, void *value,
+                          status_$t *status)
+{
+    ml_$spin_token_t token;
+    ast_$attr_update_t *u;
+    clock_t *time_ptr = (clock_t *)value;
+    clock_t now;
+    status_$t flush_status;
+    int8_t field;
+    uint16_t i;
+
+    field = ast_$defer_field(attr_id);
+    if (field == DEFER_FIELD_NONE) {
+        AST_$SET_ATTRIBUTE(uid, attr_id, value, status);
+        return;
+    }
+
+    /* An earlier update to this object failed: report it, queue nothing */
+    *status = ast_$defer_take_failure(uid);
+    if (*status != status_$ok) {
+        return;
+    }
+
+    TIME_$CLOCK(&now);
+
+    for (;;) {
+        token = ML_$SPIN_LOCK(&ast_$defer_lock);
+
+        u = NULL;
+        for (i = 0; i < ast_$deferred_count; i++) {
+            if (ast_$deferred[i].uid.high == uid->high &&
+                ast_$deferred[i].uid.low == uid->low &&
+                ast_$defer_field(ast_$deferred[i].attr_id) == field) {
+                u = &ast_$deferred[i];
+                break;
+            }
+        }
+        if (u == NULL && ast_$deferred_count < AST_DEFER_MAX) {
+            u = &ast_$deferred[ast_$deferred_count++];
+            u->uid = *uid;
+        }
+
+        if (u != NULL) {
+            /* 48-bit time, laid out as a clock_t: 32-bit high, 16-bit fraction */
+            u->attr_id = attr_id;
+            u->value[0] = time_ptr->high;
+            u->value[1] = (uint32_t)time_ptr->low << 16;
+            u->clock = now;
+            ML_$SPIN_UNLOCK(&ast_$defer_lock, token);
+            return;
+        }
+
+        ML_$SPIN_UNLOCK(&ast_$defer_lock, token);
+
+        /* Other objects' failures are kept for them */
+        AST_$FLUSH_DEFERRED(NULL, &flush_status);
+    }
+}
+
+/*
+ * AST_$FLUSH_DEFERRED - Apply queued timestamp updates
+ *
+ * With a UID, only flushes if that object has something queued (and
+ * then flushes everything, since it is one batch either way), and
+ * returns the failure of any queued update to that object, including
+ * one from an earlier flush.  Without a UID, returns the first failure
+ * of this batch; every failure stays remembered for its own object.
+ * Either way a flush already in progress is waited for first.
+ */
+void AST_$FLUSH_DEFERRED(uid_t *uid, status_$t *status)
+{
+    ast_$attr_update_t batch[AST_DEFER_MAX];
+    ml_$spin_token_t token;
+    status_$t batch_status;
+    uint16_t count;
+    uint16_t retry;
+    uint16_t i;
+
+    *status = status_$ok;
+
+    /* The count is emptied only with the flush lock held */
+    if (ast_$deferred_count == 0 &&
+        ML_$EXCLUSION_CHECK(&ast_$defer_flush_lock) >= 0) {
+        goto done;
+    }
+
+    ML_$EXCLUSION_START(&ast_$defer_flush_lock);
+
+    token = ML_$SPIN_LOCK(&ast_$defer_lock);
+
+    for (i = 0; i < ast_$deferred_count; i++) {
+        if (uid == NULL || (ast_$deferred[i].uid.high == uid->high &&
+                            ast_$deferred[i].uid.low == uid->low)) {
+            break;
+        }
+    }
+    if (i == ast_$deferred_count) {
+        ML_$SPIN_UNLOCK(&ast_$defer_lock, token);
+        ML_$EXCLUSION_STOP(&ast_$defer_flush_lock);
+        goto done;
+    }
+
+    count = ast_$deferred_count;
+    for (i = 0; i < count; i++) {
+        batch[i] = ast_$deferred[i];
+    }
+    ast_$deferred_count = 0;
+
+    ML_$SPIN_UNLOCK(&ast_$defer_lock, token);
+
+    AST_$SET_ATTRIBUTES(batch, count, &batch_status);
+    if (batch_status == status_$ok) {
+        ML_$EXCLUSION_STOP(&ast_$defer_flush_lock);
+        goto done;
+    }
+
+    /*
+     * Objects that want the whole-second form get it; any other failure
+     * is remembered for its object.
+     */
+    retry = 0;
+    for (i = 0; i < count; i++) {
+        if (batch[i].status == status_$ast_incompatible_request) {
+            batch[retry] = batch[i];
+            batch[retry].attr_id = ast_$defer_fallback(&batch[retry]);
+            retry++;
+        } else if (batch[i].status != status_$ok) {
+            ast_$defer_fail(&batch[i]);
+            if (uid == NULL && *status == status_$ok) {
+                *status = batch[i].status;
+            }
+        }
+    }
+    AST_$SET_ATTRIBUTES(batch, retry, &batch_status);
+    for (i = 0; batch_status != status_$ok && i < retry; i++) {
+        if (batch[i].status != status_$ok) {
+            ast_$defer_fail(&batch[i]);
+            if (uid == NULL && *status == status_$ok) {
+                *status = batch[i].status;
+            }
+        }
+    }
+    ML_$EXCLUSION_STOP(&ast_$defer_flush_lock);
+
+done:
+    if (uid != NULL) {
+        *status = ast_$defer_take_failure(uid);
+    }
+}
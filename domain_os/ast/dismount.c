@@ -22,6 +22,10 @@ void AST_$DISMOUNT(uint16_t vol_index, uint8_t flags, status_$t *status)
 
     local_status = status_$ok;
 
+    /* A failed timestamp update is kept for its object's next caller */
+    AST_$FLUSH_DEFERRED(NULL, &local_status);
+    local_status = status_$ok;
+
     PROC1_$INHIBIT_BEGIN();
     ML_$LOCK(AST_LOCK_ID);
 
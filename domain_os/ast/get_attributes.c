@@ -36,6 +36,12 @@ void AST_$GET_ATTRIBUTES(uid_t *uid, uint16_t flags, void *attrs, status_$t *sta
         return;
     }
 
+    /* Queued timestamp updates for this object land first */
+    AST_$FLUSH_DEFERRED(uid, status);
+    if (*status != status_$ok) {
+        return;
+    }
+
     PROC1_$INHIBIT_BEGIN();
     ML_$LOCK(AST_LOCK_ID);
 
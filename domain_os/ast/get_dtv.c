@@ -20,6 +20,11 @@ void AST_$GET_DTV(uid_t *uid, uint32_t unused, uint32_t *dtv, status_$t *status)
     local_uid.low = uid->low;
     local_status = status_$ok;
 
+    AST_$FLUSH_DEFERRED(&local_uid, status);
+    if (*status != status_$ok) {
+        return;
+    }
+
     PROC1_$INHIBIT_BEGIN();
     ML_$LOCK(AST_LOCK_ID);
 
@@ -57,4 +57,6 @@ void AST_$INIT(void)
     if (status != status_$ok) {
         CRASH_SYSTEM(&status);
     }
+
+    ast_$defer_init();
 }
@@ -1,8 +1,9 @@
 /*
  * ast_$read_area_pages_network - Read pages from network for remote objects
  *
- * Allocates pages and reads them from the network using read-ahead.
- * Used for remote objects accessed via the network file system.
+ * Allocates pages and reads them from the network, as one bulk transfer
+ * when the partner supports it and by read-ahead otherwise.  Used for
+ * remote objects accessed via the network file system.
  *
  * Parameters:
  *   aste - ASTE pointer
@@ -78,10 +79,25 @@ int16_t ast_$read_area_pages_network(aste_t *aste, uint32_t *segmap,
     page_size_shift = *((uint8_t *)((char *)aote + 0x9D)) & 0x0F;
     page_size = 1 << (page_size_shift + 9);
 
+    /*
+     * Read a run as one bulk transfer when the partner takes it; a
+     * single page, or a partner that does not, goes through read-ahead.
+     */
+    pages_read = -1;
+    if (allocated > 1) {
+        pages_read = NETWORK_$READ_BULK((char *)aote + 0xAC, &uid, page_num,
+                                        ppn_array, page_size, allocated,
+                                        flags, &dtm, &clock, &acl_info,
+                                        status);
+    }
+
     /* Perform network read-ahead */
-    pages_read = NETWORK_$READ_AHEAD((char *)aote + 0xAC, &uid, ppn_array,
-                                      page_size, allocated, no_read_ahead,
-                                      flags, &dtm, &clock, &acl_info, status);
+    if (pages_read < 0) {
+        pages_read = NETWORK_$READ_AHEAD((char *)aote + 0xAC, &uid, ppn_array,
+                                          page_size, allocated, no_read_ahead,
+                                          flags, &dtm, &clock, &acl_info,
+                                          status);
+    }
 
     /* Free excess pages that weren't used */
     for (i = allocated - pages_read - 1; i >= 0; i--) {
@@ -51,11 +51,11 @@
 #define ATTR_TYPE_SET_ALL_EXT    20   /* Set all extended attributes */
 #define ATTR_TYPE_SET_MODES      21   /* Set mode flags */
 #define ATTR_TYPE_SET_LINKCOUNT  22   /* Set link count */
-#define ATTR_TYPE_SIZE_AND_DTM   23   /* Size with DTM */
-#define ATTR_TYPE_SIZE_AND_DTM2  24   /* Size with DTM variant */
+#define ATTR_TYPE_DTM_FULL       23   /* DTM, 48-bit value */
+#define ATTR_TYPE_DTU_FULL       24   /* DTU, 48-bit value */
 #define ATTR_TYPE_SPECIAL_FLAG   25   /* Special attribute flag */
-#define ATTR_TYPE_UPDATE_DTM     26   /* Update DTM from current */
-#define ATTR_TYPE_UPDATE_DTM2    27   /* Update DTM from current variant */
+#define ATTR_TYPE_DTM_NOW        26   /* DTM from the change clock */
+#define ATTR_TYPE_DTU_NOW        27   /* DTU from the change clock */
 
 /* Global - attribute timestamp mask at A5+0x48C */
 #if defined(ARCH_M68K)
@@ -66,14 +66,21 @@ extern uint32_t ast_$attr_timestamp_mask;
 #define AST_$ATTR_TIMESTAMP_MASK ast_$attr_timestamp_mask
 #endif
 
-void AST_$SET_ATTR_DISPATCH(aote_t *aote, uint16_t attr_type, void *value,
-                            int8_t wait_flag, clock_t *clock_info, status_$t *status)
+/*
+ * ast_$apply_attr - Apply one attribute change to an AOTE
+ *
+ * The part of the dispatch that runs under the attribute lock.  The
+ * caller holds AST_LOCK_ID and keeps it; a negative return means the
+ * ACL changed and the caller must purify and fix the ACL references
+ * (see AST_$SET_ATTR_DISPATCH).
+ */
+int8_t ast_$apply_attr(aote_t *aote, uint16_t attr_type, void *value,
+                       clock_t *clock_info, uid_t *old_acl_out,
+                       uid_t *new_acl_out, status_$t *status)
 {
     int8_t needs_purify = 0;
     int8_t needs_truncate = 0;
     uint8_t obj_type;
-    uid_t old_acl_uid;
-    uid_t new_acl_uid;
 
     *status = status_$ok;
 
@@ -152,10 +159,10 @@ void AST_$SET_ATTR_DISPATCH(aote_t *aote, uint16_t attr_type, void *value,
                 goto unlock_and_return;  /* No change */
             }
             /* Save old UID for potential truncation */
-            old_acl_uid.high = *((uint32_t *)((char *)aote + 0x94));
-            old_acl_uid.low = *((uint32_t *)((char *)aote + 0x98));
-            new_acl_uid.high = uid_ptr[0];
-            new_acl_uid.low = uid_ptr[1];
+            old_acl_out->high = *((uint32_t *)((char *)aote + 0x94));
+            old_acl_out->low = *((uint32_t *)((char *)aote + 0x98));
+            new_acl_out->high = uid_ptr[0];
+            new_acl_out->low = uid_ptr[1];
             needs_purify = -1;
             /* Set new ACL UID */
             *((uint32_t *)((char *)aote + 0x94)) = uid_ptr[0];
@@ -277,7 +284,40 @@ void AST_$SET_ATTR_DISPATCH(aote_t *aote, uint16_t attr_type, void *value,
         }
         break;
 
-    /* Cases 14-27 handle extended attributes - simplified here */
+    /*
+     * Full-precision timestamps: DTM at offset 0x28, DTU at offset 0x30,
+     * each a 32-bit high part and 16-bit fraction, as TIME_$CLOCK stores
+     * them.  Setting the DTU clears the touched flag, as type 10 does.
+     */
+    case ATTR_TYPE_DTM_FULL:
+        {
+            clock_t *time_ptr = (clock_t *)value;
+            *((uint32_t *)((char *)aote + 0x28)) = time_ptr->high;
+            *((uint16_t *)((char *)aote + 0x2C)) = time_ptr->low;
+        }
+        break;
+
+    case ATTR_TYPE_DTM_NOW:
+        *((uint32_t *)((char *)aote + 0x28)) = clock_info->high;
+        *((uint16_t *)((char *)aote + 0x2C)) = clock_info->low;
+        break;
+
+    case ATTR_TYPE_DTU_FULL:
+        {
+            clock_t *time_ptr = (clock_t *)value;
+            *((uint32_t *)((char *)aote + 0x30)) = time_ptr->high;
+            *((uint16_t *)((char *)aote + 0x34)) = time_ptr->low;
+            *((uint8_t *)((char *)aote + 0xBF)) &= 0xEF;
+        }
+        break;
+
+    case ATTR_TYPE_DTU_NOW:
+        *((uint32_t *)((char *)aote + 0x30)) = clock_info->high;
+        *((uint16_t *)((char *)aote + 0x34)) = clock_info->low;
+        *((uint8_t *)((char *)aote + 0xBF)) &= 0xEF;
+        break;
+
+    /* Cases 14-22 and 25 handle extended attributes - simplified here */
     case ATTR_TYPE_OWNER1_UID:
     case ATTR_TYPE_OWNER2_UID:
     case ATTR_TYPE_SET_OWNER1:
@@ -287,11 +327,7 @@ void AST_$SET_ATTR_DISPATCH(aote_t *aote, uint16_t attr_type, void *value,
     case ATTR_TYPE_SET_ALL_EXT:
     case ATTR_TYPE_SET_MODES:
     case ATTR_TYPE_SET_LINKCOUNT:
-    case ATTR_TYPE_SIZE_AND_DTM:
-    case ATTR_TYPE_SIZE_AND_DTM2:
     case ATTR_TYPE_SPECIAL_FLAG:
-    case ATTR_TYPE_UPDATE_DTM:
-    case ATTR_TYPE_UPDATE_DTM2:
         /* TODO: Implement extended attribute cases */
         /* These are complex and involve UID copying, timestamp updates, etc. */
         break;
@@ -319,6 +355,18 @@ set_dirty_flag:
 
 unlock_and_return:
     ML_$UNLOCK(0x14);
+    return needs_truncate;
+}
+
+void AST_$SET_ATTR_DISPATCH(aote_t *aote, uint16_t attr_type, void *value,
+                            int8_t wait_flag, clock_t *clock_info, status_$t *status)
+{
+    int8_t needs_truncate;
+    uid_t old_acl_uid;
+    uid_t new_acl_uid;
+
+    needs_truncate = ast_$apply_attr(aote, attr_type, value, clock_info,
+                                     &old_acl_uid, &new_acl_uid, status);
 
     /* If we need to purify (ACL changed), do so now */
     if (needs_truncate < 0 && *((int8_t *)((char *)aote + 0xB9)) >= 0) {
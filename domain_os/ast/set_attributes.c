@@ -0,0 +1,101 @@
+/*
+ * AST_$SET_ATTRIBUTES - Apply a list of attribute changes
+ *
+ * Vectored form of AST_$SET_ATTRIBUTE.  Local objects are updated under
+ * one acquisition of the AST lock using one clock reading (or the
+ * entry's own clock, if it has one); entries that need the full
+ * single-object path (remote objects, ACL changes, nil UIDs) are applied
+ * one at a time after the lock is dropped.
+ *
+ * Parameters:
+ *   updates - Array of updates; each entry's status is filled in
+ *   count - Number of entries
+ *   status - Status return (first entry that failed, or ok)
+ */
+
+#include "ast/ast_internal.h"
+#include "proc1/proc1.h"
+#include "time/time.h"
+
+#define status_$os_only_local_access_allowed 0x0003000A
+
+/* Attribute types that must take the single-object path */
+#define ATTR_TYPE_ACL_UID 3
+#define ATTR_TYPE_EXSID 0x14
+
+/* Marks entries left for the single-object path */
+#define ATTR_UPDATE_PENDING ((status_$t)-1)
+
+void AST_$SET_ATTRIBUTES(ast_$attr_update_t *updates, uint16_t count,
+                         status_$t *status)
+{
+    ast_$attr_update_t *u;
+    aote_t *aote;
+    clock_t clock_val;
+    uid_t old_acl_uid;
+    uid_t new_acl_uid;
+    int8_t is_os_process;
+    int16_t proc_type;
+    uint16_t pending = 0;
+    uint16_t i;
+
+    *status = status_$ok;
+    if (count == 0) {
+        return;
+    }
+
+    proc_type = PROC1_$TYPE[PROC1_$CURRENT];
+    is_os_process = (proc_type == 8 || proc_type == 9) ? -1 : 0;
+
+    TIME_$CLOCK(&clock_val);
+
+    PROC1_$INHIBIT_BEGIN();
+    ML_$LOCK(AST_LOCK_ID);
+
+    for (i = 0, u = updates; i < count; i++, u++) {
+        if (u->attr_id == ATTR_TYPE_ACL_UID || u->attr_id == ATTR_TYPE_EXSID ||
+            (u->uid.high == UID_$NIL.high && u->uid.low == UID_$NIL.low)) {
+            u->status = ATTR_UPDATE_PENDING;
+            pending++;
+            continue;
+        }
+
+        aote = ast_$lookup_aote_by_uid(&u->uid);
+        if (aote == NULL) {
+            aote = ast_$force_activate_segment(&u->uid, 0, &u->status, is_os_process);
+            if (aote == NULL) {
+                continue;
+            }
+        } else {
+            aote->flags |= AOTE_FLAG_BUSY;
+        }
+
+        if (*((int8_t *)((char *)aote + 0xB9)) < 0) {
+            u->status = ATTR_UPDATE_PENDING;
+            pending++;
+            continue;
+        }
+
+        if (*((int8_t *)((char *)aote + 0x71)) < 0 && is_os_process >= 0) {
+            u->status = status_$os_only_local_access_allowed;
+            continue;
+        }
+
+        ast_$apply_attr(aote, u->attr_id, u->value,
+                        (u->clock.high != 0) ? &u->clock : &clock_val,
+                        &old_acl_uid, &new_acl_uid, &u->status);
+    }
+
+    ML_$UNLOCK(AST_LOCK_ID);
+    PROC1_$INHIBIT_END();
+
+    for (i = 0, u = updates; i < count; i++, u++) {
+        if (pending != 0 && u->status == ATTR_UPDATE_PENDING) {
+            AST_$SET_ATTRIBUTE(&u->uid, u->attr_id, u->value, &u->status);
+            pending--;
+        }
+        if (u->status != status_$ok && *status == status_$ok) {
+            *status = u->status;
+        }
+    }
+}
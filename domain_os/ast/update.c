@@ -23,6 +23,12 @@ void AST_$UPDATE(void)
         return;
     }
 
+    /*
+     * Apply queued timestamp updates before writing AOTEs back.  A
+     * failure is kept for the object's next caller.
+     */
+    AST_$FLUSH_DEFERRED(NULL, &status);
+
     ML_$LOCK(AST_LOCK_ID);
 
     aote_count = 0;
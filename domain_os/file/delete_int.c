@@ -28,12 +28,6 @@
 #define file_$object_is_remote       0x000F0002
 #define status_$ast_refcnt_says_unused      0x00030007
 
-/* File lock ID */
-#define FILE_LOCK_ID    5
-
-/* Hash table size for lock table - at 0xe5ea28, value is 58 */
-static const uint16_t FILE_LOCK_HASH_SIZE = 58;
-
 /* Forward declarations of internal functions that need to be implemented */
 static void file_$lock_add_ref(uid_t *uid);     /* FUN_00e5d0a8 */
 static void file_$lock_remove_ref(uid_t *uid);  /* FUN_00e5d134 */
@@ -72,13 +66,13 @@ int8_t FILE_$DELETE_INT(uid_t *file_uid, uint16_t flags, uint8_t *result, status
     found_locked = 0;
 
     /*
-     * Hash the file UID to find the lock table bucket.
-     * UID_$HASH returns: high 16 bits = quotient, low 16 bits = remainder (index)
+     * Hash the file UID to find the lock table bucket (the table size
+     * is set by FILE_$LOCK_INIT; it was a fixed 58 at 0xe5ea28).
      */
-    hash_index = (int16_t)UID_$HASH(file_uid, (uint16_t *)&FILE_LOCK_HASH_SIZE);
+    hash_index = file_$lot_hash(file_uid);
 
-    /* Take the file lock */
-    ML_$LOCK(FILE_LOCK_ID);
+    /* Take the bucket lock */
+    file_$lot_bucket_lock(hash_index);
 
     /*
      * Search the lock entry chain for this file.
@@ -132,7 +126,7 @@ int8_t FILE_$DELETE_INT(uid_t *file_uid, uint16_t flags, uint8_t *result, status
             file_$lock_add_ref(file_uid);
 
             /* Release lock while calling AST_$TRUNCATE */
-            ML_$UNLOCK(FILE_LOCK_ID);
+            file_$lot_bucket_unlock(hash_index);
 
             /* Determine truncate flags */
             truncate_flags = 1;
@@ -144,15 +138,15 @@ int8_t FILE_$DELETE_INT(uid_t *file_uid, uint16_t flags, uint8_t *result, status
             AST_$TRUNCATE(file_uid, 0, truncate_flags, result, status_ret);
 
             /* Re-acquire lock */
-            ML_$LOCK(FILE_LOCK_ID);
+            file_$lot_bucket_lock(hash_index);
 
             /* Call internal function to remove reference */
             file_$lock_remove_ref(file_uid);
         }
     }
 
-    /* Release the file lock */
-    ML_$UNLOCK(FILE_LOCK_ID);
+    /* Release the bucket lock */
+    file_$lot_bucket_unlock(hash_index);
 
     return found_locked;
 }
@@ -16,7 +16,7 @@
  *   - Validates lock_index is in range [1, 0x96]
  *   - Looks up lock entry in per-process table
  *   - Verifies file UID matches
- *   - Acquires lock 5 via ML_$LOCK
+ *   - Acquires lock 5 via ML_$LOCK (now the lock table spin lock)
  *   - Searches for free slot in target's lock table
  *   - If found, copies lock index, updates count, increments refcount
  *   - Releases lock 5 via ML_$UNLOCK
@@ -33,9 +33,8 @@
 /* Constants from assembly */
 #define MAX_PROC_LOCKS      150     /* 0x96 */
 #define LOCK_ENTRY_SIZE     0x1C    /* 28 bytes */
-#define PROC_LOT_BASE       0xEA202C
+#define PROC_LOT_TABLE_BASE 0xEA202C
 #define LOT_DATA_BASE       0xE935BC
-#define LOT_MAX_COUNT_BASE  0xEA3DC4
 #define PROC_LOT_OFFSET     (-0x2662)
 
 /* Dummy parameter for PROC2_$FIND_ASID */
@@ -67,6 +66,7 @@ static const int8_t find_asid_param = 0;
  *   status_$proc2_uid_not_found             - Target process not found
  *   file_$invalid_arg                - Invalid lock index
  *   file_$object_not_locked_by_this_process - Lock not found or UID mismatch
+ *   file_$object_is_remote           - Range handle on a remotely locked object
  *   file_$local_lock_table_full      - Target's lock table is full
  */
 void FILE_$EXPORT_LK(uid_t *file_uid, uint32_t *lock_index,
@@ -80,7 +80,6 @@ void FILE_$EXPORT_LK(uid_t *file_uid, uint32_t *lock_index,
     uint8_t *entry_ptr;
     uint32_t entry_offset;
     int16_t slot;
-    int16_t remaining;
     int32_t proc_table_base;
 
     /* Save current process ASID */
@@ -93,8 +92,21 @@ void FILE_$EXPORT_LK(uid_t *file_uid, uint32_t *lock_index,
         return;
     }
 
-    /* Validate lock index is in range [1, 0x96] */
     idx = *lock_index;
+
+    /* Byte-range locks are copied into the target's range list */
+    if (idx & FILE_RANGE_INDEX_FLAG) {
+        uint16_t range_out;
+
+        file_$range_export(file_uid, (uint16_t)idx, current_asid, target_asid,
+                           &range_out, status_ret);
+        if (*status_ret == status_$ok) {
+            *index_out = (int32_t)range_out;
+        }
+        return;
+    }
+
+    /* Validate lock index is in range [1, 0x96] */
     if (idx == 0 || idx > MAX_PROC_LOCKS) {
         *status_ret = file_$invalid_arg;
         return;
@@ -102,9 +114,9 @@ void FILE_$EXPORT_LK(uid_t *file_uid, uint32_t *lock_index,
 
     /*
      * Look up lock entry in current process's table
-     * Table is at PROC_LOT_BASE + ASID*300 + PROC_LOT_OFFSET + index*2
+     * Table is at PROC_LOT_TABLE_BASE + ASID*300 + PROC_LOT_OFFSET + index*2
      */
-    proc_table_base = PROC_LOT_BASE + current_asid * FILE_PROC_LOCK_ENTRY_SIZE;
+    proc_table_base = PROC_LOT_TABLE_BASE + current_asid * FILE_PROC_LOCK_ENTRY_SIZE;
     entry_idx = *(int16_t *)(proc_table_base + PROC_LOT_OFFSET + idx * 2);
 
     if (entry_idx == 0) {
@@ -129,47 +141,17 @@ void FILE_$EXPORT_LK(uid_t *file_uid, uint32_t *lock_index,
         return;
     }
 
-    /* Set initial status - will be cleared if slot found */
-    *status_ret = file_$local_lock_table_full;
-
-    /* Acquire lock 5 (file locking lock) */
-    ML_$LOCK(5);
-
     /*
-     * Search for free slot in target's lock table
-     * Iterate through slots 1 to 0x96 (150 entries)
+     * Take the first free slot in the target's lock table (slots 1 to
+     * 0x96) and add a reference to the lock entry.  Slot tables and
+     * refcounts are covered by the lock table spin lock.
      */
-    proc_table_base = PROC_LOT_BASE + target_asid * FILE_PROC_LOCK_ENTRY_SIZE;
-
-    remaining = MAX_PROC_LOCKS - 1;  /* 0x95 */
-    slot = 1;
-
-    while (remaining >= 0) {
-        int16_t *slot_ptr = (int16_t *)(proc_table_base + PROC_LOT_OFFSET + slot * 2);
-
-        if (*slot_ptr == 0) {
-            /* Found free slot - assign lock index */
-            *slot_ptr = entry_idx;
-
-            /* Update max lock count if needed */
-            int16_t *max_ptr = (int16_t *)(LOT_MAX_COUNT_BASE + target_asid * 2);
-            if (*max_ptr < slot) {
-                *max_ptr = slot;
-            }
-
-            /* Increment lock refcount */
-            entry_ptr[0x0C]++;
-
-            /* Success */
-            *status_ret = status_$ok;
-            *index_out = (int32_t)slot;
-            break;
-        }
-
-        slot++;
-        remaining--;
+    slot = file_$lot_slot_add(target_asid, entry_idx, -1);
+    if (slot == 0) {
+        *status_ret = file_$local_lock_table_full;
+        return;
     }
 
-    /* Release lock 5 */
-    ML_$UNLOCK(5);
+    *status_ret = status_$ok;
+    *index_out = (int32_t)slot;
 }
@@ -38,6 +38,15 @@
 /* Size of each lock entry in bytes */
 #define FILE_LOCK_ENTRY_SIZE        28
 
+/*
+ * Byte-range lock modes (FILE_$LOCK_RANGE)
+ */
+#define FILE_RANGE_READ             0   /* Shared: overlaps other readers */
+#define FILE_RANGE_WRITE            1   /* Exclusive over the range */
+
+/* Lock indices with this bit set name byte-range locks */
+#define FILE_RANGE_INDEX_FLAG       0x8000
+
 /*
  * File attribute IDs for FILE_$SET_ATTRIBUTE
  */
@@ -784,6 +793,44 @@ void FILE_$FORCE_UNLOCK(uid_t *file_uid, status_$t *status_ret);
 void FILE_$UNLOCK_PROC(uid_t *proc_uid, uid_t *file_uid, uint16_t *lock_mode,
                        uint32_t param_4, status_$t *status_ret);
 
+/*
+ * FILE_$LOCK_RANGE - Lock a byte range of a file
+ *
+ * Refines a whole-object lock the calling process already holds on a
+ * local file, so several writers holding a shared mode can work on
+ * disjoint regions.  Overlapping ranges conflict if either is
+ * FILE_RANGE_WRITE and they belong to different holders; conflicts
+ * return file_$object_in_use rather than waiting, like FILE_$LOCK.
+ *
+ * The returned index has FILE_RANGE_INDEX_FLAG set and can be passed to
+ * FILE_$UNLOCK_RANGE, FILE_$EXPORT_LK and FILE_$IMPORT_LK.  Range locks
+ * are released by FILE_$UNLOCK_RANGE, with the process's last lock on
+ * the object, or when the process's locks are released at exit; they
+ * are not inherited across fork.
+ *
+ * Parameters:
+ *   file_uid   - UID of file
+ *   start      - Pointer to first byte offset
+ *   length     - Pointer to length in bytes (0 = to end of file)
+ *   range_mode - Pointer to FILE_RANGE_READ or FILE_RANGE_WRITE
+ *   lock_index - Output: range lock index
+ *   status_ret - Output status code
+ */
+void FILE_$LOCK_RANGE(uid_t *file_uid, uint32_t *start, uint32_t *length,
+                      uint16_t *range_mode, uint32_t *lock_index,
+                      status_$t *status_ret);
+
+/*
+ * FILE_$UNLOCK_RANGE - Release a byte-range lock
+ *
+ * Parameters:
+ *   file_uid   - UID of file
+ *   lock_index - Pointer to index returned by FILE_$LOCK_RANGE
+ *   status_ret - Output status code
+ */
+void FILE_$UNLOCK_RANGE(uid_t *file_uid, uint32_t *lock_index,
+                        status_$t *status_ret);
+
 /*
  * ============================================================================
  * Lock Query Functions
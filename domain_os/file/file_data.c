@@ -110,10 +110,40 @@ uint16_t FILE_$LOCK_CVT_TABLE[12] = {
  */
 
 /*
- * Lock hash table (58 entries)
+ * Lock hash table (up to 251 buckets, FILE_$LOT_HASH_SIZE in use)
  * Original address: FILE_$LOCK_CONTROL + 0xC8 (0xE821F0)
  */
-uint16_t FILE_$LOT_HASHTAB[FILE_LOCK_TABLE_ENTRIES];
+uint16_t FILE_$LOT_HASHTAB[FILE_LOT_HASH_MAX];
+
+/*
+ * Number of lock hash buckets in use (set by FILE_$LOCK_INIT)
+ */
+uint16_t FILE_$LOT_HASH_SIZE = FILE_LOT_HASH_MIN;
+
+/*
+ * Per-bucket exclusion locks
+ */
+ml_$exclusion_t FILE_$LOT_BUCKET_LOCK[FILE_LOT_HASH_MAX];
+
+/*
+ * Spin lock for free list, sequence, per-process tables and refcounts
+ */
+uint16_t FILE_$LOT_SPIN_LOCK;
+
+/*
+ * Occupied slots per process lock table
+ */
+uint16_t FILE_$PROC_LOT_HELD[FILE_LOCK_TABLE_ENTRIES];
+
+/*
+ * Byte-range lock pools, object hash heads and per-process lists
+ */
+file_range_lock_t FILE_$RANGE_LOCKS[FILE_RANGE_LOCK_MAX + 1];
+file_range_obj_t  FILE_$RANGE_OBJS[FILE_RANGE_OBJ_MAX + 1];
+uint16_t FILE_$RANGE_HASHTAB[FILE_LOT_HASH_MAX];
+uint16_t FILE_$RANGE_FREE;
+uint16_t FILE_$RANGE_OBJ_FREE;
+uint16_t FILE_$RANGE_OWNED[FILE_LOCK_TABLE_ENTRIES];
 
 /*
  * Lock sequence counter
@@ -21,6 +21,7 @@
 #include "disk/disk.h"
 #include "proc1/proc1.h"
 #include "vtoc/vtoc.h"
+#include "ml/ml.h"
 
 /*
  * ============================================================================
@@ -137,8 +138,49 @@ typedef struct file_lock_entry_detail_t {
 /*
  * Lock hash table (array of head pointers)
  * Located at FILE_$LOCK_CONTROL + 0xC8
+ *
+ * The bucket count is chosen by FILE_$LOCK_INIT from physical memory,
+ * between the original 58 buckets and the 251 heads the lock_map[]
+ * area of the control block has room for.
  */
+#define FILE_LOT_HASH_MIN       58
+#define FILE_LOT_HASH_MAX       251
+
 extern uint16_t FILE_$LOT_HASHTAB[];
+extern uint16_t FILE_$LOT_HASH_SIZE;
+
+/*
+ * Lock table locking
+ *
+ * Each hash bucket has its own exclusion lock covering the chain and the
+ * mode/flag fields of the entries on it.  Holders may block in AST and
+ * REM_FILE calls, so these are exclusion regions rather than spin locks.
+ * FILE_$LOT_SPIN_LOCK covers the short, non-blocking state shared by all
+ * buckets: the free list, FILE_$LOT_HIGH, FILE_$LOT_SEQN, the per-process
+ * slot tables and entry reference counts.  Order: bucket, then spin.
+ */
+extern ml_$exclusion_t FILE_$LOT_BUCKET_LOCK[FILE_LOT_HASH_MAX];
+extern uint16_t FILE_$LOT_SPIN_LOCK;
+
+/*
+ * Number of occupied slots in each per-process lock table.  Lets the
+ * unlock-all and unlock-process paths stop once every held lock has been
+ * visited instead of walking to the high-water mark.
+ */
+extern uint16_t FILE_$PROC_LOT_HELD[FILE_LOCK_TABLE_ENTRIES];
+
+/*
+ * Lock table access (m68k target addresses)
+ */
+#define LOT_BASE        ((file_lock_entry_detail_t *)0xE935B0)
+#define LOT_ENTRY(n)    ((file_lock_entry_detail_t *)((uint8_t *)LOT_BASE + (n) * 0x1C))
+
+/* Per-process lock table: slot array and high-water mark */
+#define PROC_LOT_BASE   ((uint16_t *)0xE9F9CA)
+#define PROC_LOT_ENTRY(asid, idx) \
+    (*(uint16_t *)((uint8_t *)PROC_LOT_BASE + (asid) * 300 + (idx) * 2))
+#define PROC_LOT_COUNT(asid) \
+    (*(uint16_t *)((uint8_t *)0xEA3DC4 + (asid) * 2))
 
 /*
  * External lock control variables (in file_lock_control_t)
@@ -250,6 +292,126 @@ uint8_t FILE_$PRIV_UNLOCK(uid_t *file_uid, uint16_t lock_index,
  */
 void FILE_$PRIV_UNLOCK_ALL(uint16_t *asid_ptr);
 
+/*
+ * ============================================================================
+ * Lock Table Helpers (lot.c)
+ * ============================================================================
+ */
+
+/* Bucket index of a file UID in the lock hash table */
+int16_t file_$lot_hash(uid_t *uid);
+
+/* Enter / leave the exclusion region of one hash bucket */
+void file_$lot_bucket_lock(int16_t hash_index);
+void file_$lot_bucket_unlock(int16_t hash_index);
+
+/* Take an entry off the free list (0 if exhausted) / return it */
+uint16_t file_$lot_alloc(void);
+void file_$lot_free(uint16_t entry_idx);
+
+/* Next lock sequence number */
+uint32_t file_$lot_next_seqn(void);
+
+/*
+ * Put an entry in the first free slot of a process's lock table,
+ * optionally adding a reference.  Returns the slot, or 0 if full.
+ */
+int16_t file_$lot_slot_add(int16_t asid, uint16_t entry_idx, int8_t add_ref);
+
+/* Point an occupied slot at a different entry */
+void file_$lot_slot_set(int16_t asid, int16_t slot, uint16_t entry_idx);
+
+/*
+ * Clear a slot (if non-zero) and drop one reference on the entry.
+ * Returns the remaining reference count.
+ */
+uint8_t file_$lot_drop(int16_t asid, int16_t slot, uint16_t entry_idx);
+
+/*
+ * Copy a live entry under its bucket lock.  Returns -1 if the entry was
+ * in use and has been copied, 0 if it was free.
+ */
+int8_t file_$lot_snapshot(uint16_t entry_idx, file_lock_entry_detail_t *copy);
+
+/*
+ * ============================================================================
+ * Byte-Range Locks (range_lock.c)
+ * ============================================================================
+ *
+ * The ranges locked on one object form an interval tree: an AVL tree
+ * keyed on start offset, with each node also recording the largest end
+ * offset in its subtree, so a conflict check costs O(log n + k).  Trees
+ * hang off object records chained from FILE_$RANGE_HASHTAB, which uses
+ * the same buckets as the lock table and is guarded by the same bucket
+ * locks.  The node and object pools and the per-process lists of held
+ * ranges are covered by FILE_$LOT_SPIN_LOCK.  Pool indices are 1-based,
+ * 0 meaning none.
+ */
+#define FILE_RANGE_LOCK_MAX     512     /* Range lock nodes */
+#define FILE_RANGE_OBJ_MAX      128     /* Objects with ranges locked */
+
+typedef struct file_range_lock_t {
+    uint32_t    start;          /* 0x00: First byte */
+    uint32_t    end;            /* 0x04: Last byte (inclusive) */
+    uint32_t    max_end;        /* 0x08: Largest end in this subtree */
+    uint32_t    group;          /* 0x0C: Share group (exported copies match) */
+    uint16_t    left;           /* 0x10: Left child */
+    uint16_t    right;          /* 0x12: Right child */
+    uint16_t    obj;            /* 0x14: Object record */
+    uint16_t    owner_next;     /* 0x16: Next range held by process / free list */
+    uint16_t    owner_prev;     /* 0x18: Previous range held by process */
+    uint8_t     asid;           /* 0x1A: Holding process */
+    uint8_t     mode;           /* 0x1B: FILE_RANGE_READ / FILE_RANGE_WRITE */
+    int8_t      height;         /* 0x1C: AVL subtree height (0 = free) */
+    uint8_t     pad[3];
+} file_range_lock_t;
+
+typedef struct file_range_obj_t {
+    uid_t       uid;            /* 0x00: Object UID */
+    uint16_t    root;           /* 0x08: Interval tree root */
+    uint16_t    next;           /* 0x0A: Bucket chain / free list */
+    uint16_t    count;          /* 0x0C: Ranges in tree */
+    uint16_t    pad;
+} file_range_obj_t;
+
+extern file_range_lock_t FILE_$RANGE_LOCKS[FILE_RANGE_LOCK_MAX + 1];
+extern file_range_obj_t  FILE_$RANGE_OBJS[FILE_RANGE_OBJ_MAX + 1];
+extern uint16_t FILE_$RANGE_HASHTAB[FILE_LOT_HASH_MAX];
+extern uint16_t FILE_$RANGE_FREE;
+extern uint16_t FILE_$RANGE_OBJ_FREE;
+
+/* Head of each process's list of held ranges */
+extern uint16_t FILE_$RANGE_OWNED[FILE_LOCK_TABLE_ENTRIES];
+
+/* Reset the range lock pools (from FILE_$LOCK_INIT) */
+void file_$range_init(void);
+
+/* Release every range held by a process */
+void file_$range_unlock_asid(int16_t asid);
+
+/*
+ * Release a process's ranges on an object once it no longer holds any
+ * whole-object lock on it.  Called with the object's bucket held.
+ */
+void file_$range_unlock_object(int16_t hash_index, uid_t *file_uid,
+                               int16_t asid);
+
+/*
+ * Give another process its own copy of a range held by the caller.
+ * The copy shares the original's group, so the two never conflict.
+ */
+void file_$range_export(uid_t *file_uid, uint16_t lock_index,
+                        int16_t asid, int16_t target_asid,
+                        uint16_t *index_out, status_$t *status_ret);
+
+/*
+ * Check that lock_index is a range on file_uid held by asid.  Ranges
+ * are local only: a handle for an object the caller has locked on a
+ * remote node is refused with file_$object_is_remote.
+ */
+void file_$range_import(uid_t *file_uid, uint16_t lock_index, int16_t asid,
+                        status_$t *status_ret);
+
 /*
  * Internal lock info structure (34 bytes)
  * Output format for FILE_$LOCAL_READ_LOCK and FILE_$READ_LOCK_ENTRYI
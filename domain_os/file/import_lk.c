@@ -53,7 +53,9 @@
  *   index_out  - Output: validated lock index (same as input if valid)
  *   status_ret - Output: status code
  *                status_$ok if valid,
- *                file_$invalid_arg if invalid
+ *                file_$invalid_arg if invalid,
+ *                file_$object_is_remote for a range handle on an
+ *                object locked on a remote node
  *
  * Note: This function checks that the lock exists in the current
  * process's lock table (PROC1_$AS_ID) and that the file UID matches.
@@ -66,6 +68,19 @@ void FILE_$IMPORT_LK(uid_t *file_uid, uint32_t *index_in, uint32_t *index_out,
     int32_t entry_offset;
     uint8_t *entry_base;
 
+    /* Byte-range lock handle: must be on this process's range list */
+    if (lock_index & FILE_RANGE_INDEX_FLAG) {
+        if (lock_index > 0xFFFF) {
+            *status_ret = file_$invalid_arg;
+            return;
+        }
+        file_$range_import(file_uid, (uint16_t)lock_index, PROC1_$AS_ID, status_ret);
+        if (*status_ret == status_$ok) {
+            *index_out = lock_index;
+        }
+        return;
+    }
+
     /*
      * Validate lock index range: must be non-zero and <= 150 (0x96)
      */
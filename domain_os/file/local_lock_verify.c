@@ -16,7 +16,7 @@
  * Assembly analysis:
  *   - link.w A6,-0xc        ; Stack frame
  *   - Calls UID_$HASH to compute hash bucket
- *   - Acquires ML_$LOCK(5) for lock table protection
+ *   - Acquires ML_$LOCK(5) for lock table protection (now the bucket lock)
  *   - Iterates through hash chain checking for match
  *   - Releases ML_$UNLOCK(5) before returning
  */
@@ -62,13 +62,13 @@ void FILE_$LOCAL_LOCK_VERIFY(lock_verify_request_t *request, status_$t *status_r
     int8_t found = 0;
 
     /* Compute hash bucket for the file UID */
-    hash_index = UID_$HASH(&request->file_uid, NULL);
+    hash_index = file_$lot_hash(&request->file_uid);
 
     /* Default status: not locked by this process */
     *status_ret = file_$object_not_locked_by_this_process;
 
-    /* Acquire lock table spinlock */
-    ML_$LOCK(5);
+    /* Acquire the hash bucket lock */
+    file_$lot_bucket_lock(hash_index);
 
     /* Get head of hash chain */
     entry_idx = FILE_$LOT_HASHTAB[hash_index];
@@ -152,6 +152,6 @@ void FILE_$LOCAL_LOCK_VERIFY(lock_verify_request_t *request, status_$t *status_r
     }
 
 done:
-    /* Release lock table spinlock */
-    ML_$UNLOCK(5);
+    /* Release the hash bucket lock */
+    file_$lot_bucket_unlock(hash_index);
 }
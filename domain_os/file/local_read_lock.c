@@ -11,7 +11,7 @@
  * Assembly analysis:
  *   - link.w A6,-0xc        ; Stack frame
  *   - Calls UID_$HASH to compute hash bucket
- *   - Acquires ML_$LOCK(5) for lock table protection
+ *   - Acquires ML_$LOCK(5) for lock table protection (now the bucket lock)
  *   - Searches hash chain for matching UID
  *   - Copies 34 bytes of lock info to output
  *   - Releases ML_$UNLOCK(5) before returning
@@ -48,13 +48,13 @@ void FILE_$LOCAL_READ_LOCK(uid_t *file_uid, file_lock_info_internal_t *info_out,
     int32_t entry_offset;
 
     /* Compute hash bucket for the file UID */
-    hash_index = UID_$HASH(file_uid, NULL);
+    hash_index = file_$lot_hash(file_uid);
 
     /* Default status: not found */
     *status_ret = file_$object_not_locked_by_this_process;
 
-    /* Acquire lock table spinlock */
-    ML_$LOCK(5);
+    /* Acquire the hash bucket lock */
+    file_$lot_bucket_lock(hash_index);
 
     /* Get head of hash chain */
     entry_idx = FILE_$LOT_HASHTAB[hash_index];
@@ -136,6 +136,6 @@ void FILE_$LOCAL_READ_LOCK(uid_t *file_uid, file_lock_info_internal_t *info_out,
     }
 
 done:
-    /* Release lock table spinlock */
-    ML_$UNLOCK(5);
+    /* Release the hash bucket lock */
+    file_$lot_bucket_unlock(hash_index);
 }
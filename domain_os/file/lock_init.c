@@ -18,7 +18,8 @@
  *    - Entry[i].flags cleared
  *
  * 4. Lock control block (at 0xE82128):
- *    - lock_map[]: 251 words cleared
+ *    - lock_map[]: 251 words cleared, bucket locks initialized
+ *    - Bucket count sized from MMAP_$REAL_PAGES (58..251)
  *    - flag_2cc: Set to 1
  *    - lot_free: Set to 1 (head of free list)
  *    - base_uid: Set to UID_$NIL with low 20 bits replaced by NODE_$ME
@@ -34,6 +35,7 @@
 #include "file/file_internal.h"
 #include "ec/ec.h"
 #include "rem_file/rem_file.h"
+#include "mmap/mmap.h"
 
 /*
  * FILE_$LOCK_INIT
@@ -52,6 +54,7 @@ void FILE_$LOCK_INIT(void)
     file_lock_entry_t *entry;
     uint16_t *lock_table_ptr;
     uint16_t *table2_ptr;
+    uint32_t hash_size;
 
     /*
      * Initialize lock table (58 entries × 300 bytes)
@@ -115,9 +118,29 @@ void FILE_$LOCK_INIT(void)
      * In the m68k binary both the struct field and FILE_$LOT_HASHTAB
      * point to the same memory; for portability we keep them in sync.
      */
-    for (i = 0; i < FILE_LOCK_TABLE_ENTRIES; i++) {
+    for (i = 0; i < FILE_LOT_HASH_MAX; i++) {
         FILE_$LOT_HASHTAB[i] = 0;
+        ML_$EXCLUSION_INIT(&FILE_$LOT_BUCKET_LOCK[i]);
+    }
+
+    /*
+     * Size the hash table from physical memory: one bucket per 16 pages,
+     * clamped to the original 58 and the 251 heads available.  Larger
+     * machines run more processes and hold more locks at once.
+     */
+    hash_size = MMAP_$REAL_PAGES >> 4;
+    if (hash_size < FILE_LOT_HASH_MIN) {
+        hash_size = FILE_LOT_HASH_MIN;
+    } else if (hash_size > FILE_LOT_HASH_MAX) {
+        hash_size = FILE_LOT_HASH_MAX;
     }
+    FILE_$LOT_HASH_SIZE = (uint16_t)hash_size;
+
+    for (i = 0; i < FILE_LOCK_TABLE_ENTRIES; i++) {
+        FILE_$PROC_LOT_HELD[i] = 0;
+    }
+
+    file_$range_init();
 
     /* Initialize UID lock eventcount */
     EC_$INIT(&FILE_$UID_LOCK_EC);
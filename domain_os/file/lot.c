@@ -0,0 +1,210 @@
+/*
+ * FILE lock object table (LOT) helpers
+ *
+ * Shared bookkeeping for the lock entry table used by FILE_$PRIV_LOCK,
+ * FILE_$PRIV_UNLOCK and the other lock routines.
+ *
+ * Locking:
+ *   Each hash bucket is guarded by its own exclusion lock, so lock and
+ *   unlock traffic on files in different buckets proceeds in parallel.
+ *   Entries reachable from a bucket chain (mode, flags, sequence, chain
+ *   link) are only modified with that bucket held.
+ *
+ *   FILE_$LOT_SPIN_LOCK guards the state shared by every bucket: the free
+ *   list, FILE_$LOT_HIGH, FILE_$LOT_SEQN, the per-process slot tables with
+ *   their high-water marks and held counts, and entry reference counts.
+ *   It is only held for a few instructions and never across a call that
+ *   can block.  When both are needed the bucket is taken first.
+ *
+ *   Clearing a process slot and dropping the entry's reference happen in
+ *   the same spin section (file_$lot_drop), so FILE_$FORK_LOCK and
+ *   FILE_$EXPORT_LK, which add references without a bucket lock, either
+ *   see the slot and keep the entry alive or do not see it at all.
+ */
+
+#include "file/file_internal.h"
+
+/*
+ * file_$lot_hash - Bucket index of a file UID
+ *
+ * UID_$HASH returns the remainder (bucket) in the high word.
+ */
+int16_t file_$lot_hash(uid_t *uid)
+{
+    return (int16_t)(UID_$HASH(uid, &FILE_$LOT_HASH_SIZE) >> 16);
+}
+
+void file_$lot_bucket_lock(int16_t hash_index)
+{
+    ML_$EXCLUSION_START(&FILE_$LOT_BUCKET_LOCK[hash_index]);
+}
+
+void file_$lot_bucket_unlock(int16_t hash_index)
+{
+    ML_$EXCLUSION_STOP(&FILE_$LOT_BUCKET_LOCK[hash_index]);
+}
+
+/*
+ * file_$lot_alloc - Take an entry off the free list
+ *
+ * Returns the 1-based entry index, or 0 if the table is exhausted.
+ */
+uint16_t file_$lot_alloc(void)
+{
+    ml_$spin_token_t token;
+    uint16_t entry_idx;
+
+    token = ML_$SPIN_LOCK(&FILE_$LOT_SPIN_LOCK);
+
+    entry_idx = FILE_$LOT_FREE;
+    if (entry_idx > FILE_LOCK_ENTRY_COUNT) {
+        entry_idx = 0;
+    }
+    if (entry_idx != 0) {
+        FILE_$LOT_FREE = LOT_ENTRY(entry_idx)->next;
+        LOT_ENTRY(entry_idx)->refcount = 0;
+        if (entry_idx > FILE_$LOT_HIGH) {
+            FILE_$LOT_HIGH = entry_idx;
+        }
+    }
+
+    ML_$SPIN_UNLOCK(&FILE_$LOT_SPIN_LOCK, token);
+    return entry_idx;
+}
+
+/*
+ * file_$lot_free - Return an entry to the free list
+ *
+ * The caller must already have unlinked it from its hash chain.
+ */
+void file_$lot_free(uint16_t entry_idx)
+{
+    ml_$spin_token_t token;
+    file_lock_entry_detail_t *entry = LOT_ENTRY(entry_idx);
+
+    token = ML_$SPIN_LOCK(&FILE_$LOT_SPIN_LOCK);
+    entry->refcount = 0;
+    entry->next = FILE_$LOT_FREE;
+    FILE_$LOT_FREE = entry_idx;
+    ML_$SPIN_UNLOCK(&FILE_$LOT_SPIN_LOCK, token);
+}
+
+uint32_t file_$lot_next_seqn(void)
+{
+    ml_$spin_token_t token;
+    uint32_t seqn;
+
+    token = ML_$SPIN_LOCK(&FILE_$LOT_SPIN_LOCK);
+    seqn = ++FILE_$LOT_SEQN;
+    ML_$SPIN_UNLOCK(&FILE_$LOT_SPIN_LOCK, token);
+    return seqn;
+}
+
+/*
+ * file_$lot_slot_add - Record an entry in a process's lock table
+ *
+ * Uses the lowest free slot so the table stays dense and the high-water
+ * mark tracks the number of locks held.
+ */
+int16_t file_$lot_slot_add(int16_t asid, uint16_t entry_idx, int8_t add_ref)
+{
+    ml_$spin_token_t token;
+    int16_t slot;
+
+    token = ML_$SPIN_LOCK(&FILE_$LOT_SPIN_LOCK);
+
+    for (slot = 1; slot <= FILE_PROC_LOCK_MAX_ENTRIES; slot++) {
+        if (PROC_LOT_ENTRY(asid, slot) == 0) {
+            PROC_LOT_ENTRY(asid, slot) = entry_idx;
+            if (slot > (int16_t)PROC_LOT_COUNT(asid)) {
+                PROC_LOT_COUNT(asid) = slot;
+            }
+            FILE_$PROC_LOT_HELD[asid]++;
+            if (add_ref < 0) {
+                LOT_ENTRY(entry_idx)->refcount++;
+            }
+            ML_$SPIN_UNLOCK(&FILE_$LOT_SPIN_LOCK, token);
+            return slot;
+        }
+    }
+
+    ML_$SPIN_UNLOCK(&FILE_$LOT_SPIN_LOCK, token);
+    return 0;
+}
+
+void file_$lot_slot_set(int16_t asid, int16_t slot, uint16_t entry_idx)
+{
+    ml_$spin_token_t token;
+
+    token = ML_$SPIN_LOCK(&FILE_$LOT_SPIN_LOCK);
+    PROC_LOT_ENTRY(asid, slot) = entry_idx;
+    ML_$SPIN_UNLOCK(&FILE_$LOT_SPIN_LOCK, token);
+}
+
+/*
+ * file_$lot_drop - Release a process's hold on an entry
+ *
+ * Clears the slot (when non-zero), pulls the high-water mark back over
+ * any trailing empty slots and drops one reference on the entry.
+ * Pass entry_idx 0 to clear a slot whose entry was never referenced.
+ */
+uint8_t file_$lot_drop(int16_t asid, int16_t slot, uint16_t entry_idx)
+{
+    ml_$spin_token_t token;
+    uint8_t refcount = 0;
+    uint16_t count;
+
+    token = ML_$SPIN_LOCK(&FILE_$LOT_SPIN_LOCK);
+
+    if (slot != 0 && PROC_LOT_ENTRY(asid, slot) != 0) {
+        PROC_LOT_ENTRY(asid, slot) = 0;
+        if (FILE_$PROC_LOT_HELD[asid] != 0) {
+            FILE_$PROC_LOT_HELD[asid]--;
+        }
+        count = PROC_LOT_COUNT(asid);
+        while (count != 0 && PROC_LOT_ENTRY(asid, count) == 0) {
+            count--;
+        }
+        PROC_LOT_COUNT(asid) = count;
+    }
+
+    if (entry_idx != 0) {
+        refcount = LOT_ENTRY(entry_idx)->refcount;
+        if (refcount != 0) {
+            refcount--;
+            LOT_ENTRY(entry_idx)->refcount = refcount;
+        }
+    }
+
+    ML_$SPIN_UNLOCK(&FILE_$LOT_SPIN_LOCK, token);
+    return refcount;
+}
+
+/*
+ * file_$lot_snapshot - Copy a live entry for the table readers
+ *
+ * The entry's bucket is derived from its UID before the bucket is taken,
+ * so the UID and reference count are checked again once it is held in
+ * case the entry was freed and reused in between.
+ */
+int8_t file_$lot_snapshot(uint16_t entry_idx, file_lock_entry_detail_t *copy)
+{
+    file_lock_entry_detail_t *entry = LOT_ENTRY(entry_idx);
+    uid_t uid;
+    int16_t hash_index;
+    int8_t live = 0;
+
+    uid.high = entry->uid_high;
+    uid.low = entry->uid_low;
+    hash_index = file_$lot_hash(&uid);
+
+    file_$lot_bucket_lock(hash_index);
+    if (entry->refcount != 0 &&
+        entry->uid_high == uid.high && entry->uid_low == uid.low) {
+        *copy = *entry;
+        live = -1;
+    }
+    file_$lot_bucket_unlock(hash_index);
+
+    return live;
+}
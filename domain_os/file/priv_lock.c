@@ -17,6 +17,9 @@
  * stack frame. These are implemented as static functions with explicit
  * context pointers in this C translation.
  *
+ * Serialization is per hash bucket (see lot.c); the bucket is released
+ * around REM_FILE_$LOCK and re-entered afterwards.
+ *
  * Lock entry structure (28 bytes at DAT_00e935b0 + index * 0x1C):
  *   0x00: context     - Lock context (param_7)
  *   0x04: node_low    - Node address low
@@ -36,19 +39,6 @@
 #include "proc/proc.h"
 #include "netlog/netlog.h"
 
-/*
- * Lock table base addresses (m68k target)
- */
-#define LOT_BASE        ((file_lock_entry_detail_t *)0xE935B0)
-#define LOT_ENTRY(n)    ((file_lock_entry_detail_t *)((uint8_t *)LOT_BASE + (n) * 0x1C))
-
-/* Per-process lock table */
-#define PROC_LOT_BASE   ((uint16_t *)0xE9F9CA)
-#define PROC_LOT_ENTRY(asid, idx) \
-    (*(uint16_t *)((uint8_t *)PROC_LOT_BASE + (asid) * 300 + (idx) * 2))
-#define PROC_LOT_COUNT(asid) \
-    (*(uint16_t *)((uint8_t *)0xEA3DC4 + (asid) * 2))
-
 /*
  * Context structure for nested procedures
  * These values are stored on the parent stack frame and accessed by helpers
@@ -184,7 +174,7 @@ void FILE_$PRIV_LOCK(uid_t *file_uid, int16_t asid, uint16_t lock_index,
     /*
      * Compute UID hash for lock table lookup
      */
-    ctx.hash_index = UID_$HASH(file_uid, NULL);
+    ctx.hash_index = file_$lot_hash(file_uid);
 
     /*
      * Check if this is a null/zero UID (indicates pseudo-lock)
@@ -235,15 +225,15 @@ void FILE_$PRIV_LOCK(uid_t *file_uid, int16_t asid, uint16_t lock_index,
                 /*
                  * Remote lock path
                  */
-                ML_$LOCK(5);
+                file_$lot_bucket_lock(ctx.hash_index);
                 /* Call helper functions to set up remote context */
                 /* ... complex remote lock logic ... */
 
                 local_status = priv_lock_alloc_entry(&ctx, 0xFF, 0);
                 *status_ret = local_status;
                 if (*status_ret == 0) {
-                    FILE_$LOT_SEQN++;
-                    ML_$UNLOCK(5);
+                    file_$lot_next_seqn();
+                    file_$lot_bucket_unlock(ctx.hash_index);
 
                     entry = LOT_ENTRY(ctx.entry_index);
                     HINT_$LOOKUP_CACHE((void *)&ctx.node_id, (void *)&ctx.local_flags);
@@ -260,7 +250,7 @@ void FILE_$PRIV_LOCK(uid_t *file_uid, int16_t asid, uint16_t lock_index,
                             ctx.req_mode = lock_mode;
                         }
 
-                        ML_$LOCK(5);
+                        file_$lot_bucket_lock(ctx.hash_index);
                         priv_lock_remote_lock(&ctx, entry, ctx.req_mode, lock_index,
                                               flags & 0xFFFF, 0);
                         if (*status_ret != 0x0F0003 || i == 1) {
@@ -326,7 +316,7 @@ void FILE_$PRIV_LOCK(uid_t *file_uid, int16_t asid, uint16_t lock_index,
              */
             ctx.defer_validate = -1;
             priv_lock_check_rights(&ctx);
-            ML_$LOCK(5);
+            file_$lot_bucket_lock(ctx.hash_index);
             if (*status_ret != 0) goto done_unlock;
 
             /* Set up local lock context */
@@ -344,7 +334,7 @@ void FILE_$PRIV_LOCK(uid_t *file_uid, int16_t asid, uint16_t lock_index,
             if (ctx.defer_validate < 0 || *status_ret != 0) goto done_unlock;
 
             priv_lock_link_entry(&ctx, entry);
-            ML_$UNLOCK(5);
+            file_$lot_bucket_unlock(ctx.hash_index);
             goto done_success;
         }
 
@@ -368,7 +358,7 @@ void FILE_$PRIV_LOCK(uid_t *file_uid, int16_t asid, uint16_t lock_index,
         }
     }
 
-    ML_$LOCK(5);
+    file_$lot_bucket_lock(ctx.hash_index);
 
     existing_entry = 0;
     proc_slot = 0;
@@ -478,7 +468,8 @@ void FILE_$PRIV_LOCK(uid_t *file_uid, int16_t asid, uint16_t lock_index,
      */
     if (entry->refcount >= 2) {
         *result_out = entry->rights;
-        local_status = priv_lock_alloc_entry(&ctx, 0, 0xFF);
+        ctx.proc_slot = 0;  /* the copy has no slot until it replaces this one */
+        local_status = priv_lock_alloc_entry(&ctx, 0, 0);
         *status_ret = local_status;
         if (*status_ret != 0) goto done_unlock;
 
@@ -489,20 +480,21 @@ void FILE_$PRIV_LOCK(uid_t *file_uid, int16_t asid, uint16_t lock_index,
         if (entry->flags2 & 4) {
             priv_lock_remote_lock(&ctx, new_entry, ctx.req_mode, lock_index,
                                   (flags & 0xFF) & 0xFFBF, 0);
-            ML_$LOCK(5);
+            file_$lot_bucket_lock(ctx.hash_index);
             if (*status_ret != 0) goto done_unlock;
         }
 
-        entry->refcount--;
+        /* The copy takes over this process's slot */
+        file_$lot_drop(asid, 0, existing_entry);
         existing_entry = ctx.entry_index;
-        PROC_LOT_ENTRY(asid, proc_slot) = ctx.entry_index;
+        file_$lot_slot_set(asid, proc_slot, ctx.entry_index);
         priv_lock_link_entry(&ctx, new_entry);
         ctx.entry_index = 0;
         entry = new_entry;
     } else {
         if (entry->flags2 & 4) {
             priv_lock_remote_lock(&ctx, entry, lock_mode, lock_index, flags & 0xFFFF, 0xFF);
-            ML_$LOCK(5);
+            file_$lot_bucket_lock(ctx.hash_index);
             if (*status_ret != 0) goto done_unlock;
         }
     }
@@ -522,7 +514,7 @@ void FILE_$PRIV_LOCK(uid_t *file_uid, int16_t asid, uint16_t lock_index,
     if (flags & 0x400000) {
         entry->flags2 = (entry->flags2 & 0x7F) | (lock_index << 7);
     }
-    ML_$UNLOCK(5);
+    file_$lot_bucket_unlock(ctx.hash_index);
 
 done_success:
     /* Log if enabled */
@@ -535,16 +527,20 @@ done_success:
     return;
 
 error_cleanup:
+    /* priv_lock_remote_lock has left the bucket */
+    file_$lot_bucket_lock(ctx.hash_index);
     if (*status_ret != 0) {
         status_$t sts = *status_ret;
         if (sts != 0x0F0004 && sts != 0x0F000B &&
             ((sts >> 8) & 0xFF) != 0x11 && sts != 0x0F0001) {
             goto done_unlock;
         }
-        ML_$LOCK(5);
-        FILE_$LOT_SEQN--;
+        /*
+         * The sequence number is not handed back: another bucket may
+         * already have advanced past it, and it only needs to be unique.
+         */
         priv_lock_release_entry(&ctx);
-        ML_$UNLOCK(5);
+        file_$lot_bucket_unlock(ctx.hash_index);
         /* Retry */
         goto done_success;
     }
@@ -552,7 +548,7 @@ error_cleanup:
 
 done_unlock:
     priv_lock_release_entry(&ctx);
-    ML_$UNLOCK(5);
+    file_$lot_bucket_unlock(ctx.hash_index);
 
 done:
     if (*status_ret == file_$object_in_use) {
@@ -575,10 +571,10 @@ static status_$t priv_lock_alloc_entry(priv_lock_ctx_t *ctx, uint8_t fill_entry,
 {
     uint16_t entry_idx;
     file_lock_entry_detail_t *entry;
-    int i;
+    int16_t slot;
 
     /* Get entry from free list */
-    entry_idx = FILE_$LOT_FREE;
+    entry_idx = file_$lot_alloc();
     if (entry_idx == 0) {
         return file_$local_lock_table_full;
     }
@@ -586,14 +582,6 @@ static status_$t priv_lock_alloc_entry(priv_lock_ctx_t *ctx, uint8_t fill_entry,
     ctx->entry_index = entry_idx;
     entry = LOT_ENTRY(entry_idx);
 
-    /* Update free list */
-    FILE_$LOT_FREE = entry->next;
-
-    /* Track highest allocated */
-    if (entry_idx > FILE_$LOT_HIGH) {
-        FILE_$LOT_HIGH = entry_idx;
-    }
-
     /* Fill in entry if requested */
     if (fill_entry >= 0) {
         entry->uid_high = ctx->file_uid->high;
@@ -634,19 +622,14 @@ static status_$t priv_lock_alloc_entry(priv_lock_ctx_t *ctx, uint8_t fill_entry,
         return 0;
     }
 
-    for (i = 1; i <= FILE_PROC_LOCK_MAX_ENTRIES; i++) {
-        if (PROC_LOT_ENTRY(ctx->asid, i) == 0) {
-            ctx->proc_slot = i;
-            PROC_LOT_ENTRY(ctx->asid, i) = entry_idx;
-            if (i > PROC_LOT_COUNT(ctx->asid)) {
-                PROC_LOT_COUNT(ctx->asid) = i;
-            }
-            *ctx->lock_ptr_out = i;
-            return 0;
-        }
+    slot = file_$lot_slot_add(ctx->asid, entry_idx, 0);
+    if (slot == 0) {
+        return file_$local_lock_table_full;
     }
 
-    return file_$local_lock_table_full;
+    ctx->proc_slot = slot;
+    *ctx->lock_ptr_out = slot;
+    return 0;
 }
 
 /*
@@ -724,11 +707,10 @@ static void priv_lock_remote_lock(priv_lock_ctx_t *ctx, file_lock_entry_detail_t
     status_$t local_status;
 
     if (is_new >= 0) {
-        FILE_$LOT_SEQN++;
-        entry->context = FILE_$LOT_SEQN;
+        entry->context = file_$lot_next_seqn();
     }
 
-    ML_$UNLOCK(5);
+    file_$lot_bucket_unlock(ctx->hash_index);
 
     REM_FILE_$LOCK((void *)&ctx->attr_buf[0x4C], side, mode, flags,
                    (uint16_t)(ctx->flags >> 24),
@@ -749,23 +731,13 @@ static void priv_lock_remote_lock(priv_lock_ctx_t *ctx, file_lock_entry_detail_t
  */
 static void priv_lock_release_entry(priv_lock_ctx_t *ctx)
 {
-    file_lock_entry_detail_t *entry;
-
     if (ctx->entry_index == 0) {
         return;
     }
 
-    entry = LOT_ENTRY(ctx->entry_index);
-
-    /* Add back to free list */
-    entry->next = FILE_$LOT_FREE;
-    entry->refcount = 0;
-    FILE_$LOT_FREE = ctx->entry_index;
-
-    /* Remove from per-process table */
-    if (ctx->proc_slot != 0) {
-        PROC_LOT_ENTRY(ctx->asid, ctx->proc_slot) = 0;
-    }
+    /* Remove from per-process table, then add back to free list */
+    file_$lot_drop(ctx->asid, ctx->proc_slot, 0);
+    file_$lot_free(ctx->entry_index);
 
     ctx->entry_index = 0;
     ctx->proc_slot = 0;
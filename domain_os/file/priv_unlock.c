@@ -27,19 +27,6 @@
 #include "ml/ml.h"
 #include "netlog/netlog.h"
 
-/*
- * Lock table base addresses (m68k target)
- */
-#define LOT_BASE        ((file_lock_entry_detail_t *)0xE935B0)
-#define LOT_ENTRY(n)    ((file_lock_entry_detail_t *)((uint8_t *)LOT_BASE + (n) * 0x1C))
-
-/* Per-process lock table */
-#define PROC_LOT_BASE   ((uint16_t *)0xE9F9CA)
-#define PROC_LOT_ENTRY(asid, idx) \
-    (*(uint16_t *)((uint8_t *)PROC_LOT_BASE + (asid) * 300 + (idx) * 2))
-#define PROC_LOT_COUNT(asid) \
-    (*(uint16_t *)((uint8_t *)0xEA3DC4 + (asid) * 2))
-
 /*
  * FILE_$PRIV_UNLOCK - Core file unlocking function
  */
@@ -71,6 +58,7 @@ uint8_t FILE_$PRIV_UNLOCK(uid_t *file_uid, uint16_t lock_index,
     uint8_t entry_mode;
     int8_t has_other_locks;
     int8_t has_exclusive;
+    uint8_t entry_refs;
     char attr_buf[100];
 
     *dtv_out = 0;
@@ -78,21 +66,19 @@ uint8_t FILE_$PRIV_UNLOCK(uid_t *file_uid, uint16_t lock_index,
     done_flag = 0;
 
     /* Compute hash for lookup */
-    hash_index = UID_$HASH(file_uid, NULL);
+    hash_index = file_$lot_hash(file_uid);
 
     /*
      * Skip unlock for special modes 8 and 9
      * These are pseudo-locks that don't require actual unlock
      */
     if ((remote_flags >= 0 || lock_mode == 8) && lock_mode != 9) {
-        int proc_table_base = asid * 300 + 0xE9F9CA - 0x2662;
-
         /*
          * Main unlock loop - may retry for mode 0 (unlock all of type)
          */
         while (1) {
             proc_slot = 0;
-            ML_$LOCK(5);
+            file_$lot_bucket_lock(hash_index);
 
             if (remote_flags < 0) {
                 /*
@@ -140,7 +126,7 @@ uint8_t FILE_$PRIV_UNLOCK(uid_t *file_uid, uint16_t lock_index,
                         uint16_t flag_val = 1;
                         AST_$SET_ATTRIBUTE(file_uid, 7, &flag_val, &local_status);
                     }
-                    ML_$UNLOCK(5);
+                    file_$lot_bucket_unlock(hash_index);
                     goto done_logging;
                 }
             } else if (lock_index == 0) {
@@ -203,14 +189,7 @@ uint8_t FILE_$PRIV_UNLOCK(uid_t *file_uid, uint16_t lock_index,
             }
 
             /*
-             * Found lock entry - clear from process table and process unlock
-             */
-            if (proc_slot != 0) {
-                PROC_LOT_ENTRY(asid, proc_slot) = 0;
-            }
-
-            /*
-             * Process the unlock
+             * Found lock entry - process the unlock
              */
             done_flag = -1;
 
@@ -233,9 +212,15 @@ uint8_t FILE_$PRIV_UNLOCK(uid_t *file_uid, uint16_t lock_index,
 
             int8_t is_exclusive = ((entry_mode == 4) || (entry_mode == 0x0B)) ? -1 : 0;
 
-            /* Decrement reference count */
-            entry->refcount--;
-            if (entry->refcount != 0) {
+            /* Clear from process table and drop the reference */
+            entry_refs = file_$lot_drop(asid, proc_slot, found_entry);
+
+            /* Byte-range locks do not outlive the object lock */
+            if (remote_flags >= 0) {
+                file_$range_unlock_object(hash_index, file_uid, asid);
+            }
+
+            if (entry_refs != 0) {
                 goto done_unlock;
             }
 
@@ -262,8 +247,9 @@ uint8_t FILE_$PRIV_UNLOCK(uid_t *file_uid, uint16_t lock_index,
                             LOT_ENTRY(prev_entry)->next = entry->next;
                         }
                         /* Add to free list */
-                        entry->next = FILE_$LOT_FREE;
-                        FILE_$LOT_FREE = found_entry;
+                        file_$lot_free(found_entry);
+                        current = next;
+                        continue;
                     } else {
                         /* Another lock on same file */
                         has_other_locks = -1;
@@ -301,7 +287,7 @@ uint8_t FILE_$PRIV_UNLOCK(uid_t *file_uid, uint16_t lock_index,
                 }
             }
 
-            ML_$UNLOCK(5);
+            file_$lot_bucket_unlock(hash_index);
 
             /*
              * Handle remote unlock if needed
@@ -355,12 +341,12 @@ uint8_t FILE_$PRIV_UNLOCK(uid_t *file_uid, uint16_t lock_index,
              * If mode is 0 (unlock all), continue loop
              */
             if (local_status != 0 || lock_mode != 0) {
-                break;
+                goto done_logging;
             }
         }  /* end while loop */
 
 done_unlock:
-        ML_$UNLOCK(5);
+        file_$lot_bucket_unlock(hash_index);
     }
 
 done_logging:
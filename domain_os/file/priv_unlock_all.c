@@ -12,7 +12,7 @@
  *
  * Assembly analysis:
  *   - If *asid_ptr == 0, processes ASIDs 0-57 (0x39)
- *   - For each process, iterates through lock table entries
+ *   - For each process, iterates through occupied lock table slots
  *   - For entries with refcount >= 2, just decrements and clears slot
  *   - For entries with refcount < 2, calls FILE_$PRIV_UNLOCK
  *   - Finally calls REM_FILE_$UNLOCK_ALL if *asid_ptr == 0
@@ -21,19 +21,6 @@
 #include "file/file_internal.h"
 #include "ml/ml.h"
 
-/*
- * Lock table base addresses (m68k target)
- */
-#define LOT_BASE        ((file_lock_entry_detail_t *)0xE935B0)
-#define LOT_ENTRY(n)    ((file_lock_entry_detail_t *)((uint8_t *)LOT_BASE + (n) * 0x1C))
-
-/* Per-process lock table */
-#define PROC_LOT_BASE   ((uint16_t *)0xE9F9CA)
-#define PROC_LOT_ENTRY(asid, idx) \
-    (*(uint16_t *)((uint8_t *)PROC_LOT_BASE + (asid) * 300 + (idx) * 2))
-#define PROC_LOT_COUNT(asid) \
-    (*(uint16_t *)((uint8_t *)0xEA3DC4 + (asid) * 2))
-
 /*
  * FILE_$PRIV_UNLOCK_ALL - Unlock all locks for a process
  */
@@ -41,13 +28,14 @@ void FILE_$PRIV_UNLOCK_ALL(uint16_t *asid_ptr)
 {
     uint16_t start_asid, end_asid;
     uint16_t asid;
-    int16_t count;
     uint16_t slot;
     uint16_t entry_idx;
+    int16_t hash_index;
     file_lock_entry_detail_t *entry;
     uid_t local_uid;
     uint32_t dtv_out[2];
     status_$t local_status;
+    ml_$spin_token_t token;
 
     /*
      * Determine range of ASIDs to process
@@ -62,69 +50,70 @@ void FILE_$PRIV_UNLOCK_ALL(uint16_t *asid_ptr)
         end_asid = *asid_ptr;
     }
 
-    ML_$LOCK(5);
-
     /*
-     * Iterate through each ASID in range
+     * Iterate through each ASID in range.  Slots are kept dense and the
+     * held count says how many are occupied, so processes holding no
+     * locks are skipped and the walk stops once the last lock is gone.
      */
     for (asid = start_asid; asid <= end_asid; asid++) {
-        count = PROC_LOT_COUNT(asid) - 1;
-        if (count >= 0) {
-            /*
-             * Iterate through all slots for this ASID
-             */
-            for (slot = 1; slot <= (uint16_t)(count + 1); slot++) {
-                entry_idx = PROC_LOT_ENTRY(asid, slot);
-                if (entry_idx != 0) {
-                    entry = LOT_ENTRY(entry_idx);
-
-                    /*
-                     * Check refcount to decide how to handle
-                     */
-                    if (entry->refcount >= 2) {
-                        /*
-                         * Multiple references - just decrement and clear slot
-                         * Don't actually unlock yet
-                         */
-                        PROC_LOT_ENTRY(asid, slot) = 0;
-                        entry->refcount--;
-                    } else {
-                        /*
-                         * Single reference - need to fully unlock
-                         * Save UID before unlock releases the entry
-                         */
-                        local_uid.high = entry->uid_high;
-                        local_uid.low = entry->uid_low;
+        /* Byte-range locks go first; they refine the object locks below */
+        if (FILE_$RANGE_OWNED[asid] != 0) {
+            file_$range_unlock_asid(asid);
+        }
 
-                        ML_$UNLOCK(5);
+        for (slot = 1;
+             FILE_$PROC_LOT_HELD[asid] != 0 && slot <= PROC_LOT_COUNT(asid);
+             slot++) {
+            entry_idx = PROC_LOT_ENTRY(asid, slot);
+            if (entry_idx == 0) {
+                continue;
+            }
+            entry = LOT_ENTRY(entry_idx);
 
-                        /*
-                         * Call FILE_$PRIV_UNLOCK for this entry
-                         * Pass lock mode 0 to match any, and the slot number
-                         */
-                        FILE_$PRIV_UNLOCK(&local_uid,
-                                          (uint16_t)slot,
-                                          (uint32_t)asid,  /* mode=0, asid in low word */
-                                          0,               /* remote_flags */
-                                          0,               /* param_5 */
-                                          0,               /* param_6 */
-                                          dtv_out,         /* dtv_out */
-                                          &local_status);
+            local_uid.high = entry->uid_high;
+            local_uid.low = entry->uid_low;
+            hash_index = file_$lot_hash(&local_uid);
 
-                        ML_$LOCK(5);
-                    }
-                }
+            /*
+             * Check refcount to decide how to handle.  Only holders of
+             * the bucket take a reference count to zero, so a count of
+             * two or more seen here cannot drop out from under us.
+             */
+            file_$lot_bucket_lock(hash_index);
+            if (entry->refcount >= 2) {
+                /*
+                 * Multiple references - just decrement and clear slot
+                 * Don't actually unlock yet
+                 */
+                file_$lot_drop(asid, slot, entry_idx);
+                file_$lot_bucket_unlock(hash_index);
+                continue;
             }
+            file_$lot_bucket_unlock(hash_index);
+
+            /*
+             * Single reference - need to fully unlock
+             * Pass lock mode 0 to match any, and the slot number
+             */
+            FILE_$PRIV_UNLOCK(&local_uid,
+                              (uint16_t)slot,
+                              (uint32_t)asid,  /* mode=0, asid in low word */
+                              0,               /* remote_flags */
+                              0,               /* param_5 */
+                              0,               /* param_6 */
+                              dtv_out,         /* dtv_out */
+                              &local_status);
         }
 
         /*
          * Clear the count for this ASID
          */
+        token = ML_$SPIN_LOCK(&FILE_$LOT_SPIN_LOCK);
         PROC_LOT_COUNT(asid) = 0;
+        FILE_$PROC_LOT_HELD[asid] = 0;
+        ML_$SPIN_UNLOCK(&FILE_$LOT_SPIN_LOCK, token);
     }
 
-    ML_$UNLOCK(5);
-
     /*
      * If unlocking all processes, also unlock all remote locks
      */
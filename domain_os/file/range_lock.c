@@ -0,0 +1,653 @@
+/*
+ * FILE byte-range locks
+ *
+ * FILE_$LOCK_RANGE / FILE_$UNLOCK_RANGE and the helpers used by the
+ * export, import and unlock-all paths.
+ *
+ * A range lock refines a whole-object lock the process already holds on
+ * a local object: the whole-object lock decides who may open the file
+ * for writing at all, and range locks let holders of a shared mode keep
+ * out of each other's regions.
+ *
+ * The ranges on one object are kept in an AVL tree keyed on start
+ * offset (ties broken by node index), each node also carrying the
+ * largest end offset found in its subtree.  A conflict search skips any
+ * subtree whose largest end is below the request and stops walking right
+ * once nodes start past it, so it visits O(log n + k) nodes.
+ *
+ * Locking follows the lock table: an object's tree and record are only
+ * touched with its hash bucket held; the pools and per-process lists use
+ * FILE_$LOT_SPIN_LOCK, taken after the bucket.
+ */
+
+#include "file/file_internal.h"
+
+#define RL(n)       (&FILE_$RANGE_LOCKS[(n)])
+#define RL_OBJ(n)   (&FILE_$RANGE_OBJS[(n)])
+
+/*
+ * ============================================================================
+ * Interval tree
+ * ============================================================================
+ */
+
+static int8_t rl_height(uint16_t n)
+{
+    return (n != 0) ? RL(n)->height : 0;
+}
+
+/* Recompute height and max_end of a node from its children */
+static void rl_update(uint16_t n)
+{
+    file_range_lock_t *r = RL(n);
+    int8_t hl = rl_height(r->left);
+    int8_t hr = rl_height(r->right);
+
+    r->height = ((hl > hr) ? hl : hr) + 1;
+    r->max_end = r->end;
+    if (r->left != 0 && RL(r->left)->max_end > r->max_end) {
+        r->max_end = RL(r->left)->max_end;
+    }
+    if (r->right != 0 && RL(r->right)->max_end > r->max_end) {
+        r->max_end = RL(r->right)->max_end;
+    }
+}
+
+static uint16_t rl_rotate_right(uint16_t n)
+{
+    uint16_t l = RL(n)->left;
+
+    RL(n)->left = RL(l)->right;
+    RL(l)->right = n;
+    rl_update(n);
+    rl_update(l);
+    return l;
+}
+
+static uint16_t rl_rotate_left(uint16_t n)
+{
+    uint16_t r = RL(n)->right;
+
+    RL(n)->right = RL(r)->left;
+    RL(r)->left = n;
+    rl_update(n);
+    rl_update(r);
+    return r;
+}
+
+/* Restore the AVL invariant at n; returns the subtree's new root */
+static uint16_t rl_balance(uint16_t n)
+{
+    int16_t bal;
+    uint16_t child;
+
+    rl_update(n);
+    bal = rl_height(RL(n)->left) - rl_height(RL(n)->right);
+
+    if (bal > 1) {
+        child = RL(n)->left;
+        if (rl_height(RL(child)->left) < rl_height(RL(child)->right)) {
+            RL(n)->left = rl_rotate_left(child);
+        }
+        return rl_rotate_right(n);
+    }
+    if (bal < -1) {
+        child = RL(n)->right;
+        if (rl_height(RL(child)->right) < rl_height(RL(child)->left)) {
+            RL(n)->right = rl_rotate_right(child);
+        }
+        return rl_rotate_left(n);
+    }
+    return n;
+}
+
+/* -1 if node a sorts before node b */
+static int8_t rl_before(uint16_t a, uint16_t b)
+{
+    if (RL(a)->start != RL(b)->start) {
+        return (RL(a)->start < RL(b)->start) ? -1 : 0;
+    }
+    return (a < b) ? -1 : 0;
+}
+
+static uint16_t rl_insert(uint16_t root, uint16_t n)
+{
+    if (root == 0) {
+        RL(n)->left = 0;
+        RL(n)->right = 0;
+        rl_update(n);
+        return n;
+    }
+    if (rl_before(n, root) < 0) {
+        RL(root)->left = rl_insert(RL(root)->left, n);
+    } else {
+        RL(root)->right = rl_insert(RL(root)->right, n);
+    }
+    return rl_balance(root);
+}
+
+/* Detach the leftmost node of a subtree */
+static uint16_t rl_remove_min(uint16_t root, uint16_t *min_out)
+{
+    if (RL(root)->left == 0) {
+        *min_out = root;
+        return RL(root)->right;
+    }
+    RL(root)->left = rl_remove_min(RL(root)->left, min_out);
+    return rl_balance(root);
+}
+
+static uint16_t rl_remove(uint16_t root, uint16_t n)
+{
+    uint16_t succ;
+    uint16_t right;
+
+    if (root == 0) {
+        return 0;
+    }
+
+    if (root == n) {
+        if (RL(n)->left == 0) {
+            return RL(n)->right;
+        }
+        if (RL(n)->right == 0) {
+            return RL(n)->left;
+        }
+        right = rl_remove_min(RL(n)->right, &succ);
+        RL(succ)->left = RL(n)->left;
+        RL(succ)->right = right;
+        return rl_balance(succ);
+    }
+
+    if (rl_before(n, root) < 0) {
+        RL(root)->left = rl_remove(RL(root)->left, n);
+    } else {
+        RL(root)->right = rl_remove(RL(root)->right, n);
+    }
+    return rl_balance(root);
+}
+
+/*
+ * Find a range overlapping [start, end] that conflicts with a request
+ * of the given mode from asid/group.  Returns its index or 0.
+ */
+static uint16_t rl_conflict(uint16_t n, uint32_t start, uint32_t end,
+                            uint8_t mode, int16_t asid, uint32_t group)
+{
+    file_range_lock_t *r;
+    uint16_t hit;
+
+    while (n != 0) {
+        r = RL(n);
+        if (r->max_end < start) {
+            return 0;
+        }
+        if (r->left != 0) {
+            hit = rl_conflict(r->left, start, end, mode, asid, group);
+            if (hit != 0) {
+                return hit;
+            }
+        }
+        if (r->start > end) {
+            return 0;
+        }
+        if (r->end >= start && r->asid != asid && r->group != group &&
+            (mode == FILE_RANGE_WRITE || r->mode == FILE_RANGE_WRITE)) {
+            return n;
+        }
+        n = r->right;
+    }
+    return 0;
+}
+
+/*
+ * ============================================================================
+ * Pools and per-process lists (FILE_$LOT_SPIN_LOCK)
+ * ============================================================================
+ */
+
+static uint16_t rl_alloc(int16_t asid)
+{
+    ml_$spin_token_t token;
+    uint16_t n;
+    uint16_t head;
+
+    token = ML_$SPIN_LOCK(&FILE_$LOT_SPIN_LOCK);
+
+    n = FILE_$RANGE_FREE;
+    if (n != 0) {
+        FILE_$RANGE_FREE = RL(n)->owner_next;
+
+        /* Put it on the front of the process's list */
+        head = FILE_$RANGE_OWNED[asid];
+        RL(n)->owner_prev = 0;
+        RL(n)->owner_next = head;
+        if (head != 0) {
+            RL(head)->owner_prev = n;
+        }
+        FILE_$RANGE_OWNED[asid] = n;
+        RL(n)->asid = (uint8_t)asid;
+        RL(n)->height = 1;
+    }
+
+    ML_$SPIN_UNLOCK(&FILE_$LOT_SPIN_LOCK, token);
+    return n;
+}
+
+static void rl_free(uint16_t n)
+{
+    ml_$spin_token_t token;
+    file_range_lock_t *r = RL(n);
+
+    token = ML_$SPIN_LOCK(&FILE_$LOT_SPIN_LOCK);
+
+    if (r->owner_prev != 0) {
+        RL(r->owner_prev)->owner_next = r->owner_next;
+    } else {
+        FILE_$RANGE_OWNED[r->asid] = r->owner_next;
+    }
+    if (r->owner_next != 0) {
+        RL(r->owner_next)->owner_prev = r->owner_prev;
+    }
+
+    r->height = 0;
+    r->owner_prev = 0;
+    r->owner_next = FILE_$RANGE_FREE;
+    FILE_$RANGE_FREE = n;
+
+    ML_$SPIN_UNLOCK(&FILE_$LOT_SPIN_LOCK, token);
+}
+
+/* Object record for a UID in a bucket, created if asked (bucket held) */
+static uint16_t rl_obj(int16_t hash_index, uid_t *uid, int8_t create)
+{
+    ml_$spin_token_t token;
+    uint16_t o;
+
+    for (o = FILE_$RANGE_HASHTAB[hash_index]; o != 0; o = RL_OBJ(o)->next) {
+        if (RL_OBJ(o)->uid.high == uid->high && RL_OBJ(o)->uid.low == uid->low) {
+            return o;
+        }
+    }
+
+    if (create >= 0) {
+        return 0;
+    }
+
+    token = ML_$SPIN_LOCK(&FILE_$LOT_SPIN_LOCK);
+    o = FILE_$RANGE_OBJ_FREE;
+    if (o != 0) {
+        FILE_$RANGE_OBJ_FREE = RL_OBJ(o)->next;
+    }
+    ML_$SPIN_UNLOCK(&FILE_$LOT_SPIN_LOCK, token);
+
+    if (o != 0) {
+        RL_OBJ(o)->uid = *uid;
+        RL_OBJ(o)->root = 0;
+        RL_OBJ(o)->count = 0;
+        RL_OBJ(o)->next = FILE_$RANGE_HASHTAB[hash_index];
+        FILE_$RANGE_HASHTAB[hash_index] = o;
+    }
+    return o;
+}
+
+/* Drop an object record once its tree is empty (bucket held) */
+static void rl_obj_release(int16_t hash_index, uint16_t o)
+{
+    ml_$spin_token_t token;
+    uint16_t *link;
+
+    if (RL_OBJ(o)->count != 0) {
+        return;
+    }
+
+    for (link = &FILE_$RANGE_HASHTAB[hash_index]; *link != 0;
+         link = &RL_OBJ(*link)->next) {
+        if (*link == o) {
+            *link = RL_OBJ(o)->next;
+            break;
+        }
+    }
+
+    token = ML_$SPIN_LOCK(&FILE_$LOT_SPIN_LOCK);
+    RL_OBJ(o)->next = FILE_$RANGE_OBJ_FREE;
+    FILE_$RANGE_OBJ_FREE = o;
+    ML_$SPIN_UNLOCK(&FILE_$LOT_SPIN_LOCK, token);
+}
+
+/*
+ * ============================================================================
+ * Helpers
+ * ============================================================================
+ */
+
+/* Range node named by lock_index if asid holds it on file_uid, else 0 */
+static uint16_t rl_lookup(uid_t *file_uid, uint32_t lock_index, int16_t asid)
+{
+    uint16_t n = (uint16_t)(lock_index & ~FILE_RANGE_INDEX_FLAG);
+    file_range_lock_t *r;
+
+    if ((lock_index & FILE_RANGE_INDEX_FLAG) == 0 ||
+        n == 0 || n > FILE_RANGE_LOCK_MAX) {
+        return 0;
+    }
+
+    r = RL(n);
+    if (r->height == 0 || r->asid != asid ||
+        RL_OBJ(r->obj)->uid.high != file_uid->high ||
+        RL_OBJ(r->obj)->uid.low != file_uid->low) {
+        return 0;
+    }
+    return n;
+}
+
+/* Take a node out of its object's tree and free it (bucket held) */
+static void rl_release(int16_t hash_index, uint16_t n)
+{
+    uint16_t o = RL(n)->obj;
+
+    RL_OBJ(o)->root = rl_remove(RL_OBJ(o)->root, n);
+    RL_OBJ(o)->count--;
+    rl_free(n);
+    rl_obj_release(hash_index, o);
+}
+
+/* Link a filled-in node into its object's tree (bucket held) */
+static void rl_link(uint16_t n)
+{
+    uint16_t o = RL(n)->obj;
+
+    RL_OBJ(o)->root = rl_insert(RL_OBJ(o)->root, n);
+    RL_OBJ(o)->count++;
+}
+
+/*
+ * The caller must hold a local whole-object lock on the file.  Slots
+ * are dense, so the walk ends once every held lock has been seen.
+ */
+static void rl_check_object_lock(uid_t *file_uid, int16_t asid, status_$t *status_ret)
+{
+    file_lock_entry_detail_t *entry;
+    uint16_t entry_idx;
+    int16_t held;
+    int16_t slot;
+
+    *status_ret = file_$object_not_locked_by_this_process;
+    held = FILE_$PROC_LOT_HELD[asid];
+
+    for (slot = 1; held > 0 && slot <= PROC_LOT_COUNT(asid); slot++) {
+        entry_idx = PROC_LOT_ENTRY(asid, slot);
+        if (entry_idx == 0) {
+            continue;
+        }
+        held--;
+
+        entry = LOT_ENTRY(entry_idx);
+        if (entry->uid_high == file_uid->high && entry->uid_low == file_uid->low) {
+            if (entry->flags2 & FILE_LOCK_F2_REMOTE) {
+                *status_ret = file_$object_is_remote;
+            } else {
+                *status_ret = status_$ok;
+            }
+            return;
+        }
+    }
+}
+
+/*
+ * A handle that is not on the caller's list cannot be a range on a
+ * remote object, since those are never granted; say so rather than
+ * reporting the handle as bad.
+ */
+static void rl_check_remote(uid_t *file_uid, int16_t asid, status_$t not_held,
+                            status_$t *status_ret)
+{
+    status_$t status;
+
+    rl_check_object_lock(file_uid, asid, &status);
+    *status_ret = (status == file_$object_is_remote) ? status : not_held;
+}
+
+/*
+ * ============================================================================
+ * Public entry points
+ * ============================================================================
+ */
+
+void FILE_$LOCK_RANGE(uid_t *file_uid, uint32_t *start, uint32_t *length,
+                      uint16_t *range_mode, uint32_t *lock_index,
+                      status_$t *status_ret)
+{
+    int16_t asid = PROC1_$AS_ID;
+    uint16_t mode = *range_mode;
+    uint32_t first = *start;
+    uint32_t last;
+    uint32_t group;
+    int16_t hash_index;
+    uint16_t obj;
+    uint16_t n;
+
+    if (mode > FILE_RANGE_WRITE) {
+        *status_ret = file_$illegal_lock_request;
+        return;
+    }
+
+    if (*length == 0) {
+        last = 0xFFFFFFFF;
+    } else {
+        last = first + *length - 1;
+        if (last < first) {
+            *status_ret = file_$invalid_arg;
+            return;
+        }
+    }
+
+    rl_check_object_lock(file_uid, asid, status_ret);
+    if (*status_ret != status_$ok) {
+        return;
+    }
+
+    group = file_$lot_next_seqn();
+    hash_index = file_$lot_hash(file_uid);
+    file_$lot_bucket_lock(hash_index);
+
+    obj = rl_obj(hash_index, file_uid, 0);
+    if (obj != 0 &&
+        rl_conflict(RL_OBJ(obj)->root, first, last, (uint8_t)mode, asid, group) != 0) {
+        *status_ret = file_$object_in_use;
+        goto done;
+    }
+
+    if (obj == 0) {
+        obj = rl_obj(hash_index, file_uid, -1);
+        if (obj == 0) {
+            *status_ret = file_$local_lock_table_full;
+            goto done;
+        }
+    }
+
+    n = rl_alloc(asid);
+    if (n == 0) {
+        rl_obj_release(hash_index, obj);
+        *status_ret = file_$local_lock_table_full;
+        goto done;
+    }
+
+    RL(n)->start = first;
+    RL(n)->end = last;
+    RL(n)->mode = (uint8_t)mode;
+    RL(n)->group = group;
+    RL(n)->obj = obj;
+    rl_link(n);
+
+    *lock_index = FILE_RANGE_INDEX_FLAG | n;
+    *status_ret = status_$ok;
+
+done:
+    file_$lot_bucket_unlock(hash_index);
+}
+
+void FILE_$UNLOCK_RANGE(uid_t *file_uid, uint32_t *lock_index,
+                        status_$t *status_ret)
+{
+    int16_t hash_index;
+    uint16_t n;
+
+    hash_index = file_$lot_hash(file_uid);
+    file_$lot_bucket_lock(hash_index);
+
+    n = rl_lookup(file_uid, *lock_index, PROC1_$AS_ID);
+    if (n == 0) {
+        *status_ret = file_$object_not_locked_by_this_process;
+    } else {
+        rl_release(hash_index, n);
+        *status_ret = status_$ok;
+    }
+
+    file_$lot_bucket_unlock(hash_index);
+}
+
+/*
+ * ============================================================================
+ * Internal interfaces
+ * ============================================================================
+ */
+
+void file_$range_init(void)
+{
+    int16_t i;
+
+    for (i = 1; i <= FILE_RANGE_LOCK_MAX; i++) {
+        RL(i)->height = 0;
+        RL(i)->owner_next = (i < FILE_RANGE_LOCK_MAX) ? i + 1 : 0;
+    }
+    FILE_$RANGE_FREE = 1;
+
+    for (i = 1; i <= FILE_RANGE_OBJ_MAX; i++) {
+        RL_OBJ(i)->next = (i < FILE_RANGE_OBJ_MAX) ? i + 1 : 0;
+    }
+    FILE_$RANGE_OBJ_FREE = 1;
+
+    for (i = 0; i < FILE_LOT_HASH_MAX; i++) {
+        FILE_$RANGE_HASHTAB[i] = 0;
+    }
+    for (i = 0; i < FILE_LOCK_TABLE_ENTRIES; i++) {
+        FILE_$RANGE_OWNED[i] = 0;
+    }
+}
+
+void file_$range_unlock_asid(int16_t asid)
+{
+    ml_$spin_token_t token;
+    int16_t hash_index;
+    uid_t uid;
+    uint16_t n;
+
+    for (;;) {
+        token = ML_$SPIN_LOCK(&FILE_$LOT_SPIN_LOCK);
+        n = FILE_$RANGE_OWNED[asid];
+        ML_$SPIN_UNLOCK(&FILE_$LOT_SPIN_LOCK, token);
+
+        if (n == 0) {
+            break;
+        }
+
+        uid = RL_OBJ(RL(n)->obj)->uid;
+        hash_index = file_$lot_hash(&uid);
+
+        file_$lot_bucket_lock(hash_index);
+        rl_release(hash_index, n);
+        file_$lot_bucket_unlock(hash_index);
+    }
+}
+
+void file_$range_unlock_object(int16_t hash_index, uid_t *file_uid,
+                               int16_t asid)
+{
+    ml_$spin_token_t token;
+    status_$t status;
+    file_range_obj_t *obj;
+    uint16_t n;
+    uint16_t next;
+
+    if (FILE_$RANGE_OWNED[asid] == 0) {
+        return;
+    }
+
+    /* Another lock on the object still covers the ranges */
+    rl_check_object_lock(file_uid, asid, &status);
+    if (status != file_$object_not_locked_by_this_process) {
+        return;
+    }
+
+    token = ML_$SPIN_LOCK(&FILE_$LOT_SPIN_LOCK);
+    n = FILE_$RANGE_OWNED[asid];
+    ML_$SPIN_UNLOCK(&FILE_$LOT_SPIN_LOCK, token);
+
+    while (n != 0) {
+        token = ML_$SPIN_LOCK(&FILE_$LOT_SPIN_LOCK);
+        next = RL(n)->owner_next;
+        ML_$SPIN_UNLOCK(&FILE_$LOT_SPIN_LOCK, token);
+
+        obj = RL_OBJ(RL(n)->obj);
+        if (obj->uid.high == file_uid->high && obj->uid.low == file_uid->low) {
+            rl_release(hash_index, n);
+        }
+        n = next;
+    }
+}
+
+void file_$range_export(uid_t *file_uid, uint16_t lock_index,
+                        int16_t asid, int16_t target_asid,
+                        uint16_t *index_out, status_$t *status_ret)
+{
+    int16_t hash_index;
+    uint16_t n;
+    uint16_t copy;
+
+    hash_index = file_$lot_hash(file_uid);
+    file_$lot_bucket_lock(hash_index);
+
+    n = rl_lookup(file_uid, lock_index, asid);
+    if (n == 0) {
+        rl_check_remote(file_uid, asid, file_$object_not_locked_by_this_process,
+                        status_ret);
+        goto done;
+    }
+
+    copy = rl_alloc(target_asid);
+    if (copy == 0) {
+        *status_ret = file_$local_lock_table_full;
+        goto done;
+    }
+
+    RL(copy)->start = RL(n)->start;
+    RL(copy)->end = RL(n)->end;
+    RL(copy)->mode = RL(n)->mode;
+    RL(copy)->group = RL(n)->group;
+    RL(copy)->obj = RL(n)->obj;
+    rl_link(copy);
+
+    *index_out = FILE_RANGE_INDEX_FLAG | copy;
+    *status_ret = status_$ok;
+
+done:
+    file_$lot_bucket_unlock(hash_index);
+}
+
+void file_$range_import(uid_t *file_uid, uint16_t lock_index, int16_t asid,
+                        status_$t *status_ret)
+{
+    int16_t hash_index;
+    uint16_t n;
+
+    hash_index = file_$lot_hash(file_uid);
+    file_$lot_bucket_lock(hash_index);
+    n = rl_lookup(file_uid, lock_index, asid);
+    if (n == 0) {
+        rl_check_remote(file_uid, asid, file_$invalid_arg, status_ret);
+    } else {
+        *status_ret = status_$ok;
+    }
+    file_$lot_bucket_unlock(hash_index);
+}
@@ -14,6 +14,8 @@
  *   - Checks if UID is local vs volume-based
  *   - Uses DISK_$LVUID_TO_VOLX to map volume UIDs
  *   - Iterates through lock table with ML_$LOCK(5) protection
+ *     (now: scan under the lock table spin lock, then copy the entry
+ *     under its hash bucket lock via file_$lot_snapshot)
  *   - Calls FILE_$VERIFY_LOCK_HOLDER to verify lock validity
  */
 
@@ -82,6 +84,8 @@ void FILE_$READ_LOCK_ENTRYI(uid_t *file_uid, uint16_t *index,
     uint16_t volx_table[3];
     uint8_t byte0, byte1;
     int16_t short1;
+    ml_$spin_token_t token;
+    file_lock_entry_detail_t snap;
 
     /* Start index: if 0 passed, start at 1 */
     start_index = *index;
@@ -139,7 +143,7 @@ void FILE_$READ_LOCK_ENTRYI(uid_t *file_uid, uint16_t *index,
         local_status = 0x000F000C;  /* file_$no_more_lock_entries */
         found_entry = 0;
 
-        ML_$LOCK(5);
+        token = ML_$SPIN_LOCK(&FILE_$LOT_SPIN_LOCK);
 
         if (is_per_asid < 0) {
             /*
@@ -217,17 +221,26 @@ void FILE_$READ_LOCK_ENTRYI(uid_t *file_uid, uint16_t *index,
         /*
          * If no entry found, we're done
          */
+        ML_$SPIN_UNLOCK(&FILE_$LOT_SPIN_LOCK, token);
+
         if (found_entry == 0) {
-            ML_$UNLOCK(5);
             start_index = 0xFFFF;
             goto done;
         }
 
         /*
-         * Found an entry - extract information
+         * Found an entry - copy it under its bucket lock.  If it was
+         * unlocked in the meantime, move on to the next one.
+         */
+        if (file_$lot_snapshot(found_entry, &snap) >= 0) {
+            local_status = file_$object_not_locked_by_this_process;
+            continue;
+        }
+
+        /*
+         * Extract information (offsets relative to the end of the entry)
          */
-        int32_t entry_offset = found_entry * LOT_ENTRY_SIZE;
-        uint8_t *entry_base = (uint8_t *)(LOT_DATA_BASE + LOT_ENTRY_SIZE + entry_offset);
+        uint8_t *entry_base = (uint8_t *)&snap + LOT_ENTRY_SIZE;
 
         /* File UID: at offsets -0x10 and -0x0C */
         info_out->file_uid.high = *(uint32_t *)(entry_base - 0x10);
@@ -280,8 +293,6 @@ void FILE_$READ_LOCK_ENTRYI(uid_t *file_uid, uint16_t *index,
             info_out->remote_info = *(uint32_t *)(entry_base - 0x14);
         }
 
-        ML_$UNLOCK(5);
-
         /*
          * For global queries with non-zero uid_low, verify lock holder
          * Skip verification for per-ASID queries (uid_low is always the ASID pattern)
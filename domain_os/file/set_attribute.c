@@ -149,6 +149,13 @@ void FILE_$SET_ATTRIBUTE(uid_t *file_uid, int16_t attr_id, void *value,
         }
     }
 
-    /* Set the attribute locally via AST */
-    AST_$SET_ATTRIBUTE(file_uid, attr_id, value, status_ret);
+    /*
+     * Set the attribute locally via AST.  Timestamp updates on local
+     * objects are queued there and coalesced until the next write-back.
+     */
+    if ((lookup_context.remote_flags & 0x80) == 0) {
+        AST_$DEFER_ATTRIBUTE(file_uid, attr_id, value, status_ret);
+    } else {
+        AST_$SET_ATTRIBUTE(file_uid, attr_id, value, status_ret);
+    }
 }
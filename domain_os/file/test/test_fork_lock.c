@@ -18,6 +18,7 @@
  *   - Per-process lock table: 0xE9F9CA + ASID*300 + slot*2
  *   - Lock entry refcounts:   0xE935BC + entry*0x1C + 0x0C
  *   - Slot counts:            0xEA3DC4 + ASID*2
+ *   - Held counts:            FILE_$PROC_LOT_HELD[ASID]
  *
  * For testing, we use small arrays and verify the algorithm directly.
  */
@@ -33,14 +34,15 @@ static uint16_t slot_table[TEST_MAX_ASID][TEST_MAX_SLOTS + 1]; /* slots 0..MAX *
 /* Simulated slot counts per ASID */
 static int16_t slot_count[TEST_MAX_ASID];
 
+/* Simulated held (occupied slot) counts per ASID */
+static uint16_t held_count[TEST_MAX_ASID];
+
 /* Simulated lock entry data (refcount at offset 0x0C) */
 static uint8_t entry_data[TEST_MAX_ENTRIES][TEST_ENTRY_SIZE];
 
-/* Mock ML_$LOCK / ML_$UNLOCK tracking */
+/* Mock ML_$SPIN_LOCK / ML_$SPIN_UNLOCK tracking */
 static int mock_lock_called;
 static int mock_unlock_called;
-static int16_t mock_lock_num;
-static int16_t mock_unlock_num;
 
 /* Mock PROC1_$AS_ID */
 static int16_t mock_parent_asid;
@@ -49,12 +51,11 @@ static void reset_mocks(void) {
     int i, j;
     mock_lock_called = 0;
     mock_unlock_called = 0;
-    mock_lock_num = -1;
-    mock_unlock_num = -1;
     mock_parent_asid = 0;
 
     for (i = 0; i < TEST_MAX_ASID; i++) {
         slot_count[i] = 0;
+        held_count[i] = 0;
         for (j = 0; j <= TEST_MAX_SLOTS; j++) {
             slot_table[i][j] = 0;
         }
@@ -79,28 +80,24 @@ static void fork_lock_sim(uint16_t *new_asid, status_$t *status_ret) {
 
     *status_ret = status_$ok;
 
+    child_asid = *new_asid;
+
     mock_lock_called++;
-    mock_lock_num = 5;
 
     count = slot_count[parent_asid];
 
-    if (count != 0) {
-        child_asid = *new_asid;
-
-        for (i = 1; i <= count; i++) {
-            entry_idx = slot_table[parent_asid][i];
-            if (entry_idx != 0) {
-                slot_table[child_asid][i] = entry_idx;
-                entry_data[entry_idx][0x0C]++;
-            }
+    for (i = 1; i <= count; i++) {
+        entry_idx = slot_table[parent_asid][i];
+        if (entry_idx != 0) {
+            slot_table[child_asid][i] = entry_idx;
+            entry_data[entry_idx][0x0C]++;
         }
     }
 
-    child_asid = *new_asid;
     slot_count[child_asid] = slot_count[parent_asid];
+    held_count[child_asid] = held_count[parent_asid];
 
     mock_unlock_called++;
-    mock_unlock_num = 5;
 }
 
 /*
@@ -121,8 +118,6 @@ void test_fork_lock_no_locks(void) {
     ASSERT_EQ(slot_count[1], 0);
     ASSERT_EQ(mock_lock_called, 1);
     ASSERT_EQ(mock_unlock_called, 1);
-    ASSERT_EQ(mock_lock_num, 5);
-    ASSERT_EQ(mock_unlock_num, 5);
 }
 
 /*
@@ -167,6 +162,7 @@ void test_fork_lock_sparse_entries(void) {
     slot_table[1][3] = 5;
     slot_table[1][4] = 0;  /* empty */
     slot_table[1][5] = 7;
+    held_count[1] = 3;
 
     entry_data[2][0x0C] = 1;
     entry_data[5][0x0C] = 3;
@@ -176,6 +172,7 @@ void test_fork_lock_sparse_entries(void) {
 
     ASSERT_EQ(status, status_$ok);
     ASSERT_EQ(slot_count[3], 5);
+    ASSERT_EQ(held_count[3], 3);
 
     /* Non-zero entries copied */
     ASSERT_EQ(slot_table[3][1], 2);
@@ -0,0 +1,284 @@
+/*
+ * Unit tests for FILE_$LOCK_RANGE / FILE_$UNLOCK_RANGE
+ *
+ * Tests conflict detection between overlapping and adjacent byte ranges,
+ * and that a process's ranges go away with its object lock and at
+ * process exit.  Linked against range_lock.c; the bucket locks, hash and
+ * sequence numbers are mocked.
+ *
+ * The lock table and per-process slot tables live at fixed m68k
+ * addresses (LOT_BASE, PROC_LOT_BASE), so the tests map that region
+ * before touching them.
+ */
+
+#include "file/file_internal.h"
+
+#define TEST_UID_HIGH   0x00012345
+#define TEST_UID_LOW    0x00000077
+#define TEST_LOT_MAP    0xE93000
+#define TEST_LOT_SIZE   0x12000
+
+/*
+ * Host mmap; <sys/mman.h> clashes with base.h's size_t.  Flags are the
+ * Linux values (PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_FIXED|MAP_ANONYMOUS).
+ */
+extern void *mmap(void *addr, unsigned long len, int prot, int flags,
+                  int fd, long off);
+#define TEST_PROT_RW    0x03
+#define TEST_MAP_FLAGS  0x32
+
+/* Storage normally defined in file_data.c */
+file_range_lock_t FILE_$RANGE_LOCKS[FILE_RANGE_LOCK_MAX + 1];
+file_range_obj_t  FILE_$RANGE_OBJS[FILE_RANGE_OBJ_MAX + 1];
+uint16_t FILE_$RANGE_HASHTAB[FILE_LOT_HASH_MAX];
+uint16_t FILE_$RANGE_FREE;
+uint16_t FILE_$RANGE_OBJ_FREE;
+uint16_t FILE_$RANGE_OWNED[FILE_LOCK_TABLE_ENTRIES];
+uint16_t FILE_$PROC_LOT_HELD[FILE_LOCK_TABLE_ENTRIES];
+uint16_t FILE_$LOT_SPIN_LOCK;
+uint16_t PROC1_$AS_ID;
+
+/* Mock state tracking */
+static uint32_t mock_seqn;
+static int mock_bucket_depth;
+
+ml_$spin_token_t ML_$SPIN_LOCK(void *lockp) { (void)lockp; return 0; }
+void ML_$SPIN_UNLOCK(void *lockp, ml_$spin_token_t token) { (void)lockp; (void)token; }
+
+int16_t file_$lot_hash(uid_t *uid) { return (int16_t)(uid->low % FILE_LOT_HASH_MAX); }
+void file_$lot_bucket_lock(int16_t hash_index) { (void)hash_index; mock_bucket_depth++; }
+void file_$lot_bucket_unlock(int16_t hash_index) { (void)hash_index; mock_bucket_depth--; }
+uint32_t file_$lot_next_seqn(void) { return ++mock_seqn; }
+
+static uid_t test_uid = { TEST_UID_HIGH, TEST_UID_LOW };
+
+/* Give asid a local whole-object lock on test_uid in slot 1 */
+static void hold_object_lock(int16_t asid, uint16_t entry_idx)
+{
+    file_lock_entry_detail_t *entry = LOT_ENTRY(entry_idx);
+
+    memset(entry, 0, sizeof(*entry));
+    entry->uid_high = test_uid.high;
+    entry->uid_low = test_uid.low;
+    PROC_LOT_ENTRY(asid, 1) = entry_idx;
+    PROC_LOT_COUNT(asid) = 1;
+    FILE_$PROC_LOT_HELD[asid] = 1;
+}
+
+/* What file_$lot_drop does to the process's slot table */
+static void drop_object_lock(int16_t asid)
+{
+    PROC_LOT_ENTRY(asid, 1) = 0;
+    FILE_$PROC_LOT_HELD[asid] = 0;
+}
+
+static void reset_mocks(void)
+{
+    static int mapped;
+
+    if (!mapped) {
+        mmap((void *)TEST_LOT_MAP, TEST_LOT_SIZE, TEST_PROT_RW,
+             TEST_MAP_FLAGS, -1, 0);
+        mapped = 1;
+    }
+    memset((void *)TEST_LOT_MAP, 0, TEST_LOT_SIZE);
+    memset(FILE_$PROC_LOT_HELD, 0, sizeof(FILE_$PROC_LOT_HELD));
+    mock_seqn = 0;
+    mock_bucket_depth = 0;
+
+    file_$range_init();
+    hold_object_lock(1, 3);
+    hold_object_lock(2, 4);
+}
+
+static status_$t lock_range(int16_t asid, uint32_t start, uint32_t length,
+                            uint16_t mode, uint32_t *index)
+{
+    status_$t status;
+
+    PROC1_$AS_ID = asid;
+    FILE_$LOCK_RANGE(&test_uid, &start, &length, &mode, index, &status);
+    return status;
+}
+
+static int16_t free_nodes(void)
+{
+    int16_t count = 0;
+    uint16_t n;
+
+    for (n = FILE_$RANGE_FREE; n != 0; n = FILE_$RANGE_LOCKS[n].owner_next) {
+        count++;
+    }
+    return count;
+}
+
+/*
+ * Test: Overlapping ranges
+ * Expected: Write conflicts with any overlap from another process;
+ * reads share; a process never conflicts with itself
+ */
+void test_range_lock_overlapping(void)
+{
+    uint32_t a, b, c;
+
+    reset_mocks();
+
+    ASSERT_EQ(lock_range(1, 0, 100, FILE_RANGE_WRITE, &a), status_$ok);
+    ASSERT_EQ(a & FILE_RANGE_INDEX_FLAG, FILE_RANGE_INDEX_FLAG);
+    ASSERT_EQ(lock_range(2, 50, 100, FILE_RANGE_WRITE, &b), file_$object_in_use);
+    ASSERT_EQ(lock_range(2, 99, 1, FILE_RANGE_READ, &b), file_$object_in_use);
+    ASSERT_EQ(lock_range(1, 50, 100, FILE_RANGE_WRITE, &c), status_$ok);
+
+    ASSERT_EQ(lock_range(1, 1000, 100, FILE_RANGE_READ, &a), status_$ok);
+    ASSERT_EQ(lock_range(2, 1050, 10, FILE_RANGE_READ, &b), status_$ok);
+    ASSERT_EQ(lock_range(2, 1090, 20, FILE_RANGE_WRITE, &b), file_$object_in_use);
+
+    /* Length 0 runs to the end of the file */
+    ASSERT_EQ(lock_range(2, 5000, 0, FILE_RANGE_WRITE, &b), status_$ok);
+    ASSERT_EQ(lock_range(1, 0xFFFFFF00, 16, FILE_RANGE_READ, &a), file_$object_in_use);
+
+    ASSERT_EQ(mock_bucket_depth, 0);
+}
+
+/*
+ * Test: Adjacent ranges
+ * Expected: [0,100) and [100,200) do not overlap, so two writers coexist
+ */
+void test_range_lock_adjacent(void)
+{
+    uint32_t a, b;
+
+    reset_mocks();
+
+    ASSERT_EQ(lock_range(1, 0, 100, FILE_RANGE_WRITE, &a), status_$ok);
+    ASSERT_EQ(lock_range(2, 100, 100, FILE_RANGE_WRITE, &b), status_$ok);
+    ASSERT_EQ(lock_range(2, 99, 2, FILE_RANGE_WRITE, &b), file_$object_in_use);
+}
+
+/*
+ * Test: Unlock a single range
+ * Expected: Only the holder can release it, after which the region is free
+ */
+void test_range_lock_unlock_one(void)
+{
+    uint32_t a, b;
+    status_$t status;
+
+    reset_mocks();
+
+    ASSERT_EQ(lock_range(1, 0, 100, FILE_RANGE_WRITE, &a), status_$ok);
+
+    PROC1_$AS_ID = 2;
+    FILE_$UNLOCK_RANGE(&test_uid, &a, &status);
+    ASSERT_EQ(status, file_$object_not_locked_by_this_process);
+
+    PROC1_$AS_ID = 1;
+    FILE_$UNLOCK_RANGE(&test_uid, &a, &status);
+    ASSERT_EQ(status, status_$ok);
+    ASSERT_EQ(lock_range(2, 0, 100, FILE_RANGE_WRITE, &b), status_$ok);
+}
+
+/*
+ * Test: Range locks need an object lock
+ * Expected: file_$object_not_locked_by_this_process without one
+ */
+void test_range_lock_needs_object_lock(void)
+{
+    uint32_t a;
+
+    reset_mocks();
+    drop_object_lock(1);
+
+    ASSERT_EQ(lock_range(1, 0, 100, FILE_RANGE_READ, &a),
+              file_$object_not_locked_by_this_process);
+}
+
+/*
+ * Test: Releasing the object lock releases the process's ranges
+ * Expected: Ranges stay while the object lock is held, then all of that
+ * process's ranges on the object are freed and other processes can lock
+ */
+void test_range_lock_released_with_object_lock(void)
+{
+    uint32_t a, b;
+    int16_t hash_index = file_$lot_hash(&test_uid);
+    int16_t before;
+
+    reset_mocks();
+    before = free_nodes();
+
+    ASSERT_EQ(lock_range(1, 0, 100, FILE_RANGE_WRITE, &a), status_$ok);
+    ASSERT_EQ(lock_range(1, 200, 100, FILE_RANGE_WRITE, &a), status_$ok);
+    ASSERT_EQ(lock_range(2, 400, 100, FILE_RANGE_WRITE, &b), status_$ok);
+
+    /* Still holding the object: nothing released */
+    file_$range_unlock_object(hash_index, &test_uid, 1);
+    ASSERT_EQ(free_nodes(), before - 3);
+
+    drop_object_lock(1);
+    file_$range_unlock_object(hash_index, &test_uid, 1);
+    ASSERT_EQ(FILE_$RANGE_OWNED[1], 0);
+    ASSERT_EQ(free_nodes(), before - 1);
+
+    ASSERT_EQ(lock_range(2, 0, 300, FILE_RANGE_WRITE, &b), status_$ok);
+}
+
+/*
+ * Test: Release all at process exit
+ * Expected: Every range the process held is back on the free list and the
+ * object record is freed once its tree is empty
+ */
+void test_range_lock_release_all(void)
+{
+    uint32_t a;
+    int16_t before;
+    uint32_t i;
+
+    reset_mocks();
+    before = free_nodes();
+
+    for (i = 0; i < 20; i++) {
+        ASSERT_EQ(lock_range(1, i * 10, 10, FILE_RANGE_WRITE, &a), status_$ok);
+    }
+    ASSERT_EQ(free_nodes(), before - 20);
+
+    file_$range_unlock_asid(1);
+    ASSERT_EQ(FILE_$RANGE_OWNED[1], 0);
+    ASSERT_EQ(free_nodes(), before);
+    ASSERT_EQ(FILE_$RANGE_HASHTAB[file_$lot_hash(&test_uid)], 0);
+}
+
+/*
+ * Test: Sharing range handles
+ * Expected: A held range is copied to another process and can then be
+ * imported there; a handle on an object locked on a remote node is
+ * refused with file_$object_is_remote, other bad handles as before
+ */
+void test_range_lock_export_import(void)
+{
+    uint32_t a;
+    uint16_t copy;
+    status_$t status;
+
+    reset_mocks();
+
+    ASSERT_EQ(lock_range(1, 0, 100, FILE_RANGE_WRITE, &a), status_$ok);
+    file_$range_export(&test_uid, (uint16_t)a, 1, 2, &copy, &status);
+    ASSERT_EQ(status, status_$ok);
+    file_$range_import(&test_uid, copy, 2, &status);
+    ASSERT_EQ(status, status_$ok);
+
+    file_$range_import(&test_uid, (uint16_t)a, 2, &status);
+    ASSERT_EQ(status, file_$invalid_arg);
+    file_$range_export(&test_uid, copy, 1, 2, &copy, &status);
+    ASSERT_EQ(status, file_$object_not_locked_by_this_process);
+
+    /* Nothing can be held on a remote object, so any handle is refused */
+    reset_mocks();
+    LOT_ENTRY(3)->flags2 |= FILE_LOCK_F2_REMOTE;
+    ASSERT_EQ(lock_range(1, 200, 100, FILE_RANGE_WRITE, &a), file_$object_is_remote);
+    file_$range_import(&test_uid, FILE_RANGE_INDEX_FLAG | 1, 1, &status);
+    ASSERT_EQ(status, file_$object_is_remote);
+    file_$range_export(&test_uid, FILE_RANGE_INDEX_FLAG | 1, 1, 2, &copy, &status);
+    ASSERT_EQ(status, file_$object_is_remote);
+}
@@ -21,6 +21,11 @@
  *   - If local ASID != current, checks ACL rights first
  *   - For local ASID: iterates through process lock table calling PRIV_UNLOCK
  *   - For remote (asid=0): iterates with READ_LOCK_ENTRYI matching node
+ *
+ * Both cases now visit only what is relevant: the local case stops once
+ * every slot the process holds has been seen and only calls PRIV_UNLOCK
+ * for slots on this file; the remote case walks the file's hash bucket
+ * rather than the whole lock table.
  */
 
 #include "file/file_internal.h"
@@ -30,9 +35,8 @@
 /* External reference not in headers */
 extern uint32_t NODE_$ME;
 
-/* Per-process lock count table */
-#define PROC_LOT_COUNT(asid) \
-    (*(uint16_t *)((uint8_t *)0xEA3DC4 + (asid) * 2))
+/* Remote entries collected per pass over the file's hash bucket */
+#define UNLOCK_PROC_BATCH   16
 
 /*
  * FILE_$UNLOCK_PROC - Unlock a file on behalf of a process
@@ -41,14 +45,18 @@ void FILE_$UNLOCK_PROC(uid_t *proc_uid, uid_t *file_uid, uint16_t *lock_mode,
                        uint32_t param_4, status_$t *status_ret)
 {
     int16_t asid;
-    int16_t count;
+    int16_t held;
     int16_t slot;
-    uint16_t iter_index;
+    int16_t hash_index;
+    int16_t entry_idx;
+    int16_t found, total, prev_total, i;
+    file_lock_entry_detail_t *entry;
     uint32_t dtv_out[2];
     uint16_t req_mode;
 
-    /* Lock entry info buffer from FILE_$READ_LOCK_ENTRYI */
-    file_lock_info_internal_t lock_info;
+    /* Remote entries (context, owner node) found in one bucket pass */
+    uint32_t batch_context[UNLOCK_PROC_BATCH];
+    uint32_t batch_node[UNLOCK_PROC_BATCH];
 
     /*
      * Determine ASID of target process
@@ -88,14 +96,24 @@ void FILE_$UNLOCK_PROC(uid_t *proc_uid, uid_t *file_uid, uint16_t *lock_mode,
      */
     if (asid != 0) {
         /*
-         * Local process - iterate through its lock table
+         * Local process - visit its occupied slots until every held lock
+         * has been seen, unlocking those on this file
          */
-        count = PROC_LOT_COUNT(asid) - 1;
-        if (count < 0) {
-            return;
-        }
+        held = FILE_$PROC_LOT_HELD[asid];
+
+        for (slot = 1; held > 0 && slot <= PROC_LOT_COUNT(asid); slot++) {
+            entry_idx = PROC_LOT_ENTRY(asid, slot);
+            if (entry_idx == 0) {
+                continue;
+            }
+            held--;
+
+            entry = LOT_ENTRY(entry_idx);
+            if ((entry->uid_high != file_uid->high) ||
+                (entry->uid_low != file_uid->low)) {
+                continue;
+            }
 
-        for (slot = 1; slot <= count + 1; slot++) {
             FILE_$PRIV_UNLOCK(file_uid,
                               (uint16_t)slot,
                               ((uint32_t)*lock_mode << 16) | (uint32_t)asid,
@@ -111,57 +129,67 @@ void FILE_$UNLOCK_PROC(uid_t *proc_uid, uid_t *file_uid, uint16_t *lock_mode,
         }
     } else {
         /*
-         * Remote process - iterate through lock entries looking for matching node
+         * Remote process - collect this file's entries held by the
+         * process's node from its hash bucket, then unlock them with the
+         * bucket released.  Repeat while a pass makes progress.
          */
-        iter_index = 1;
+        req_mode = *lock_mode;
+        hash_index = file_$lot_hash(file_uid);
+        prev_total = 0x7FFF;
 
         do {
-            FILE_$READ_LOCK_ENTRYI(&UID_$NIL, &iter_index, &lock_info, status_ret);
+            found = 0;
+            total = 0;
+
+            file_$lot_bucket_lock(hash_index);
+            for (entry_idx = FILE_$LOT_HASHTAB[hash_index]; entry_idx > 0;
+                 entry_idx = entry->next) {
+                entry = LOT_ENTRY(entry_idx);
+
+                if ((entry->refcount != 0) &&
+                    ((entry->flags2 & 4) == 0) &&
+                    (entry->uid_high == file_uid->high) &&
+                    (entry->uid_low == file_uid->low) &&
+                    ((entry->node_low & 0xFFFFF) == (proc_uid->low & 0xFFFFF)) &&
+                    ((req_mode == 0) ||
+                     (req_mode == ((entry->flags2 & 0x78) >> 3)))) {
+                    if (found < UNLOCK_PROC_BATCH) {
+                        batch_context[found] = entry->context;
+                        batch_node[found] = entry->node_low;
+                        found++;
+                    }
+                    total++;
+                }
+            }
+            file_$lot_bucket_unlock(hash_index);
 
-            /*
-             * Check if this lock entry matches the target process's node
-             * and the requested file
-             */
-            if ((lock_info.owner_node & 0xFFFFF) == (proc_uid->low & 0xFFFFF)) {
+            if (total == 0 || total >= prev_total) {
+                break;
+            }
+            prev_total = total;
+
+            for (i = 0; i < found; i++) {
                 /*
-                 * Node matches - check if status is OK and UID matches
+                 * Call FILE_$PRIV_UNLOCK with remote unlock flags
+                 * remote_flags = -1 (0xFF prefix = remote unlock)
                  */
-                if ((*status_ret == status_$ok) &&
-                    (lock_info.file_uid.high == file_uid->high) &&
-                    (lock_info.file_uid.low == file_uid->low)) {
-
-                    req_mode = *lock_mode;
-
-                    /* Check mode matches (or mode=0 for any) */
-                    if ((req_mode == lock_info.mode) || (req_mode == 0)) {
-                        /*
-                         * Call FILE_$PRIV_UNLOCK with remote unlock flags
-                         * remote_flags = -1 (0xFF prefix = remote unlock)
-                         */
-                        FILE_$PRIV_UNLOCK(file_uid,
-                                          0,                     /* lock_index = 0 (search) */
-                                          (uint32_t)req_mode << 16,
-                                          -1,                    /* remote_flags = -1 */
-                                          lock_info.context,     /* context */
-                                          lock_info.owner_node,  /* node address */
-                                          dtv_out,               /* dtv_out */
-                                          status_ret);
-
-                        if (*status_ret == file_$object_not_locked_by_this_process) {
-                            *status_ret = status_$ok;
-                        }
-                    }
+                FILE_$PRIV_UNLOCK(file_uid,
+                                  0,                     /* lock_index = 0 (search) */
+                                  (uint32_t)req_mode << 16,
+                                  -1,                    /* remote_flags = -1 */
+                                  batch_context[i],      /* context */
+                                  batch_node[i],         /* node address */
+                                  dtv_out,               /* dtv_out */
+                                  status_ret);
+
+                if (*status_ret == file_$object_not_locked_by_this_process) {
+                    *status_ret = status_$ok;
+                }
+                if (*status_ret != status_$ok) {
+                    break;
                 }
             }
-        } while (*status_ret == status_$ok);
-
-        /*
-         * Map "not locked" to success (finished iteration)
-         */
-        if (*status_ret == file_$obj_not_locked_by_this_process) {
-            *status_ret = status_$ok;
-            return;
-        }
+        } while (*status_ret == status_$ok && total > found);
     }
 
     *status_ret = status_$ok;
@@ -122,8 +122,10 @@ typedef struct mac_$buffer_t {
  * Describes a packet to send
  */
 typedef struct mac_$send_pkt_t {
-  uint8_t dest_addr[6];  /* 0x00: Destination MAC address */
-  uint8_t pad_06[2];     /* 0x06: Padding */
+  uint8_t dest_addr[6];  /* 0x00: Destination MAC address; if arp_flag is
+                          * negative, the network address to resolve (type,
+                          * high, low), replaced by the resolved address */
+  uint8_t pad_06[2];     /* 0x06: Padding (resolved address is 8 bytes) */
   uint8_t src_addr[6];   /* 0x08: Source MAC address */
   uint8_t pad_0e[2];     /* 0x0E: Padding */
   uint8_t pad_10[4];     /* 0x10: Unknown */
@@ -67,17 +67,20 @@ void MAC_OS_$PROC2_CLEANUP(void);
 /*
  * MAC_OS_$ARP - Perform ARP lookup
  *
- * Parameters:
- *   arp_table  - ARP table pointer
- *   port_num   - Port number
- *   pkt_desc   - Packet descriptor with destination address
- *   result     - Result buffer
- *   status_ret - Status return
+ * Declared as in mac_os/mac_os.h
  *
  * Original address: 0x00E0C0CE
  */
-void MAC_OS_$ARP(void *arp_table, uint16_t port_num, void *pkt_desc,
-                 void *result, status_$t *status_ret);
+void MAC_OS_$ARP(void *addr_info, int16_t port_num, uint16_t *mac_addr,
+                 uint8_t *flags, status_$t *status_ret);
+
+/*
+ * MAC_OS_$ARP_LOOKUP - MAC_OS_$ARP through the resolution cache
+ *
+ * Declared as in mac_os/mac_os.h; flags receives 0xFF for a broadcast
+ */
+void MAC_OS_$ARP_LOOKUP(void *addr_info, int16_t port_num, uint16_t *mac_addr,
+                        uint8_t *flags, status_$t *status_ret);
 
 /*
  * MAC_OS_$PUT_INFO - Put MAC info
@@ -2,7 +2,7 @@
  * MAC_$SEND - Send a packet on a MAC channel
  *
  * Sends a packet on the specified channel. May perform ARP lookup
- * if the destination address is not cached.
+ * if the destination address is not cached (MAC_OS_$ARP_LOOKUP).
  *
  * Original address: 0x00E0BB12
  * Original size: 316 bytes
@@ -22,6 +22,9 @@ void MAC_$SEND(uint16_t *channel, mac_$send_pkt_t *pkt_desc,
     status_$t os_status;
     uint8_t cleanup_buf[24];  /* FIM cleanup handler context */
 
+    uint8_t arp_flags;
+    uint16_t arp_addr[5];     /* Address to resolve, at offset 4 */
+
     /* Local copy of packet descriptor for MAC_OS_$SEND */
     mac_$send_pkt_t local_pkt;
     uint16_t local_bytes_sent;
@@ -82,8 +85,18 @@ void MAC_$SEND(uint16_t *channel, mac_$send_pkt_t *pkt_desc,
      * Otherwise, skip ARP and send directly.
      */
     if (pkt_desc->arp_flag < 0) {
-        /* Do ARP lookup */
-        MAC_OS_$ARP(MAC_$ARP_TABLE, port_num, pkt_desc, NULL, status_ret);
+        /*
+         * Resolve the destination, from the resolution cache when it can
+         * be.  dest_addr holds the network address (type, high, low); it
+         * is copied out first since the answer is written over it.
+         */
+        arp_addr[0] = 0;
+        arp_addr[1] = 0;
+        arp_addr[2] = ((uint16_t *)pkt_desc->dest_addr)[0];
+        arp_addr[3] = ((uint16_t *)pkt_desc->dest_addr)[1];
+        arp_addr[4] = ((uint16_t *)pkt_desc->dest_addr)[2];
+        MAC_OS_$ARP_LOOKUP(arp_addr, port_num, (uint16_t *)pkt_desc,
+                           &arp_flags, status_ret);
         if (*status_ret != status_$ok) {
             FIM_$RLS_CLEANUP(cleanup_buf);
             return;
@@ -153,6 +166,8 @@ void MAC_$SEND(uint16_t *channel, mac_$send_pkt_t *pkt_desc,
     (void)local_pkt;
     (void)local_bytes_sent;
     (void)chain_ptr;
+    (void)arp_flags;
+    (void)arp_addr;
     *status_ret = status_$mac_channel_not_open;
 #endif
 }
@@ -0,0 +1,225 @@
+/*
+ * MAC_OS_$ARP_LOOKUP - Resolve address through the resolution cache
+ *
+ * MAC_$SEND used to call MAC_OS_$ARP for every packet that asked for
+ * resolution.  Results are now kept in a cache hashed on port and
+ * address, so a send to an address seen recently finds its answer in a
+ * few probes.  A resolved address lives MAC_ARP_TTL ticks and is then
+ * resolved again by the next send to it; an address that failed to
+ * resolve is remembered for MAC_ARP_NEG_TTL ticks so that repeated sends
+ * to it fail at once.
+ *
+ * MAC_OS_$ARP works the hardware address out from the port type and the
+ * address itself, with no exchange on the network, so all a hit saves
+ * is that computation.  The cache does no work of its own on a send
+ * beyond the lookup.
+ *
+ * When the cache is full, entries are reused in turn (a clock hand), so
+ * the cost of a lookup does not grow with the number of hosts sent to.
+ */
+
+#include "mac_os/mac_os_internal.h"
+
+static mac_os_$arp_entry_t mac_os_$arp_cache[MAC_ARP_CACHE_MAX];
+static uint16_t mac_os_$arp_buckets[MAC_ARP_HASH_SIZE];
+static uint16_t mac_os_$arp_free;
+static uint16_t mac_os_$arp_hand;
+
+static uint16_t mac_os_$arp_lock;
+
+static uint32_t mac_os_$arp_hits;
+static uint32_t mac_os_$arp_misses;
+
+static uint16_t mac_os_$arp_hash(uint16_t port, uint16_t *addr)
+{
+    uint32_t h;
+
+    h = ((uint32_t)addr[1] << 16 | addr[2]) ^ ((uint32_t)addr[0] << 5) ^ port;
+    h ^= h >> 11;
+    h ^= h >> 7;
+    return (uint16_t)h & (MAC_ARP_HASH_SIZE - 1);
+}
+
+void mac_os_$arp_cache_init(void)
+{
+    int16_t i;
+
+    for (i = 0; i < MAC_ARP_HASH_SIZE; i++) {
+        mac_os_$arp_buckets[i] = MAC_ARP_NIL;
+    }
+    for (i = 0; i < MAC_ARP_CACHE_MAX; i++) {
+        mac_os_$arp_cache[i].state = MAC_ARP_FREE;
+        mac_os_$arp_cache[i].next =
+            (i == MAC_ARP_CACHE_MAX - 1) ? MAC_ARP_NIL : (uint16_t)(i + 1);
+    }
+    mac_os_$arp_free = 0;
+    mac_os_$arp_hand = 0;
+}
+
+/* Call with mac_os_$arp_lock held */
+static uint16_t mac_os_$arp_find(uint16_t port, uint16_t *addr)
+{
+    uint16_t idx;
+    mac_os_$arp_entry_t *e;
+
+    idx = mac_os_$arp_buckets[mac_os_$arp_hash(port, addr)];
+    while (idx != MAC_ARP_NIL) {
+        e = &mac_os_$arp_cache[idx];
+        if (e->port == port && e->addr[2] == addr[2] &&
+            e->addr[1] == addr[1] && e->addr[0] == addr[0]) {
+            return idx;
+        }
+        idx = e->next;
+    }
+    return MAC_ARP_NIL;
+}
+
+/* Call with mac_os_$arp_lock held */
+static void mac_os_$arp_unlink(uint16_t idx)
+{
+    mac_os_$arp_entry_t *e;
+    uint16_t *link;
+
+    e = &mac_os_$arp_cache[idx];
+    link = &mac_os_$arp_buckets[mac_os_$arp_hash(e->port, e->addr)];
+    while (*link != MAC_ARP_NIL) {
+        if (*link == idx) {
+            *link = e->next;
+            return;
+        }
+        link = &mac_os_$arp_cache[*link].next;
+    }
+}
+
+/*
+ * Take a free entry, or else the next one round from the clock hand, and
+ * link it in under port and addr.  Call with mac_os_$arp_lock held.
+ */
+static uint16_t mac_os_$arp_alloc(uint16_t port, uint16_t *addr)
+{
+    uint16_t idx;
+    uint16_t bucket;
+    mac_os_$arp_entry_t *e;
+
+    idx = mac_os_$arp_free;
+    if (idx != MAC_ARP_NIL) {
+        mac_os_$arp_free = mac_os_$arp_cache[idx].next;
+    } else {
+        idx = mac_os_$arp_hand;
+        mac_os_$arp_hand = (mac_os_$arp_hand + 1) & (MAC_ARP_CACHE_MAX - 1);
+        mac_os_$arp_unlink(idx);
+    }
+
+    e = &mac_os_$arp_cache[idx];
+    e->port = port;
+    e->addr[0] = addr[0];
+    e->addr[1] = addr[1];
+    e->addr[2] = addr[2];
+    bucket = mac_os_$arp_hash(port, addr);
+    e->next = mac_os_$arp_buckets[bucket];
+    mac_os_$arp_buckets[bucket] = idx;
+    return idx;
+}
+
+/* Call with mac_os_$arp_lock held */
+static void mac_os_$arp_fill(mac_os_$arp_entry_t *e, uint16_t *mac_addr,
+                             uint8_t flags, status_$t status, uint32_t now)
+{
+    int16_t i;
+
+    if (status == status_$ok) {
+        for (i = 0; i < 4; i++) {
+            e->mac_addr[i] = mac_addr[i];
+        }
+        e->flags = flags;
+        e->state = MAC_ARP_VALID;
+        e->expires = now + MAC_ARP_TTL;
+    } else {
+        e->status = status;
+        e->state = MAC_ARP_NEGATIVE;
+        e->expires = now + MAC_ARP_NEG_TTL;
+    }
+}
+
+void MAC_OS_$ARP_LOOKUP(void *addr_info, int16_t port_num, uint16_t *mac_addr,
+                        uint8_t *flags, status_$t *status_ret)
+{
+    ml_$spin_token_t token;
+    mac_os_$arp_entry_t *e;
+    uint16_t *addr;
+    uint16_t idx;
+    uint32_t now;
+    int16_t i;
+
+    addr = (uint16_t *)((uint8_t *)addr_info + 4);
+
+    /* Broadcasts cost MAC_OS_$ARP nothing to work out */
+    if (addr[0] == 0xFFFF && addr[1] == 0xFFFF && addr[2] == 0xFFFF) {
+        MAC_OS_$ARP(addr_info, port_num, mac_addr, flags, status_ret);
+        return;
+    }
+
+    now = TIME_$CLOCKH;
+    token = ML_$SPIN_LOCK(&mac_os_$arp_lock);
+    idx = mac_os_$arp_find((uint16_t)port_num, addr);
+    if (idx != MAC_ARP_NIL) {
+        e = &mac_os_$arp_cache[idx];
+        if (e->state != MAC_ARP_FREE && (int32_t)(e->expires - now) > 0) {
+            if (e->state == MAC_ARP_VALID) {
+                for (i = 0; i < 4; i++) {
+                    mac_addr[i] = e->mac_addr[i];
+                }
+                *flags = e->flags;
+                *status_ret = status_$ok;
+            } else {
+                *flags = 0;
+                *status_ret = e->status;
+            }
+            mac_os_$arp_hits++;
+            ML_$SPIN_UNLOCK(&mac_os_$arp_lock, token);
+            return;
+        }
+    }
+    mac_os_$arp_misses++;
+    ML_$SPIN_UNLOCK(&mac_os_$arp_lock, token);
+
+    MAC_OS_$ARP(addr_info, port_num, mac_addr, flags, status_ret);
+    if (*status_ret != status_$ok &&
+        *status_ret != status_$mac_arp_address_not_found) {
+        return;
+    }
+
+    /* Another sender may have filled it in meanwhile; either will do */
+    token = ML_$SPIN_LOCK(&mac_os_$arp_lock);
+    idx = mac_os_$arp_find((uint16_t)port_num, addr);
+    if (idx == MAC_ARP_NIL) {
+        idx = mac_os_$arp_alloc((uint16_t)port_num, addr);
+    }
+    mac_os_$arp_fill(&mac_os_$arp_cache[idx], mac_addr, *flags, *status_ret, now);
+    ML_$SPIN_UNLOCK(&mac_os_$arp_lock, token);
+}
+
+void MAC_OS_$ARP_FLUSH(int16_t port_num)
+{
+    ml_$spin_token_t token;
+    mac_os_$arp_entry_t *e;
+    int16_t i;
+
+    token = ML_$SPIN_LOCK(&mac_os_$arp_lock);
+    for (i = 0; i < MAC_ARP_CACHE_MAX; i++) {
+        e = &mac_os_$arp_cache[i];
+        if (e->state != MAC_ARP_FREE && e->port == (uint16_t)port_num) {
+            mac_os_$arp_unlink((uint16_t)i);
+            e->state = MAC_ARP_FREE;
+            e->next = mac_os_$arp_free;
+            mac_os_$arp_free = (uint16_t)i;
+        }
+    }
+    ML_$SPIN_UNLOCK(&mac_os_$arp_lock, token);
+}
+
+void MAC_OS_$ARP_STATS(uint32_t *hits, uint32_t *misses)
+{
+    *hits = mac_os_$arp_hits;
+    *misses = mac_os_$arp_misses;
+}
@@ -47,6 +47,9 @@ void MAC_OS_$INIT(void)
     /* Initialize the exclusion lock */
     ML_$EXCLUSION_INIT((ml_$exclusion_t *)MAC_OS_$EXCLUSION);
 
+    /* Empty the address resolution cache */
+    mac_os_$arp_cache_init();
+
     /* Get the route port pointer array */
     route_portp = (void **)0xE26EE8;
 
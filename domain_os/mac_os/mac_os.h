@@ -323,6 +323,38 @@ void MAC_OS_$PROC2_CLEANUP(uint16_t as_id);
 void MAC_OS_$ARP(void *addr_info, int16_t port_num, uint16_t *mac_addr,
                  uint8_t *flags, status_$t *status_ret);
 
+/*
+ * MAC_OS_$ARP_LOOKUP - Resolve address through the resolution cache
+ *
+ * As MAC_OS_$ARP, but answers from a cache of earlier results when it
+ * can; MAC_OS_$ARP is called for an address not in the cache or whose
+ * entry has expired.  Failures (status_$mac_arp_address_not_found) are
+ * cached for a short time too.
+ *
+ * Parameters: those of MAC_OS_$ARP
+ */
+void MAC_OS_$ARP_LOOKUP(void *addr_info, int16_t port_num, uint16_t *mac_addr,
+                        uint8_t *flags, status_$t *status_ret);
+
+/*
+ * MAC_OS_$ARP_FLUSH - Forget every cached result for a port
+ *
+ * Called when a port's configuration changes.
+ *
+ * Parameters:
+ *   port_num   - Port number
+ */
+void MAC_OS_$ARP_FLUSH(int16_t port_num);
+
+/*
+ * MAC_OS_$ARP_STATS - Cache statistics
+ *
+ * Parameters:
+ *   hits       - Output: lookups answered from the cache
+ *   misses     - Output: lookups that called MAC_OS_$ARP
+ */
+void MAC_OS_$ARP_STATS(uint32_t *hits, uint32_t *misses);
+
 /*
  * MAC_OS_$PUT_INFO - Store port information
  *
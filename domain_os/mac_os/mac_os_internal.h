@@ -50,6 +50,45 @@
 #define ROUTE_PORT_NET_TYPE_OFFSET      0x2E    /* Network type (2 bytes) */
 #define ROUTE_PORT_LINE_NUM_OFFSET      0x30    /* Line number (2 bytes) */
 
+/*
+ * ============================================================================
+ * ARP Resolution Cache
+ * ============================================================================
+ * Results of MAC_OS_$ARP, hashed on port and address.  Times are in
+ * TIME_$CLOCKH ticks (about 4 a second).
+ */
+
+#define MAC_ARP_CACHE_MAX       512     /* Entries */
+#define MAC_ARP_HASH_SIZE       128     /* Hash buckets, a power of 2 */
+#define MAC_ARP_NIL             0xFFFF  /* End of a hash chain */
+
+#define MAC_ARP_TTL             1200    /* Life of a resolved address (5 min) */
+#define MAC_ARP_NEG_TTL         40      /* Life of a failed resolution (10 s) */
+
+/* Entry states */
+#define MAC_ARP_FREE            0
+#define MAC_ARP_VALID           1       /* mac_addr and flags good */
+#define MAC_ARP_NEGATIVE        2       /* Resolution failed with status */
+
+typedef struct mac_os_$arp_entry_t {
+    uint16_t    next;           /* 0x00: Next in hash chain */
+    uint8_t     state;          /* 0x02: MAC_ARP_* */
+    uint8_t     pad_03;
+    uint16_t    port;           /* 0x04: Port number */
+    uint16_t    addr[3];        /* 0x06: Type, address high, address low */
+    uint16_t    mac_addr[4];    /* 0x0C: Length word and address */
+    uint8_t     flags;          /* 0x14: 0xFF for broadcast */
+    uint8_t     pad_15;
+    uint16_t    pad_16;
+    status_$t   status;         /* 0x18: Status of a failed resolution */
+    uint32_t    expires;        /* 0x1C: Entry is unusable once reached */
+} mac_os_$arp_entry_t;
+
+/*
+ * mac_os_$arp_cache_init - Empty the cache; called by MAC_OS_$INIT
+ */
+void mac_os_$arp_cache_init(void);
+
 /*
  * ============================================================================
  * Internal Helper Functions
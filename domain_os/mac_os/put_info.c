@@ -124,6 +124,9 @@ void MAC_OS_$PUT_INFO(mac_os_$port_info_t *info, int16_t *port_num, status_$t *s
         OS_$DATA_COPY(info, dest, 8);
     }
 
+    /* Addresses resolved under the old configuration no longer hold */
+    MAC_OS_$ARP_FLUSH(port);
+
 done:
     ML_$EXCLUSION_STOP((ml_$exclusion_t *)MAC_OS_$EXCLUSION);
 #else
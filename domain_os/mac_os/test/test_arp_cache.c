@@ -0,0 +1,326 @@
+/*
+ * Unit tests for the ARP resolution cache
+ *
+ * Tests that packets sent with MAC_$SEND are resolved through the cache,
+ * keyed on their destination address and port: a repeat send is answered
+ * without MAC_OS_$ARP, a failed resolution is remembered for a short time,
+ * entries expire, a flush forgets one port, broadcasts are never cached,
+ * and the most recent sends survive a cache overrun.  Linked against
+ * mac/send.c and arp_cache.c; MAC_OS_$ARP is a resolver that maps
+ * addresses as the real one does for an Ethernet port, and MAC_OS_$SEND
+ * records where each packet went.
+ */
+
+#include "mac_os/mac_os_internal.h"
+#include "mac/mac.h"
+
+#define TEST_CHANNEL    0
+#define TEST_ASID       3
+#define TEST_CLOCK      1000
+#define TEST_IP_TYPE    0x0800
+#define TEST_NET_PREFIX 0x1E00
+
+/* Channel table, within the MAC data at MAC_$DATA_BASE */
+#define TEST_MAC_MAP    0xE22000
+#define TEST_MAC_SIZE   0x2000
+
+/*
+ * Host mmap; <sys/mman.h> clashes with base.h's size_t.  Flags are the
+ * Linux values (PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_FIXED|MAP_ANONYMOUS).
+ */
+extern void *mmap(void *addr, unsigned long len, int prot, int flags,
+                  int fd, long off);
+#define TEST_PROT_RW    0x03
+#define TEST_MAP_FLAGS  0x32
+
+/* Storage normally defined in the proc1 and time data */
+uint16_t PROC1_$AS_ID;
+uint32_t TIME_$CLOCKH;
+
+/* Mock state tracking */
+static int mock_spin_depth;
+static int mock_resolver_calls;
+static int mock_resolver_locked;        /* MAC_OS_$ARP called under the lock */
+static int mock_cleanups;               /* Handlers set and not released */
+static int mock_packets;
+static uint16_t mock_wire_dest[4];      /* Last packet's resolved address */
+
+ml_$spin_token_t ML_$SPIN_LOCK(void *lockp) { (void)lockp; mock_spin_depth++; return 0; }
+void ML_$SPIN_UNLOCK(void *lockp, ml_$spin_token_t token) { (void)lockp; (void)token; mock_spin_depth--; }
+status_$t FIM_$CLEANUP(void *handler) { (void)handler; mock_cleanups++; return status_$cleanup_handler_set; }
+void FIM_$RLS_CLEANUP(void *cleanup_data) { (void)cleanup_data; mock_cleanups--; }
+
+void MAC_OS_$SEND(int16_t *channel, mac_os_$send_pkt_t *pkt_desc,
+                  int16_t *bytes_sent, status_$t *status_ret)
+{
+    (void)channel;
+    memcpy(mock_wire_dest, pkt_desc, sizeof(mock_wire_dest));
+    mock_packets++;
+    *bytes_sent = 0x40;
+    *status_ret = status_$ok;
+}
+
+/*
+ * An Ethernet port maps IP-type addresses with the 0x1E00 prefix, as
+ * MAC_OS_$ARP does; anything else is not found.
+ */
+void MAC_OS_$ARP(void *addr_info, int16_t port_num, uint16_t *mac_addr,
+                 uint8_t *flags, status_$t *status_ret)
+{
+    uint16_t *a = (uint16_t *)((uint8_t *)addr_info + 4);
+
+    mock_resolver_calls++;
+    if (mock_spin_depth != 0) {
+        mock_resolver_locked++;
+    }
+    *flags = 0;
+    *status_ret = status_$ok;
+    if (a[0] == 0xFFFF && a[1] == 0xFFFF && a[2] == 0xFFFF) {
+        *flags = 0xFF;
+        mac_addr[0] = 2;
+        return;
+    }
+    if (a[0] == TEST_IP_TYPE && (a[1] & 0xFF00) == TEST_NET_PREFIX) {
+        mac_addr[0] = 2;
+        mac_addr[1] = (uint16_t)((a[1] & 0x000F) | (port_num << 8));
+        mac_addr[2] = a[2];
+        return;
+    }
+    *status_ret = status_$mac_arp_address_not_found;
+}
+
+/* Open TEST_CHANNEL on port for TEST_ASID */
+static void open_channel(uint16_t port)
+{
+    *(uint16_t *)(MAC_$DATA_BASE + 0x7AA + TEST_CHANNEL * 20) = port;
+    *(uint16_t *)(MAC_$DATA_BASE + 0x7B2 + TEST_CHANNEL * 20) =
+        0x200 | (TEST_ASID << 2);
+}
+
+static void reset_mocks(void)
+{
+    static int mapped;
+
+    if (!mapped) {
+        mmap((void *)TEST_MAC_MAP, TEST_MAC_SIZE, TEST_PROT_RW,
+             TEST_MAP_FLAGS, -1, 0);
+        mapped = 1;
+    }
+    mac_os_$arp_cache_init();
+    PROC1_$AS_ID = TEST_ASID;
+    TIME_$CLOCKH = TEST_CLOCK;
+    mock_spin_depth = 0;
+    mock_resolver_calls = 0;
+    mock_resolver_locked = 0;
+    mock_cleanups = 0;
+    mock_packets = 0;
+    memset(mock_wire_dest, 0, sizeof(mock_wire_dest));
+    open_channel(0);
+}
+
+/* MAC_$SEND a packet to a network address, asking for resolution */
+static status_$t send_packet(uint16_t port, uint16_t type, uint16_t hi, uint16_t lo)
+{
+    mac_$send_pkt_t pkt;
+    uint16_t channel = TEST_CHANNEL;
+    uint16_t bytes_sent;
+    status_$t status;
+
+    open_channel(port);
+    memset(&pkt, 0, sizeof(pkt));
+    ((uint16_t *)pkt.dest_addr)[0] = type;
+    ((uint16_t *)pkt.dest_addr)[1] = hi;
+    ((uint16_t *)pkt.dest_addr)[2] = lo;
+    pkt.arp_flag = -1;
+
+    MAC_$SEND(&channel, &pkt, &bytes_sent, &status);
+    return status;
+}
+
+static status_$t send_host(uint16_t port, uint32_t host)
+{
+    return send_packet(port, TEST_IP_TYPE,
+                       (uint16_t)(TEST_NET_PREFIX | ((host >> 16) & 0xF)),
+                       (uint16_t)host);
+}
+
+/*
+ * Test: Two sends to the same host
+ * Expected: The first calls MAC_OS_$ARP, not under the cache lock; the
+ * second is answered from the cache; both packets go to the host
+ */
+void test_arp_cache_miss_then_hit(void)
+{
+    reset_mocks();
+
+    ASSERT_EQ(send_host(0, 0x12345), status_$ok);
+    ASSERT_EQ(mock_resolver_calls, 1);
+    ASSERT_EQ(mock_wire_dest[2], 0x2345);
+
+    ASSERT_EQ(send_host(0, 0x12345), status_$ok);
+    ASSERT_EQ(mock_resolver_calls, 1);
+    ASSERT_EQ(mock_packets, 2);
+    ASSERT_EQ(mock_wire_dest[0], 2);
+    ASSERT_EQ(mock_wire_dest[1], 0x0001);
+    ASSERT_EQ(mock_wire_dest[2], 0x2345);
+    ASSERT_EQ(mock_resolver_locked, 0);
+    ASSERT_EQ(mock_cleanups, 0);
+}
+
+/*
+ * Test: Sends to many different hosts, then the same hosts again
+ * Expected: Each host is resolved once, and each cached answer is that
+ * host's, not another destination's
+ */
+void test_arp_cache_keyed_on_destination(void)
+{
+    uint32_t h;
+
+    reset_mocks();
+    for (h = 0; h < 300; h++) {
+        ASSERT_EQ(send_host((uint16_t)(h & 3), h * 7919), status_$ok);
+    }
+    for (h = 0; h < 300; h++) {
+        ASSERT_EQ(send_host((uint16_t)(h & 3), h * 7919), status_$ok);
+        ASSERT_EQ(mock_wire_dest[0], 2);
+        ASSERT_EQ(mock_wire_dest[1], ((h * 7919 >> 16) & 0xF) | ((h & 3) << 8));
+        ASSERT_EQ(mock_wire_dest[2], (uint16_t)(h * 7919));
+    }
+    ASSERT_EQ(mock_resolver_calls, 300);
+}
+
+/*
+ * Test: The same address sent to on two ports
+ * Expected: Resolved separately for each port
+ */
+void test_arp_cache_same_address_other_port(void)
+{
+    reset_mocks();
+    ASSERT_EQ(send_host(1, 0x42), status_$ok);
+    ASSERT_EQ(send_host(2, 0x42), status_$ok);
+    ASSERT_EQ(mock_resolver_calls, 2);
+    ASSERT_EQ(mock_wire_dest[1] & 0xFF00, 0x0200);
+}
+
+/*
+ * Test: A packet that does not ask for resolution
+ * Expected: Sent as it is; MAC_OS_$ARP is not called
+ */
+void test_arp_cache_no_resolution(void)
+{
+    mac_$send_pkt_t pkt;
+    uint16_t channel = TEST_CHANNEL;
+    uint16_t bytes_sent;
+    status_$t status;
+
+    reset_mocks();
+    memset(&pkt, 0, sizeof(pkt));
+    ((uint16_t *)pkt.dest_addr)[0] = 0x0102;
+    pkt.arp_flag = 0;
+
+    MAC_$SEND(&channel, &pkt, &bytes_sent, &status);
+    ASSERT_EQ(status, status_$ok);
+    ASSERT_EQ(bytes_sent, 0x40);
+    ASSERT_EQ(mock_resolver_calls, 0);
+    ASSERT_EQ(mock_wire_dest[0], 0x0102);
+}
+
+/*
+ * Test: Sends to an address that cannot be resolved, before and after
+ * the failure expires
+ * Expected: Nothing is sent; the failure is answered from the cache
+ * until MAC_ARP_NEG_TTL has passed
+ */
+void test_arp_cache_negative_cached_then_expires(void)
+{
+    reset_mocks();
+    ASSERT_EQ(send_packet(0, 0x0600, 1, 2), status_$mac_arp_address_not_found);
+    ASSERT_EQ(send_packet(0, 0x0600, 1, 2), status_$mac_arp_address_not_found);
+    ASSERT_EQ(mock_resolver_calls, 1);
+    ASSERT_EQ(mock_packets, 0);
+    ASSERT_EQ(mock_cleanups, 0);
+
+    TIME_$CLOCKH += MAC_ARP_NEG_TTL;
+    ASSERT_EQ(send_packet(0, 0x0600, 1, 2), status_$mac_arp_address_not_found);
+    ASSERT_EQ(mock_resolver_calls, 2);
+}
+
+/*
+ * Test: Sends to a host just before and at MAC_ARP_TTL
+ * Expected: The entry answers until it expires, then the host is
+ * resolved again
+ */
+void test_arp_cache_expired_entry(void)
+{
+    reset_mocks();
+    ASSERT_EQ(send_host(0, 11), status_$ok);
+    TIME_$CLOCKH += MAC_ARP_TTL - 1;
+    ASSERT_EQ(send_host(0, 11), status_$ok);
+    ASSERT_EQ(mock_resolver_calls, 1);
+
+    TIME_$CLOCKH += 1;
+    ASSERT_EQ(send_host(0, 11), status_$ok);
+    ASSERT_EQ(mock_resolver_calls, 2);
+    ASSERT_EQ(mock_wire_dest[2], 11);
+}
+
+/*
+ * Test: MAC_OS_$ARP_FLUSH of one port
+ * Expected: That port's entries are resolved again; another port's are not
+ */
+void test_arp_cache_flush_forgets_one_port(void)
+{
+    reset_mocks();
+    ASSERT_EQ(send_host(0, 5), status_$ok);
+    ASSERT_EQ(send_host(1, 5), status_$ok);
+    MAC_OS_$ARP_FLUSH(0);
+    ASSERT_EQ(send_host(1, 5), status_$ok);
+    ASSERT_EQ(mock_resolver_calls, 2);
+    ASSERT_EQ(send_host(0, 5), status_$ok);
+    ASSERT_EQ(mock_resolver_calls, 3);
+}
+
+/*
+ * Test: Two broadcasts
+ * Expected: Both go to MAC_OS_$ARP and neither counts as a cache hit or
+ * miss
+ */
+void test_arp_cache_broadcast_not_cached(void)
+{
+    uint32_t hits_before, misses_before, hits, misses;
+
+    reset_mocks();
+    MAC_OS_$ARP_STATS(&hits_before, &misses_before);
+    ASSERT_EQ(send_packet(0, 0xFFFF, 0xFFFF, 0xFFFF), status_$ok);
+    ASSERT_EQ(send_packet(0, 0xFFFF, 0xFFFF, 0xFFFF), status_$ok);
+    ASSERT_EQ(mock_resolver_calls, 2);
+    ASSERT_EQ(mock_packets, 2);
+    MAC_OS_$ARP_STATS(&hits, &misses);
+    ASSERT_EQ(hits, hits_before);
+    ASSERT_EQ(misses, misses_before);
+}
+
+/*
+ * Test: Sends to eight times as many hosts as the cache holds
+ * Expected: Every answer is still right, and the most recent cache-full
+ * of hosts are all still cached
+ */
+void test_arp_cache_overrun(void)
+{
+    uint32_t h;
+    int before;
+
+    reset_mocks();
+    for (h = 0; h < MAC_ARP_CACHE_MAX * 8; h++) {
+        ASSERT_EQ(send_host(0, h), status_$ok);
+        ASSERT_EQ(mock_wire_dest[2], (uint16_t)h);
+    }
+    ASSERT_EQ(mock_resolver_calls, MAC_ARP_CACHE_MAX * 8);
+
+    before = mock_resolver_calls;
+    for (h = MAC_ARP_CACHE_MAX * 7; h < MAC_ARP_CACHE_MAX * 8; h++) {
+        ASSERT_EQ(send_host(0, h), status_$ok);
+        ASSERT_EQ(mock_wire_dest[2], (uint16_t)h);
+    }
+    ASSERT_EQ(mock_resolver_calls, before);
+}
@@ -90,7 +90,11 @@ void MSG_$CLOSEI(msg_$socket_t *socket, status_$t *status_ret)
         /* Decrement open socket count */
         (*(int16_t *)(MSG_$DATA_BASE + MSG_OFF_OPEN_COUNT))--;
 
-        /* Close the underlying socket */
+        /*
+         * Free its same-node ring, crediting what is left on it while the
+         * socket is still ours, then close the underlying socket
+         */
+        msg_$ring_release(sock_num);
         SOCK_$CLOSE(sock_num);
 
         /* If no more sockets open, unregister network service */
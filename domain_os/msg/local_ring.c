@@ -0,0 +1,241 @@
+/*
+ * msg_$ring_* - Same-node message rings
+ *
+ * A message between two sockets on this node used to be built into an
+ * internet packet in a header buffer, queued on the destination socket
+ * and taken apart again by APP_$RECEIVE, all to cross from one address
+ * space to another.  Supervisor memory is the same in every address
+ * space, so instead the sender copies the message into pool pages
+ * (PKT_$COPY_TO_PA) and puts a descriptor on a ring belonging to the
+ * destination socket; the receiver takes the descriptor off and copies
+ * the message out into its buffer.  That is still two copies: only
+ * whole data pages that land on page boundaries in the receiver's
+ * buffer are remapped instead of copied (PKT_$DAT_FLIP).  What is saved
+ * is building and parsing the internet header and queueing through the
+ * socket.  The socket's event count is advanced as for a queued packet,
+ * so MSG_$WAIT and MSG_$GET_EC work unchanged.
+ *
+ * A message on a ring holds its pool pages until it is received, so it
+ * is charged to the destination socket's quotas (SOCK_$CHARGE) as if it
+ * were queued there, and credited back when it is taken off the ring.
+ *
+ * Rings are attached to sockets on their first local message and freed
+ * when the socket closes.  A message that does not fit (header over a
+ * page, data over MSG_RING_PAGES pages, ring full, no ring free, over
+ * the socket's quota) goes the old way.  So does any message sent while packets are queued on the
+ * destination socket, so that a sender's messages are never received
+ * out of order: the ring is always emptied first.
+ */
+
+#include "msg/msg_internal.h"
+#include "pkt/pkt.h"
+
+static msg_$ring_t msg_$rings[MSG_RING_COUNT];
+
+/* Ring number + 1 for each socket, 0 if it has none */
+static uint8_t msg_$ring_of[MSG_MAX_SOCKET + 1];
+
+/* Covers ring attach and detach, and head and tail */
+static uint16_t msg_$ring_spin;
+
+static int8_t msg_$has_owner(int16_t sock)
+{
+#if defined(ARCH_M68K)
+    uint8_t *bitmap;
+
+    bitmap = (uint8_t *)(MSG_$DATA_BASE + MSG_OFF_OWNERSHIP + (sock << 3));
+    return (*(uint32_t *)bitmap != 0 || *(uint32_t *)(bitmap + 4) != 0)
+               ? -1 : 0;
+#else
+    (void)sock;
+    return 0;
+#endif
+}
+
+/* Call with msg_$ring_spin held */
+static msg_$ring_t *msg_$ring_get(int16_t sock, int8_t attach)
+{
+    int16_t i;
+
+    if (msg_$ring_of[sock] != 0) {
+        return &msg_$rings[msg_$ring_of[sock] - 1];
+    }
+    if (attach >= 0) {
+        return NULL;
+    }
+
+    for (i = 0; i < MSG_RING_COUNT; i++) {
+        if (msg_$rings[i].sock == 0) {
+            msg_$rings[i].sock = sock;
+            msg_$rings[i].head = 0;
+            msg_$rings[i].tail = 0;
+            msg_$ring_of[sock] = (uint8_t)(i + 1);
+            return &msg_$rings[i];
+        }
+    }
+    return NULL;
+}
+
+static void msg_$ring_dump(msg_$ring_slot_t *slot)
+{
+    if (slot->hdr_len != 0) {
+        PKT_$DUMP_DATA(&slot->hdr_page, (int16_t)slot->hdr_len);
+    }
+    if (slot->data_len != 0) {
+        PKT_$DUMP_DATA(slot->pages, (int16_t)slot->data_len);
+    }
+}
+
+int8_t msg_$ring_send(int16_t dest_sock, uint32_t dest_proc,
+                      uint32_t src_proc, int16_t src_sock, int16_t msg_type,
+                      void *hdr, uint16_t hdr_len,
+                      void *data, uint16_t data_len)
+{
+    msg_$ring_slot_t msg;
+    msg_$ring_t *ring;
+    ec_$eventcount_t *sock_ec;
+    ml_$spin_token_t token;
+    status_$t status;
+
+    if (dest_sock < 1 || dest_sock > MSG_MAX_SOCKET ||
+        hdr_len > MSG_RING_PAGE_SIZE ||
+        data_len > MSG_RING_PAGES * MSG_RING_PAGE_SIZE) {
+        return 0;
+    }
+
+    /* Out of the sender's address space into pool pages */
+    msg.src_proc = src_proc;
+    msg.dest_proc = dest_proc;
+    msg.src_sock = (uint16_t)src_sock;
+    msg.msg_type = (uint16_t)msg_type;
+    msg.hdr_len = hdr_len;
+    msg.data_len = data_len;
+    if (hdr_len != 0) {
+        PKT_$COPY_TO_PA((char *)hdr, hdr_len, &msg.hdr_page, &status);
+        if (status != status_$ok) {
+            return 0;
+        }
+    }
+    if (data_len != 0) {
+        PKT_$COPY_TO_PA((char *)data, data_len, msg.pages, &status);
+        if (status != status_$ok) {
+            msg.data_len = 0;
+            msg_$ring_dump(&msg);
+            return 0;
+        }
+    }
+
+    if (SOCK_$CHARGE((uint16_t)dest_sock, data_len) >= 0) {
+        msg_$ring_dump(&msg);
+        return 0;
+    }
+
+    sock_ec = SOCK_$EVENT_COUNTERS[dest_sock];
+
+    /*
+     * Nothing may be queued on the socket ahead of us, and the owner is
+     * checked under the lock so that a close cannot miss the message
+     */
+    token = ML_$SPIN_LOCK(&msg_$ring_spin);
+    ring = NULL;
+    if (((uint8_t *)sock_ec)[0x15] == 0 && msg_$has_owner(dest_sock) < 0) {
+        ring = msg_$ring_get(dest_sock, -1);
+    }
+    if (ring == NULL || (uint16_t)(ring->tail - ring->head) >= MSG_RING_SLOTS) {
+        ML_$SPIN_UNLOCK(&msg_$ring_spin, token);
+        SOCK_$CREDIT((uint16_t)dest_sock, data_len);
+        msg_$ring_dump(&msg);
+        return 0;
+    }
+    ring->slots[ring->tail & MSG_RING_MASK] = msg;
+    ring->tail++;
+    ML_$SPIN_UNLOCK(&msg_$ring_spin, token);
+
+    EC_$ADVANCE(sock_ec);
+    return -1;
+}
+
+int8_t msg_$ring_rcv(int16_t sock, msg_$ring_slot_t *msg)
+{
+    msg_$ring_t *ring;
+    ml_$spin_token_t token;
+    int8_t got;
+
+    got = 0;
+    token = ML_$SPIN_LOCK(&msg_$ring_spin);
+    ring = msg_$ring_get(sock, 0);
+    if (ring != NULL && ring->head != ring->tail) {
+        *msg = ring->slots[ring->head & MSG_RING_MASK];
+        ring->head++;
+        got = -1;
+    }
+    ML_$SPIN_UNLOCK(&msg_$ring_spin, token);
+
+    if (got < 0) {
+        SOCK_$CREDIT((uint16_t)sock, msg->data_len);
+    }
+    return got;
+}
+
+uint16_t msg_$ring_copy_out(msg_$ring_slot_t *msg, char *buf,
+                            uint16_t max_len)
+{
+    uint16_t hdr_len;
+    uint16_t data_len;
+
+    hdr_len = msg->hdr_len;
+    if (hdr_len > max_len) {
+        hdr_len = max_len;
+    }
+    if (hdr_len != 0) {
+        PKT_$DAT_COPY(&msg->hdr_page, (int16_t)hdr_len, buf);
+    }
+
+    data_len = msg->data_len;
+    if (data_len > max_len - hdr_len) {
+        data_len = max_len - hdr_len;
+    }
+    if (data_len != 0) {
+        PKT_$DAT_FLIP(msg->pages, (int16_t)data_len, buf + hdr_len);
+    }
+
+    msg_$ring_dump(msg);
+    return hdr_len + data_len;
+}
+
+int16_t msg_$ring_count(int16_t sock)
+{
+    msg_$ring_t *ring;
+
+    if (msg_$ring_of[sock] == 0) {
+        return 0;
+    }
+    ring = &msg_$rings[msg_$ring_of[sock] - 1];
+    return (int16_t)(uint16_t)(ring->tail - ring->head);
+}
+
+void msg_$ring_release(int16_t sock)
+{
+    msg_$ring_t *ring;
+    ml_$spin_token_t token;
+    uint16_t head;
+    uint16_t tail;
+
+    token = ML_$SPIN_LOCK(&msg_$ring_spin);
+    ring = msg_$ring_get(sock, 0);
+    if (ring == NULL) {
+        ML_$SPIN_UNLOCK(&msg_$ring_spin, token);
+        return;
+    }
+    msg_$ring_of[sock] = 0;
+    head = ring->head;
+    tail = ring->tail;
+    ML_$SPIN_UNLOCK(&msg_$ring_spin, token);
+
+    /* Nobody can reach the ring now: give back what was never received */
+    for (; head != tail; head++) {
+        SOCK_$CREDIT((uint16_t)sock, ring->slots[head & MSG_RING_MASK].data_len);
+        msg_$ring_dump(&ring->slots[head & MSG_RING_MASK]);
+    }
+    ring->sock = 0;
+}
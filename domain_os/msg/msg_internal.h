@@ -143,6 +143,63 @@ static inline void msg_$set_depth(msg_$socket_t socket, int16_t depth) {
 #endif
 }
 
+/*
+ * Same-node message rings (see local_ring.c)
+ */
+#define MSG_RING_COUNT      16      /* Rings, attached to sockets on use */
+#define MSG_RING_SLOTS      8       /* Messages per ring (power of 2) */
+#define MSG_RING_MASK       (MSG_RING_SLOTS - 1)
+#define MSG_RING_PAGES      4       /* Data pages per message */
+#define MSG_RING_PAGE_SIZE  0x400
+
+/*
+ * A message on a ring: who it is from and for, and the pool pages its
+ * header and data were copied into
+ */
+typedef struct msg_$ring_slot_t {
+  uint32_t src_proc;                 /* 0x00: Source process */
+  uint32_t dest_proc;                /* 0x04: Destination process */
+  uint16_t src_sock;                 /* 0x08: Source socket */
+  uint16_t msg_type;                 /* 0x0A: Message type */
+  uint16_t hdr_len;                  /* 0x0C: Header length */
+  uint16_t data_len;                 /* 0x0E: Data length */
+  uint32_t hdr_page;                 /* 0x10: Header page */
+  uint32_t pages[MSG_RING_PAGES];    /* 0x14: Data pages */
+} msg_$ring_slot_t;
+
+typedef struct msg_$ring_t {
+  int16_t sock;                      /* Socket using the ring, 0 if free */
+  uint16_t head;                     /* Next to receive (free-running) */
+  uint16_t tail;                     /* Next to fill (free-running) */
+  uint16_t _pad;
+  msg_$ring_slot_t slots[MSG_RING_SLOTS];
+} msg_$ring_t;
+
+/*
+ * Put a message for a socket on this node on its ring.  Returns -1 if
+ * it was queued, 0 if it must be sent through the socket instead.
+ */
+int8_t msg_$ring_send(int16_t dest_sock, uint32_t dest_proc,
+                      uint32_t src_proc, int16_t src_sock, int16_t msg_type,
+                      void *hdr, uint16_t hdr_len,
+                      void *data, uint16_t data_len);
+
+/* Take the next message off a socket's ring; -1 if there was one */
+int8_t msg_$ring_rcv(int16_t sock, msg_$ring_slot_t *msg);
+
+/*
+ * Move a message taken by msg_$ring_rcv into buf (header, then data),
+ * release its pages, and return the length moved
+ */
+uint16_t msg_$ring_copy_out(msg_$ring_slot_t *msg, char *buf,
+                            uint16_t max_len);
+
+/* Messages waiting on a socket's ring */
+int16_t msg_$ring_count(int16_t sock);
+
+/* Free a closed socket's ring and anything left on it */
+void msg_$ring_release(int16_t sock);
+
 /*
  * Internal receive implementation
  */
@@ -50,6 +50,7 @@ void MSG_$RCVI(msg_$socket_t *socket,
     uint8_t asid;
     uint8_t byte_index;
     uint8_t *bitmap;
+    msg_$ring_slot_t ring_msg;
 
     sock_num = *socket;
 
@@ -70,6 +71,20 @@ void MSG_$RCVI(msg_$socket_t *socket,
         return;
     }
 
+    /* Messages from this node come off the socket's ring first */
+    if (msg_$ring_rcv(sock_num, &ring_msg) < 0) {
+        *bytes_received = (int16_t)msg_$ring_copy_out(&ring_msg, data_buf,
+                                                      (uint16_t)*data_len);
+        if (type_buf != NULL) {
+            *(uint16_t *)type_buf = ring_msg.msg_type;
+        }
+        if (msg_len != NULL) {
+            *msg_len = (int16_t)(ring_msg.hdr_len + ring_msg.data_len);
+        }
+        *status_ret = status_$ok;
+        return;
+    }
+
     /*
      * Call internal receive implementation.
      * The actual receive logic handles:
@@ -124,6 +124,7 @@ void MSG_$RCV_CONTIGI(msg_$socket_t *socketidp,
     uint16_t copy_len;
     uint16_t overflow_len;
     uint32_t available;
+    msg_$ring_slot_t ring_msg;
 
     sock_num = *socketidp;
 
@@ -143,6 +144,28 @@ void MSG_$RCV_CONTIGI(msg_$socket_t *socketidp,
         return;
     }
 
+    /* Messages from this node come off the socket's ring first */
+    if (msg_$ring_rcv(sock_num, &ring_msg) < 0) {
+        *dest_proc = ring_msg.dest_proc;
+        *src_proc = ring_msg.src_proc;
+        *dest_node = *(uint32_t *)0xE245A4;  /* NODE_$ME */
+        *dest_sock = (uint16_t)sock_num;
+        *src_node = *(uint32_t *)0xE245A4;
+        *src_sock = ring_msg.src_sock;
+        *msg_type = ring_msg.msg_type;
+
+        hw_addr->proto_family = 0;
+        hw_addr->flags = 0;
+        hw_addr->proto_type = 0;
+        hw_addr->proto_subtype = 0;
+        hw_addr->reserved2 = 0;
+        hw_addr->reserved3 = 0xFFFF;
+
+        *data_len = msg_$ring_copy_out(&ring_msg, data_buf, *max_len);
+        *status_ret = status_$ok;
+        return;
+    }
+
     /* Call APP_$RECEIVE to get the message
      * This fills in our local variables via a packed structure
      */
@@ -211,8 +234,8 @@ void MSG_$RCV_CONTIGI(msg_$socket_t *socketidp,
             available = overflow_len;
         }
 
-        /* Copy overflow data */
-        PKT_$DAT_COPY(local_2c, (int16_t)available, data_buf + *data_len);
+        /* Move overflow data, remapping whole pages */
+        PKT_$DAT_FLIP((uint32_t *)local_2c, (int16_t)available, data_buf + *data_len);
 
         /* Release overflow buffers */
         PKT_$DUMP_DATA(local_2c, *(uint16_t *)(local_34 + 4));
@@ -126,7 +126,7 @@ static void msg_$rcv_hw_internal(
         }
         *overflow_len = ovf_copy;
 
-        PKT_$DAT_COPY(local_2c, ovf_copy, overflow_buf);
+        PKT_$DAT_FLIP((uint32_t *)local_2c, ovf_copy, overflow_buf);
         PKT_$DUMP_DATA(local_2c, *(uint16_t *)(local_34 + 4));
     }
 
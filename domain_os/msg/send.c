@@ -71,6 +71,18 @@ status_$t MSG_$$SEND(int16_t port_num,
         return *status_ret;
     }
 
+    /*
+     * Same node: put the message on the destination socket's ring if it
+     * will go, rather than building a packet for it
+     */
+    if (dest_node == *(uint32_t *)0xE245A4 &&  /* NODE_$ME */
+        msg_$ring_send(dest_sock, dest_proc, src_proc, src_sock, type_val,
+                       data_buf, header_len, data_ptr, data_len) < 0) {
+        *(int16_t *)result = (int16_t)data_len;
+        *status_ret = status_$ok;
+        return status_$ok;
+    }
+
     /*
      * Copy message descriptor with flags set.
      * Set bit 2 (0x04) in byte at offset 1.
@@ -54,10 +54,14 @@ int16_t MSG_$TEST_FOR_MESSAGE(msg_$socket_t *socket, uint32_t *ec_value,
     *status_ret = status_$ok;
 
     /*
-     * Check if message is pending (byte at offset 0x15).
+     * Check if message is pending (byte at offset 0x15), or waiting on
+     * the socket's same-node ring.
      * Return -1 if message pending, 0 if not.
      */
     pending = *(uint8_t *)((uint8_t *)sock_ec + 0x15);
+    if (msg_$ring_count(sock_num) != 0) {
+        pending = 1;
+    }
     return (pending != 0) ? -1 : 0;
 
 #else
@@ -62,9 +62,11 @@ void MSG_$WAITI(msg_$socket_t *socket, msg_$time_t *timeout, status_$t *status_r
 
     /*
      * Check if message is already available.
-     * Byte at offset 0x15 in socket EC struct indicates pending message.
+     * Byte at offset 0x15 in socket EC struct indicates pending message;
+     * messages from this node may also be waiting on the socket's ring.
      */
-    if (*(uint8_t *)((uint8_t *)sock_ec + 0x15) != 0) {
+    if (*(uint8_t *)((uint8_t *)sock_ec + 0x15) != 0 ||
+        msg_$ring_count(sock_num) != 0) {
         /* Message already available */
         *status_ret = status_$ok;
         return;
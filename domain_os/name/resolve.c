@@ -10,6 +10,9 @@
  */
 
 #include "name/name_internal.h"
+#include "hint/hint.h"
+#include "network/network.h"
+#include "rem_file/rem_file.h"
 
 /*
  * name_$parse_component - Parse next path component
@@ -56,6 +59,54 @@ static void name_$parse_component(char *path, uint16_t path_len, uint16_t start_
     }
 }
 
+/*
+ * name_$resolve_remote - Hand the rest of a path to a remote directory
+ *
+ * When the directory being searched lives on another node, sends it the
+ * whole remaining path in one request rather than looking up component
+ * by component.  The server resolves as far as it holds the objects;
+ * past that (a directory mounted from a third node, a link) the caller
+ * carries on from the returned position.
+ *
+ * Returns -1 if the remote walk resolved something or failed a lookup
+ * (status_ret says which), 0 if the caller should look up the next
+ * component itself.
+ */
+static int8_t name_$resolve_remote(char *path, uint16_t path_len, uint16_t comp_start,
+                                   uid_t *current_uid, uid_t *dir_uid_ret,
+                                   int16_t *consumed, status_$t *status_ret)
+{
+    rem_file_$resolve_result_t result;
+    uint32_t hints[16];
+    uint16_t remaining;
+
+    if (HINT_$GET_HINTS(current_uid, hints) == 0 || hints[1] == NODE_$ME) {
+        return 0;
+    }
+
+    remaining = path_len - comp_start + 1;
+    if (remaining > REM_FILE_RESOLVE_PATH_MAX) {
+        return 0;
+    }
+
+    REM_FILE_$RESOLVE_PATHU(hints, current_uid, path + comp_start - 1, remaining,
+                            &result, status_ret);
+
+    /* Older servers and transport trouble: go component by component */
+    if (*status_ret == file_$bad_reply_received_from_remote_node ||
+        *status_ret == file_$comms_problem_with_remote_node) {
+        return 0;
+    }
+
+    if (result.consumed != 0) {
+        *consumed = comp_start + result.consumed;
+        *dir_uid_ret = result.dir_uid;
+        *current_uid = result.entry_uid;
+    }
+
+    return (result.consumed != 0 || *status_ret != status_$ok) ? -1 : 0;
+}
+
 /*
  * name_$resolve_internal - Internal pathname resolution
  *
@@ -113,6 +164,11 @@ void name_$resolve_internal(char *path, int16_t path_len, uid_t *dir_uid_ret,
             break;
 
         case start_path_$network:
+            /* "//node/..." - node names are entries in the network root */
+            consumed = 3;
+            NAME_$GET_ROOT_UID(&current_uid);
+            break;
+
         case start_path_$error:
             *status_ret = status_$naming_invalid_pathname;
             return;
@@ -149,6 +205,15 @@ void name_$resolve_internal(char *path, int16_t path_len, uid_t *dir_uid_ret,
             return;
         }
 
+        /* Remote directory: resolve as much as possible in one trip */
+        if (name_$resolve_remote(path, word_path_len, comp_start, &current_uid,
+                                 dir_uid_ret, &consumed, status_ret) < 0) {
+            if (*status_ret != status_$ok) {
+                return;
+            }
+            continue;
+        }
+
         /* Look up the component in the directory */
         DIR_$GET_ENTRYU(dir_uid_ret, path + comp_start - 1, (uint16_t *)&comp_len,
                         &entry_type, status_ret);
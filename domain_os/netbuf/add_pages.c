@@ -51,8 +51,10 @@ void NETBUF_$ADD_PAGES(uint32_t counts)
 
     /* Calculate how many data buffers we can allocate */
     dat_count = dat_requested;
-    if ((int32_t)dat_count > (int32_t)(NETBUF_$DAT_LIM - NETBUF_$DAT_CNT)) {
-        dat_count = (int16_t)(NETBUF_$DAT_LIM - NETBUF_$DAT_CNT);
+    if ((int32_t)dat_count > (int32_t)(NETBUF_$DAT_LIM - NETBUF_$DAT_CNT -
+                                       netbuf_$mag_dat_cnt)) {
+        dat_count = (int16_t)(NETBUF_$DAT_LIM - NETBUF_$DAT_CNT -
+                              netbuf_$mag_dat_cnt);
     }
 
     /* Check total doesn't exceed max allocation */
@@ -95,6 +97,7 @@ void NETBUF_$ADD_PAGES(uint32_t counts)
         token = ML_$SPIN_LOCK(&NETBUF_$SPIN_LOCK);
         *(uint32_t *)(hdr_ptr + NETBUF_HDR_NEXT_OFF) = NETBUF_$HDR_TOP;
         NETBUF_$HDR_TOP = va;
+        netbuf_$hdr_cnt++;
         ML_$SPIN_UNLOCK(&NETBUF_$SPIN_LOCK, token);
     }
 
@@ -114,7 +117,8 @@ void NETBUF_$ADD_PAGES(uint32_t counts)
     }
 
     /* If we over-allocated data buffers, trim back */
-    if (NETBUF_$DAT_CNT > NETBUF_$DAT_LIM) {
-        NETBUF_$DEL_PAGES(0, (int16_t)(NETBUF_$DAT_LIM - NETBUF_$DAT_CNT));
+    if (NETBUF_$DAT_CNT + netbuf_$mag_dat_cnt > NETBUF_$DAT_LIM) {
+        NETBUF_$DEL_PAGES(0, (int16_t)(NETBUF_$DAT_LIM - NETBUF_$DAT_CNT -
+                                       netbuf_$mag_dat_cnt));
     }
 }
@@ -55,10 +55,19 @@ void NETBUF_$DEL_PAGES(int16_t hdr_count, int16_t dat_count)
     /* Free header buffers */
     token = ML_$SPIN_LOCK(&NETBUF_$SPIN_LOCK);
 
+    /* Put the buffers network processes are keeping back on the lists */
+    netbuf_$mag_drain();
+
     for (i = 0; i < hdr_to_free; i++) {
         /* Remove from header free list */
         va = NETBUF_$HDR_TOP;
+        if (va == 0) {
+            /* The rest are in use; they are still allocated */
+            NETBUF_$HDR_ALLOC += hdr_to_free - i;
+            break;
+        }
         NETBUF_$HDR_TOP = NETBUF_HDR_NEXT(va);
+        netbuf_$hdr_cnt--;
 
         /* Return VA slot and get physical address */
         ppn = netbuf_rtnva_locked(&va);
@@ -71,6 +80,7 @@ void NETBUF_$DEL_PAGES(int16_t hdr_count, int16_t dat_count)
 
     /* Free data buffers */
     token = ML_$SPIN_LOCK(&NETBUF_$SPIN_LOCK);
+    netbuf_$mag_drain();
 
     /* Calculate how many data buffers we can free
      * Maintain minimum of 10 data buffers
@@ -27,20 +27,20 @@ int8_t NETBUF_$GET_DAT_COND(uint32_t *addr_out)
 
     token = ML_$SPIN_LOCK(&NETBUF_$SPIN_LOCK);
 
-    if (NETBUF_$DAT_CNT == 0) {
-        /* Pool is empty */
+    if (NETBUF_$DAT_CNT != 0) {
+        /* Get page from free list */
+        ppn = NETBUF_$DAT_TOP;
+
+        /* Update free list head */
+        NETBUF_$DAT_TOP = NETBUF_DAT_NEXT(ppn);
+        NETBUF_$DAT_CNT--;
+    } else if (netbuf_$mag_steal_dat(&ppn) >= 0) {
+        /* Pool is empty, magazines included */
         ML_$SPIN_UNLOCK(&NETBUF_$SPIN_LOCK, token);
         *addr_out = 0;
         return 0;
     }
 
-    /* Get page from free list */
-    ppn = NETBUF_$DAT_TOP;
-
-    /* Update free list head */
-    NETBUF_$DAT_TOP = NETBUF_DAT_NEXT(ppn);
-    NETBUF_$DAT_CNT--;
-
     ML_$SPIN_UNLOCK(&NETBUF_$SPIN_LOCK, token);
 
     *addr_out = ppn << 10;
@@ -61,6 +61,11 @@ void NETBUF_$GET_DAT(uint32_t *addr_out)
     uint32_t ppn;
     int16_t proc_type;
 
+    /* A network process takes one from its magazine first */
+    if (netbuf_$mag_get_dat(addr_out) < 0) {
+        return;
+    }
+
     while (1) {
         /* Try to get buffer from pool */
         result = NETBUF_$GET_DAT_COND(addr_out);
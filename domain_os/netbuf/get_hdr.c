@@ -27,15 +27,19 @@ int8_t NETBUF_$GET_HDR_COND(uint32_t *phys_out, uint32_t *va_out)
     *va_out = NETBUF_$HDR_TOP;
     va = *va_out;
 
-    if (va == 0) {
+    if (va != 0) {
+        /* Remove from free list */
+        NETBUF_$HDR_TOP = NETBUF_HDR_NEXT(va);
+        netbuf_$hdr_cnt--;
+    } else if (netbuf_$mag_steal_hdr(va_out) < 0) {
+        /* List is empty, but a network process is holding some */
+        va = *va_out;
+    } else {
         /* Pool is empty */
         ML_$SPIN_UNLOCK(&NETBUF_$SPIN_LOCK, token);
         return 0;
     }
 
-    /* Remove from free list */
-    NETBUF_$HDR_TOP = NETBUF_HDR_NEXT(va);
-
     ML_$SPIN_UNLOCK(&NETBUF_$SPIN_LOCK, token);
 
     /* Return physical address from buffer */
@@ -60,6 +64,11 @@ void NETBUF_$GET_HDR(uint32_t *phys_out, uint32_t *va_out)
     int16_t proc_type;
     int i;
 
+    /* A network process takes one from its magazine first */
+    if (netbuf_$mag_get_hdr(phys_out, va_out) < 0) {
+        return;
+    }
+
     while (1) {
         /* Try to get buffer from pool */
         result = NETBUF_$GET_HDR_COND(phys_out, va_out);
@@ -0,0 +1,369 @@
+/*
+ * netbuf_$mag_* - Per-process buffer magazines
+ *
+ * The receive daemons, the routing process and the request and page
+ * servers get and return a header buffer and a data buffer or two for
+ * every packet, each time unlinking or linking one buffer on a global
+ * list.  Each of those processes now has a magazine of buffers of its
+ * own: most gets and returns are a push or pop on it, and the global
+ * lists are walked once per NETBUF_MAG_BATCH buffers.
+ *
+ * A get or return that the magazine alone can satisfy only masks
+ * interrupts around the push or pop: this is a single processor, so
+ * nothing else can touch the magazine meanwhile, and no lock is taken.
+ * Refills, spills and everything that reaches into another process's
+ * magazine are done under NETBUF_$SPIN_LOCK, which also masks
+ * interrupts, so buffers in a magazine are never out of reach: they
+ * count against NETBUF_$DAT_LIM
+ * like buffers on the global list, a process that finds the global list
+ * empty takes one from another process's magazine, NETBUF_$DEL_PAGES
+ * empties them all before freeing, and NETBUF_$RTN_MAG gives a process's
+ * magazine back when it is unbound.
+ *
+ * Refilling is also where the pool is watched: if a refill leaves the
+ * global list below its low watermark the pool is grown there and then,
+ * in the network process that needs the buffers, rather than that
+ * process later sleeping on the delay queue.
+ */
+
+#include "netbuf/netbuf_internal.h"
+
+static netbuf_$mag_t netbuf_$mags[PROC1_MAX_PROCESSES];
+
+static int16_t netbuf_$hdr_low_water;
+static int16_t netbuf_$dat_low_water = 8;
+static int16_t netbuf_$grow_by = 4;
+static int8_t netbuf_$growing;
+static uint32_t netbuf_$grows;
+
+static netbuf_$mag_t *netbuf_$my_mag(void)
+{
+    if (PROC1_$TYPE[PROC1_$CURRENT] != NETBUF_NETWORK_PROC_TYPE) {
+        return NULL;
+    }
+    return &netbuf_$mags[PROC1_$CURRENT];
+}
+
+/*
+ * Move every buffer in a magazine to the global lists.  Called locked.
+ * The buffers were already counted as free, so no limit is checked.
+ */
+static void netbuf_$mag_empty(netbuf_$mag_t *mag)
+{
+    uint32_t va;
+    uint32_t ppn;
+
+    while (mag->n_hdr > 0) {
+        va = mag->hdr[--mag->n_hdr];
+        NETBUF_HDR_NEXT(va) = NETBUF_$HDR_TOP;
+        NETBUF_$HDR_TOP = va;
+        netbuf_$hdr_cnt++;
+        netbuf_$mag_hdr_cnt--;
+    }
+    while (mag->n_dat > 0) {
+        ppn = mag->dat[--mag->n_dat];
+        NETBUF_DAT_NEXT(ppn) = (uint16_t)NETBUF_$DAT_TOP;
+        NETBUF_$DAT_TOP = ppn;
+        NETBUF_$DAT_CNT++;
+        netbuf_$mag_dat_cnt--;
+    }
+}
+
+/*
+ * Grow the pool if either list is below its watermark.  Only one process
+ * grows it at a time; NETBUF_$ADD_PAGES keeps data buffers within
+ * NETBUF_$DAT_LIM and header buffers within NETBUF_HDR_MAX.
+ */
+static void netbuf_$check_water(void)
+{
+    ml_$spin_token_t token;
+    uint32_t counts;
+
+    token = ML_$SPIN_LOCK(&NETBUF_$SPIN_LOCK);
+    counts = 0;
+    if (netbuf_$growing >= 0) {
+        if (netbuf_$hdr_cnt < netbuf_$hdr_low_water) {
+            counts |= (uint32_t)netbuf_$grow_by << 16;
+        }
+        if ((int32_t)NETBUF_$DAT_CNT < netbuf_$dat_low_water) {
+            counts |= (uint16_t)netbuf_$grow_by;
+        }
+        if (counts != 0) {
+            netbuf_$growing = -1;
+        }
+    }
+    ML_$SPIN_UNLOCK(&NETBUF_$SPIN_LOCK, token);
+
+    if (counts != 0) {
+        NETBUF_$ADD_PAGES(counts);
+        netbuf_$grows++;
+        netbuf_$growing = 0;
+    }
+}
+
+int8_t netbuf_$mag_get_hdr(uint32_t *phys_out, uint32_t *va_out)
+{
+    netbuf_$mag_t *mag;
+    ml_$spin_token_t token;
+    uint16_t saved_sr;
+    uint32_t va;
+    int8_t refilled = 0;
+
+    mag = netbuf_$my_mag();
+    if (mag == NULL) {
+        return 0;
+    }
+
+    DISABLE_INTERRUPTS(saved_sr);
+    if (mag->n_hdr != 0) {
+        va = mag->hdr[--mag->n_hdr];
+        netbuf_$mag_hdr_cnt--;
+        ENABLE_INTERRUPTS(saved_sr);
+        *va_out = va;
+        *phys_out = NETBUF_HDR_PHYS(va);
+        return -1;
+    }
+    ENABLE_INTERRUPTS(saved_sr);
+
+    token = ML_$SPIN_LOCK(&NETBUF_$SPIN_LOCK);
+    if (mag->n_hdr == 0) {
+        while (mag->n_hdr < NETBUF_MAG_BATCH && NETBUF_$HDR_TOP != 0) {
+            va = NETBUF_$HDR_TOP;
+            NETBUF_$HDR_TOP = NETBUF_HDR_NEXT(va);
+            netbuf_$hdr_cnt--;
+            netbuf_$mag_hdr_cnt++;
+            mag->hdr[mag->n_hdr++] = va;
+        }
+        refilled = -1;
+    }
+    va = 0;
+    if (mag->n_hdr != 0) {
+        va = mag->hdr[--mag->n_hdr];
+        netbuf_$mag_hdr_cnt--;
+    }
+    ML_$SPIN_UNLOCK(&NETBUF_$SPIN_LOCK, token);
+
+    if (refilled < 0) {
+        netbuf_$check_water();
+    }
+    if (va == 0) {
+        return 0;
+    }
+
+    *va_out = va;
+    *phys_out = NETBUF_HDR_PHYS(va);
+    return -1;
+}
+
+int8_t netbuf_$mag_rtn_hdr(uint32_t va)
+{
+    netbuf_$mag_t *mag;
+    ml_$spin_token_t token;
+    uint16_t saved_sr;
+    uint32_t top;
+
+    mag = netbuf_$my_mag();
+    if (mag == NULL) {
+        return 0;
+    }
+
+    DISABLE_INTERRUPTS(saved_sr);
+    if (mag->n_hdr < NETBUF_MAG_SIZE) {
+        mag->hdr[mag->n_hdr++] = va;
+        netbuf_$mag_hdr_cnt++;
+        ENABLE_INTERRUPTS(saved_sr);
+        return -1;
+    }
+    ENABLE_INTERRUPTS(saved_sr);
+
+    token = ML_$SPIN_LOCK(&NETBUF_$SPIN_LOCK);
+    if (mag->n_hdr == NETBUF_MAG_SIZE) {
+        while (mag->n_hdr > NETBUF_MAG_SIZE - NETBUF_MAG_BATCH) {
+            top = mag->hdr[--mag->n_hdr];
+            NETBUF_HDR_NEXT(top) = NETBUF_$HDR_TOP;
+            NETBUF_$HDR_TOP = top;
+            netbuf_$hdr_cnt++;
+            netbuf_$mag_hdr_cnt--;
+        }
+    }
+    mag->hdr[mag->n_hdr++] = va;
+    netbuf_$mag_hdr_cnt++;
+    ML_$SPIN_UNLOCK(&NETBUF_$SPIN_LOCK, token);
+
+    return -1;
+}
+
+int8_t netbuf_$mag_get_dat(uint32_t *addr_out)
+{
+    netbuf_$mag_t *mag;
+    ml_$spin_token_t token;
+    uint16_t saved_sr;
+    uint32_t ppn;
+    int8_t refilled = 0;
+
+    mag = netbuf_$my_mag();
+    if (mag == NULL) {
+        return 0;
+    }
+
+    DISABLE_INTERRUPTS(saved_sr);
+    if (mag->n_dat != 0) {
+        ppn = mag->dat[--mag->n_dat];
+        netbuf_$mag_dat_cnt--;
+        ENABLE_INTERRUPTS(saved_sr);
+        *addr_out = ppn << 10;
+        return -1;
+    }
+    ENABLE_INTERRUPTS(saved_sr);
+
+    token = ML_$SPIN_LOCK(&NETBUF_$SPIN_LOCK);
+    if (mag->n_dat == 0) {
+        while (mag->n_dat < NETBUF_MAG_BATCH && NETBUF_$DAT_CNT != 0) {
+            ppn = NETBUF_$DAT_TOP;
+            NETBUF_$DAT_TOP = NETBUF_DAT_NEXT(ppn);
+            NETBUF_$DAT_CNT--;
+            netbuf_$mag_dat_cnt++;
+            mag->dat[mag->n_dat++] = ppn;
+        }
+        refilled = -1;
+    }
+    ppn = 0;
+    if (mag->n_dat != 0) {
+        ppn = mag->dat[--mag->n_dat];
+        netbuf_$mag_dat_cnt--;
+    }
+    ML_$SPIN_UNLOCK(&NETBUF_$SPIN_LOCK, token);
+
+    if (refilled < 0) {
+        netbuf_$check_water();
+    }
+    if (ppn == 0) {
+        return 0;
+    }
+
+    *addr_out = ppn << 10;
+    return -1;
+}
+
+int8_t netbuf_$mag_rtn_dat(uint32_t ppn)
+{
+    netbuf_$mag_t *mag;
+    ml_$spin_token_t token;
+    uint16_t saved_sr;
+    uint32_t top;
+
+    mag = netbuf_$my_mag();
+    if (mag == NULL) {
+        return 0;
+    }
+
+    DISABLE_INTERRUPTS(saved_sr);
+    if (mag->n_dat < NETBUF_MAG_SIZE &&
+        NETBUF_$DAT_CNT + netbuf_$mag_dat_cnt < NETBUF_$DAT_LIM) {
+        mag->dat[mag->n_dat++] = ppn;
+        netbuf_$mag_dat_cnt++;
+        ENABLE_INTERRUPTS(saved_sr);
+        return -1;
+    }
+    ENABLE_INTERRUPTS(saved_sr);
+
+    token = ML_$SPIN_LOCK(&NETBUF_$SPIN_LOCK);
+
+    if (NETBUF_$DAT_CNT + netbuf_$mag_dat_cnt >= NETBUF_$DAT_LIM) {
+        /* Pool is full: free it, as NETBUF_$RTN_DAT does */
+        ML_$SPIN_UNLOCK(&NETBUF_$SPIN_LOCK, token);
+        MMAP_$FREE(ppn);
+        return -1;
+    }
+
+    if (mag->n_dat == NETBUF_MAG_SIZE) {
+        while (mag->n_dat > NETBUF_MAG_SIZE - NETBUF_MAG_BATCH) {
+            top = mag->dat[--mag->n_dat];
+            NETBUF_DAT_NEXT(top) = (uint16_t)NETBUF_$DAT_TOP;
+            NETBUF_$DAT_TOP = top;
+            NETBUF_$DAT_CNT++;
+            netbuf_$mag_dat_cnt--;
+        }
+    }
+    mag->dat[mag->n_dat++] = ppn;
+    netbuf_$mag_dat_cnt++;
+    ML_$SPIN_UNLOCK(&NETBUF_$SPIN_LOCK, token);
+
+    return -1;
+}
+
+int8_t netbuf_$mag_steal_hdr(uint32_t *va_out)
+{
+    netbuf_$mag_t *mag;
+    int16_t i;
+
+    if (netbuf_$mag_hdr_cnt == 0) {
+        return 0;
+    }
+    for (i = 0, mag = netbuf_$mags; i < PROC1_MAX_PROCESSES; i++, mag++) {
+        if (mag->n_hdr != 0) {
+            *va_out = mag->hdr[--mag->n_hdr];
+            netbuf_$mag_hdr_cnt--;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int8_t netbuf_$mag_steal_dat(uint32_t *ppn_out)
+{
+    netbuf_$mag_t *mag;
+    int16_t i;
+
+    if (netbuf_$mag_dat_cnt == 0) {
+        return 0;
+    }
+    for (i = 0, mag = netbuf_$mags; i < PROC1_MAX_PROCESSES; i++, mag++) {
+        if (mag->n_dat != 0) {
+            *ppn_out = mag->dat[--mag->n_dat];
+            netbuf_$mag_dat_cnt--;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void netbuf_$mag_drain(void)
+{
+    netbuf_$mag_t *mag;
+    int16_t i;
+
+    if (netbuf_$mag_hdr_cnt == 0 && netbuf_$mag_dat_cnt == 0) {
+        return;
+    }
+    for (i = 0, mag = netbuf_$mags; i < PROC1_MAX_PROCESSES; i++, mag++) {
+        netbuf_$mag_empty(mag);
+    }
+}
+
+void NETBUF_$RTN_MAG(uint16_t pid)
+{
+    ml_$spin_token_t token;
+
+    if (pid >= PROC1_MAX_PROCESSES) {
+        return;
+    }
+
+    token = ML_$SPIN_LOCK(&NETBUF_$SPIN_LOCK);
+    netbuf_$mag_empty(&netbuf_$mags[pid]);
+    ML_$SPIN_UNLOCK(&NETBUF_$SPIN_LOCK, token);
+}
+
+void NETBUF_$SET_WATERMARKS(int16_t hdr_low, int16_t dat_low, int16_t grow_by)
+{
+    netbuf_$hdr_low_water = hdr_low;
+    netbuf_$dat_low_water = dat_low;
+    netbuf_$grow_by = grow_by;
+}
+
+void NETBUF_$GET_DEPTH(int16_t *hdr_free, int16_t *dat_free, uint32_t *grows)
+{
+    *hdr_free = netbuf_$hdr_cnt + netbuf_$mag_hdr_cnt;
+    *dat_free = (int16_t)(NETBUF_$DAT_CNT + netbuf_$mag_dat_cnt);
+    *grows = netbuf_$grows;
+}
@@ -208,4 +208,37 @@ void NETBUF_$RTN_DAT(uint32_t addr);
 void NETBUF_$RTN_PKT(uint32_t *hdr_ptr, uint32_t *va_ptr,
                      uint32_t *dat_arr, int16_t dat_len);
 
+/*
+ * NETBUF_$SET_WATERMARKS - Set the pool refill thresholds
+ *
+ * When a network process refills its buffer magazine and leaves fewer
+ * than the low watermark of a kind in the global pool, grow_by more are
+ * added with NETBUF_$ADD_PAGES, so that allocation does not have to wait.
+ * A watermark of 0 turns growing off for that kind.
+ *
+ * @param hdr_low   Header buffer low watermark
+ * @param dat_low   Data buffer low watermark
+ * @param grow_by   Buffers added each time
+ */
+void NETBUF_$SET_WATERMARKS(int16_t hdr_low, int16_t dat_low, int16_t grow_by);
+
+/*
+ * NETBUF_$GET_DEPTH - Current pool depth
+ *
+ * @param hdr_free  Output: free header buffers, including magazines
+ * @param dat_free  Output: free data buffers, including magazines
+ * @param grows     Output: times the pool was grown at a watermark
+ */
+void NETBUF_$GET_DEPTH(int16_t *hdr_free, int16_t *dat_free, uint32_t *grows);
+
+/*
+ * NETBUF_$RTN_MAG - Return a process's buffer magazine to the pool
+ *
+ * Called when the process is unbound, so that the buffers it kept for
+ * itself go back on the global free lists.
+ *
+ * @param pid   Level 1 process ID
+ */
+void NETBUF_$RTN_MAG(uint16_t pid);
+
 #endif /* NETBUF_H */
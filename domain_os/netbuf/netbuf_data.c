@@ -43,6 +43,17 @@ uint16_t NETBUF_$DELAY_TYPE = 0;
  */
 clock_t NETBUF_$DELAY_TIME = { 0, 0x100 };
 
+/*
+ * Free header buffers on the global list
+ */
+int16_t netbuf_$hdr_cnt;
+
+/*
+ * Free buffers in network processes' magazines
+ */
+int16_t netbuf_$mag_hdr_cnt;
+uint32_t netbuf_$mag_dat_cnt;
+
 /*
  * Error status for crash
  */
@@ -140,4 +140,50 @@ extern clock_t NETBUF_$DELAY_TIME;
  */
 extern status_$t netbuf_err;
 
+/*
+ * Free header buffers on NETBUF_$HDR_TOP.  Not in the original data
+ * area, which only counted header buffers allocated.
+ */
+extern int16_t netbuf_$hdr_cnt;
+
+/*
+ * Free buffers held in network processes' magazines.  A data buffer is
+ * free if it is on NETBUF_$DAT_TOP or in a magazine, and the two counts
+ * together are kept within NETBUF_$DAT_LIM.
+ */
+extern int16_t netbuf_$mag_hdr_cnt;
+extern uint32_t netbuf_$mag_dat_cnt;
+
+/*
+ * Buffer magazines (magazine.c)
+ *
+ * Each network process (type 7) keeps a few header and data buffers of
+ * its own and only walks the global free lists to move NETBUF_MAG_BATCH
+ * of them at a time.  Magazines are read and changed under
+ * NETBUF_$SPIN_LOCK, so that the _COND entry points (which may run at
+ * interrupt level) can take a buffer from any magazine when the global
+ * list is empty.
+ */
+#define NETBUF_MAG_SIZE         8
+#define NETBUF_MAG_BATCH        4
+
+typedef struct netbuf_$mag_t {
+  int16_t n_hdr;
+  int16_t n_dat;
+  uint32_t hdr[NETBUF_MAG_SIZE]; /* Header buffer VAs */
+  uint32_t dat[NETBUF_MAG_SIZE]; /* Data buffer PPNs */
+} netbuf_$mag_t;
+
+int8_t netbuf_$mag_get_hdr(uint32_t *phys_out, uint32_t *va_out);
+int8_t netbuf_$mag_rtn_hdr(uint32_t va);
+int8_t netbuf_$mag_get_dat(uint32_t *addr_out);
+int8_t netbuf_$mag_rtn_dat(uint32_t ppn);
+
+/* Take one buffer from any magazine.  Called locked. */
+int8_t netbuf_$mag_steal_hdr(uint32_t *va_out);
+int8_t netbuf_$mag_steal_dat(uint32_t *ppn_out);
+
+/* Move every magazine's buffers to the global lists.  Called locked. */
+void netbuf_$mag_drain(void);
+
 #endif /* NETBUF_INTERNAL_H */
@@ -5,8 +5,9 @@
  *
  * Original address: 0x00E0F046
  *
- * If the pool is at capacity (dat_cnt >= dat_lim), the page is freed
- * via MMAP_$FREE instead of being returned to the pool.
+ * If the pool is at capacity (dat_cnt >= dat_lim, counting buffers in
+ * magazines), the page is freed via MMAP_$FREE instead of being
+ * returned to the pool.
  */
 
 #include "netbuf/netbuf_internal.h"
@@ -18,9 +19,14 @@ void NETBUF_$RTN_DAT(uint32_t addr)
 
     ppn = addr >> 10;
 
+    /* A network process keeps it in its magazine */
+    if (netbuf_$mag_rtn_dat(ppn) < 0) {
+        return;
+    }
+
     token = ML_$SPIN_LOCK(&NETBUF_$SPIN_LOCK);
 
-    if (NETBUF_$DAT_CNT < NETBUF_$DAT_LIM) {
+    if (NETBUF_$DAT_CNT + netbuf_$mag_dat_cnt < NETBUF_$DAT_LIM) {
         /* Add to free list */
         NETBUF_DAT_NEXT(ppn) = (uint16_t)NETBUF_$DAT_TOP;
         NETBUF_$DAT_TOP = ppn;
@@ -31,13 +31,20 @@ void NETBUF_$RTN_HDR(uint32_t *va_ptr)
         CRASH_SYSTEM(&netbuf_err);
     }
 
+    va = va & ~0x3FF;  /* Align to 1KB boundary */
+
+    /* A network process keeps it in its magazine */
+    if (netbuf_$mag_rtn_hdr(va) < 0) {
+        return;
+    }
+
     /* Acquire lock and add to free list */
     token = ML_$SPIN_LOCK(&NETBUF_$SPIN_LOCK);
 
-    /* Link buffer into free list (using 1KB aligned address) */
-    va = va & ~0x3FF;  /* Align to 1KB boundary */
+    /* Link buffer into free list */
     NETBUF_HDR_NEXT(va) = NETBUF_$HDR_TOP;
     NETBUF_$HDR_TOP = va;
+    netbuf_$hdr_cnt++;
 
     ML_$SPIN_UNLOCK(&NETBUF_$SPIN_LOCK, token);
 }
@@ -5,6 +5,7 @@
  *   - cmd=0: Initialize logging (wire pages, allocate buffers, set target)
  *   - cmd=1: Shutdown logging (send pending, free resources)
  *   - cmd=2: Update kinds filter
+ *   - cmd=3: As cmd=0, but log in the compact format
  *
  * Original address: 0x00E71914
  */
@@ -47,6 +48,11 @@ void NETLOG_$CNTL(int16_t *cmd, uint32_t *node, uint16_t *sock,
     int16_t i;
     int16_t wire_count;
     uint32_t ppn_shifted;
+    netlog_$ring_t *ring;
+    uint32_t buf_va[2];
+    ml_$spin_token_t token;
+    clock_t now;
+    int8_t send;
 
     *status_ret = status_$ok;
 
@@ -60,19 +66,56 @@ void NETLOG_$CNTL(int16_t *cmd, uint32_t *node, uint16_t *sock,
         NETLOG_$OK_TO_LOG_SERVER = 0;
 
         /*
-         * If there are pending entries in the current buffer, send them
+         * If there are pending entries in the page being filled, send
+         * them.  A compact ring passes the page to SEND_PAGE with any
+         * others still waiting (it is never one of them).
          */
-        if (nl->page_counts[nl->current_buf_index] > 0) {
+        send = 0;
+        token = ML_$SPIN_LOCK(&nl->spin_lock);
+        if (NETLOG_COMPACT(nl)) {
+            ring = NETLOG_RING(nl);
+            if (((netlog_$page_hdr_t *)ring->fill_va)->entries > 0) {
+                ring->filled++;
+                nl->done_cnt++;
+            }
+            send = (int8_t)0xFF;
+        } else if (nl->page_counts[nl->current_buf_index] > 0) {
             nl->send_page_index = nl->current_buf_index;
             nl->done_cnt++;
+            send = (int8_t)0xFF;
+        }
+        ML_$SPIN_UNLOCK(&nl->spin_lock, token);
+        if (send < 0) {
             NETLOG_$SEND_PAGE();
         }
 
+        /*
+         * Detach the buffers before freeing them; LOG_IT and SEND_PAGE
+         * do nothing once they are gone
+         */
+        token = ML_$SPIN_LOCK(&nl->spin_lock);
+        buf_va[0] = nl->buffer_va[1];
+        buf_va[1] = nl->buffer_va[2];
+        nl->buffer_va[1] = 0;
+        nl->buffer_va[2] = 0;
+        ML_$SPIN_UNLOCK(&nl->spin_lock, token);
+
+        /*
+         * Return the compact ring's pages
+         */
+        if (NETLOG_COMPACT(nl)) {
+            ring = (netlog_$ring_t *)buf_va[0];
+            for (i = 0; i < NETLOG_PAGES; i++) {
+                NETBUF_$RTNVA(&ring->page_va[i]);
+                MMAP_$FREE(ring->page_ppn[i]);
+            }
+        }
+
         /*
          * Return buffer virtual addresses
          */
-        NETBUF_$RTNVA(&nl->buffer_va[1]);
-        NETBUF_$RTNVA(&nl->buffer_va[2]);
+        NETBUF_$RTNVA(&buf_va[0]);
+        NETBUF_$RTNVA(&buf_va[1]);
 
         /*
          * Free buffer physical pages
@@ -101,8 +144,9 @@ void NETLOG_$CNTL(int16_t *cmd, uint32_t *node, uint16_t *sock,
 
     /*
      * Command 0: Initialize logging
+     * Command 3: Initialize logging in the compact format
      */
-    if (*cmd == 0 && nl->initialized >= 0) {
+    if ((*cmd == 0 || *cmd == 3) && nl->initialized >= 0) {
         /*
          * Wire code and data pages
          * First, wire the NETLOG code section
@@ -131,7 +175,8 @@ void NETLOG_$CNTL(int16_t *cmd, uint32_t *node, uint16_t *sock,
         NETLOG_$KINDS = *kinds;
 
         /*
-         * Allocate two buffer pages for double-buffering
+         * Allocate two buffer pages: for double-buffering, or in the
+         * compact format the ring and the page batches are shipped from
          */
         WP_$CALLOC(&nl->buffer_ppn[0], status_ret);
         WP_$CALLOC(&nl->buffer_ppn[1], status_ret);
@@ -141,27 +186,51 @@ void NETLOG_$CNTL(int16_t *cmd, uint32_t *node, uint16_t *sock,
          * ppn_shifted = ppn << 10 (1KB pages)
          */
         ppn_shifted = nl->buffer_ppn[0] << 10;
-        NETBUF_$GETVA(ppn_shifted, &nl->buffer_va[1], status_ret);
+        NETBUF_$GETVA(ppn_shifted, &buf_va[0], status_ret);
 
         ppn_shifted = nl->buffer_ppn[1] << 10;
         NETBUF_$GETVA(ppn_shifted, &nl->buffer_va[2], status_ret);
 
         /*
-         * Initialize buffer state
-         * Start with buffer 1 as current
+         * Initialize packet template; pkt_type2 also tells LOG_IT and
+         * SEND_PAGE which format is in use
          */
-        nl->current_buf_index = 1;
+        nl->pkt_type1 = NETLOG_PKT_TYPE1;   /* 99 */
+        nl->pkt_type2 = (*cmd == 3) ? NETLOG_FORMAT_COMPACT : NETLOG_PKT_TYPE2;
+        nl->pkt_done_cnt = 0;
         nl->done_cnt = 0;
-        nl->page_counts[1] = 0;
-        nl->page_counts[2] = 0;
-        nl->current_buf_ptr = nl->buffer_va[1];
+
+        if (*cmd == 3) {
+            /*
+             * Allocate the ring's pages and start filling the first
+             */
+            ring = (netlog_$ring_t *)buf_va[0];
+            for (i = 0; i < NETLOG_PAGES; i++) {
+                WP_$CALLOC(&ring->page_ppn[i], status_ret);
+                NETBUF_$GETVA(ring->page_ppn[i] << 10, &ring->page_va[i], status_ret);
+            }
+            ring->ship_index = 0;
+            ring->filled = 0;
+            ring->lost = 0;
+            TIME_$CLOCK(&now);
+            netlog_$page_open(ring, ring->page_va[0], now.high);
+        } else {
+            /*
+             * Initialize buffer state
+             * Start with buffer 1 as current
+             */
+            nl->current_buf_index = 1;
+            nl->page_counts[1] = 0;
+            nl->page_counts[2] = 0;
+            nl->current_buf_ptr = buf_va[0];
+        }
 
         /*
-         * Initialize packet template
+         * LOG_IT writes nothing until the buffer is in place
          */
-        nl->pkt_type1 = NETLOG_PKT_TYPE1;   /* 99 */
-        nl->pkt_type2 = NETLOG_PKT_TYPE2;   /* 1 */
-        nl->pkt_done_cnt = 0;
+        token = ML_$SPIN_LOCK(&nl->spin_lock);
+        nl->buffer_va[1] = buf_va[0];
+        ML_$SPIN_UNLOCK(&nl->spin_lock, token);
 
         /*
          * Set flags to indicate ready
@@ -171,9 +240,9 @@ void NETLOG_$CNTL(int16_t *cmd, uint32_t *node, uint16_t *sock,
     }
 
     /*
-     * Commands 0 and 2: Update logging flags based on kinds
+     * Commands 0, 2 and 3: Update logging flags based on kinds
      */
-    if (*cmd == 0 || *cmd == 2) {
+    if (*cmd == 0 || *cmd == 2 || *cmd == 3) {
         NETLOG_$KINDS = *kinds;
 
         /*
@@ -0,0 +1,229 @@
+/*
+ * netlog_$* - Compact log format
+ *
+ * Encoding of entries into ring pages, called by NETLOG_$LOG_IT with the
+ * NETLOG spin lock held, and the squeezing NETLOG_$SEND_PAGE does to a
+ * filled page before shipping it.  The formats are described in
+ * netlog_internal.h.
+ *
+ * An entry the original wrote as 26 bytes is usually four to eight:
+ * consecutive events tend to come from the same process, about the same
+ * object, with parameters (block numbers, counts) close to the last.
+ */
+
+#include "netlog/netlog_internal.h"
+
+static uint8_t *netlog_$put_varint(uint8_t *p, uint32_t v)
+{
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+void netlog_$page_open(netlog_$ring_t *ring, uint32_t page_va, uint32_t base_time)
+{
+    netlog_$page_hdr_t *hdr = (netlog_$page_hdr_t *)page_va;
+    int16_t i;
+
+    hdr->format = NETLOG_FORMAT_COMPACT;
+    hdr->entries = 0;
+    hdr->base_time = base_time;
+    hdr->len = 0;
+    hdr->n_uids = 0;
+    hdr->lost = ring->lost;
+    ring->lost = 0;
+
+    ring->fill_va = page_va;
+    ring->off = sizeof(netlog_$page_hdr_t);
+    ring->last_uid = NETLOG_UID_NONE;
+    ring->last_time = base_time;
+    ring->last_pid = 0;
+    for (i = 0; i < NETLOG_PARAMS; i++) {
+        ring->last_params[i] = 0;
+    }
+    for (i = 0; i < NETLOG_UID_HASH; i++) {
+        ring->uid_hash[i] = 0;
+    }
+}
+
+/* UID index i is stored at NETLOG_PAGE_LIMIT - 8 * (i + 1) */
+#define NETLOG_UID_AT(page, i) \
+    ((uint32_t *)((uint8_t *)(page) + NETLOG_PAGE_LIMIT - 8 * ((i) + 1)))
+
+/* Index of uid in the fill page's table, adding it if need be */
+static int16_t netlog_$intern(netlog_$ring_t *ring, netlog_$page_hdr_t *hdr,
+                              uint32_t *uid)
+{
+    uint32_t *e;
+    uint16_t h;
+    uint8_t slot;
+
+    /* Most often the same as last time */
+    if (ring->last_uid != NETLOG_UID_NONE) {
+        e = NETLOG_UID_AT(hdr, ring->last_uid);
+        if (e[0] == uid[0] && e[1] == uid[1]) {
+            return (int16_t)ring->last_uid;
+        }
+    }
+
+    h = (uint16_t)(uid[0] ^ uid[1] ^ (uid[1] >> 16));
+    h = (h ^ (h >> 6)) & (NETLOG_UID_HASH - 1);
+    while ((slot = ring->uid_hash[h]) != 0) {
+        e = NETLOG_UID_AT(hdr, slot - 1);
+        if (e[0] == uid[0] && e[1] == uid[1]) {
+            return (int16_t)(slot - 1);
+        }
+        h = (h + 1) & (NETLOG_UID_HASH - 1);
+    }
+
+    if (hdr->n_uids == NETLOG_UID_MAX) {
+        return -1;
+    }
+    e = NETLOG_UID_AT(hdr, hdr->n_uids);
+    e[0] = uid[0];
+    e[1] = uid[1];
+    ring->uid_hash[h] = (uint8_t)(hdr->n_uids + 1);
+    return (int16_t)hdr->n_uids++;
+}
+
+int16_t netlog_$encode(netlog_$ring_t *ring, uint8_t kind, uint8_t pid,
+                       uint32_t time, uint32_t *uid, uint16_t *params)
+{
+    netlog_$page_hdr_t *hdr = (netlog_$page_hdr_t *)ring->fill_va;
+    uint8_t *p;
+    uint8_t *lead;
+    uint8_t *maskp;
+    uint8_t mask;
+    int16_t uid_index;
+    int16_t diff;
+    int16_t i;
+
+    /* Room for the longest entry and one more UID, or the page is full */
+    if (ring->off + NETLOG_ENTRY_MAX + 8 >
+        NETLOG_PAGE_LIMIT - 8 * hdr->n_uids) {
+        return -1;
+    }
+    uid_index = netlog_$intern(ring, hdr, uid);
+    if (uid_index < 0) {
+        return -1;
+    }
+
+    p = (uint8_t *)ring->fill_va + ring->off;
+    lead = p++;
+    *lead = kind & NETLOG_E_KIND;
+
+    p = netlog_$put_varint(p, time - ring->last_time);
+    ring->last_time = time;
+
+    if (pid != ring->last_pid) {
+        *lead |= NETLOG_E_PID;
+        *p++ = pid;
+        ring->last_pid = pid;
+    }
+
+    if ((uint16_t)uid_index != ring->last_uid) {
+        *lead |= NETLOG_E_UID;
+        *p++ = (uint8_t)uid_index;
+        ring->last_uid = (uint16_t)uid_index;
+    }
+
+    maskp = p++;
+    mask = 0;
+    for (i = 0; i < NETLOG_PARAMS; i++) {
+        if (params[i] != ring->last_params[i]) {
+            mask |= (uint8_t)(1 << i);
+            diff = (int16_t)(params[i] - ring->last_params[i]);
+            p = netlog_$put_varint(p, (uint16_t)((diff << 1) ^ (diff >> 15)));
+            ring->last_params[i] = params[i];
+        }
+    }
+    if (mask != 0) {
+        *lead |= NETLOG_E_PARAMS;
+        *maskp = mask;
+    } else {
+        p--;
+    }
+
+    ring->off = (uint16_t)(p - (uint8_t *)ring->fill_va);
+    hdr->len = ring->off - sizeof(netlog_$page_hdr_t);
+    hdr->entries++;
+    return 0;
+}
+
+uint16_t netlog_$page_image(uint8_t *page)
+{
+    netlog_$page_hdr_t *hdr = (netlog_$page_hdr_t *)page;
+    uint8_t *src;
+    uint8_t *dst;
+    uint16_t n;
+
+    n = hdr->n_uids * 8;
+    src = page + NETLOG_PAGE_LIMIT - n;
+    dst = page + sizeof(netlog_$page_hdr_t) + hdr->len;
+    if (dst != src) {
+        while (n-- > 0) {
+            *dst++ = *src++;
+        }
+    }
+    return (uint16_t)(sizeof(netlog_$page_hdr_t) + hdr->len + hdr->n_uids * 8);
+}
+
+uint16_t netlog_$squeeze(const uint8_t *src, uint16_t len,
+                         uint8_t *dst, uint16_t max)
+{
+    uint16_t table[NETLOG_SQUEEZE_HASH];
+    const uint8_t *ip = src;
+    const uint8_t *end = src + len;
+    const uint8_t *m;
+    uint8_t *op = dst;
+    uint8_t *ctl = NULL;
+    uint8_t bit = 0;
+    uint16_t h;
+    uint16_t off;
+    uint16_t n;
+
+    for (h = 0; h < NETLOG_SQUEEZE_HASH; h++) {
+        table[h] = 0;
+    }
+
+    while (ip < end) {
+        if (bit == 0) {
+            /* A control byte and eight items of at most two bytes */
+            if ((op - dst) + 17 > max) {
+                return 0;
+            }
+            ctl = op++;
+            *ctl = 0;
+            bit = 1;
+        }
+
+        if (end - ip >= 3) {
+            h = (uint16_t)((ip[0] << 8 | ip[1]) ^ (ip[2] << 4));
+            h = (h ^ (h >> 8)) & (NETLOG_SQUEEZE_HASH - 1);
+            m = (table[h] != 0) ? src + table[h] - 1 : NULL;
+            table[h] = (uint16_t)(ip - src + 1);
+
+            if (m != NULL && (off = (uint16_t)(ip - m)) <= 1024 &&
+                m[0] == ip[0] && m[1] == ip[1] && m[2] == ip[2]) {
+                n = 3;
+                while (n < 66 && ip + n < end && m[n] == ip[n]) {
+                    n++;
+                }
+                *ctl |= bit;
+                *op++ = (uint8_t)(((n - 3) << 2) | ((off - 1) >> 8));
+                *op++ = (uint8_t)(off - 1);
+                ip += n;
+                bit <<= 1;
+                continue;
+            }
+        }
+
+        *op++ = *ip++;
+        bit <<= 1;
+    }
+
+    return (uint16_t)(op - dst);
+}
@@ -7,11 +7,60 @@
  * This function uses a spin lock for thread safety and double-buffering
  * to allow one buffer to be sent while the other accumulates entries.
  *
+ * In the compact format (NETLOG_$CNTL command 3) entries are instead
+ * delta-encoded (compact.c) into a ring of NETLOG_PAGES pages; the
+ * sender is woken as each fills, and ships whatever has filled by the
+ * time it runs, so pages it has not caught up with are not overwritten.
+ *
  * Original address: 0x00E71B38
  */
 
 #include "netlog/netlog_internal.h"
 
+/*
+ * Encode an entry into the compact ring.  Called locked; returns
+ * negative if a page filled and the sender is to be woken.
+ */
+static int8_t netlog_$log_compact(netlog_data_t *nl, uint8_t kind,
+                                  uint32_t time, uint32_t *uid,
+                                  uint16_t param3, uint16_t param4,
+                                  uint16_t param5, uint16_t param6,
+                                  uint16_t param7, uint16_t param8)
+{
+    netlog_$ring_t *ring = NETLOG_RING(nl);
+    uint16_t params[NETLOG_PARAMS];
+    uint8_t pid = NETLOG_GET_CURRENT_PID();
+
+    params[0] = param3;
+    params[1] = param4 & 0xFF;
+    params[2] = param5;
+    params[3] = param6;
+    params[4] = param7;
+    params[5] = param8;
+
+    if (netlog_$encode(ring, kind, pid, time, uid, params) == 0) {
+        return 0;
+    }
+
+    /*
+     * Page is full.  If every other page is still waiting to be shipped
+     * the entry is lost (and counted); otherwise pass the page to
+     * SEND_PAGE and start the next.
+     */
+    if (ring->filled == NETLOG_PAGES - 1) {
+        ring->lost++;
+        return 0;
+    }
+    ring->filled++;
+    nl->done_cnt++;
+    netlog_$page_open(ring,
+                      ring->page_va[(ring->ship_index + ring->filled) %
+                                    NETLOG_PAGES],
+                      time);
+    netlog_$encode(ring, kind, pid, time, uid, params);
+    return (int8_t)0xFF;
+}
+
 void NETLOG_$LOG_IT(uint16_t kind, uint32_t *uid,
                     uint16_t param3, uint16_t param4,
                     uint16_t param5, uint16_t param6,
@@ -49,6 +98,25 @@ void NETLOG_$LOG_IT(uint16_t kind, uint32_t *uid,
      */
     TIME_$CLOCK(&timestamp);
 
+    /*
+     * Nothing is written once CNTL has detached the buffers
+     */
+    if (nl->buffer_va[1] == 0) {
+        ML_$SPIN_UNLOCK(&nl->spin_lock, token);
+        return;
+    }
+
+    if (NETLOG_COMPACT(nl)) {
+        need_advance = netlog_$log_compact(nl, (uint8_t)kind, timestamp.high,
+                                           uid, param3, param4, param5,
+                                           param6, param7, param8);
+        ML_$SPIN_UNLOCK(&nl->spin_lock, token);
+        if (need_advance < 0) {
+            EC_$ADVANCE(&NETLOG_$EC);
+        }
+        return;
+    }
+
     /*
      * Increment entry count for current buffer and get index
      * Entry indices are 1-based (1 to 39)
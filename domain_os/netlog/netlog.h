@@ -3,7 +3,9 @@
  *
  * This module provides network logging capabilities for Domain/OS.
  * Log entries are buffered locally and sent to a remote logging server
- * when a page fills up (39 entries per page).
+ * when a page fills up (39 entries per page), or, if logging was started
+ * in the compact format, delta-encoded into a ring of pages and sent in
+ * batches as pages fill.
  *
  * The logging system supports filtering by "kind" - a bitmask that
  * controls which categories of events are logged.
@@ -46,7 +48,9 @@
  * Log entry structure (26 bytes, 0x1A)
  *
  * Each log entry contains a kind, process ID, timestamp, UID,
- * and up to 6 additional parameters.
+ * and up to 6 additional parameters.  Logging started with CNTL command
+ * 3 sends the same fields in the compact format described in
+ * netlog_internal.h instead.
  */
 typedef struct netlog_entry_t {
     uint8_t     kind;           /* 0x00: Log entry type/category */
@@ -99,7 +103,8 @@ extern uint16_t NETLOG_$SOCK;           /* 0xE248F8: Socket number */
  * Initializes, shuts down, or updates the network logging subsystem.
  *
  * Parameters:
- *   cmd        - Command: 0=init, 1=shutdown, 2=update kinds
+ *   cmd        - Command: 0=init, 1=shutdown, 2=update kinds,
+ *                3=init in the compact format
  *   node       - Pointer to target node ID (for init)
  *   sock       - Pointer to socket number (for init)
  *   kinds      - Pointer to kinds bitmask
@@ -111,6 +116,9 @@ extern uint16_t NETLOG_$SOCK;           /* 0xE248F8: Socket number */
  *   - Sets target node and socket
  *   - Enables logging based on kinds
  *
+ * For cmd=3 (init, compact format):
+ *   - As cmd=0, and allocates the page ring
+ *
  * For cmd=1 (shutdown):
  *   - Sends any pending log data
  *   - Frees buffers
@@ -150,6 +158,10 @@ void NETLOG_$CNTL(int16_t *cmd, uint32_t *node, uint16_t *sock,
  *   4. If buffer full, switches buffers and signals event count
  *   5. Releases spin lock
  *
+ * In the compact format, steps 3 and 4 encode the entry into the current
+ * ring page and, if it is full, start the next (or count the entry lost,
+ * if no page is free).
+ *
  * Original address: 0x00E71B38
  */
 void NETLOG_$LOG_IT(uint16_t kind, uint32_t *uid,
@@ -158,13 +170,16 @@ void NETLOG_$LOG_IT(uint16_t kind, uint32_t *uid,
                     uint16_t param7, uint16_t param8);
 
 /*
- * NETLOG_$SEND_PAGE - Send a filled log page
+ * NETLOG_$SEND_PAGE - Send filled log pages
  *
- * Sends the completed log page to the logging server.
- * Called internally when a buffer fills, or during shutdown.
+ * Sends the completed log page to the logging server, or in the compact
+ * format every filled page of the ring, squeezed and as many to a packet
+ * as fit.  Called by the network process when NETLOG_$EC is advanced,
+ * and during shutdown.
  *
- * The function:
- *   1. Captures page metadata (done count, entry count)
+ * For each packet, the function:
+ *   1. Sets the header template (done count and entry count, or first
+ *      page number and page count)
  *   2. Gets a network header
  *   3. Builds an internet packet header
  *   4. Sends the packet via NET_IO_$SEND
@@ -28,7 +28,7 @@
  * Packet type constants used in the packet header
  */
 #define NETLOG_PKT_TYPE1 99 /* 0x63 */
-#define NETLOG_PKT_TYPE2 1
+#define NETLOG_PKT_TYPE2 1 /* Fixed format, as the original sent */
 
 /*
  * Protocol constant for PKT_$BLD_INTERNET_HDR
@@ -136,9 +136,121 @@ extern netlog_data_t netlog_data;
 #define NETLOG_SWITCH_BUFFER(idx) (3 - (idx))
 
 /*
- * Internal function prototypes
+ * ============================================================================
+ * Compact Format
+ * ============================================================================
+ * Logging started with CNTL command 3 writes entries, delta-encoded,
+ * to a ring of NETLOG_PAGES wired pages, and sends them in packets with
+ * pkt_type2 NETLOG_FORMAT_COMPACT; command 0 keeps the fixed format, so
+ * a server that reads only that is not sent anything else.  In the
+ * compact format the two buffers CNTL allocates are not filled with
+ * netlog_entry_t: buffer 1 holds the ring (netlog_$ring_t) and buffer 2
+ * is where SEND_PAGE builds the batches it ships.  page_counts,
+ * current_buf_ptr, send_page_index and current_buf_index are unused.
+ *
+ * A page starts with a netlog_$page_hdr_t.  Entries grow up from it and
+ * the page's UID table grows down from NETLOG_PAGE_LIMIT, eight bytes a
+ * UID, index 0 highest.  An entry is:
+ *
+ *   lead byte    kind in NETLOG_E_KIND, and which of the below follow
+ *   varint       timestamp less that of the entry before
+ *   [byte]       process ID, if not that of the entry before
+ *   [byte]       UID table index, if not that of the entry before
+ *   [byte]       mask of parameters (param3 first) that changed, then
+ *                for each a zigzag varint of the 16-bit difference
+ *
+ * A varint is seven bits a byte, low first, 0x80 set on all but the
+ * last.  At the start of a page the entry before is taken to have had
+ * time base_time, process ID 0, no UID and all parameters 0.
  */
+#define NETLOG_PAGES            8       /* Pages in the ring */
+#define NETLOG_PAGE_SIZE        1024
+#define NETLOG_PAGE_LIMIT       (NETLOG_PAGE_SIZE - 8)  /* Room for batch records */
+#define NETLOG_UID_MAX          32      /* UIDs a page can name */
+#define NETLOG_UID_HASH         64      /* Slots in the UID lookup */
+#define NETLOG_UID_NONE         0xFFFF
+#define NETLOG_PARAMS           6
+#define NETLOG_ENTRY_MAX        27      /* Longest entry: 1+5+1+1+1+6*3 */
+
+/* Page format and pkt_type2 of packets carrying compact batches */
+#define NETLOG_FORMAT_COMPACT   2
+
+/* Lead byte */
+#define NETLOG_E_KIND           0x1F
+#define NETLOG_E_PID            0x20
+#define NETLOG_E_UID            0x40
+#define NETLOG_E_PARAMS         0x80
+
+typedef struct netlog_$page_hdr_t {
+  uint16_t format;    /* 0x00: NETLOG_FORMAT_COMPACT */
+  uint16_t entries;   /* 0x02: Entries in the page */
+  uint32_t base_time; /* 0x04: Time the first entry's delta is from */
+  uint16_t len;       /* 0x08: Bytes of entries, from 0x10 */
+  uint16_t n_uids;    /* 0x0A: UIDs in the table */
+  uint32_t lost;      /* 0x0C: Entries lost, all pages full, before this */
+} netlog_$page_hdr_t;
+
+typedef struct netlog_$ring_t {
+  uint32_t page_va[NETLOG_PAGES];
+  uint32_t page_ppn[NETLOG_PAGES];
+  uint16_t ship_index; /* Oldest page filled and not shipped */
+  uint16_t filled;     /* Pages filled and not shipped */
+  uint32_t lost;       /* Entries lost since the fill page was opened */
+
+  /* The page being filled, page_va[(ship_index + filled) % NETLOG_PAGES] */
+  uint32_t fill_va;
+  uint16_t off;        /* Next entry byte */
+  uint16_t last_uid;   /* State after the last entry, for deltas */
+  uint32_t last_time;
+  uint16_t last_params[NETLOG_PARAMS];
+  uint8_t last_pid;
+  uint8_t _pad;
+  uint8_t uid_hash[NETLOG_UID_HASH]; /* UID index + 1, 0 if empty */
+} netlog_$ring_t;
+
+#define NETLOG_COMPACT(nl) ((nl)->pkt_type2 == NETLOG_FORMAT_COMPACT)
+#define NETLOG_RING(nl) ((netlog_$ring_t *)(nl)->buffer_va[1])
+#define NETLOG_SHIP_VA(nl) ((nl)->buffer_va[2])
+#define NETLOG_SHIP_PPN(nl) ((nl)->buffer_ppn[1])
+
+/*
+ * Shipped batch
+ *
+ * The data page of a NETLOG_FORMAT_COMPACT packet holds a record for
+ * each page in the batch, then a record with clen 0.  A record is
+ * followed by clen bytes: the page image (header, entries and UID
+ * table, closed up) squeezed, or as it is if clen equals ulen.  The
+ * packet's pkt_done_cnt is the number of the batch's first page,
+ * counting from 1, and pkt_entry_cnt how many pages it holds.
+ *
+ * Squeezed data is a control byte before each run of eight items, bit
+ * i set if item i is a copy.  A literal item is a byte.  A copy is two
+ * bytes, high first: length - 3 in the top six bits and distance back
+ * - 1 in the low ten.
+ */
+typedef struct netlog_$batch_rec_t {
+  uint16_t clen;
+  uint16_t ulen;
+} netlog_$batch_rec_t;
+
+#define NETLOG_SQUEEZE_HASH     256
+
+/*
+ * Internal function prototypes (compact.c)
+ */
+
+/* Start filling page_va, entries timed from base_time */
+void netlog_$page_open(netlog_$ring_t *ring, uint32_t page_va, uint32_t base_time);
+
+/* Append an entry to the fill page; -1 if the page is full */
+int16_t netlog_$encode(netlog_$ring_t *ring, uint8_t kind, uint8_t pid,
+                       uint32_t time, uint32_t *uid, uint16_t *params);
+
+/* Close the gap before a filled page's UID table; returns image length */
+uint16_t netlog_$page_image(uint8_t *page);
 
-/* None currently - all functions are in the public header */
+/* Squeeze len bytes into at most max; 0 if they will not go */
+uint16_t netlog_$squeeze(const uint8_t *src, uint16_t len,
+                         uint8_t *dst, uint16_t max);
 
 #endif /* NETLOG_INTERNAL_H */
@@ -1,12 +1,19 @@
 /*
- * NETLOG_$SEND_PAGE - Send a filled log page
+ * NETLOG_$SEND_PAGE - Send filled log pages
  *
- * Sends the completed log page to the logging server.
- * This function is called internally when a buffer fills up
- * or during shutdown to send any remaining entries.
+ * Sends the completed log page to the logging server.  This is called
+ * by the network process when NETLOG_$EC is advanced, and during
+ * shutdown to send any remaining entries.
  *
- * The function:
- *   1. Captures page metadata (done count, entry count)
+ * In the compact format each filled page of the ring has the gap before
+ * its UID table closed up and is squeezed (compact.c), and as many as
+ * fit go in one packet's data page, so a sender that has fallen behind
+ * catches up a batch at a time.  The batch format is in
+ * netlog_internal.h.
+ *
+ * For each packet:
+ *   1. Sets the header template (done count and entry count, or first
+ *      page number and page count)
  *   2. Gets a network header buffer
  *   3. Builds an internet packet header
  *   4. Sends the packet via NET_IO_$SEND
@@ -19,6 +26,8 @@
 #include "network/network.h"
 #include "pkt/pkt.h"
 #include "net_io/net_io.h"
+#include "os/os.h"
+#include "ring/ring.h"
 
 /*
  * AUDIT data end address for packet info
@@ -31,10 +40,15 @@
     #define AUDIT_PKT_INFO      (&AUDIT_PKT_INFO_SYM)
 #endif
 
-void NETLOG_$SEND_PAGE(void)
+/*
+ * Send the page at data_va (physical page data_ppn) with the template
+ * counts done_cnt and entry_cnt.  For a compact batch these are the
+ * number of its first page and how many pages it holds.
+ */
+static void netlog_$ship(netlog_data_t *nl, uint32_t done_cnt,
+                         uint16_t entry_cnt, uint32_t data_va,
+                         uint32_t data_ppn)
 {
-    netlog_data_t *nl = NETLOG_DATA;
-
     /*
      * Local variables for network header building
      * These match the stack layout in the original function
@@ -48,13 +62,10 @@ void NETLOG_$SEND_PAGE(void)
     status_$t status;               /* -0x0C: Status return */
     uint32_t hdr_pa;                /* -0x08: Header physical address */
     uint8_t send_extra[4];          /* -0x04: Extra data for NET_IO_$SEND */
+    uint16_t xmit_class;
 
-    /*
-     * Capture metadata for the page being sent
-     * Copy done_cnt and entry count to packet header template
-     */
-    nl->pkt_done_cnt = nl->done_cnt;
-    nl->pkt_entry_cnt = nl->page_counts[nl->send_page_index];
+    nl->pkt_done_cnt = done_cnt;
+    nl->pkt_entry_cnt = entry_cnt;
 
     /*
      * Get a network header buffer
@@ -65,6 +76,7 @@ void NETLOG_$SEND_PAGE(void)
     /*
      * Build the internet packet header if sending is enabled
      */
+    status = status_$ok;
     if (nl->ok_to_send < 0) {
         PKT_$BLD_INTERNET_HDR(
             0,                          /* param1: flags */
@@ -100,20 +112,23 @@ void NETLOG_$SEND_PAGE(void)
          * Calculate data length: buffer_ppn << 10 gives size in bytes
          * The original shifts left by 10 (multiply by 1024)
          */
-        data_len = nl->buffer_ppn[nl->send_page_index - 1] << 10;
+        data_len = data_ppn << 10;
 
+        /* Log pages are shipped at the BULK rate */
+        xmit_class = RING_$XMIT_SET_CLASS(RING_XMIT_BULK);
         NET_IO_$SEND(
             port,                                               /* port */
             &hdr_va,                                            /* hdr_ptr */
             hdr_pa,                                             /* hdr_pa */
             pkt_len,                                            /* hdr_len */
-            nl->buffer_va[nl->send_page_index],                 /* data_va */
+            data_va,                                            /* data_va */
             &data_len,                                          /* data_len */
             NETLOG_PROTOCOL,                                    /* protocol: 0x3F6 */
             0,                                                  /* flags */
             send_extra,                                         /* extra */
             &status                                             /* status_ret */
         );
+        RING_$XMIT_SET_CLASS(xmit_class);
     }
 
     /*
@@ -121,3 +136,117 @@ void NETLOG_$SEND_PAGE(void)
      */
     NETWORK_$RTNHDR(&hdr_va);
 }
+
+/*
+ * Put a page image in a batch, squeezed if that makes it smaller; the
+ * length stored, or 0 if there is not room.  An image is never longer
+ * than NETLOG_PAGE_LIMIT, so it always fits in an empty batch.
+ */
+static uint16_t netlog_$store(uint8_t *page, uint16_t ulen, uint8_t *dst,
+                              uint16_t room)
+{
+    uint16_t clen;
+
+    clen = netlog_$squeeze(page, ulen, dst, (room < ulen) ? room : ulen);
+    if (clen != 0 && clen < ulen) {
+        return clen;
+    }
+    if (ulen > room) {
+        return 0;
+    }
+    OS_$DATA_COPY(page, dst, ulen);
+    return ulen;
+}
+
+void NETLOG_$SEND_PAGE(void)
+{
+    netlog_data_t *nl = NETLOG_DATA;
+    netlog_$ring_t *ring;
+    netlog_$batch_rec_t *rec;
+    ml_$spin_token_t token;
+    uint8_t *ship;
+    uint8_t *page;
+    uint32_t first;
+    uint16_t filled;
+    uint16_t index;
+    uint16_t off;
+    uint16_t count;
+    uint16_t ulen;
+    uint16_t clen;
+    uint16_t room;
+    uint16_t i;
+
+    /*
+     * Nothing is sent once CNTL has detached the buffers
+     */
+    if (nl->buffer_va[1] == 0 || nl->buffer_va[2] == 0) {
+        return;
+    }
+
+    /*
+     * Capture metadata for the page being sent
+     */
+    if (!NETLOG_COMPACT(nl)) {
+        netlog_$ship(nl, nl->done_cnt, nl->page_counts[nl->send_page_index],
+                     nl->buffer_va[nl->send_page_index],
+                     nl->buffer_ppn[nl->send_page_index - 1]);
+        return;
+    }
+
+    /*
+     * Pages filled so far are ours until we give them back below;
+     * LOG_IT fills only the page after them
+     */
+    ring = NETLOG_RING(nl);
+    token = ML_$SPIN_LOCK(&nl->spin_lock);
+    filled = ring->filled;
+    index = ring->ship_index;
+    first = nl->done_cnt - filled + 1;
+    ML_$SPIN_UNLOCK(&nl->spin_lock, token);
+
+    if (filled == 0) {
+        return;
+    }
+
+    ship = (uint8_t *)NETLOG_SHIP_VA(nl);
+    off = 0;
+    count = 0;
+    for (i = 0; i < filled; i++) {
+        page = (uint8_t *)ring->page_va[(index + i) % NETLOG_PAGES];
+        ulen = netlog_$page_image(page);
+
+        /* Leave room for the end record */
+        room = 0;
+        if (off + 2 * sizeof(netlog_$batch_rec_t) < NETLOG_PAGE_SIZE) {
+            room = NETLOG_PAGE_SIZE - off - 2 * sizeof(netlog_$batch_rec_t);
+        }
+        clen = netlog_$store(page, ulen, ship + off + sizeof(netlog_$batch_rec_t),
+                             room);
+        if (clen == 0) {
+            /* Send what we have; an empty batch always has room */
+            ((netlog_$batch_rec_t *)(ship + off))->clen = 0;
+            netlog_$ship(nl, first, count, NETLOG_SHIP_VA(nl),
+                         NETLOG_SHIP_PPN(nl));
+            first += count;
+            off = 0;
+            count = 0;
+            clen = netlog_$store(page, ulen, ship + sizeof(netlog_$batch_rec_t),
+                                 NETLOG_PAGE_SIZE - 2 * sizeof(netlog_$batch_rec_t));
+        }
+
+        rec = (netlog_$batch_rec_t *)(ship + off);
+        rec->clen = clen;
+        rec->ulen = ulen;
+        off += sizeof(netlog_$batch_rec_t) + clen;
+        count++;
+    }
+
+    ((netlog_$batch_rec_t *)(ship + off))->clen = 0;
+    netlog_$ship(nl, first, count, NETLOG_SHIP_VA(nl), NETLOG_SHIP_PPN(nl));
+
+    /* Give the pages back to LOG_IT */
+    token = ML_$SPIN_LOCK(&nl->spin_lock);
+    ring->ship_index = (index + filled) % NETLOG_PAGES;
+    ring->filled -= filled;
+    ML_$SPIN_UNLOCK(&nl->spin_lock, token);
+}
@@ -0,0 +1,328 @@
+/*
+ * Unit tests for the NETLOG compact format
+ *
+ * Tests the entry encoding, the page image SEND_PAGE ships and its
+ * squeezing, and that NETLOG_$LOG_IT fills the ring only when logging
+ * was started in the compact format.  Linked against compact.c and
+ * log_it.c; the spin lock, clock and event count are mocked.
+ *
+ * Ring pages are addressed by 32-bit virtual addresses, so the tests
+ * map them at a fixed low address (TEST_PAGE_MAP) before use, along with
+ * the pages holding NETLOG_DATA and the current process ID.
+ */
+
+#include "netlog/netlog_internal.h"
+
+#define TEST_PAGE_MAP   0x30000000
+#define TEST_MAP_PAGES  (NETLOG_PAGES + 1)
+
+/*
+ * Host mmap; <sys/mman.h> clashes with base.h's size_t.  Flags are the
+ * Linux values (PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_FIXED|MAP_ANONYMOUS).
+ */
+extern void *mmap(void *addr, unsigned long len, int prot, int flags,
+                  int fd, long off);
+#define TEST_PROT_RW    0x03
+#define TEST_MAP_FLAGS  0x32
+
+#define TEST_PAGE_VA(i) (TEST_PAGE_MAP + (i) * NETLOG_PAGE_SIZE)
+
+/* Pages holding NETLOG_DATA (0xE85684) and PROC1_$CURRENT (0xE20608) */
+#define TEST_DATA_MAP   0xE85000
+#define TEST_PROC1_MAP  0xE20000
+#define TEST_FIXED_SIZE 0x1000
+#define TEST_PID        ((uint8_t *)0xE20609)   /* NETLOG_GET_CURRENT_PID */
+
+/* Storage normally defined in netlog_data.c */
+uint32_t NETLOG_$KINDS;
+ec_$eventcount_t NETLOG_$EC;
+
+/* Mock state tracking */
+static uint32_t mock_clock;
+static int mock_advances;
+
+ml_$spin_token_t ML_$SPIN_LOCK(void *lockp) { (void)lockp; return 0; }
+void ML_$SPIN_UNLOCK(void *lockp, ml_$spin_token_t token) { (void)lockp; (void)token; }
+void TIME_$CLOCK(clock_t *clock) { clock->high = mock_clock; clock->low = 0; }
+void EC_$ADVANCE(ec_$eventcount_t *ec) { (void)ec; mock_advances++; }
+
+static netlog_$ring_t *ring;
+static uint32_t test_uid[2] = { 0x00012345, 0x00000077 };
+static uint16_t test_params[NETLOG_PARAMS] = { 0x0010, 0x02, 0x1000, 0, 0, 0 };
+
+static void reset_mocks(void)
+{
+    static int mapped;
+
+    if (!mapped) {
+        mmap((void *)TEST_PAGE_MAP, TEST_MAP_PAGES * NETLOG_PAGE_SIZE,
+             TEST_PROT_RW, TEST_MAP_FLAGS, -1, 0);
+        mmap((void *)TEST_DATA_MAP, TEST_FIXED_SIZE, TEST_PROT_RW,
+             TEST_MAP_FLAGS, -1, 0);
+        mmap((void *)TEST_PROC1_MAP, TEST_FIXED_SIZE, TEST_PROT_RW,
+             TEST_MAP_FLAGS, -1, 0);
+        mapped = 1;
+    }
+    memset((void *)TEST_PAGE_MAP, 0, TEST_MAP_PAGES * NETLOG_PAGE_SIZE);
+    memset(NETLOG_DATA, 0, sizeof(netlog_data_t));
+    mock_clock = 1000;
+    mock_advances = 0;
+    *TEST_PID = 5;
+    NETLOG_$KINDS = 0xFFFFFFFF;
+
+    /* What NETLOG_$CNTL command 3 sets up; the ring is in the last page */
+    ring = (netlog_$ring_t *)TEST_PAGE_VA(NETLOG_PAGES);
+    ring->page_va[0] = TEST_PAGE_VA(0);
+    netlog_$page_open(ring, ring->page_va[0], mock_clock);
+}
+
+static void start_compact(void)
+{
+    int16_t i;
+
+    for (i = 0; i < NETLOG_PAGES; i++) {
+        ring->page_va[i] = TEST_PAGE_VA(i);
+    }
+    NETLOG_DATA->pkt_type2 = NETLOG_FORMAT_COMPACT;
+    NETLOG_DATA->buffer_va[1] = (uint32_t)(uintptr_t)ring;
+}
+
+static void log_event(uint16_t param3)
+{
+    NETLOG_$LOG_IT(1, test_uid, param3, 0x02, 0x1000, 0, 0, 0);
+}
+
+static netlog_$page_hdr_t *page_hdr(int16_t i)
+{
+    return (netlog_$page_hdr_t *)TEST_PAGE_VA(i);
+}
+
+static uint8_t *entry_bytes(int16_t i)
+{
+    return (uint8_t *)TEST_PAGE_VA(i) + sizeof(netlog_$page_hdr_t);
+}
+
+/*
+ * Test: First entry in a page
+ * Expected: Carries the process ID, a new UID index and the parameters
+ * that differ from zero, and adds the UID to the page's table
+ */
+void test_compact_first_entry(void)
+{
+    uint8_t *p;
+    uint32_t *uid;
+
+    reset_mocks();
+
+    ASSERT_EQ(netlog_$encode(ring, 3, 5, 1010, test_uid, test_params), 0);
+
+    p = entry_bytes(0);
+    ASSERT_EQ(p[0], 3 | NETLOG_E_PID | NETLOG_E_UID | NETLOG_E_PARAMS);
+    ASSERT_EQ(p[1], 10);            /* Time delta from base_time */
+    ASSERT_EQ(p[2], 5);             /* Process ID */
+    ASSERT_EQ(p[3], 0);             /* UID index */
+    ASSERT_EQ(p[4], 0x07);          /* param3, param4 and param5 changed */
+    ASSERT_EQ(p[5], 0x20);          /* zigzag(0x10) */
+    ASSERT_EQ(p[6], 0x04);          /* zigzag(2) */
+    ASSERT_EQ(p[7], 0x80);          /* zigzag(0x1000) = 0x2000 as a varint */
+    ASSERT_EQ(p[8], 0x40);
+
+    ASSERT_EQ(page_hdr(0)->entries, 1);
+    ASSERT_EQ(page_hdr(0)->len, 9);
+    ASSERT_EQ(page_hdr(0)->n_uids, 1);
+    uid = (uint32_t *)(TEST_PAGE_VA(0) + NETLOG_PAGE_LIMIT - 8);
+    ASSERT_EQ(uid[0], test_uid[0]);
+    ASSERT_EQ(uid[1], test_uid[1]);
+}
+
+/*
+ * Test: Entry like the one before
+ * Expected: Only the lead byte and the time delta are written
+ */
+void test_compact_repeated_entry(void)
+{
+    uint8_t *p;
+
+    reset_mocks();
+
+    netlog_$encode(ring, 3, 5, 1010, test_uid, test_params);
+    ASSERT_EQ(netlog_$encode(ring, 3, 5, 1300, test_uid, test_params), 0);
+
+    p = entry_bytes(0) + 9;
+    ASSERT_EQ(p[0], 3);
+    ASSERT_EQ(p[1], 0x80 | (290 & 0x7F));
+    ASSERT_EQ(p[2], 290 >> 7);
+    ASSERT_EQ(page_hdr(0)->len, 12);
+    ASSERT_EQ(page_hdr(0)->n_uids, 1);
+}
+
+/*
+ * Test: A parameter that went down
+ * Expected: Only that parameter is sent, as a zigzag difference
+ */
+void test_compact_param_decrease(void)
+{
+    uint16_t params[NETLOG_PARAMS];
+    uint8_t *p;
+
+    reset_mocks();
+
+    netlog_$encode(ring, 3, 5, 1010, test_uid, test_params);
+    memcpy(params, test_params, sizeof(params));
+    params[2]--;
+    netlog_$encode(ring, 3, 5, 1010, test_uid, params);
+
+    p = entry_bytes(0) + 9;
+    ASSERT_EQ(p[0], 3 | NETLOG_E_PARAMS);
+    ASSERT_EQ(p[1], 0);
+    ASSERT_EQ(p[2], 0x04);          /* param5 only */
+    ASSERT_EQ(p[3], 1);             /* zigzag(-1) */
+}
+
+/*
+ * Test: UID table fills
+ * Expected: The page is full once NETLOG_UID_MAX UIDs are named, and
+ * entries never run into the table
+ */
+void test_compact_uid_table_full(void)
+{
+    netlog_$page_hdr_t *hdr = page_hdr(0);
+    uint32_t uid[2];
+    int16_t i;
+
+    reset_mocks();
+
+    uid[0] = test_uid[0];
+    for (i = 0; i < NETLOG_UID_MAX; i++) {
+        uid[1] = i;
+        ASSERT_EQ(netlog_$encode(ring, 3, 5, 1010, uid, test_params), 0);
+    }
+    uid[1] = NETLOG_UID_MAX;
+    ASSERT_EQ(netlog_$encode(ring, 3, 5, 1010, uid, test_params), -1);
+    ASSERT_EQ(hdr->n_uids, NETLOG_UID_MAX);
+
+    /* A UID already in the table still fits */
+    uid[1] = 7;
+    ASSERT_EQ(netlog_$encode(ring, 3, 5, 1010, uid, test_params), 0);
+    ASSERT_EQ((int)(sizeof(netlog_$page_hdr_t) + hdr->len) <=
+              NETLOG_PAGE_LIMIT - 8 * hdr->n_uids, 1);
+}
+
+/*
+ * Test: Page image and squeeze
+ * Expected: The UID table follows the entries in the image, a page of
+ * similar entries squeezes smaller, and a squeeze that would not fit
+ * returns 0
+ */
+void test_compact_page_image(void)
+{
+    uint8_t *page = (uint8_t *)TEST_PAGE_VA(0);
+    uint8_t *out = (uint8_t *)TEST_PAGE_VA(1);
+    uint32_t *uid;
+    uint16_t params[NETLOG_PARAMS];
+    uint16_t ulen;
+    uint16_t clen;
+    uint32_t t = 1000;
+
+    reset_mocks();
+
+    memcpy(params, test_params, sizeof(params));
+    while (netlog_$encode(ring, 3, 5, t, test_uid, params) == 0) {
+        t += 37;
+        params[2] += 8;
+    }
+
+    ulen = netlog_$page_image(page);
+    ASSERT_EQ(ulen, sizeof(netlog_$page_hdr_t) + page_hdr(0)->len + 8);
+    uid = (uint32_t *)(page + ulen - 8);
+    ASSERT_EQ(uid[0], test_uid[0]);
+    ASSERT_EQ(uid[1], test_uid[1]);
+
+    clen = netlog_$squeeze(page, ulen, out, ulen);
+    ASSERT_EQ(clen != 0 && clen < ulen, 1);
+    ASSERT_EQ(netlog_$squeeze(page, ulen, out, 16), 0);
+}
+
+/*
+ * Test: Logging started with command 0
+ * Expected: LOG_IT writes fixed 26-byte entries, as it always has
+ */
+void test_compact_fixed_format_default(void)
+{
+    netlog_entry_t *entry;
+
+    reset_mocks();
+    NETLOG_DATA->pkt_type2 = NETLOG_PKT_TYPE2;
+    NETLOG_DATA->buffer_va[1] = TEST_PAGE_VA(0);
+    NETLOG_DATA->buffer_va[2] = TEST_PAGE_VA(1);
+    NETLOG_DATA->current_buf_index = 1;
+    NETLOG_DATA->current_buf_ptr = TEST_PAGE_VA(0);
+
+    log_event(0x10);
+
+    entry = NETLOG_ENTRY_ADDR(TEST_PAGE_VA(0), 1);
+    ASSERT_EQ(NETLOG_DATA->page_counts[1], 1);
+    ASSERT_EQ(entry->kind, 1);
+    ASSERT_EQ(entry->timestamp, 1000);
+    ASSERT_EQ(entry->uid_high, test_uid[0]);
+    ASSERT_EQ(entry->param3, 0x10);
+}
+
+/*
+ * Test: Ring full
+ * Expected: Each filled page wakes the sender once; with every other
+ * page waiting to be shipped, entries are counted lost rather than
+ * overwriting a page, and the count goes in the next page opened
+ */
+void test_compact_ring_full_counts_lost(void)
+{
+    uint16_t param3 = 0;
+    int16_t i;
+
+    reset_mocks();
+    start_compact();
+
+    while (ring->filled < NETLOG_PAGES - 1) {
+        mock_clock += 100;
+        log_event(param3 += 3);
+    }
+    ASSERT_EQ(mock_advances, NETLOG_PAGES - 1);
+    ASSERT_EQ(NETLOG_DATA->done_cnt, NETLOG_PAGES - 1);
+
+    /* Fill the last page, then lose entries */
+    while (ring->lost == 0) {
+        mock_clock += 100;
+        log_event(param3 += 3);
+    }
+    for (i = 1; i < 5; i++) {
+        log_event(param3 += 3);
+    }
+    ASSERT_EQ(ring->lost, 5);
+    ASSERT_EQ(mock_advances, NETLOG_PAGES - 1);
+    ASSERT_EQ(page_hdr(0)->lost, 0);
+
+    /* SEND_PAGE gives pages back; the next page opened reports the loss */
+    ring->ship_index = NETLOG_PAGES - 1;
+    ring->filled = 0;
+    log_event(param3 += 3);
+    ASSERT_EQ(ring->filled, 1);
+    ASSERT_EQ(page_hdr(0)->lost, 5);
+    ASSERT_EQ(page_hdr(0)->entries, 1);
+    ASSERT_EQ(ring->lost, 0);
+}
+
+/*
+ * Test: Buffers detached by shutdown
+ * Expected: LOG_IT writes nothing
+ */
+void test_compact_detached_ring(void)
+{
+    reset_mocks();
+    start_compact();
+    NETLOG_DATA->buffer_va[1] = 0;
+
+    log_event(0x10);
+
+    ASSERT_EQ(page_hdr(0)->entries, 0);
+    ASSERT_EQ(mock_advances, 0);
+}
@@ -2,8 +2,9 @@
  * NETWORK_$ADD_REQUEST_SERVERS - Create request server processes
  *
  * Creates network request server processes up to the requested count,
- * capped at a maximum of 3. Request servers handle remote file operations
- * and other network service requests.
+ * capped at NETWORK_MAX_REQUEST_SERVERS (3 in the original). Request
+ * servers handle remote file operations and other network service
+ * requests.
  *
  * Original address: 0x00E71E0C
  *
@@ -50,9 +51,11 @@
 #include "network/network.h"
 
 /*
- * Maximum number of request servers
+ * Maximum number of request servers.  The original allowed 3; the file
+ * server now copes with more running at once (duplicate requests are
+ * caught by its reply cache), so busy servers can be given more.
  */
-#define MAX_REQUEST_SERVERS         3
+#define MAX_REQUEST_SERVERS         NETWORK_MAX_REQUEST_SERVERS
 
 /*
  * Process type for request server:
@@ -68,7 +71,7 @@ int16_t NETWORK_$ADD_REQUEST_SERVERS(int16_t *count_ptr, status_$t *status_ret)
     *status_ret = status_$ok;
 
     /*
-     * Cap the target count at MAX_REQUEST_SERVERS (3).
+     * Cap the target count at MAX_REQUEST_SERVERS.
      * Original assembly: uses D2 as target, comparing and selecting min.
      */
     target_count = MAX_REQUEST_SERVERS;
@@ -0,0 +1,134 @@
+/*
+ * NETWORK_$BULK_READ_SERVER - Answer a bulk page read
+ *
+ * Server side of NETWORK_$READ_BULK.  The pages of the run are brought in
+ * with AST_$TOUCH and sent straight from their physical pages with
+ * PKT_$SEND_INTERNET_SG: nothing is copied into a buffer first.  The
+ * segment stays wired while the burst is sent so the pages cannot be
+ * taken away under the transmit.
+ *
+ * Only the pages still wanted are sent, lowest first, and no more than
+ * the client's window; the client asks again for the rest.
+ */
+
+#include "network/network_internal.h"
+#include "ast/ast.h"
+#include "pkt/pkt.h"
+#include "ring/ring.h"
+
+/* PKT info template at 0xE2E380, as the file server uses */
+extern uint8_t DAT_00e2e380[];
+
+/*
+ * Send one data packet; ppn 0 sends the header alone (an error, or the
+ * end of the object).
+ */
+static void network_$bulk_send(network_bulk_data_t *data, uint32_t ppn,
+                               uint32_t routing_key, uint32_t src_node,
+                               uint16_t src_sock, uint16_t server_sock,
+                               uint16_t pkt_id)
+{
+    pkt_$sg_t sg;
+    uint16_t len_out;
+    uint8_t send_extra[4];
+    status_$t status;
+    uint16_t xmit_class;
+
+    sg.len = (ppn != 0) ? NETWORK_BULK_PAGE_SIZE : 0;
+    sg.pad = 0;
+    sg.pages[0] = ppn << 10;
+
+    /* Someone is waiting on these pages, usually for a page fault */
+    xmit_class = RING_$XMIT_SET_CLASS(RING_XMIT_PAGING);
+    PKT_$SEND_INTERNET_SG(routing_key, src_node, src_sock,
+                          (int32_t)-1, NODE_$ME, server_sock,
+                          DAT_00e2e380, pkt_id,
+                          data, sizeof(*data), &sg,
+                          &len_out, send_extra, &status);
+    RING_$XMIT_SET_CLASS(xmit_class);
+}
+
+void NETWORK_$BULK_READ_SERVER(void *request, uint32_t routing_key,
+                               uint32_t src_node, uint16_t src_sock,
+                               uint16_t server_sock, uint16_t pkt_id)
+{
+    network_bulk_read_req_t *req = (network_bulk_read_req_t *)request;
+    network_bulk_data_t data;
+    uint32_t ppn_array[NETWORK_BULK_MAX_PAGES];
+    aste_t *aste;
+    aote_t *aote;
+    uint16_t page;
+    uint16_t count;
+    uint16_t touched;
+    uint16_t sent;
+    uint16_t window;
+    int16_t i;
+    status_$t status;
+
+    data.cmd = NETWORK_CMD_BULK_READ + 1;
+    data.index = 0;
+    data.status = status_$ok;
+    data.dtm = 0;
+    data.clock.high = 0;
+    data.clock.low = 0;
+    data.pad = 0;
+    data.acl_info = 0;
+
+    page = req->first_page & (NETWORK_BULK_MAX_PAGES - 1);
+    count = req->count;
+    window = req->window;
+    if (window == 0 || window > NETWORK_BULK_MAX_WINDOW) {
+        window = NETWORK_BULK_MAX_WINDOW;
+    }
+
+    if (count == 0 || page + count > NETWORK_BULK_MAX_PAGES) {
+        data.status = status_$network_data_length_too_large;
+        network_$bulk_send(&data, 0, routing_key, src_node, src_sock,
+                           server_sock, pkt_id);
+        return;
+    }
+
+    aste = AST_$ACTIVATE_AND_WIRE(&req->uid,
+                                  (uint16_t)(req->first_page >> 5), &status);
+    if (aste == NULL) {
+        data.status = status;
+        network_$bulk_send(&data, 0, routing_key, src_node, src_sock,
+                           server_sock, pkt_id);
+        return;
+    }
+
+    ML_$LOCK(PMAP_LOCK_ID);
+    touched = AST_$TOUCH(aste, 0, page, count, ppn_array, &status, 0);
+    aote = aste->aote;
+    data.dtm = *(int32_t *)((char *)aote + 0x30);
+    data.clock.high = *(uint32_t *)((char *)aote + 0x40);
+    data.clock.low = *(uint16_t *)((char *)aote + 0x44);
+    data.acl_info = *(uint32_t *)((char *)aote + 0x28);
+    ML_$UNLOCK(PMAP_LOCK_ID);
+
+    if (status != status_$ok && touched == 0) {
+        data.status = status;
+        network_$bulk_send(&data, 0, routing_key, src_node, src_sock,
+                           server_sock, pkt_id);
+        goto done;
+    }
+
+    for (i = 0, sent = 0; i < count && sent < window; i++) {
+        if ((req->want & (1U << i)) == 0) {
+            continue;
+        }
+        data.index = i;
+        if (i >= touched) {
+            /* Past the end of the object: say so once and stop */
+            network_$bulk_send(&data, 0, routing_key, src_node, src_sock,
+                               server_sock, pkt_id);
+            break;
+        }
+        network_$bulk_send(&data, ppn_array[i], routing_key, src_node,
+                           src_sock, server_sock, pkt_id);
+        sent++;
+    }
+
+done:
+    aste->wire_count--;
+}
@@ -21,6 +21,7 @@
 #include "pkt/pkt.h"
 #include "ec/ec.h"
 #include "misc/misc.h"
+#include "ring/ring.h"
 
 /*
  * Status codes
@@ -63,6 +64,7 @@ void network_$do_request(void *net_handle, void *cmd_buf, int16_t cmd_len,
     int16_t *cmd_ptr;
     int16_t *resp_ptr;
     uint32_t target_node;
+    uint16_t xmit_class;
 
     retry_count = 0;
 
@@ -97,11 +99,13 @@ void network_$do_request(void *net_handle, void *cmd_buf, int16_t cmd_len,
          * Send the request packet.
          * This builds and transmits the packet, returning retry and timeout info.
          */
+        xmit_class = RING_$XMIT_SET_CLASS(RING_XMIT_PAGING);
         network_$send_request(net_handle, sock_num, pkt_id,
                               (int16_t *)cmd_buf, cmd_len,
                               (int16_t)(param4 >> 16),
                               ((param4 & 0xFFFF) << 16) | param5,
                               &max_retries, &timeout_value, status_ret);
+        RING_$XMIT_SET_CLASS(xmit_class);
 
         /* Check if send failed */
         if (*status_ret != status_$ok) {
@@ -114,6 +114,58 @@ int16_t NETWORK_$READ_AHEAD(void *net_info, void *uid, uint32_t *ppn_array,
                             int32_t *dtm, clock_t *clock,
                             uint32_t *acl_info, status_$t *status);
 
+/*
+ * NETWORK_$READ_BULK - Read a run of pages from a network partner
+ *
+ * Asks the partner's page server for up to NETWORK_BULK_MAX_PAGES pages
+ * of one segment in a single request, and takes the train of data
+ * packets it answers with.  Lost pages are asked for again by bitmap.
+ * Each page lands in a network data buffer whose PPN is stored in
+ * ppn_array[i], as NETWORK_$READ_AHEAD does, so nothing is copied.
+ *
+ * @param net_info       Network partner info (node at offset 4)
+ * @param uid            Object UID
+ * @param first_page     Page number in the object of ppn_array[0]
+ * @param ppn_array      Output: PPNs of the pages read
+ * @param page_size      Page size
+ * @param count          Number of pages
+ * @param flags          Operation flags (as for NETWORK_$READ_AHEAD)
+ * @param dtm            Data timestamp output
+ * @param clock          Clock output
+ * @param acl_info       ACL info output
+ * @param status         Output status code
+ *
+ * @return Number of pages read from first_page on, or -1 if the partner
+ *         (or the request) is not suited to a bulk read; the caller should
+ *         then use NETWORK_$READ_AHEAD.  Pages read beyond a gap are
+ *         returned to the network buffer pool.
+ */
+#define NETWORK_BULK_MAX_PAGES  32      /* One segment */
+
+int16_t NETWORK_$READ_BULK(void *net_info, uid_t *uid, uint32_t first_page,
+                           uint32_t *ppn_array, uint16_t page_size,
+                           int16_t count, uint8_t flags,
+                           int32_t *dtm, clock_t *clock,
+                           uint32_t *acl_info, status_$t *status);
+
+/*
+ * NETWORK_$BULK_READ_SERVER - Answer a bulk page read
+ *
+ * Called by the page server for a NETWORK_CMD_BULK_READ request.  Sends
+ * the wanted pages of the run, up to the client's window, straight from
+ * the object's physical pages, one page per packet.
+ *
+ * @param request        Request as received
+ * @param routing_key    Routing key of the request
+ * @param src_node       Requesting node
+ * @param src_sock       Requesting socket
+ * @param server_sock    Page server's socket
+ * @param pkt_id         Packet ID of the request
+ */
+void NETWORK_$BULK_READ_SERVER(void *request, uint32_t routing_key,
+                               uint32_t src_node, uint16_t src_sock,
+                               uint16_t server_sock, uint16_t pkt_id);
+
 /*
  * NETWORK_$INSTALL_NET - Install network node
  *
@@ -269,14 +321,14 @@ int16_t NETWORK_$ADD_PAGE_SERVERS(int16_t *count_ptr, status_$t *status_ret);
  * NETWORK_$ADD_REQUEST_SERVERS - Create request server processes
  *
  * Creates additional network request server processes up to the requested
- * count (maximum 3). Request servers handle remote file operations and
- * other network requests.
+ * count (maximum NETWORK_MAX_REQUEST_SERVERS). Request servers handle
+ * remote file operations and other network requests.
  *
  * On diskless nodes (NETWORK_$REALLY_DISKLESS < 0), at least one request
  * server must remain, so the function stops creating servers if count
  * reaches 1.
  *
- * @param count_ptr    Pointer to desired request server count (capped at 3)
+ * @param count_ptr    Pointer to desired request server count
  * @param status_ret   Output: status code (set to status_$ok on entry,
  *                     may contain error from PROC1_$CREATE_P)
  *
@@ -284,13 +336,16 @@ int16_t NETWORK_$ADD_PAGE_SERVERS(int16_t *count_ptr, status_$t *status_ret);
  *
  * Original address: 0x00E71E0C
  */
+#define NETWORK_MAX_REQUEST_SERVERS 8
+
 int16_t NETWORK_$ADD_REQUEST_SERVERS(int16_t *count_ptr, status_$t *status_ret);
 
 /*
  * NETWORK_$PAGE_SERVER - Page server main loop
  *
  * Entry point for network page server processes. This function runs
- * as an infinite loop handling page requests.
+ * as an infinite loop handling page requests from the page server
+ * socket.
  *
  * Original address: 0x00E11548
  */
@@ -28,6 +28,74 @@ extern int8_t NETWORK_$LOOPBACK_FLAG;
  * Network command codes
  */
 #define NETWORK_CMD_RING_INFO 0x0E /* Get ring information */
+#define NETWORK_CMD_BULK_READ 0x20 /* Read a run of pages (data is 0x21) */
+
+/*
+ * Bulk page read (read_bulk.c, bulk_read_server.c)
+ *
+ * The client sends one request naming the run and a bitmap of the pages
+ * it still wants; bit i is page first_page + i.  The server answers with
+ * up to window data packets, one page each, in page order, all with the
+ * request's packet ID.  The client repeats the request with the pages
+ * still missing (a selective acknowledgement) until it has them all,
+ * opening the window after a complete burst and halving it after a loss.
+ *
+ * A data packet without data marks the end of the object: pages from
+ * that index on do not exist.
+ */
+#define NETWORK_BULK_PAGE_SIZE      0x400
+#define NETWORK_BULK_INITIAL_WINDOW 4
+#define NETWORK_BULK_MAX_WINDOW     16
+
+typedef struct network_bulk_read_req_t {
+  uint16_t cmd;        /* 0x00: NETWORK_CMD_BULK_READ */
+  uint16_t count;      /* 0x02: Pages in the run */
+  uid_t uid;           /* 0x04: Object */
+  uint32_t first_page; /* 0x0C: Page number in the object */
+  uint32_t want;       /* 0x10: Pages still wanted */
+  uint16_t window;     /* 0x14: Pages to send in this burst */
+  uint8_t flags;       /* 0x16: As for NETWORK_$READ_AHEAD */
+  uint8_t pad;
+} network_bulk_read_req_t;
+
+typedef struct network_bulk_data_t {
+  uint16_t cmd;        /* 0x00: NETWORK_CMD_BULK_READ + 1 */
+  uint16_t index;      /* 0x02: Page within the run */
+  status_$t status;    /* 0x04: Error reading the run (no data) */
+  int32_t dtm;         /* 0x08: Object timestamps */
+  clock_t clock;       /* 0x0C */
+  uint16_t pad;
+  uint32_t acl_info;   /* 0x14 */
+} network_bulk_data_t;
+
+/*
+ * Page server (page_server.c)
+ *
+ * Page servers take requests from the page server socket.  A request
+ * the server does not know is answered with a bare reply header holding
+ * status_$network_unknown_request_type, which is how a client tells an
+ * older page server from a lost request.
+ */
+#define NETWORK_PAGE_SOCKET         1
+#define NETWORK_PAGE_MAX_REQUEST    0x40
+
+typedef struct network_page_reply_t {
+  uint16_t cmd;        /* 0x00: Request command + 1 */
+  uint16_t pad;
+  status_$t status;    /* 0x04 */
+} network_page_reply_t;
+
+/*
+ * network_$page_request - Answer one page server request
+ *
+ * Receives the next request queued on sock_num and passes it to the
+ * handler for its command.
+ *
+ * @param sock_num       Page server socket
+ *
+ * @return -1 if a request was taken, 0 if the socket's queue was empty
+ */
+int8_t network_$page_request(uint16_t sock_num);
 
 /*
  * Network status codes (module 0x11)
@@ -0,0 +1,128 @@
+/*
+ * NETWORK_$PAGE_SERVER - Page server main loop
+ *
+ * Each page server process takes requests off the page server socket,
+ * one at a time, and hands them to the handler for their command.  All
+ * the page servers share the socket, so a burst of requests is spread
+ * over however many NETWORK_$ADD_PAGE_SERVERS has started.
+ *
+ * Only the commands reconstructed in this tree are dispatched here;
+ * anything else is refused with status_$network_unknown_request_type.
+ */
+
+#include "network/network_internal.h"
+#include "app/app.h"
+#include "app/app_internal.h"
+#include "ec/ec.h"
+#include "netbuf/netbuf.h"
+#include "pkt/pkt.h"
+#include "sock/sock.h"
+
+/* PKT info template at 0xE2E380, as the file server uses */
+extern uint8_t DAT_00e2e380[];
+
+/*
+ * Refuse a request the page server does not know
+ */
+static void network_$page_refuse(uint16_t cmd, uint32_t routing_key,
+                                 uint32_t src_node, uint16_t src_sock,
+                                 uint16_t server_sock, uint16_t pkt_id)
+{
+    network_page_reply_t reply;
+    uint16_t len_out;
+    uint16_t extra;
+    status_$t status;
+
+    reply.cmd = cmd + 1;
+    reply.pad = 0;
+    reply.status = status_$network_unknown_request_type;
+
+    PKT_$SEND_INTERNET(routing_key, src_node, src_sock, -1, NODE_$ME,
+                       server_sock, DAT_00e2e380, pkt_id,
+                       &reply, sizeof(reply), NULL, 0,
+                       &len_out, &extra, &status);
+}
+
+int8_t network_$page_request(uint16_t sock_num)
+{
+    app_receive_result_t recv;
+    union {
+        uint16_t cmd;
+        network_bulk_read_req_t bulk_read;
+        uint32_t raw[NETWORK_PAGE_MAX_REQUEST / sizeof(uint32_t)];
+    } request;
+    uint32_t src_node;
+    uint32_t routing_key;
+    uint32_t hdr_page;
+    uint16_t src_sock;
+    uint16_t pkt_id;
+    uint16_t request_len;
+    int16_t data_len;
+    int16_t i;
+    status_$t status;
+
+    APP_$RECEIVE(sock_num, &recv, &status);
+    if (status != status_$ok) {
+        return 0;
+    }
+
+    /* Everything needed from the header, before it goes back */
+    src_node = ((app_pkt_hdr_t *)recv.hdr_ptr)->src_node;
+    src_sock = ((app_pkt_hdr_t *)recv.hdr_ptr)->src_sock;
+    routing_key = recv.routing_key;
+    request_len = *(uint16_t *)((uint8_t *)recv.hdr_ptr + 2);
+    data_len = *(int16_t *)((uint8_t *)recv.hdr_ptr + 4);
+    pkt_id = *(uint16_t *)((uint8_t *)recv.hdr_ptr + 6);
+
+    /* A short request reads as zeros past its end */
+    for (i = 0; i < (int16_t)(sizeof(request.raw) / sizeof(request.raw[0])); i++) {
+        request.raw[i] = 0;
+    }
+    if (request_len > sizeof(request)) {
+        request_len = sizeof(request);
+    }
+    OS_$DATA_COPY(recv.data_ptr, (char *)&request, request_len);
+
+    hdr_page = (uint32_t)recv.data_ptr & 0xFFFFFC00;
+    NETBUF_$RTN_HDR(&hdr_page);
+
+    /* Requests carry no data pages */
+    if (recv.data_bufs[0] != 0) {
+        PKT_$DUMP_DATA(recv.data_bufs, data_len);
+    }
+
+    switch (request.cmd) {
+    case NETWORK_CMD_BULK_READ:
+        NETWORK_$BULK_READ_SERVER(&request.bulk_read, routing_key, src_node,
+                                  src_sock, sock_num, pkt_id);
+        break;
+
+    default:
+        network_$page_refuse(request.cmd, routing_key, src_node,
+                             src_sock, sock_num, pkt_id);
+        break;
+    }
+
+    return -1;
+}
+
+void NETWORK_$PAGE_SERVER(void)
+{
+    ec_$eventcount_t *ecs[3];
+    int32_t wait_val;
+
+    ecs[0] = (ec_$eventcount_t *)SOCK_$SOCKET_PTR[NETWORK_PAGE_SOCKET];
+    ecs[1] = NULL;
+    ecs[2] = NULL;
+
+    for (;;) {
+        /* Read the count first so a request queued meanwhile wakes us */
+        wait_val = EC_$READ(ecs[0]) + 1;
+
+        while (network_$page_request(NETWORK_PAGE_SOCKET) < 0) {
+            ;
+        }
+
+        EC_$WAIT(ecs, &wait_val);
+    }
+}
@@ -0,0 +1,259 @@
+/*
+ * NETWORK_$READ_BULK - Read a run of pages from a network partner
+ *
+ * NETWORK_$READ_AHEAD costs a round trip per request and gets at most a
+ * few pages per answer.  A bulk read asks for the whole run at once and
+ * the page server streams it back, so a cold sequential read of a segment
+ * costs one round trip plus the transfer time, and a lost page costs only
+ * its own retransmission.  See network_internal.h for the exchange.
+ *
+ * Pages arrive in network data buffers taken from the pool the caller
+ * filled, and are handed back by PPN without being copied.
+ */
+
+#include "network/network_internal.h"
+#include "sock/sock.h"
+#include "pkt/pkt.h"
+#include "ec/ec.h"
+#include "ml/ml.h"
+#include "netbuf/netbuf.h"
+#include "ring/ring.h"
+
+/*
+ * Partners that rejected a bulk read (older page servers).  Small and
+ * overwritten round-robin; a node that is upgraded is tried again once
+ * its slot is reused.
+ */
+#define BULK_OLD_NODES 8
+
+static uint32_t network_$bulk_old_node[BULK_OLD_NODES];
+static uint16_t network_$bulk_old_next;
+static uint16_t network_$bulk_lock;
+
+static int8_t network_$bulk_is_old(uint32_t node)
+{
+    int16_t i;
+
+    for (i = 0; i < BULK_OLD_NODES; i++) {
+        if (network_$bulk_old_node[i] == node) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void network_$bulk_note_old(uint32_t node)
+{
+    ml_$spin_token_t token;
+
+    token = ML_$SPIN_LOCK(&network_$bulk_lock);
+    if (network_$bulk_is_old(node) >= 0) {
+        network_$bulk_old_node[network_$bulk_old_next] = node;
+        network_$bulk_old_next = (network_$bulk_old_next + 1) % BULK_OLD_NODES;
+    }
+    ML_$SPIN_UNLOCK(&network_$bulk_lock, token);
+}
+
+static uint16_t network_$bulk_pages_in(uint32_t bits)
+{
+    uint16_t n = 0;
+
+    while (bits != 0) {
+        bits &= bits - 1;
+        n++;
+    }
+    return n;
+}
+
+int16_t NETWORK_$READ_BULK(void *net_info, uid_t *uid, uint32_t first_page,
+                           uint32_t *ppn_array, uint16_t page_size,
+                           int16_t count, uint8_t flags,
+                           int32_t *dtm, clock_t *clock,
+                           uint32_t *acl_info, status_$t *status)
+{
+    network_bulk_read_req_t req;
+    network_bulk_data_t data;
+    int16_t resp_info[4];
+    uint32_t data_bufs[6];
+    uint16_t data_len;
+    uint32_t node = ((uint32_t *)net_info)[1];
+    uint32_t want;              /* Pages still to come */
+    uint32_t got;               /* Pages held in ppn_array */
+    uint32_t bit;
+    uint16_t window;
+    uint16_t burst;
+    uint16_t received;
+    uint16_t max_retries;
+    int16_t timeout_value;
+    int16_t timeouts;
+    int16_t sock_num;
+    int16_t pkt_id;
+    int16_t pages;
+    int16_t i;
+    int32_t event_count;
+    int8_t have_times;
+    int8_t result;
+    uint16_t xmit_class;
+
+    if (count < 2 || count > NETWORK_BULK_MAX_PAGES ||
+        page_size != NETWORK_BULK_PAGE_SIZE ||
+        (first_page & (NETWORK_BULK_MAX_PAGES - 1)) + count > NETWORK_BULK_MAX_PAGES ||
+        network_$bulk_is_old(node) < 0) {
+        return -1;
+    }
+
+    /*
+     * The socket must be able to queue a full window of pages.  Unlike
+     * network_$do_request, running out of sockets is not fatal here: the
+     * caller can still read the pages the old way.
+     */
+    result = SOCK_$ALLOCATE((uint16_t *)&sock_num,
+                            0x20000 | NETWORK_BULK_MAX_WINDOW, 0x400);
+    if (result >= 0) {
+        return -1;
+    }
+
+    event_count = *((int32_t *)SOCK_$SOCKET_PTR[sock_num]) + 1;
+
+    /* One packet ID for the whole run, so late pages still count */
+    pkt_id = PKT_$NEXT_ID();
+
+    want = (count == 32) ? 0xFFFFFFFF : ((1U << count) - 1);
+    got = 0;
+    window = NETWORK_BULK_INITIAL_WINDOW;
+    timeouts = 0;
+    have_times = 0;
+    *dtm = 0;
+    *status = status_$ok;
+
+    req.cmd = NETWORK_CMD_BULK_READ;
+    req.count = count;
+    req.uid = *uid;
+    req.first_page = first_page;
+    req.flags = flags;
+    req.pad = 0;
+
+    while (want != 0) {
+        req.want = want;
+        req.window = window;
+
+        xmit_class = RING_$XMIT_SET_CLASS(RING_XMIT_PAGING);
+        network_$send_request(net_info, sock_num, pkt_id,
+                              (int16_t *)&req, sizeof(req), 0, 0,
+                              &max_retries, &timeout_value, status);
+        RING_$XMIT_SET_CLASS(xmit_class);
+        if (*status != status_$ok) {
+            break;
+        }
+
+        burst = network_$bulk_pages_in(want);
+        if (burst > window) {
+            burst = window;
+        }
+
+        for (received = 0; received < burst; ) {
+            result = network_$wait_response(sock_num, pkt_id,
+                                            timeout_value + NETWORK_$RETRY_TIMEOUT,
+                                            &event_count, (int16_t *)&data,
+                                            resp_info, data_bufs, &data_len);
+            if (result >= 0) {
+                break;
+            }
+
+            if (data.cmd != NETWORK_CMD_BULK_READ + 1 ||
+                data.status == status_$network_unknown_request_type) {
+                if (data_bufs[0] != 0) {
+                    PKT_$DUMP_DATA(data_bufs, data_len);
+                }
+                network_$bulk_note_old(node);
+                *status = status_$network_unknown_request_type;
+                goto done;
+            }
+
+            if (data.status != status_$ok) {
+                if (data_bufs[0] != 0) {
+                    PKT_$DUMP_DATA(data_bufs, data_len);
+                }
+                *status = data.status;
+                goto done;
+            }
+
+            bit = 1U << (data.index & 0x1F);
+            if (data.index >= count || (want & bit) == 0 ||
+                data_bufs[0] == 0 || data_len != page_size) {
+                if (data_bufs[0] != 0) {
+                    PKT_$DUMP_DATA(data_bufs, data_len);
+                } else if (data.index < count && (want & bit) != 0) {
+                    /*
+                     * End of the object.  Earlier pages of this burst were
+                     * sent before this, so anything of them still missing
+                     * was lost; ask again for those only.
+                     */
+                    want &= bit - 1;
+                    burst = received;
+                }
+                continue;
+            }
+
+            ppn_array[data.index] = data_bufs[0] >> 10;
+            want &= ~bit;
+            got |= bit;
+            received++;
+
+            if (have_times >= 0) {
+                *dtm = data.dtm;
+                *clock = data.clock;
+                *acl_info = data.acl_info;
+                have_times = -1;
+            }
+        }
+
+        PKT_$NOTE_VISIBLE(node, received != 0 ? 0xFF : 0);
+
+        if (received == burst) {
+            timeouts = 0;
+            window <<= 1;
+            if (window > NETWORK_BULK_MAX_WINDOW) {
+                window = NETWORK_BULK_MAX_WINDOW;
+            }
+            continue;
+        }
+
+        /* Something was lost: back off, then ask for what is missing */
+        window >>= 1;
+        if (window == 0) {
+            window = 1;
+        }
+        if (received == 0) {
+            timeouts++;
+            if (timeouts >= (int16_t)max_retries && node != NETWORK_$MOTHER_NODE) {
+                *status = status_$network_remote_node_failed_to_respond;
+                break;
+            }
+        }
+    }
+
+done:
+    SOCK_$CLOSE((uint16_t)sock_num);
+
+    /* Only the unbroken run from first_page is used */
+    for (pages = 0; pages < count && (got & (1U << pages)) != 0; pages++) {
+    }
+
+    for (i = pages + 1; i < count; i++) {
+        if ((got & (1U << i)) != 0) {
+            NETBUF_$RTN_DAT(ppn_array[i] << 10);
+        }
+    }
+
+    /*
+     * Nothing at all, because the object ends at first_page or the partner
+     * does not know the request: READ_AHEAD handles both.
+     */
+    if (pages == 0 &&
+        (*status == status_$ok || *status == status_$network_unknown_request_type)) {
+        return -1;
+    }
+
+    return pages;
+}
@@ -0,0 +1,290 @@
+/*
+ * Unit tests for the page server's request dispatch
+ *
+ * Tests that a NETWORK_CMD_BULK_READ request taken off the page server
+ * socket reaches NETWORK_$BULK_READ_SERVER, which sends only the pages
+ * still wanted, no more than the window, marks the end of the object and
+ * refuses a bad run; that an unknown command is refused; and that the
+ * request's header is read before it is given back.  Linked against
+ * page_server.c and bulk_read_server.c; the socket, packet, AST and lock
+ * calls are mocked.
+ */
+
+#include "network/network_internal.h"
+#include "app/app_internal.h"
+#include "ast/ast.h"
+#include "pkt/pkt.h"
+#include "ring/ring.h"
+
+#define TEST_SOCK       NETWORK_PAGE_SOCKET
+#define TEST_ME         0x1234
+#define TEST_CLIENT     0x5678
+#define TEST_CLIENT_SOCK 0x2F
+#define TEST_ROUTING    0x00010000
+#define TEST_PKT_ID     0x4242
+#define TEST_PPN_BASE   0x100
+#define TEST_MAX_SENDS  40
+
+/* Storage normally defined in the network, sock and pkt data */
+uint32_t NODE_$ME;
+void *SOCK_$SOCKET_PTR[64];
+uint8_t DAT_00e2e380[32];
+
+/* Mock state tracking */
+static uint8_t mock_hdr[0x20];          /* Packet header */
+static uint8_t mock_tpl[0x40];          /* Request, in the header buffer */
+static int mock_queued;                 /* Requests left on the socket */
+static int mock_hdr_returned;           /* NETBUF_$RTN_HDR calls */
+static int mock_activates;
+static uint16_t mock_activate_seg;
+static uint16_t mock_object_pages;      /* Pages in the object */
+static aste_t mock_aste;
+static uint32_t mock_aote[0x40];
+
+static struct {
+    uint32_t node;
+    uint16_t sock;
+    uint16_t pkt_id;
+    network_bulk_data_t data;
+    uint16_t len;
+    uint32_t page;
+} mock_sent[TEST_MAX_SENDS];
+static int mock_sends;
+
+static network_page_reply_t mock_reply;
+static int mock_replies;
+
+void OS_$DATA_COPY(const void *src, void *dst, uint32_t len) { memcpy(dst, src, len); }
+void PKT_$DUMP_DATA(uint32_t *buffers, int16_t len) { (void)buffers; (void)len; }
+void ML_$LOCK(int16_t resource_id) { (void)resource_id; }
+void ML_$UNLOCK(int16_t resource_id) { (void)resource_id; }
+uint16_t RING_$XMIT_SET_CLASS(uint16_t xmit_class) { (void)xmit_class; return RING_XMIT_DEFAULT; }
+int32_t EC_$READ(ec_$eventcount_t *ec) { return ec->value; }
+int16_t EC_$WAIT(ec_$eventcount_t *ecs[3], int32_t *wait_val) { (void)ecs; (void)wait_val; return 0; }
+
+void NETBUF_$RTN_HDR(uint32_t *va_ptr)
+{
+    (void)va_ptr;
+    mock_hdr_returned++;
+    /* Anything still to be read from it is gone */
+    memset(mock_hdr, 0xA5, sizeof(mock_hdr));
+}
+
+void APP_$RECEIVE(uint16_t sock_num, void *result, status_$t *status_ret)
+{
+    app_receive_result_t *recv = (app_receive_result_t *)result;
+
+    if (sock_num != TEST_SOCK || mock_queued == 0) {
+        *status_ret = 0x000D0003;       /* Queue is empty */
+        return;
+    }
+    mock_queued--;
+    memset(recv, 0, sizeof(*recv));
+    recv->hdr_ptr = mock_hdr;
+    recv->data_ptr = mock_tpl;
+    recv->routing_key = TEST_ROUTING;
+    *status_ret = status_$ok;
+}
+
+void PKT_$SEND_INTERNET(uint32_t routing_key, uint32_t dest_node, uint16_t dest_sock,
+                        int32_t src_node_or, uint32_t src_node, uint16_t src_sock,
+                        void *pkt_info, uint16_t request_id,
+                        void *template, uint16_t template_len,
+                        void *data, int16_t data_len,
+                        uint16_t *len_out, void *extra, status_$t *status_ret)
+{
+    (void)routing_key; (void)dest_node; (void)dest_sock; (void)src_node_or;
+    (void)src_node; (void)src_sock; (void)pkt_info; (void)request_id;
+    (void)data; (void)data_len; (void)len_out; (void)extra;
+    memcpy(&mock_reply, template, template_len);
+    mock_replies++;
+    *status_ret = status_$ok;
+}
+
+void PKT_$SEND_INTERNET_SG(uint32_t routing_key, uint32_t dest_node, uint16_t dest_sock,
+                           int32_t src_node_or, uint32_t src_node, uint16_t src_sock,
+                           void *pkt_info, uint16_t request_id,
+                           void *template, uint16_t template_len,
+                           pkt_$sg_t *data, uint16_t *len_out, void *extra,
+                           status_$t *status_ret)
+{
+    (void)routing_key; (void)src_node_or; (void)src_node; (void)src_sock;
+    (void)pkt_info; (void)template_len; (void)len_out; (void)extra;
+    if (mock_sends < TEST_MAX_SENDS) {
+        mock_sent[mock_sends].node = dest_node;
+        mock_sent[mock_sends].sock = dest_sock;
+        mock_sent[mock_sends].pkt_id = request_id;
+        memcpy(&mock_sent[mock_sends].data, template, sizeof(network_bulk_data_t));
+        mock_sent[mock_sends].len = data->len;
+        mock_sent[mock_sends].page = data->pages[0];
+    }
+    mock_sends++;
+    *status_ret = status_$ok;
+}
+
+aste_t *AST_$ACTIVATE_AND_WIRE(uid_t *uid, uint16_t seg, status_$t *status)
+{
+    (void)uid;
+    mock_activates++;
+    mock_activate_seg = seg;
+    mock_aste.wire_count++;
+    *status = status_$ok;
+    return &mock_aste;
+}
+
+uint16_t AST_$TOUCH(aste_t *aste, uint32_t mode, uint16_t page, uint16_t count,
+                    uint32_t *ppn_array, status_$t *status, uint16_t flags)
+{
+    uint16_t i;
+
+    (void)aste; (void)mode; (void)flags;
+    for (i = 0; i < count && page + i < mock_object_pages; i++) {
+        ppn_array[i] = TEST_PPN_BASE + page + i;
+    }
+    *status = status_$ok;
+    return i;
+}
+
+static void reset_mocks(void)
+{
+    NODE_$ME = TEST_ME;
+    mock_queued = 0;
+    mock_hdr_returned = 0;
+    mock_activates = 0;
+    mock_activate_seg = 0xFFFF;
+    mock_object_pages = 0xFFFF;
+    mock_sends = 0;
+    mock_replies = 0;
+    memset(&mock_reply, 0, sizeof(mock_reply));
+    memset(mock_sent, 0, sizeof(mock_sent));
+    memset(&mock_aste, 0, sizeof(mock_aste));
+    memset(mock_aote, 0, sizeof(mock_aote));
+    mock_aste.aote = (struct aote_t *)(void *)mock_aote;
+}
+
+/* Queue one request on the page server socket */
+static void queue_request(const void *req, uint16_t len)
+{
+    app_pkt_hdr_t *hdr = (app_pkt_hdr_t *)mock_hdr;
+
+    memset(mock_hdr, 0, sizeof(mock_hdr));
+    memset(mock_tpl, 0, sizeof(mock_tpl));
+    memcpy(mock_tpl, req, len);
+    *(uint16_t *)(mock_hdr + 2) = len;
+    *(uint16_t *)(mock_hdr + 6) = TEST_PKT_ID;
+    hdr->src_node = TEST_CLIENT;
+    hdr->src_sock = TEST_CLIENT_SOCK;
+    mock_queued++;
+}
+
+static void queue_bulk_read(uint32_t first_page, uint16_t count,
+                            uint32_t want, uint16_t window)
+{
+    network_bulk_read_req_t req;
+
+    memset(&req, 0, sizeof(req));
+    req.cmd = NETWORK_CMD_BULK_READ;
+    req.count = count;
+    req.first_page = first_page;
+    req.want = want;
+    req.window = window;
+    queue_request(&req, sizeof(req));
+}
+
+/*
+ * Test: A bulk read with some pages already received
+ * Expected: Only the wanted pages are sent, lowest first and no more than
+ * the window, from their physical pages, to the client with the request's
+ * packet ID; the segment is wired while they are sent and the header is
+ * given back once
+ */
+void test_page_server_bulk_read(void)
+{
+    reset_mocks();
+    queue_bulk_read(0x40 + 8, 8, 0xB6, 3);
+
+    ASSERT_EQ(network_$page_request(TEST_SOCK), -1);
+    ASSERT_EQ(mock_activates, 1);
+    ASSERT_EQ(mock_activate_seg, 2);
+    ASSERT_EQ(mock_sends, 3);
+    ASSERT_EQ(mock_sent[0].data.cmd, NETWORK_CMD_BULK_READ + 1);
+    ASSERT_EQ(mock_sent[0].data.index, 1);
+    ASSERT_EQ(mock_sent[1].data.index, 2);
+    ASSERT_EQ(mock_sent[2].data.index, 4);
+    ASSERT_EQ(mock_sent[0].len, NETWORK_BULK_PAGE_SIZE);
+    ASSERT_EQ(mock_sent[0].page, (TEST_PPN_BASE + 8 + 1) << 10);
+    ASSERT_EQ(mock_sent[2].page, (TEST_PPN_BASE + 8 + 4) << 10);
+    ASSERT_EQ(mock_sent[2].node, TEST_CLIENT);
+    ASSERT_EQ(mock_sent[2].sock, TEST_CLIENT_SOCK);
+    ASSERT_EQ(mock_sent[2].pkt_id, TEST_PKT_ID);
+    ASSERT_EQ(mock_aste.wire_count, 0);
+    ASSERT_EQ(mock_hdr_returned, 1);
+    ASSERT_EQ(mock_replies, 0);
+
+    /* Nothing more queued */
+    ASSERT_EQ(network_$page_request(TEST_SOCK), 0);
+    ASSERT_EQ(mock_sends, 3);
+}
+
+/*
+ * Test: A run reaching past the end of the object
+ * Expected: The pages that exist are sent, then one packet without data
+ * at the first missing index, and nothing after it
+ */
+void test_page_server_bulk_read_end_of_object(void)
+{
+    reset_mocks();
+    mock_object_pages = 5;
+    queue_bulk_read(0, 8, 0xFF, 16);
+
+    ASSERT_EQ(network_$page_request(TEST_SOCK), -1);
+    ASSERT_EQ(mock_sends, 6);
+    ASSERT_EQ(mock_sent[4].data.index, 4);
+    ASSERT_EQ(mock_sent[4].len, NETWORK_BULK_PAGE_SIZE);
+    ASSERT_EQ(mock_sent[5].data.index, 5);
+    ASSERT_EQ(mock_sent[5].len, 0);
+    ASSERT_EQ(mock_sent[5].data.status, status_$ok);
+    ASSERT_EQ(mock_aste.wire_count, 0);
+}
+
+/*
+ * Test: A run that is empty or crosses a segment boundary
+ * Expected: One packet without data holding an error; the object is not
+ * activated
+ */
+void test_page_server_bulk_read_bad_run(void)
+{
+    reset_mocks();
+    queue_bulk_read(0, 0, 0, 4);
+    ASSERT_EQ(network_$page_request(TEST_SOCK), -1);
+    ASSERT_EQ(mock_sends, 1);
+    ASSERT_EQ(mock_sent[0].len, 0);
+    ASSERT_EQ(mock_sent[0].data.status, status_$network_data_length_too_large);
+
+    reset_mocks();
+    queue_bulk_read(30, 4, 0xF, 4);
+    ASSERT_EQ(network_$page_request(TEST_SOCK), -1);
+    ASSERT_EQ(mock_sends, 1);
+    ASSERT_EQ(mock_sent[0].data.status, status_$network_data_length_too_large);
+    ASSERT_EQ(mock_activates, 0);
+}
+
+/*
+ * Test: A command the page server does not know
+ * Expected: Refused with status_$network_unknown_request_type in a reply
+ * to the next command; no pages are sent
+ */
+void test_page_server_unknown_command(void)
+{
+    uint16_t req[4] = { 0x05, 0, 0, 0 };
+
+    reset_mocks();
+    queue_request(req, sizeof(req));
+
+    ASSERT_EQ(network_$page_request(TEST_SOCK), -1);
+    ASSERT_EQ(mock_replies, 1);
+    ASSERT_EQ(mock_reply.cmd, 0x06);
+    ASSERT_EQ(mock_reply.status, status_$network_unknown_request_type);
+    ASSERT_EQ(mock_sends, 0);
+    ASSERT_EQ(mock_hdr_returned, 1);
+}
@@ -232,6 +232,7 @@ void OS_$INIT(uint32_t *param_1, uint32_t *param_2)
     if (NETWORK_$DISKLESS >= 0) {
         DISK_$INIT();
         DBUF_$INIT();
+        VTOC_$SCAN_INIT();
     }
 
     CAL_$BOOT_VOLX = 0;
@@ -188,6 +188,7 @@ void VOLX_$MOUNT(void *boot_device, void *param2, void *param3,
 status_$t VOLX_$SHUTDOWN(void);
 void VOLX_$REC_ENTRY(void *param1, uid_t *uid);
 void VTOCE_$READ(void *param1, void *param2, status_$t *status);
+void VTOC_$SCAN_INIT(void);
 
 /* Network - NETWORK_$ADD_REQUEST_SERVERS, NETWORK_$SET_SERVICE declared in network/network.h */
 void SOCK_$INIT(void);
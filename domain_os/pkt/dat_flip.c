@@ -0,0 +1,105 @@
+/*
+ * PKT_$DAT_FLIP - Move data from network buffers, flipping whole pages
+ *
+ * Like PKT_$DAT_COPY, but a buffer that holds a full page bound for a
+ * page-aligned destination is not copied: its physical page is
+ * associated with the object page mapped at the destination in place of
+ * the page there, and a fresh page goes into the network buffer pool to
+ * replace it.  The buffer entry is then set to PKT_BUF_FLIPPED so that
+ * PKT_$DUMP_DATA skips it.
+ *
+ * Anything that cannot be flipped (a partial page, an unaligned or
+ * unmapped destination, an object the caller may not write, an object
+ * that refuses the page) is copied as before.  Large IPC messages into page-aligned buffers move without any
+ * copy at all.
+ */
+
+#include "pkt/pkt_internal.h"
+#include "misc/crash_system.h"
+#include "mst/mst.h"
+#include "ast/ast.h"
+#include "file/file.h"
+
+static uint32_t pkt_$flipped_bytes;
+static uint32_t pkt_$copied_bytes;
+
+/*
+ * Hand one data buffer's page to the object page mapped at dest_va.
+ * Returns -1 if it was taken.
+ *
+ * AST_$ASSOC replaces the object's page whatever the mapping allows, so
+ * the caller must be able to write the object itself; otherwise the copy
+ * (which faults as any store to the buffer would) is left to decide.
+ */
+static int8_t pkt_$flip_page(uint32_t buffer, char *dest_va)
+{
+    uid_t uid;
+    uint32_t va;
+    uint32_t offset;
+    uint16_t rights;
+    status_$t status;
+
+    va = (uint32_t)dest_va;
+    MST_$GET_UID(&va, &uid, &offset, &status);
+    if (status != status_$ok) {
+        return 0;
+    }
+
+    /* Write access (mode 2), checked against the ACL: no lock slot */
+    FILE_$CHECK_PROT(&uid, 2, 0, NULL, &rights, &status);
+    if (status != status_$ok) {
+        return 0;
+    }
+
+    AST_$ASSOC(&uid, (uint16_t)(offset >> 15), 0,
+               (uint16_t)((offset >> 10) & 0x1F), 0, buffer >> 10, &status);
+    if (status != status_$ok) {
+        return 0;
+    }
+
+    /* The pool gave up a page for good: put a new one in */
+    NETBUF_$ADD_PAGES(1);
+    return -1;
+}
+
+void PKT_$DAT_FLIP(uint32_t *buffers, int16_t len, char *dest_va)
+{
+    int16_t chunk_size;
+    int16_t remaining;
+    char *buf_va;
+    status_$t status;
+
+    remaining = len;
+
+    while (remaining > 0) {
+        chunk_size = remaining;
+        if (chunk_size > PKT_CHUNK_SIZE) {
+            chunk_size = PKT_CHUNK_SIZE;
+        }
+
+        if (chunk_size == PKT_CHUNK_SIZE &&
+            ((uint32_t)dest_va & (PKT_CHUNK_SIZE - 1)) == 0 &&
+            pkt_$flip_page(*buffers, dest_va) < 0) {
+            *buffers = PKT_BUF_FLIPPED;
+            pkt_$flipped_bytes += PKT_CHUNK_SIZE;
+        } else {
+            NETBUF_$GETVA(*buffers, (uint32_t *)&buf_va, &status);
+            if (status != status_$ok) {
+                CRASH_SYSTEM(&status);
+            }
+            OS_$DATA_COPY(buf_va, dest_va, (uint32_t)chunk_size);
+            NETBUF_$RTNVA((uint32_t *)&buf_va);
+            pkt_$copied_bytes += chunk_size;
+        }
+
+        remaining -= chunk_size;
+        dest_va += chunk_size;
+        buffers++;
+    }
+}
+
+void PKT_$FLIP_STATS(uint32_t *flipped_bytes, uint32_t *copied_bytes)
+{
+    *flipped_bytes = pkt_$flipped_bytes;
+    *copied_bytes = pkt_$copied_bytes;
+}
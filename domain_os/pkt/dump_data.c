@@ -12,6 +12,8 @@
  *    If so, we've released enough buffers
  * 4. Call NETBUF_$RTN_DAT for each buffer
  *
+ * Buffers marked PKT_BUF_FLIPPED by PKT_$DAT_FLIP are skipped.
+ *
  * Original address: 0x00E127E6
  */
 
@@ -40,8 +42,10 @@ void PKT_$DUMP_DATA(uint32_t *buffers, int16_t len)
             return;
         }
 
-        /* Return this buffer to the pool */
-        NETBUF_$RTN_DAT(buffers[buf_num - 1]);
+        /* Return this buffer to the pool, unless PKT_$DAT_FLIP gave it away */
+        if (buffers[buf_num - 1] != PKT_BUF_FLIPPED) {
+            NETBUF_$RTN_DAT(buffers[buf_num - 1]);
+        }
 
         buf_num++;
     }
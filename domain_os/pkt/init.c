@@ -21,6 +21,9 @@ void PKT_$INIT(void)
 {
     status_$t status;
 
+    /* Table of requests waiting on the shared reply sockets */
+    pkt_$reply_init();
+
     /* Create the ping server process */
     PROC1_$CREATE_P(PKT_$PING_SERVER, PING_SERVER_TYPE, &status);
 
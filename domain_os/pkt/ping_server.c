@@ -57,6 +57,9 @@ void PKT_$PING_SERVER(void)
         CRASH_SYSTEM(&sock_open_error);
     }
 
+    /* Echoes are the first thing to go when network buffers run low */
+    SOCK_$SET_QUOTA(PKT_PING_SOCKET, SOCK_PAGE_QUOTA_DEFAULT(3), 0, 0, SOCK_PRI_LOW);
+
     /* Set lock to prevent preemption during receive processing */
     PROC1_$SET_LOCK(0x13);
 
@@ -16,6 +16,7 @@
 #define PKT_H
 
 #include "base/base.h"
+#include "ec/ec.h"
 
 /*
  * ============================================================================
@@ -192,6 +193,30 @@ void PKT_$DUMP_DATA(uint32_t *buffers, int16_t len);
  */
 void PKT_$DAT_COPY(uint32_t *buffers, int16_t len, char *dest_va);
 
+/*
+ * PKT_$DAT_FLIP - Move data from network buffers to a destination
+ *
+ * As PKT_$DAT_COPY, except that full pages going to page-aligned
+ * destinations are remapped rather than copied.  A buffer that was
+ * remapped is set to PKT_BUF_FLIPPED and no longer belongs to the
+ * caller; PKT_$DUMP_DATA skips it.
+ *
+ * @param buffers       Array of buffer physical addresses (updated)
+ * @param len           Length of data to move
+ * @param dest_va       Destination virtual address
+ */
+#define PKT_BUF_FLIPPED 1       /* Never a valid buffer address */
+
+void PKT_$DAT_FLIP(uint32_t *buffers, int16_t len, char *dest_va);
+
+/*
+ * PKT_$FLIP_STATS - Bytes moved by PKT_$DAT_FLIP
+ *
+ * @param flipped_bytes Output: bytes remapped
+ * @param copied_bytes  Output: bytes copied
+ */
+void PKT_$FLIP_STATS(uint32_t *flipped_bytes, uint32_t *copied_bytes);
+
 /*
  * ============================================================================
  * Packet Sending and Receiving
@@ -228,6 +253,34 @@ void PKT_$SEND_INTERNET(uint32_t routing_key, uint32_t dest_node, uint16_t dest_
                         void *data, int16_t data_len,
                         uint16_t *len_out, void *extra, status_$t *status_ret);
 
+/*
+ * PKT_$SEND_INTERNET_SG - Send an internet packet from existing pages
+ *
+ * As PKT_$SEND_INTERNET, but the data is described by page references
+ * instead of being copied in: the driver transmits straight from the
+ * pages (file or segment pages being served, for instance).  The pages
+ * must stay put until the call returns and remain the caller's.
+ *
+ * @param data          Page list; data->len bytes are sent, 0x400 from
+ *                      each page in turn (the last may be short)
+ *
+ * The other parameters are those of PKT_$SEND_INTERNET.
+ */
+#define PKT_SG_MAX_PAGES 4
+
+typedef struct pkt_$sg_t {
+    uint16_t len;                       /* Bytes of data */
+    uint16_t pad;
+    uint32_t pages[PKT_SG_MAX_PAGES];   /* ppn << 10 of each page */
+} pkt_$sg_t;
+
+void PKT_$SEND_INTERNET_SG(uint32_t routing_key, uint32_t dest_node, uint16_t dest_sock,
+                           int32_t src_node_or, uint32_t src_node, uint16_t src_sock,
+                           void *pkt_info, uint16_t request_id,
+                           void *template, uint16_t template_len,
+                           pkt_$sg_t *data, uint16_t *len_out, void *extra,
+                           status_$t *status_ret);
+
 /*
  * PKT_$SAR_INTERNET - Send and receive internet packet
  *
@@ -262,6 +315,74 @@ void PKT_$SAR_INTERNET(uint32_t routing_key, uint32_t dest_node, uint16_t dest_s
                        uint16_t *resp_tpl_len, void *resp_data_buf, uint16_t resp_data_max,
                        uint16_t *resp_data_len, status_$t *status_ret);
 
+/*
+ * ============================================================================
+ * Shared Reply Sockets
+ * ============================================================================
+ *
+ * Request/response callers send from a long-lived socket shared by all
+ * callers of the same kind, and their replies are matched to them by
+ * packet ID (PKT_$NEXT_ID).  A caller's reply is filed in its own entry
+ * and the entry's event count advanced.  Whoever is woken receives for
+ * everybody, so a caller waits on both its event count and the socket's.
+ */
+
+/*
+ * APP_$RECEIVE result as the request/response callers use it
+ */
+typedef struct pkt_$recv_t {
+    uint32_t hdr_ptr;           /* 0x00: +2 template length, +4 data length, +6 ID */
+    char *data_ptr;             /* 0x04: Template, in the header buffer */
+    uint32_t data_bufs[10];     /* 0x08: Data buffers */
+} pkt_$recv_t;
+
+#define PKT_REPLY_MAX           32      /* Requests outstanding, all callers */
+
+#define PKT_REPLY_CHAN_SAR      0       /* PKT_$SAR_INTERNET */
+#define PKT_REPLY_CHAN_FILE     1       /* REM_FILE_$SEND_REQUEST */
+#define PKT_REPLY_CHANS         2
+
+typedef struct pkt_$reply_t {
+    ec_$eventcount_t *ec;       /* Advanced when the reply has been filed */
+    uint16_t sock;              /* Socket to send the request from */
+    uint16_t entry;             /* Index in the correlation table */
+} pkt_$reply_t;
+
+/*
+ * PKT_$REPLY_OPEN - Register a request for a reply
+ *
+ * @param chan          PKT_REPLY_CHAN_*
+ * @param id            Packet ID the request is sent with
+ * @param reply         Output: socket to send from and event count
+ *
+ * Returns:
+ *   -1 if registered; 0 if the table is full or the shared socket could
+ *   not be allocated, in which case the caller uses a socket of its own
+ */
+int8_t PKT_$REPLY_OPEN(uint16_t chan, int16_t id, pkt_$reply_t *reply);
+
+/*
+ * PKT_$REPLY_RECEIVE - Receive a request's reply
+ *
+ * As APP_$RECEIVE on a socket of the caller's own: first receives
+ * whatever is queued on the shared socket and files it, then returns
+ * the caller's reply if there is one.  Each reply is returned once;
+ * another with the same ID (an answer to a retransmission) may follow.
+ *
+ * @param reply         From PKT_$REPLY_OPEN
+ * @param result        Output: as from APP_$RECEIVE
+ * @param status_ret    Output: status_$ok or
+ *                      status_$network_buffer_queue_is_empty
+ */
+void PKT_$REPLY_RECEIVE(pkt_$reply_t *reply, void *result, status_$t *status_ret);
+
+/*
+ * PKT_$REPLY_CLOSE - Stop waiting for a reply
+ *
+ * Gives back a reply filed but never received, and frees the entry.
+ */
+void PKT_$REPLY_CLOSE(pkt_$reply_t *reply);
+
 /*
  * ============================================================================
  * Node Visibility Tracking
@@ -314,4 +435,46 @@ void PKT_$NOTE_VISIBLE(uint32_t node_id, int8_t is_visible);
  */
 int8_t PKT_$LIKELY_TO_ANSWER(void *addr_info, status_$t *status_ret);
 
+/*
+ * ============================================================================
+ * Round-Trip Time Estimation
+ * ============================================================================
+ *
+ * Smoothed RTT and RTT variance per node (Jacobson), used to time
+ * retransmissions of request/response exchanges.  Samples follow Karn's
+ * rule: only a reply to a request sent once is timed, and a timeout
+ * doubles the node's timeout until the next good sample.
+ */
+
+#define PKT_RTT_MIN_TICKS       2       /* TIME_$CLOCKH ticks (~0.5 s) */
+#define PKT_RTT_INITIAL_TICKS   4       /* Nodes with no samples yet */
+#define PKT_RTT_MAX_TICKS       32      /* Backoff ceiling (~8 s) */
+
+/*
+ * PKT_$RTT_STAMP - Current time in clock units (4 us), for timing
+ * an exchange with PKT_$RTT_SAMPLE
+ */
+uint32_t PKT_$RTT_STAMP(void);
+
+/*
+ * PKT_$RTT_SAMPLE - Record a measured round trip to a node
+ *
+ * @param node_id       Node that answered
+ * @param sent_stamp    PKT_$RTT_STAMP taken when the request was sent
+ */
+void PKT_$RTT_SAMPLE(uint32_t node_id, uint32_t sent_stamp);
+
+/*
+ * PKT_$RTT_NOTE_TIMEOUT - Back off after a node failed to answer in time
+ */
+void PKT_$RTT_NOTE_TIMEOUT(uint32_t node_id);
+
+/*
+ * PKT_$RTT_TIMEOUT - Retransmission timeout for a node
+ *
+ * Returns:
+ *   Ticks of TIME_$CLOCKH to wait for a reply
+ */
+uint16_t PKT_$RTT_TIMEOUT(uint32_t node_id);
+
 #endif /* PKT_H */
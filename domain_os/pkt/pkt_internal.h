@@ -61,6 +61,27 @@ typedef struct pkt_$request_template_t {
                         /* Additional fields follow based on type */
 } pkt_$request_template_t;
 
+/*
+ * Correlation table entry (PKT_$REPLY_*)
+ */
+#define PKT_REPLY_FREE 0
+#define PKT_REPLY_WAITING 1 /* Registered, no reply filed */
+#define PKT_REPLY_FILED 2   /* Reply in recv, not yet received */
+
+typedef struct pkt_$reply_entry_t {
+  uint8_t state;       /* PKT_REPLY_* */
+  uint8_t chan;        /* PKT_REPLY_CHAN_* */
+  int16_t id;          /* Packet ID of the request */
+  ec_$eventcount_t ec; /* Advanced when a reply is filed */
+  pkt_$recv_t recv;    /* The filed reply */
+} pkt_$reply_entry_t;
+
+typedef struct pkt_$reply_chan_t {
+  uint32_t proto_bufpages; /* For SOCK_$ALLOCATE */
+  uint16_t sock;
+  int8_t open; /* -1 once sock is allocated */
+} pkt_$reply_chan_t;
+
 /*
  * PKT module global data area
  * Base address: 0xE24C9C (m68k)
@@ -124,4 +145,22 @@ extern uint32_t *ROUTE_$PORTP;        /* Route port pointers */
  */
 void PKT_$PING_SERVER(void);
 
+/*
+ * pkt_$reply_init - Set up the correlation table; called by PKT_$INIT
+ */
+void pkt_$reply_init(void);
+
+/*
+ * pkt_$send_buffers - Transmit a packet whose data is already in pages
+ *
+ * The header-build and send/retry loop of PKT_$SEND_INTERNET, shared
+ * with PKT_$SEND_INTERNET_SG.  data_buffers stay with the caller.
+ */
+void pkt_$send_buffers(uint32_t routing_key, uint32_t dest_node, uint16_t dest_sock,
+                       int32_t src_node_or, uint32_t src_node, uint16_t src_sock,
+                       void *pkt_info, uint16_t request_id,
+                       void *template, uint16_t template_len,
+                       uint32_t *data_buffers, int16_t data_len,
+                       uint16_t *len_out, void *extra, status_$t *status_ret);
+
 #endif /* PKT_INTERNAL_H */
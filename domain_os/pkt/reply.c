@@ -0,0 +1,200 @@
+/*
+ * PKT_$REPLY_* - Shared reply sockets
+ *
+ * PKT_$SAR_INTERNET and REM_FILE_$SEND_REQUEST used to allocate a socket
+ * for each exchange and close it afterwards, so every remote call paid
+ * for a SOCK_$ALLOCATE and a SOCK_$CLOSE, and enough calls in progress at
+ * once ran the socket table out (crashing the system, as neither can
+ * carry on without a socket).  Each kind of caller now sends from one
+ * socket allocated the first time it is needed and kept, and replies are
+ * matched to requests by packet ID through a table of requests waiting.
+ *
+ * Whichever waiter is woken receives everything queued on the socket,
+ * files each reply in its request's entry and advances that entry's
+ * event count.  A reply nobody is waiting for (a duplicate, or one that
+ * arrived after its caller gave up) is thrown away.
+ */
+
+#include "pkt/pkt_internal.h"
+
+static pkt_$reply_entry_t pkt_$replies[PKT_REPLY_MAX];
+
+/*
+ * One buffer page per packet, as the callers allocated their own
+ * sockets, but a queue as deep as the table of requests waiting: every
+ * outstanding request can have its reply queued at once.  The callers'
+ * own depths (2 and 3) were for one exchange each.
+ */
+#define PKT_REPLY_SOCK_PROTO    (((uint32_t)PKT_REPLY_MAX << 16) | 1)
+
+static pkt_$reply_chan_t pkt_$reply_chans[PKT_REPLY_CHANS] = {
+    { PKT_REPLY_SOCK_PROTO, 0, 0 },     /* PKT_REPLY_CHAN_SAR */
+    { PKT_REPLY_SOCK_PROTO, 0, 0 },     /* PKT_REPLY_CHAN_FILE */
+};
+
+static uint16_t pkt_$reply_lock;
+
+void pkt_$reply_init(void)
+{
+    int16_t i;
+
+    for (i = 0; i < PKT_REPLY_MAX; i++) {
+        pkt_$replies[i].state = PKT_REPLY_FREE;
+        EC_$INIT(&pkt_$replies[i].ec);
+    }
+}
+
+/*
+ * Allocate a channel's socket the first time it is needed, with room for
+ * bulk data (REM_FILE_$SEND_REQUEST asked for that only for some calls).
+ */
+static int8_t pkt_$reply_start(pkt_$reply_chan_t *chan)
+{
+    ml_$spin_token_t token;
+    uint16_t sock;
+    int8_t close_it = 0;
+
+    if (chan->open < 0) {
+        return -1;
+    }
+
+    if (SOCK_$ALLOCATE(&sock, chan->proto_bufpages, 0x10400) >= 0) {
+        return 0;
+    }
+
+    token = ML_$SPIN_LOCK(&pkt_$reply_lock);
+    if (chan->open < 0) {
+        close_it = -1;
+    } else {
+        chan->sock = sock;
+        chan->open = -1;
+    }
+    ML_$SPIN_UNLOCK(&pkt_$reply_lock, token);
+
+    if (close_it < 0) {
+        SOCK_$CLOSE(sock);
+    }
+    return -1;
+}
+
+static void pkt_$reply_discard(pkt_$recv_t *recv)
+{
+    uint32_t hdr_page;
+    int16_t data_len;
+
+    /* The data length is in the header: read it before the header goes */
+    data_len = *(int16_t *)(recv->hdr_ptr + 4);
+
+    hdr_page = (uint32_t)recv->data_ptr & 0xFFFFFC00;
+    NETBUF_$RTN_HDR(&hdr_page);
+    if (recv->data_bufs[0] != 0) {
+        PKT_$DUMP_DATA(recv->data_bufs, data_len);
+    }
+}
+
+/*
+ * Receive all that is queued on a channel's socket and file it
+ */
+static void pkt_$reply_drain(uint16_t chan)
+{
+    ml_$spin_token_t token;
+    pkt_$reply_entry_t *e;
+    pkt_$recv_t recv;
+    status_$t status;
+    int16_t id;
+    int16_t i;
+
+    for (;;) {
+        APP_$RECEIVE(pkt_$reply_chans[chan].sock, &recv, &status);
+        if (status != status_$ok) {
+            return;
+        }
+
+        id = *(int16_t *)(recv.hdr_ptr + 6);
+        e = NULL;
+        token = ML_$SPIN_LOCK(&pkt_$reply_lock);
+        for (i = 0; i < PKT_REPLY_MAX; i++) {
+            if (pkt_$replies[i].state == PKT_REPLY_WAITING &&
+                pkt_$replies[i].chan == chan && pkt_$replies[i].id == id) {
+                e = &pkt_$replies[i];
+                e->recv = recv;
+                e->state = PKT_REPLY_FILED;
+                break;
+            }
+        }
+        ML_$SPIN_UNLOCK(&pkt_$reply_lock, token);
+
+        if (e != NULL) {
+            EC_$ADVANCE(&e->ec);
+        } else {
+            pkt_$reply_discard(&recv);
+        }
+    }
+}
+
+int8_t PKT_$REPLY_OPEN(uint16_t chan, int16_t id, pkt_$reply_t *reply)
+{
+    ml_$spin_token_t token;
+    int16_t i;
+
+    if (chan >= PKT_REPLY_CHANS || pkt_$reply_start(&pkt_$reply_chans[chan]) >= 0) {
+        return 0;
+    }
+
+    token = ML_$SPIN_LOCK(&pkt_$reply_lock);
+    for (i = 0; i < PKT_REPLY_MAX; i++) {
+        if (pkt_$replies[i].state == PKT_REPLY_FREE) {
+            pkt_$replies[i].state = PKT_REPLY_WAITING;
+            pkt_$replies[i].chan = (uint8_t)chan;
+            pkt_$replies[i].id = id;
+            break;
+        }
+    }
+    ML_$SPIN_UNLOCK(&pkt_$reply_lock, token);
+
+    if (i == PKT_REPLY_MAX) {
+        return 0;
+    }
+
+    reply->ec = &pkt_$replies[i].ec;
+    reply->sock = pkt_$reply_chans[chan].sock;
+    reply->entry = (uint16_t)i;
+    return -1;
+}
+
+void PKT_$REPLY_RECEIVE(pkt_$reply_t *reply, void *result, status_$t *status_ret)
+{
+    ml_$spin_token_t token;
+    pkt_$reply_entry_t *e;
+
+    e = &pkt_$replies[reply->entry];
+    pkt_$reply_drain(e->chan);
+
+    *status_ret = status_$network_buffer_queue_is_empty;
+    token = ML_$SPIN_LOCK(&pkt_$reply_lock);
+    if (e->state == PKT_REPLY_FILED) {
+        *(pkt_$recv_t *)result = e->recv;
+        e->state = PKT_REPLY_WAITING;
+        *status_ret = status_$ok;
+    }
+    ML_$SPIN_UNLOCK(&pkt_$reply_lock, token);
+}
+
+void PKT_$REPLY_CLOSE(pkt_$reply_t *reply)
+{
+    ml_$spin_token_t token;
+    pkt_$reply_entry_t *e;
+    pkt_$recv_t recv;
+    int8_t filed;
+
+    e = &pkt_$replies[reply->entry];
+    token = ML_$SPIN_LOCK(&pkt_$reply_lock);
+    filed = (e->state == PKT_REPLY_FILED) ? -1 : 0;
+    recv = e->recv;
+    e->state = PKT_REPLY_FREE;
+    ML_$SPIN_UNLOCK(&pkt_$reply_lock, token);
+
+    if (filed < 0) {
+        pkt_$reply_discard(&recv);
+    }
+}
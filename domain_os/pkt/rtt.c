@@ -0,0 +1,159 @@
+/*
+ * PKT_$RTT_* - Per-node round-trip time estimation
+ *
+ * Request/response exchanges used to wait a fixed time before
+ * retransmitting, which is far too long on a quiet ring and too short on
+ * a congested one.  Each node that has answered recently gets an entry
+ * here with its smoothed RTT and mean deviation, from which the
+ * retransmission timeout is computed as srtt + 4 * rttvar, doubled for
+ * each timeout since the last good sample.
+ *
+ * Estimates are kept in clock units (4 us) with the usual scaling:
+ * srtt is 8 times the average and rttvar 4 times the mean deviation,
+ * so the updates need only shifts.  Timeouts are given in TIME_$CLOCKH
+ * ticks since that is what the waiters sleep on.
+ *
+ * The table is small and replaced least recently used first, like the
+ * missing node list.
+ */
+
+#include "pkt/pkt_internal.h"
+
+#define PKT_RTT_NODES       16
+#define PKT_RTT_MAX_BACKOFF 4
+
+/* Longest sample taken (~1 minute); anything slower is noise */
+#define PKT_RTT_MAX_SAMPLE  0x00E4E1C0
+
+typedef struct {
+    uint32_t node_id;
+    uint32_t srtt;          /* Smoothed RTT << 3 */
+    uint32_t rttvar;        /* Mean deviation << 2 */
+    uint32_t seq_number;    /* Last use, for replacement */
+    uint16_t backoff;       /* Timeouts since the last sample */
+    uint16_t pad;
+} pkt_$rtt_entry_t;
+
+static pkt_$rtt_entry_t pkt_$rtt[PKT_RTT_NODES];
+static uint32_t pkt_$rtt_seq;
+static uint16_t pkt_$rtt_lock;
+
+/*
+ * Find a node's entry, or with create set, claim one for it.  Called with
+ * the lock held.
+ */
+static pkt_$rtt_entry_t *pkt_$rtt_lookup(uint32_t node_id, int8_t create)
+{
+    pkt_$rtt_entry_t *e;
+    pkt_$rtt_entry_t *oldest = &pkt_$rtt[0];
+    int16_t i;
+
+    for (i = 0, e = pkt_$rtt; i < PKT_RTT_NODES; i++, e++) {
+        if (e->node_id == node_id && e->seq_number != 0) {
+            e->seq_number = ++pkt_$rtt_seq;
+            return e;
+        }
+        if (e->seq_number < oldest->seq_number) {
+            oldest = e;
+        }
+    }
+
+    if (create >= 0) {
+        return NULL;
+    }
+
+    oldest->node_id = node_id;
+    oldest->srtt = 0;
+    oldest->rttvar = 0;
+    oldest->backoff = 0;
+    oldest->seq_number = ++pkt_$rtt_seq;
+    return oldest;
+}
+
+uint32_t PKT_$RTT_STAMP(void)
+{
+    clock_t now;
+
+    TIME_$CLOCK(&now);
+    return (now.high << 16) | now.low;
+}
+
+void PKT_$RTT_SAMPLE(uint32_t node_id, uint32_t sent_stamp)
+{
+    ml_$spin_token_t token;
+    pkt_$rtt_entry_t *e;
+    uint32_t rtt;
+    int32_t delta;
+
+    rtt = PKT_$RTT_STAMP() - sent_stamp;
+    if (rtt > PKT_RTT_MAX_SAMPLE) {
+        return;
+    }
+
+    token = ML_$SPIN_LOCK(&pkt_$rtt_lock);
+    e = pkt_$rtt_lookup(node_id, -1);
+
+    if (e->srtt == 0) {
+        /* First sample: deviation starts at half the RTT */
+        e->srtt = rtt << 3;
+        e->rttvar = rtt << 1;
+    } else {
+        delta = (int32_t)rtt - (int32_t)(e->srtt >> 3);
+        e->srtt += delta;
+        if (delta < 0) {
+            delta = -delta;
+        }
+        delta -= (int32_t)(e->rttvar >> 2);
+        e->rttvar += delta;
+    }
+    if (e->srtt == 0) {
+        e->srtt = 1;
+    }
+    e->backoff = 0;
+
+    ML_$SPIN_UNLOCK(&pkt_$rtt_lock, token);
+}
+
+void PKT_$RTT_NOTE_TIMEOUT(uint32_t node_id)
+{
+    ml_$spin_token_t token;
+    pkt_$rtt_entry_t *e;
+
+    token = ML_$SPIN_LOCK(&pkt_$rtt_lock);
+    e = pkt_$rtt_lookup(node_id, -1);
+    if (e->backoff < PKT_RTT_MAX_BACKOFF) {
+        e->backoff++;
+    }
+    ML_$SPIN_UNLOCK(&pkt_$rtt_lock, token);
+}
+
+uint16_t PKT_$RTT_TIMEOUT(uint32_t node_id)
+{
+    ml_$spin_token_t token;
+    pkt_$rtt_entry_t *e;
+    uint32_t ticks;
+
+    token = ML_$SPIN_LOCK(&pkt_$rtt_lock);
+    e = pkt_$rtt_lookup(node_id, 0);
+
+    if (e == NULL) {
+        ticks = PKT_RTT_INITIAL_TICKS;
+    } else {
+        if (e->srtt == 0) {
+            ticks = PKT_RTT_INITIAL_TICKS;
+        } else {
+            ticks = ((e->srtt >> 3) + e->rttvar + 0xFFFF) >> 16;
+            if (ticks < PKT_RTT_MIN_TICKS) {
+                ticks = PKT_RTT_MIN_TICKS;
+            }
+        }
+        ticks <<= e->backoff;
+    }
+
+    ML_$SPIN_UNLOCK(&pkt_$rtt_lock, token);
+
+    if (ticks > PKT_RTT_MAX_TICKS) {
+        ticks = PKT_RTT_MAX_TICKS;
+    }
+    return (uint16_t)ticks;
+}
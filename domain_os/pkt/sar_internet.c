@@ -5,17 +5,18 @@
  * node visibility tracking.
  *
  * The algorithm:
- * 1. Allocate a socket for receiving the response
- * 2. Generate a unique request ID
+ * 1. Generate a unique request ID
+ * 2. Register it on the shared reply socket (PKT_$REPLY_OPEN); only if
+ *    that is not possible, allocate a socket for receiving the response
  * 3. Loop sending and waiting for response:
  *    a. Send request via PKT_$SEND_INTERNET
- *    b. Wait on socket EC, time EC, and quit EC
+ *    b. Wait on socket EC (and the request's own EC), time EC, and quit EC
  *    c. If response received with matching ID, success
  *    d. If timeout, retry (up to max retries)
  *    e. If quit requested, abort
  * 4. After 2 retries with no response, check if node is likely to answer
  * 5. Update visibility tracking based on result
- * 6. Close socket and return
+ * 6. Release the registration or close the socket, and return
  *
  * Original address: 0x00E71EC4
  */
@@ -37,47 +38,47 @@ void PKT_$SAR_INTERNET(uint32_t routing_key, uint32_t dest_node, uint16_t dest_s
                        uint16_t *resp_data_len, status_$t *status_ret)
 {
     int8_t result;
+    int8_t shared;
     uint16_t sock_num;
     int16_t request_id;
     int16_t retry_num;
     uint16_t max_retries;
-    int32_t wait_val;
     int32_t timeout_val;
     int32_t quit_check_val;
     ec_$eventcount_t *sock_ec;
-    void *recv_pkt;
+    pkt_$reply_t reply;
+    pkt_$recv_t recv;
     status_$t local_status;
     uint16_t len_out[2];
     int16_t recv_id;
     uint16_t recv_tpl_len;
+    uint16_t recv_data_len;
     uint16_t copy_len;
     uint32_t recv_ppn;
-    uint32_t data_buffers[10];
     uint32_t addr_info[2];
-    int16_t wait_result;
+    uint16_t wait_result;
     int8_t got_response;
 
-    /* Allocate a socket for receiving response */
-    result = SOCK_$ALLOCATE(&sock_num, 0x20001, 0x10400);
-    if (result >= 0) {
-        CRASH_SYSTEM(&sock_alloc_error);
-    }
-
-    /* Get socket's event count */
-    /* TODO: Get proper socket event count from socket table */
-    /* sock_ec = *(ec_$eventcount_t **)(&SOCK_EC_ARRAY + sock_num * 4); */
-    sock_ec = NULL;  /* Placeholder */
-
     /* Generate request ID */
     request_id = PKT_$NEXT_ID();
 
-    /* Get initial wait value */
-    if (sock_ec != NULL) {
-        wait_val = *(int32_t *)sock_ec + 1;
+    /*
+     * Send from the shared reply socket; a socket of our own only when
+     * the correlation table is full
+     */
+    shared = PKT_$REPLY_OPEN(PKT_REPLY_CHAN_SAR, request_id, &reply);
+    if (shared < 0) {
+        sock_num = reply.sock;
     } else {
-        wait_val = 1;
+        result = SOCK_$ALLOCATE(&sock_num, 0x20001, 0x10400);
+        if (result >= 0) {
+            CRASH_SYSTEM(&sock_alloc_error);
+        }
     }
 
+    /* Get socket's event count */
+    sock_ec = SOCK_$EVENT_COUNTERS[sock_num];
+
     /* Get quit check value for current address space */
     quit_check_val = FIM_$QUIT_VALUE[PROC1_$AS_ID] + 1;
 
@@ -118,42 +119,33 @@ void PKT_$SAR_INTERNET(uint32_t routing_key, uint32_t dest_node, uint16_t dest_s
         /* Calculate timeout */
         timeout_val = TIME_$CLOCKH + (uint32_t)(timeout + len_out[0]);
 
-        /* Wait for response or timeout */
+        /* Receive until our response comes or we time out */
         for (;;) {
-            ec_$eventcount_t *ecs[3];
-            int32_t wait_vals[3];
+            ec_$eventcount_t *ecs[4];
+            int32_t wait_vals[4];
 
-            /* Set up event counts to wait on */
+            /*
+             * Event count values are taken before receiving, so anything
+             * arriving after the receive ends the wait at once
+             */
             ecs[0] = sock_ec;
             ecs[1] = (ec_$eventcount_t *)&TIME_$CLOCKH;
-            ecs[2] = (ec_$eventcount_t *)(FIM_$QUIT_EC + PROC1_$AS_ID * 3);
-            wait_vals[0] = wait_val;
+            ecs[2] = &FIM_$QUIT_EC[PROC1_$AS_ID];
+            ecs[3] = reply.ec;
+            wait_vals[0] = sock_ec->value + 1;
             wait_vals[1] = timeout_val;
             wait_vals[2] = quit_check_val;
 
-            wait_result = EC_$WAIT(ecs, wait_vals);
-
-            if (wait_result == 1) {
-                /* Timeout */
-                break;
-            }
-
-            if (wait_result == 2) {
-                /* Quit requested */
-                FIM_$QUIT_VALUE[PROC1_$AS_ID] = *(uint32_t *)(FIM_$QUIT_EC + PROC1_$AS_ID * 3);
-                *status_ret = 0x120010;  /* Quit status */
-                goto cleanup_no_visibility;
+            if (shared < 0) {
+                wait_vals[3] = reply.ec->value + 1;
+                PKT_$REPLY_RECEIVE(&reply, &recv, &local_status);
+            } else {
+                APP_$RECEIVE(sock_num, &recv, &local_status);
             }
 
-            /* Response received - increment wait value for next wait */
-            wait_val++;
-
-            /* Receive the response */
-            APP_$RECEIVE(sock_num, &recv_pkt, status_ret);
-
-            if (*status_ret == status_$ok) {
+            if (local_status == status_$ok) {
                 /* Extract response template length */
-                recv_tpl_len = *(uint16_t *)((char *)recv_pkt + 2);
+                recv_tpl_len = *(uint16_t *)(recv.hdr_ptr + 2);
 
                 /* Copy template to caller's buffer */
                 copy_len = recv_tpl_len;
@@ -161,39 +153,56 @@ void PKT_$SAR_INTERNET(uint32_t routing_key, uint32_t dest_node, uint16_t dest_s
                     copy_len = resp_tpl_max;
                 }
                 *resp_tpl_len = copy_len;
-                OS_$DATA_COPY(*(char **)((char *)recv_pkt + 0x28), resp_tpl_buf, (uint32_t)copy_len);
+                OS_$DATA_COPY(recv.data_ptr, resp_tpl_buf, (uint32_t)copy_len);
 
-                /* Get response ID */
-                recv_id = *(int16_t *)((char *)recv_pkt + 6);
+                /* Get response ID and data length, before the header goes */
+                recv_id = *(int16_t *)(recv.hdr_ptr + 6);
+                recv_data_len = *(uint16_t *)(recv.hdr_ptr + 4);
 
                 /* Return header buffer */
-                recv_ppn = (*(uint32_t *)((char *)recv_pkt + 0x28)) & 0xFFFFFC00;
+                recv_ppn = (uint32_t)recv.data_ptr & 0xFFFFFC00;
                 NETBUF_$RTN_HDR(&recv_ppn);
 
                 /* Handle data buffers */
-                data_buffers[0] = *(uint32_t *)((char *)recv_pkt + 0x2C);
-                if (data_buffers[0] == 0) {
+                if (recv.data_bufs[0] == 0) {
                     *resp_data_len = 0;
                 } else {
                     /* Copy data to caller's buffer */
-                    uint16_t data_len = *(uint16_t *)((char *)recv_pkt + 4);
-                    copy_len = data_len;
+                    copy_len = recv_data_len;
                     if (copy_len > resp_data_max) {
                         copy_len = resp_data_max;
                     }
                     *resp_data_len = copy_len;
-                    PKT_$DAT_COPY(data_buffers, copy_len, (char *)resp_data_buf);
-                    PKT_$DUMP_DATA(data_buffers, data_len);
+                    PKT_$DAT_COPY(recv.data_bufs, copy_len, (char *)resp_data_buf);
+                    PKT_$DUMP_DATA(recv.data_bufs, recv_data_len);
                 }
 
                 /* Check if response matches our request */
                 if (recv_id == request_id) {
                     got_response = (int8_t)0xFF;
+                    *status_ret = status_$ok;
                     goto cleanup;
                 }
+
+                /* Wrong ID - see if anything else is queued */
+                continue;
+            }
+
+            wait_result = EC_$WAITN(ecs, wait_vals, (shared < 0) ? 4 : 3);
+
+            if (wait_result == 2) {
+                /* Timeout */
+                break;
+            }
+
+            if (wait_result == 3) {
+                /* Quit requested */
+                FIM_$QUIT_VALUE[PROC1_$AS_ID] = FIM_$QUIT_EC[PROC1_$AS_ID].count;
+                *status_ret = 0x120010;  /* Quit status */
+                goto cleanup_no_visibility;
             }
 
-            /* Wrong ID or error - continue waiting */
+            /* Socket or reply event - receive again */
         }
 
         /* Timeout - check if we should retry */
@@ -228,6 +237,10 @@ cleanup:
     }
 
 cleanup_no_visibility:
-    /* Close the socket */
-    SOCK_$CLOSE(sock_num);
+    /* Give up the registration, or close our own socket */
+    if (shared < 0) {
+        PKT_$REPLY_CLOSE(&reply);
+    } else {
+        SOCK_$CLOSE(sock_num);
+    }
 }
@@ -32,18 +32,6 @@ void PKT_$SEND_INTERNET(uint32_t routing_key, uint32_t dest_node, uint16_t dest_
                         uint16_t *len_out, void *extra, status_$t *status_ret)
 {
     uint32_t data_buffers[PKT_MAX_DATA_CHUNKS];
-    uint16_t hdr_len[3];
-    int16_t port;
-    uint32_t hdr_buf[64];  /* Header buffer - 256 bytes max */
-    uint32_t hdr_va;
-    uint32_t hdr_pa;
-    status_$t local_status;
-    uint16_t retry_count;
-    uint16_t max_retries;
-    uint16_t param15, param16;
-    uint16_t delay_type;
-    clock_t wait_delay;
-    status_$t wait_status;
 
     data_buffers[0] = 0;
 
@@ -61,6 +49,40 @@ void PKT_$SEND_INTERNET(uint32_t routing_key, uint32_t dest_node, uint16_t dest_
         }
     }
 
+    pkt_$send_buffers(routing_key, dest_node, dest_sock,
+                      src_node_or, src_node, src_sock,
+                      pkt_info, request_id, template, template_len,
+                      data_buffers, data_len, len_out, extra, status_ret);
+
+    /* Release data buffers */
+    PKT_$DUMP_DATA(data_buffers, data_len);
+}
+
+/*
+ * pkt_$send_buffers - Transmit a packet whose data is already in pages
+ *
+ * Steps 3 and 4 above, shared with PKT_$SEND_INTERNET_SG.  The data
+ * buffers are left with the caller.
+ */
+void pkt_$send_buffers(uint32_t routing_key, uint32_t dest_node, uint16_t dest_sock,
+                       int32_t src_node_or, uint32_t src_node, uint16_t src_sock,
+                       void *pkt_info, uint16_t request_id,
+                       void *template, uint16_t template_len,
+                       uint32_t *data_buffers, int16_t data_len,
+                       uint16_t *len_out, void *extra, status_$t *status_ret)
+{
+    uint16_t hdr_len[3];
+    int16_t port;
+    uint32_t hdr_va;
+    uint32_t hdr_pa;
+    status_$t local_status;
+    uint16_t retry_count;
+    uint16_t max_retries;
+    uint16_t param15, param16;
+    uint16_t delay_type;
+    clock_t wait_delay;
+    status_$t wait_status;
+
     /* Get retry count from pkt_info structure */
     /* Offset 0x08 contains retry count; 0 means use default (0xFFFF = unlimited) */
     if (*(int16_t *)((char *)pkt_info + 8) == 0) {
@@ -133,8 +155,5 @@ void PKT_$SEND_INTERNET(uint32_t routing_key, uint32_t dest_node, uint16_t dest_
         NETWORK_$RTNHDR(&hdr_va);
     }
 
-    /* Release data buffers */
-    PKT_$DUMP_DATA(data_buffers, data_len);
-
     *status_ret = local_status;
 }
@@ -0,0 +1,43 @@
+/*
+ * PKT_$SEND_INTERNET_SG - Send an internet packet from existing pages
+ *
+ * PKT_$SEND_INTERNET copies the data into network buffers with
+ * PKT_$COPY_TO_PA before sending.  Callers whose data already sits in
+ * whole physical pages (a page server sending file pages) pass the pages
+ * instead, and the driver DMAs from them: the header is the only thing
+ * built per packet.
+ */
+
+#include "pkt/pkt_internal.h"
+
+void PKT_$SEND_INTERNET_SG(uint32_t routing_key, uint32_t dest_node, uint16_t dest_sock,
+                           int32_t src_node_or, uint32_t src_node, uint16_t src_sock,
+                           void *pkt_info, uint16_t request_id,
+                           void *template, uint16_t template_len,
+                           pkt_$sg_t *data, uint16_t *len_out, void *extra,
+                           status_$t *status_ret)
+{
+    uint32_t data_buffers[PKT_MAX_DATA_CHUNKS];
+    int16_t i;
+
+    if (template_len > 0x200) {
+        *status_ret = status_$network_message_header_too_big;
+        return;
+    }
+
+    if (data->len > PKT_SG_MAX_PAGES * PKT_CHUNK_SIZE) {
+        *status_ret = status_$network_data_length_too_large;
+        return;
+    }
+
+    for (i = 0; i < PKT_MAX_DATA_CHUNKS; i++) {
+        data_buffers[i] = (i < PKT_SG_MAX_PAGES && i * PKT_CHUNK_SIZE < data->len)
+                              ? data->pages[i] : 0;
+    }
+
+    pkt_$send_buffers(routing_key, dest_node, dest_sock,
+                      src_node_or, src_node, src_sock,
+                      pkt_info, request_id, template, template_len,
+                      data_buffers, (int16_t)data->len, len_out, extra,
+                      status_ret);
+}
@@ -14,6 +14,8 @@
 #include "pmap/pmap.h"
 #include "time/time.h"
 #include "misc/misc.h"
+#include "netbuf/netbuf.h"
+#include "ring/ring.h"
 
 #define TS_QUEUE_ELEM_SIZE  12
 
@@ -50,6 +52,8 @@ void PROC1_$UNBIND(uint16_t pid, status_$t *status_ret)
          * Self-termination case
          * Purge working set and suspend ourselves
          */
+        NETBUF_$RTN_MAG(pid);
+        RING_$XMIT_UNBIND(pid, pcb->asid);
         PMAP_$PURGE_WS(pid, 0);
 
         DISABLE_INTERRUPTS(saved_sr);
@@ -86,7 +90,9 @@ void PROC1_$UNBIND(uint16_t pid, status_$t *status_ret)
             }
         }
 
-        /* Purge working set */
+        /* Return its network buffers and purge working set */
+        NETBUF_$RTN_MAG(pid);
+        RING_$XMIT_UNBIND(pid, pcb->asid);
         PMAP_$PURGE_WS(pid, 0);
 
         DISABLE_INTERRUPTS(saved_sr);
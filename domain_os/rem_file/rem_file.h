@@ -481,6 +481,41 @@ void REM_FILE_$NAME_GET_ENTRYU(void *addr_info, uid_t *dir_uid,
                                 char *name, uint16_t name_len,
                                 void *result_out, status_$t *status);
 
+/*
+ * REM_FILE_$RESOLVE_PATHU - Resolve a pathname on a remote server
+ *
+ * Sends the rest of a pathname to the node holding dir_uid, which walks
+ * it locally and answers once, instead of one NAME_GET_ENTRYU round trip
+ * per component.  The server stops early at anything it does not hold
+ * itself (a directory on another node) or cannot walk (a non-directory,
+ * "..", a name too long for one lookup); result->consumed says how many
+ * bytes of path were resolved and the caller continues from there.
+ *
+ * If a lookup fails the status is that of the failing component.
+ * Servers that predate the request are remembered and answered with
+ * file_$bad_reply_received_from_remote_node without asking again.
+ *
+ * @param addr_info      Address info for remote node
+ * @param dir_uid        Directory to start from
+ * @param path           Path (no leading slash needed)
+ * @param path_len       Path length (at most REM_FILE_RESOLVE_PATH_MAX)
+ * @param result         Output: how far the path was resolved
+ * @param status         Output status code
+ */
+#define REM_FILE_RESOLVE_PATH_MAX 256
+
+typedef struct rem_file_$resolve_result_t {
+    uint16_t consumed;      /* Path bytes resolved */
+    uint16_t entry_type;    /* Type of the last entry resolved */
+    uid_t dir_uid;          /* Directory containing it */
+    uid_t entry_uid;        /* Last entry resolved */
+} rem_file_$resolve_result_t;
+
+void REM_FILE_$RESOLVE_PATHU(void *addr_info, uid_t *dir_uid,
+                             char *path, uint16_t path_len,
+                             rem_file_$resolve_result_t *result,
+                             status_$t *status);
+
 /*
  * REM_FILE_$RN_DO_OP - Execute remote naming operation
  *
@@ -50,6 +50,7 @@
 #define REM_FILE_OP_GET_SEG_MAP         0x2A
 #define REM_FILE_OP_UNLOCK_ALL          0x04
 #define REM_FILE_OP_RN_DO_OP            0x80  /* Generic operation marker */
+#define REM_FILE_OP_RESOLVE_PATH        0x2E  /* Walk a multi-component path */
 
 /*
  * Request header (common to all remote file operations)
@@ -69,6 +70,45 @@ typedef struct {
     /* Operation-specific data follows */
 } rem_file_request_hdr_t;
 
+/*
+ * RESOLVE_PATH request and reply (opcode 0x2E / 0x2F)
+ *
+ * The path follows the fixed part in the request itself: at most
+ * 0x78 + REM_FILE_RESOLVE_PATH_MAX bytes, which fits the single header
+ * the server copies requests from.  The server walks it from dir_uid for
+ * as long as each component is a directory it holds itself, and reports
+ * how far it got.
+ */
+typedef struct {
+    uint16_t msg_type;          /* Set to 1 by SEND_REQUEST */
+    uint8_t magic;              /* 0x80 */
+    uint8_t opcode;             /* REM_FILE_OP_RESOLVE_PATH */
+    uid_t dir_uid;              /* 0x04: Directory to start from */
+    uint16_t path_len;          /* 0x0C: Bytes of path */
+    int8_t priv_flag;           /* 0x0E: Caller is privileged */
+    uint8_t pad;
+    uint8_t re_sids[36];        /* 0x10: Caller's SIDs */
+    uid_t proj_list[8];         /* 0x34: Caller's project list */
+    uint8_t proj_extra[2];      /* 0x74 */
+    uint16_t pad2;
+    char path[REM_FILE_RESOLVE_PATH_MAX];  /* 0x78: Path (path_len bytes sent) */
+} rem_file_resolve_path_req_t;
+
+#define REM_FILE_RESOLVE_PATH_FIXED 0x78
+
+typedef struct {
+    uint16_t msg_type;
+    uint8_t magic;
+    uint8_t opcode;             /* REM_FILE_OP_RESOLVE_PATH + 1 */
+    status_$t status;           /* 0x04: Status of the last lookup tried */
+    uint16_t consumed;          /* 0x08: Path bytes resolved */
+    uint16_t entry_type;        /* 0x0A: Type of the last entry resolved */
+    uid_t dir_uid;              /* 0x0C: Directory holding it */
+    uid_t entry_uid;            /* 0x14: Last entry resolved */
+} rem_file_resolve_path_resp_t;
+
+#define REM_FILE_RESOLVE_PATH_REPLY 0x1C
+
 /*
  * Response buffer size
  * Must be at least 0xE4 (228) bytes to accommodate the largest response structures
@@ -142,6 +182,24 @@ void REM_FILE_$SEND_REQUEST(void *addr_info, void *request, int16_t request_len,
                             int16_t *bulk_len, uint16_t *packet_id,
                             status_$t *status_ret);
 
+/*
+ * Server reply cache (reply_cache.c)
+ *
+ * Requests are keyed by (source node, packet ID); see
+ * rem_file_$reply_check for the results.
+ */
+#define REM_FILE_REPLY_MAX      0x108   /* Reply header + 0x100 data */
+
+#define REM_FILE_REPLY_NEW      0       /* Execute it */
+#define REM_FILE_REPLY_RUNNING  1       /* Duplicate of one in progress: drop */
+#define REM_FILE_REPLY_CACHED   2       /* Duplicate of one answered: resend */
+
+int8_t rem_file_$reply_check(uint32_t node_id, uint16_t pkt_id,
+                             void *reply, uint16_t *reply_len);
+void rem_file_$reply_save(uint32_t node_id, uint16_t pkt_id,
+                          void *reply, uint16_t reply_len);
+void rem_file_$reply_forget(uint32_t node_id, uint16_t pkt_id);
+
 /*
  * REM_FILE_$RN_DO_OP - Remote network do operation
  *
@@ -0,0 +1,156 @@
+/*
+ * rem_file_$reply_* - Server duplicate request detection and reply cache
+ *
+ * Clients retransmit a request when its reply is late, and with several
+ * request servers the retransmission can arrive while the original is
+ * still being executed, or after it has been answered.  Re-executing it
+ * is at best wasted work and at worst wrong (a second create, a second
+ * unlock).  The server therefore remembers recent requests by (node,
+ * packet ID):
+ *
+ *   - a duplicate of a request still being executed is dropped; the
+ *     client will retransmit again if the answer is lost too.
+ *   - a duplicate of an answered request gets the saved reply back
+ *     without being executed again.
+ *
+ * Entries are reused least recently used first.  A request whose entry
+ * has been reused before its duplicate arrives is executed again, as it
+ * always was.
+ */
+
+#include "rem_file/rem_file_internal.h"
+#include "ml/ml.h"
+#include "os/os.h"
+
+#define REPLY_CACHE_SIZE    32
+
+#define REPLY_ENTRY_FREE        0
+#define REPLY_ENTRY_RUNNING     1
+#define REPLY_ENTRY_ANSWERED    2
+
+typedef struct {
+    uint32_t node_id;
+    uint16_t pkt_id;
+    uint8_t state;
+    uint8_t pad;
+    uint32_t seq_number;        /* Last use, for replacement */
+    uint16_t reply_len;
+    uint8_t reply[REM_FILE_REPLY_MAX];
+} rem_file_$reply_entry_t;
+
+static rem_file_$reply_entry_t rem_file_$reply_cache[REPLY_CACHE_SIZE];
+static uint32_t rem_file_$reply_seq;
+static uint16_t rem_file_$reply_lock;
+
+/*
+ * rem_file_$reply_check - Look a request up before executing it
+ *
+ * Returns REM_FILE_REPLY_NEW if the request should be executed (it is
+ * then recorded as running), REM_FILE_REPLY_RUNNING if it should be
+ * dropped, or REM_FILE_REPLY_CACHED with the saved reply copied to
+ * reply/reply_len.
+ */
+int8_t rem_file_$reply_check(uint32_t node_id, uint16_t pkt_id,
+                             void *reply, uint16_t *reply_len)
+{
+    ml_$spin_token_t token;
+    rem_file_$reply_entry_t *e;
+    rem_file_$reply_entry_t *victim = NULL;
+    int8_t result;
+    int16_t i;
+
+    token = ML_$SPIN_LOCK(&rem_file_$reply_lock);
+
+    for (i = 0, e = rem_file_$reply_cache; i < REPLY_CACHE_SIZE; i++, e++) {
+        if (e->state != REPLY_ENTRY_FREE &&
+            e->node_id == node_id && e->pkt_id == pkt_id) {
+            break;
+        }
+        /* Running entries are never reused */
+        if (e->state != REPLY_ENTRY_RUNNING &&
+            (victim == NULL || e->seq_number < victim->seq_number)) {
+            victim = e;
+        }
+    }
+
+    if (i < REPLY_CACHE_SIZE) {
+        if (e->state == REPLY_ENTRY_RUNNING) {
+            ML_$SPIN_UNLOCK(&rem_file_$reply_lock, token);
+            return REM_FILE_REPLY_RUNNING;
+        }
+        e->seq_number = ++rem_file_$reply_seq;
+        *reply_len = e->reply_len;
+        OS_$DATA_COPY((char *)e->reply, (char *)reply, e->reply_len);
+        ML_$SPIN_UNLOCK(&rem_file_$reply_lock, token);
+        return REM_FILE_REPLY_CACHED;
+    }
+
+    result = REM_FILE_REPLY_NEW;
+    if (victim != NULL) {
+        victim->node_id = node_id;
+        victim->pkt_id = pkt_id;
+        victim->state = REPLY_ENTRY_RUNNING;
+        victim->reply_len = 0;
+        victim->seq_number = ++rem_file_$reply_seq;
+    }
+
+    ML_$SPIN_UNLOCK(&rem_file_$reply_lock, token);
+    return result;
+}
+
+/*
+ * rem_file_$reply_forget - Drop a request that was executed unanswered
+ *
+ * For requests that get no reply (NODE_CRASH), or whose reply is never
+ * sent; a duplicate is then executed again.
+ */
+void rem_file_$reply_forget(uint32_t node_id, uint16_t pkt_id)
+{
+    ml_$spin_token_t token;
+    rem_file_$reply_entry_t *e;
+    int16_t i;
+
+    token = ML_$SPIN_LOCK(&rem_file_$reply_lock);
+
+    for (i = 0, e = rem_file_$reply_cache; i < REPLY_CACHE_SIZE; i++, e++) {
+        if (e->state == REPLY_ENTRY_RUNNING &&
+            e->node_id == node_id && e->pkt_id == pkt_id) {
+            e->state = REPLY_ENTRY_FREE;
+            break;
+        }
+    }
+
+    ML_$SPIN_UNLOCK(&rem_file_$reply_lock, token);
+}
+
+/*
+ * rem_file_$reply_save - Record the reply to a request being executed
+ *
+ * A reply too long to keep leaves the entry empty, so a duplicate is
+ * executed again.
+ */
+void rem_file_$reply_save(uint32_t node_id, uint16_t pkt_id,
+                          void *reply, uint16_t reply_len)
+{
+    ml_$spin_token_t token;
+    rem_file_$reply_entry_t *e;
+    int16_t i;
+
+    token = ML_$SPIN_LOCK(&rem_file_$reply_lock);
+
+    for (i = 0, e = rem_file_$reply_cache; i < REPLY_CACHE_SIZE; i++, e++) {
+        if (e->state == REPLY_ENTRY_RUNNING &&
+            e->node_id == node_id && e->pkt_id == pkt_id) {
+            if (reply_len > REM_FILE_REPLY_MAX) {
+                e->state = REPLY_ENTRY_FREE;
+            } else {
+                OS_$DATA_COPY((char *)reply, (char *)e->reply, reply_len);
+                e->reply_len = reply_len;
+                e->state = REPLY_ENTRY_ANSWERED;
+            }
+            break;
+        }
+    }
+
+    ML_$SPIN_UNLOCK(&rem_file_$reply_lock, token);
+}
@@ -0,0 +1,138 @@
+/*
+ * REM_FILE_$RESOLVE_PATHU - Resolve a pathname on a remote server
+ *
+ * Client side of the RESOLVE_PATH request: one round trip resolves every
+ * component the server holds, where NAME_GET_ENTRYU takes one per
+ * component.
+ */
+
+#include "rem_file/rem_file_internal.h"
+#include "file/file.h"
+#include "ml/ml.h"
+
+/* proc_priv_table is indexed by PROC1_$CURRENT to check process privileges */
+extern int16_t proc_priv_table[];  /* At 0xe7dacc */
+
+/*
+ * Nodes that answered RESOLVE_PATH with a bad reply (older servers).
+ * Small and overwritten round-robin; a node that is upgraded is tried
+ * again once its slot is reused.
+ */
+#define RESOLVE_OLD_NODES 8
+
+static uint32_t rem_file_$resolve_old_node[RESOLVE_OLD_NODES];
+static uint16_t rem_file_$resolve_old_next;
+static uint16_t rem_file_$resolve_lock;
+
+static int8_t rem_file_$resolve_is_old(uint32_t node)
+{
+    int16_t i;
+
+    for (i = 0; i < RESOLVE_OLD_NODES; i++) {
+        if (rem_file_$resolve_old_node[i] == node) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void rem_file_$resolve_note_old(uint32_t node)
+{
+    ml_$spin_token_t token;
+
+    token = ML_$SPIN_LOCK(&rem_file_$resolve_lock);
+    if (rem_file_$resolve_is_old(node) >= 0) {
+        rem_file_$resolve_old_node[rem_file_$resolve_old_next] = node;
+        rem_file_$resolve_old_next =
+            (rem_file_$resolve_old_next + 1) % RESOLVE_OLD_NODES;
+    }
+    ML_$SPIN_UNLOCK(&rem_file_$resolve_lock, token);
+}
+
+void REM_FILE_$RESOLVE_PATHU(void *addr_info, uid_t *dir_uid,
+                             char *path, uint16_t path_len,
+                             rem_file_$resolve_result_t *result,
+                             status_$t *status)
+{
+    rem_file_resolve_path_req_t request;
+    uint8_t response[REM_FILE_RESPONSE_BUF_SIZE];
+    rem_file_resolve_path_resp_t *resp = (rem_file_resolve_path_resp_t *)response;
+    uint32_t node = ((uint32_t *)addr_info)[1];
+    uint16_t received_len = 0;
+    uint16_t packet_id;
+    uint16_t zero = 0;
+    int i;
+    uint8_t re_sids[40];
+    uint8_t sids_out[36];
+    uid_t proj_list[8];
+    int16_t proj_max = 8;
+    int16_t proj_count;
+
+    result->consumed = 0;
+
+    if (path_len == 0 || path_len > REM_FILE_RESOLVE_PATH_MAX) {
+        *status = file_$bad_reply_received_from_remote_node;
+        return;
+    }
+    if (rem_file_$resolve_is_old(node) < 0) {
+        *status = file_$bad_reply_received_from_remote_node;
+        return;
+    }
+
+    request.magic = 0x80;
+    request.opcode = REM_FILE_OP_RESOLVE_PATH;
+    request.dir_uid = *dir_uid;
+    request.path_len = path_len;
+    request.priv_flag = (proc_priv_table[PROC1_$CURRENT] > 0) ? -1 : 0;
+    request.pad = 0;
+    request.pad2 = 0;
+
+    ACL_$GET_RE_SIDS(re_sids, sids_out, status);
+    if (*status != status_$ok) {
+        return;
+    }
+
+    ACL_$GET_PROJ_LIST(proj_list, &proj_max, &proj_count, status);
+    if (*status != status_$ok) {
+        return;
+    }
+
+    for (i = 0; i < 36; i++) {
+        request.re_sids[i] = sids_out[i];
+    }
+    for (i = 0; i < 8; i++) {
+        request.proj_list[i] = proj_list[i];
+    }
+    /* Project count, big-endian, as ACL_$SET_PROJ_LIST takes it */
+    request.proj_extra[0] = (uint8_t)(proj_count >> 8);
+    request.proj_extra[1] = (uint8_t)proj_count;
+
+    /* The server reads the path from the request, not from data pages */
+    for (i = 0; i < path_len; i++) {
+        request.path[i] = path[i];
+    }
+
+    REM_FILE_$SEND_REQUEST(addr_info, &request,
+                           REM_FILE_RESOLVE_PATH_FIXED + path_len,
+                           NULL, 0,
+                           response, REM_FILE_RESPONSE_BUF_SIZE,
+                           &received_len, &zero, 0,
+                           (int16_t *)&zero, &packet_id,
+                           status);
+
+    if (*status == file_$bad_reply_received_from_remote_node) {
+        rem_file_$resolve_note_old(node);
+        return;
+    }
+
+    /* A failed lookup still reports how far the walk got */
+    if (received_len < REM_FILE_RESOLVE_PATH_REPLY ||
+        resp->consumed > path_len) {
+        return;
+    }
+
+    result->consumed = resp->consumed;
+    result->entry_type = resp->entry_type;
+    result->dir_uid = resp->dir_uid;
+    result->entry_uid = resp->entry_uid;
+}
@@ -7,16 +7,18 @@
  *
  * Protocol flow:
  *   1. Set msg_type = 1 at start of request buffer
- *   2. Allocate a socket, generate packet ID
+ *   2. Generate packet ID, register it on the shared reply socket
+ *      (PKT_$REPLY_OPEN), or allocate a socket if the table is full
  *   3. Send/retry loop (max 60 retries):
  *      - PKT_$SEND_INTERNET to dest_sock=2
- *      - EC_$WAIT on socket EC + TIME_$CLOCKH with computed timeout
+ *      - EC_$WAIT on socket EC + TIME_$CLOCKH with the node's RTT timeout
  *      - On socket event: APP_$RECEIVE, copy header, handle bulk data
- *      - On timeout: check quit signal, probe node visibility
- *      - On busy response (first word 0xFFFF): delay 2 ticks, retry
+ *      - On timeout: check quit signal, back off, probe node visibility
+ *      - On busy response (first word 0xFFFF): delay, doubling from
+ *        2 ticks, retry
  *   4. Validate response[3] == request[3] + 1
  *   5. Extract status from response+4
- *   6. Cleanup: SOCK_$CLOSE, output packet_id
+ *   6. Cleanup: PKT_$REPLY_CLOSE or SOCK_$CLOSE, output packet_id
  *
  * Connection states:
  *   0 = initial (no timeout yet)
@@ -54,6 +56,12 @@ static const status_$t crash_status_split_extra = 0x000F0004;
  */
 #define SEND_REQUEST_MAX_SINGLE     0x200  /* 512 bytes */
 
+/*
+ * Busy delays double from 2 ticks up to this.  Each costs half its
+ * length in retries, so the retry limit still bounds the time spent.
+ */
+#define SEND_REQUEST_BUSY_MAX_TICKS 16
+
 /*
  * Connection state tracking
  */
@@ -95,6 +103,12 @@ void REM_FILE_$SEND_REQUEST(void *addr_info, void *request, int16_t request_len,
     uint32_t hdr_page;          /* local_a0: header page address for RTN_HDR */
     uint32_t bulk_handle;       /* local_9c: bulk data buffer handle */
     uint8_t cleanup_buf[88];    /* auStack_8c: FIM_$CLEANUP handler buffer */
+    uint32_t sent_stamp;        /* PKT_$RTT_STAMP of the last send */
+    int16_t transmits;          /* Sends so far; only the first is timed */
+    uint16_t busy_ticks;        /* Next busy delay */
+    pkt_$reply_t reply;         /* Registration on the shared reply socket */
+    int8_t shared;              /* -1 if sending from the shared socket */
+    int32_t reply_wait_val;     /* Next reply EC value to wait for */
 
     /* APP_$RECEIVE result: local_34 through local_2c */
     uint32_t recv_hdr_ptr;      /* local_34: pointer to received header */
@@ -130,9 +144,22 @@ void REM_FILE_$SEND_REQUEST(void *addr_info, void *request, int16_t request_len,
         split_flag = 1;
     }
 
-    /* Allocate a socket: protocol=3, bufpages=split_flag|0x0400 */
-    {
+    /* Generate packet ID */
+    pkt_id = PKT_$NEXT_ID();
+
+    /*
+     * Send from the shared reply socket, which always has room for bulk
+     * data.  Only if the correlation table is full, allocate a socket:
+     * protocol=3, bufpages=split_flag|0x0400
+     */
+    shared = PKT_$REPLY_OPEN(PKT_REPLY_CHAN_FILE, pkt_id, &reply);
+    if (shared < 0) {
+        sock_num = (int16_t)reply.sock;
+        reply_wait_val = reply.ec->value + 1;
+    } else {
         int8_t result;
+        reply.ec = NULL;
+        reply_wait_val = 0;
         result = SOCK_$ALLOCATE((uint16_t *)&sock_num, 0x30001,
                                 ((uint32_t)split_flag << 16) | 0x0400);
         if (result >= 0) {
@@ -147,11 +174,10 @@ void REM_FILE_$SEND_REQUEST(void *addr_info, void *request, int16_t request_len,
     /* Save current quit value for this address space */
     quit_saved = FIM_$QUIT_VALUE[PROC1_$AS_ID];
 
-    /* Generate packet ID */
-    pkt_id = PKT_$NEXT_ID();
-
     /* Initialize retry counter */
     retry_count = 0;
+    transmits = 0;
+    busy_ticks = 2;
 
     /* Set up send parameters - handle request splitting if needed */
     if (request_len <= SEND_REQUEST_MAX_SINGLE) {
@@ -180,6 +206,8 @@ retry_send:
         }
 
         /* Send the packet to dest_sock=2 (file server socket) */
+        sent_stamp = PKT_$RTT_STAMP();
+        transmits++;
         PKT_$SEND_INTERNET(addr_words[0], addr_words[1],
                            2,              /* dest_sock */
                            -1,             /* src_node_or = use default */
@@ -205,55 +233,47 @@ retry_send:
         }
 
         /* Compute timeout deadline:
-         * TIME_$CLOCKH + per-process timeout base (A5+8) + send overhead (local_c6)
+         * TIME_$CLOCKH + the node's RTT timeout + send overhead (local_c6)
          *
-         * TODO: The per-process timeout base is accessed via A5+8. This is an
-         * A5-relative global in the original Pascal runtime. For now we use 0
-         * as a placeholder - the actual value would come from the process-specific
-         * data area. This needs arch-specific abstraction.
+         * The original used a per-process timeout base (A5+8) in place of
+         * the RTT timeout.
          */
-        timeout_deadline = (int32_t)TIME_$CLOCKH + 0 /* *(uint16_t *)(A5+8) */ + (uint32_t)send_c6;
+        timeout_deadline = (int32_t)TIME_$CLOCKH + PKT_$RTT_TIMEOUT(addr_words[1]) +
+                           (uint32_t)send_c6;
 
         /* Wait loop for response */
         do {
             while (1) {
-                /* EC_$WAIT: wait on socket EC (index 0) and timer (index 1)
-                 *
-                 * Assembly builds the EC array as:
-                 *   ecs[0] = NULL (terminator placeholder, but overwritten)
-                 *   ecs[1] = sock_ec (local_b0)
-                 *   ecs[2] = &TIME_$CLOCKH
-                 *
-                 * wait_vals = sock_ec_wait_val (local_c0) used as the value
-                 * for EC_$WAIT. The array layout is built on stack.
+                /* Wait on the socket EC, the timer and, when sending from
+                 * the shared socket, the request's own EC (EC_$WAITN
+                 * returns the 1-based index of the one satisfied)
                  *
-                 * Returns: 0 = sock event, 1 = timer, 2+ = quit
+                 * The original used EC_$WAIT on the socket EC and timer:
+                 * 0 = sock event, 1 = timer
                  */
-                int16_t which;
+                uint16_t which;
                 do {
                     ec_$eventcount_t *ecs[3];
                     int32_t wait_vals[3];
 
-                    ecs[0] = NULL;
-                    ecs[1] = sock_ec;
-                    ecs[2] = (ec_$eventcount_t *)&TIME_$CLOCKH;
+                    ecs[0] = sock_ec;
+                    ecs[1] = (ec_$eventcount_t *)&TIME_$CLOCKH;
+                    ecs[2] = reply.ec;
 
-                    /* EC_$WAIT uses the wait_val parameter as a pointer to
-                     * an array of int32_t values corresponding to each EC */
-                    wait_vals[0] = 0;
-                    wait_vals[1] = sock_ec_wait_val;
-                    wait_vals[2] = timeout_deadline;
+                    wait_vals[0] = sock_ec_wait_val;
+                    wait_vals[1] = timeout_deadline;
+                    wait_vals[2] = reply_wait_val;
 
-                    which = EC_$WAIT(ecs, (int32_t *)&sock_ec_wait_val);
+                    which = EC_$WAITN(ecs, wait_vals, (shared < 0) ? 3 : 2);
                 } while (0);
 
-                if (which == 0) {
-                    /* Socket event */
+                if (which != 2) {
+                    /* Socket or reply event */
                     break;
                 }
 
-                if (which == 1) {
-                    /* Timeout on quit EC or similar - check quit signal */
+                {
+                    /* Timer - check quit signal */
                     int16_t quit_offset = PROC1_$AS_ID * 12;
                     int32_t *quit_ec_base = (int32_t *)&FIM_$QUIT_EC;
 
@@ -268,6 +288,7 @@ retry_send:
 
                     /* Timeout without quit - add 12 to retry count */
                     retry_count += 12;
+                    PKT_$RTT_NOTE_TIMEOUT(addr_words[1]);
 
                     if (conn_state == CONN_STATE_INITIAL) {
                         conn_state = CONN_STATE_FIRST_TIMEOUT;
@@ -287,12 +308,20 @@ retry_send:
                     /* CONN_STATE_DISKLESS_MOTHER or CONN_STATE_CONFIRMED - just retry */
                     goto retry_send;
                 }
-                /* which == other: shouldn't happen, loop again */
             }
 
-            /* Socket event received - advance wait value and try receive */
-            sock_ec_wait_val++;
-            APP_$RECEIVE(sock_num, &recv_hdr_ptr, &local_status);
+            /* Socket event received - advance wait value and try receive.
+             * On the shared socket other requests' replies advance the
+             * socket EC too, so wait from its current value; ours is
+             * handed over by PKT_$REPLY_RECEIVE. */
+            if (shared < 0) {
+                sock_ec_wait_val = sock_ec->value + 1;
+                reply_wait_val = reply.ec->value + 1;
+                PKT_$REPLY_RECEIVE(&reply, &recv_hdr_ptr, &local_status);
+            } else {
+                sock_ec_wait_val++;
+                APP_$RECEIVE(sock_num, &recv_hdr_ptr, &local_status);
+            }
 
             /* If queue is empty, keep waiting */
             if (local_status == status_$network_buffer_queue_is_empty) {
@@ -407,7 +436,10 @@ retry_send:
             continue;
         }
 
-        /* Response matched our request */
+        /* Response matched our request; time it unless it was resent */
+        if (transmits == 1) {
+            PKT_$RTT_SAMPLE(addr_words[1], sent_stamp);
+        }
 
         /* Update node visibility if this was first response */
         if (conn_state == CONN_STATE_FIRST_TIMEOUT || conn_state == CONN_STATE_INITIAL) {
@@ -418,7 +450,7 @@ retry_send:
         /* Check for busy response (first word of response = 0xFFFF) */
         if (resp_i16[0] == -1) {
             /* Server is busy - increment per-process busy counter (A5+4)
-             * and wait 2 ticks before retrying.
+             * and wait busy_ticks before retrying.
              *
              * TODO: The assembly does addq.l #1,(0x4,A5) which increments
              * a per-process counter. This needs arch-specific abstraction.
@@ -432,12 +464,15 @@ retry_send:
                 timer_ecs[2] = NULL;
 
                 timer_vals[0] = 0;
-                timer_vals[1] = (int32_t)(TIME_$CLOCKH + 2);
+                timer_vals[1] = (int32_t)(TIME_$CLOCKH + busy_ticks);
 
                 /* Wait on just the timer EC (address 0xe2b0d4) */
                 EC_$WAIT(timer_ecs, timer_vals);
             }
-            retry_count += 1;
+            retry_count += busy_ticks >> 1;
+            if (busy_ticks < SEND_REQUEST_BUSY_MAX_TICKS) {
+                busy_ticks <<= 1;
+            }
             goto retry_send;
         }
 
@@ -457,6 +492,10 @@ retry_send:
     *status_ret = file_$comms_problem_with_remote_node;
 
 done:
-    SOCK_$CLOSE(sock_num);
+    if (shared < 0) {
+        PKT_$REPLY_CLOSE(&reply);
+    } else {
+        SOCK_$CLOSE(sock_num);
+    }
     *packet_id = (uint16_t)pkt_id;
 }
@@ -16,6 +16,10 @@
  * - Area management (opcodes 0x86, 0x88, 0x8A)
  * - Node/process management (opcodes 0x00, 0x12, 0x26, 0x7E)
  *
+ * Several request server processes run this concurrently; a request
+ * retransmitted by its client is answered from the reply cache
+ * (reply_cache.c) rather than executed twice.
+ *
  * Protocol:
  * - Requests arrive via APP_$RECEIVE on protocol 2
  * - Request byte 0: message length
@@ -34,6 +38,7 @@
 #include "area/area.h"
 #include "ml/ml.h"
 #include "app/app.h"
+#include "app/app_internal.h"
 #include "netbuf/netbuf.h"
 #include "pkt/pkt.h"
 #include "audit/audit.h"
@@ -64,6 +69,7 @@
 #define SERVER_OP_GENERATE_UID      0x24    /* Generate unique UID */
 #define SERVER_OP_CREATE_PRESR10    0x26    /* Pre-SR10 create */
 #define SERVER_OP_DROP_HARD_LINK    0x28    /* Drop hard link */
+#define SERVER_OP_RESOLVE_PATH      0x2E    /* Walk a multi-component path */
 #define SERVER_OP_CREATE_TYPE       0x7E    /* Create typed object */
 #define SERVER_OP_SET_PROT          0x80    /* Set protection */
 #define SERVER_OP_SET_ATTRIB        0x82    /* Set attribute with SIDs */
@@ -195,8 +201,9 @@ static void server_get_entry(void *request, void *response)
  * Original address: 0x00E62DE8
  *
  * @param stack_frame Parent stack frame pointer
+ * @param reply_len   Reply length, set for the dispatcher
  */
-static void server_set_attribute(uint8_t *stack_frame)
+static void server_set_attribute(uint8_t *stack_frame, uint16_t *reply_len)
 {
     status_$t status;
     uint8_t acl_attrs[12];
@@ -208,7 +215,6 @@ static void server_set_attribute(uint8_t *stack_frame)
     int16_t *attr_type = (int16_t *)(stack_frame - 0x42C);
     uint8_t *attr_value = stack_frame - 0x42A;
     status_$t *status_out = (status_$t *)(stack_frame - 0x19C);
-    uint16_t *reply_len = (uint16_t *)(stack_frame - 0x4C8);
 
     *reply_len = 8;
 
@@ -307,11 +313,11 @@ done:
  * Original address: 0x00E62F54
  *
  * @param stack_frame Parent stack frame pointer
+ * @param reply_len   Reply length, set for the dispatcher
  */
-static void server_get_entry_sids(uint8_t *stack_frame)
+static void server_get_entry_sids(uint8_t *stack_frame, uint16_t *reply_len)
 {
     int16_t request_version = *(int16_t *)(stack_frame - 0x4CA);
-    uint16_t *reply_len = (uint16_t *)(stack_frame - 0x4C8);
     status_$t *status_out = (status_$t *)(stack_frame - 0x19C);
 
     *reply_len = 0x38;
@@ -385,11 +391,11 @@ cleanup:
  * Original address: 0x00E63096
  *
  * @param stack_frame Parent stack frame pointer
+ * @param reply_len   Reply length, set for the dispatcher
  */
-static void server_drop_link(uint8_t *stack_frame)
+static void server_drop_link(uint8_t *stack_frame, uint16_t *reply_len)
 {
     status_$t *status_out = (status_$t *)(stack_frame - 0x19C);
-    uint16_t *reply_len = (uint16_t *)(stack_frame - 0x4C8);
     int8_t admin_flag = *(int8_t *)(stack_frame - 0x406);
     uint8_t saved_sids1[40];
     uint8_t saved_sids2[40];
@@ -458,12 +464,12 @@ cleanup_super:
  * Original address: 0x00E631C2
  *
  * @param stack_frame Parent stack frame pointer
+ * @param reply_len   Reply length, set for the dispatcher
  */
-static void server_truncate_delete(uint8_t *stack_frame)
+static void server_truncate_delete(uint8_t *stack_frame, uint16_t *reply_len)
 {
     status_$t status;
     status_$t *status_out = (status_$t *)(stack_frame - 0x19C);
-    uint16_t *reply_len = (uint16_t *)(stack_frame - 0x4C8);
     uid_t *file_uid = (uid_t *)(stack_frame - 0x434);
     int8_t delete_flag = *(int8_t *)(stack_frame - 0x42C);
     uint8_t *target_uid = stack_frame - 0x104;
@@ -522,11 +528,11 @@ static void server_truncate_delete(uint8_t *stack_frame)
  * Original address: 0x00E632C2
  *
  * @param stack_frame Parent stack frame pointer
+ * @param reply_len   Reply length, set for the dispatcher
  */
-static void server_generate_uid(uint8_t *stack_frame)
+static void server_generate_uid(uint8_t *stack_frame, uint16_t *reply_len)
 {
     status_$t *status_out = (status_$t *)(stack_frame - 0x19C);
-    uint16_t *reply_len = (uint16_t *)(stack_frame - 0x4C8);
     uid_t *result_uid = (uid_t *)(stack_frame - 0x198);
     int16_t *retry_count = (int16_t *)(stack_frame - 0x4C0);
     uid_t generated_uid;
@@ -577,11 +583,11 @@ static void server_generate_uid(uint8_t *stack_frame)
  * Original address: 0x00E63344
  *
  * @param stack_frame Parent stack frame pointer
+ * @param reply_len   Reply length, set for the dispatcher
  */
-static void server_set_prot_attrib(uint8_t *stack_frame)
+static void server_set_prot_attrib(uint8_t *stack_frame, uint16_t *reply_len)
 {
     status_$t *status_out = (status_$t *)(stack_frame - 0x19C);
-    uint16_t *reply_len = (uint16_t *)(stack_frame - 0x4C8);
     int8_t opcode_flag = *(int8_t *)(stack_frame - 0x435);
     int8_t sids_set = 0;
     int8_t proj_set = 0;
@@ -683,6 +689,171 @@ cleanup:
 }
 
 
+/*
+ * server_resolve_path - Walk as much of a pathname as this node holds
+ *
+ * Looks up each component in turn with the caller's SIDs, stopping at
+ * the first one that fails, is not a directory, is "..", or lives on
+ * another node (the client continues from there).  Each name goes
+ * through the same case mapping as a single GET_ENTRY.
+ */
+#define RESOLVE_ENTRY_DIRECTORY 1
+
+static void server_resolve_path(rem_file_resolve_path_req_t *req,
+                                rem_file_resolve_path_resp_t *resp,
+                                uint16_t request_len)
+{
+    struct {
+        int16_t entry_type;
+        uid_t entry_uid;
+        uint32_t extra_info;
+    } entry;
+    struct {
+        char name[40];
+        int16_t name_len;
+    } comp;
+    uint8_t saved_sids1[40];
+    uint8_t saved_sids2[40];
+    uint8_t saved_proj1[16];
+    uint8_t saved_proj2[16];
+    uid_t saved_proj_list[9];
+    uint8_t saved_proj_count[2];
+    int8_t sids_set = 0;
+    int8_t proj_set = 0;
+    uid_t current;
+    uint32_t location;
+    status_$t status;
+    uint16_t path_len;
+    uint16_t pos;
+    uint16_t start;
+    int16_t i;
+
+    resp->consumed = 0;
+    resp->entry_type = RESOLVE_ENTRY_DIRECTORY;
+    resp->dir_uid = req->dir_uid;
+    resp->entry_uid = req->dir_uid;
+
+    path_len = req->path_len;
+    if (path_len > REM_FILE_RESOLVE_PATH_MAX ||
+        request_len < REM_FILE_RESOLVE_PATH_FIXED + path_len) {
+        resp->status = file_$bad_reply_received_from_remote_node;
+        return;
+    }
+
+    /* Take on the caller's identity for the lookups */
+    ACL_$ENTER_SUPER();
+    AUDIT_$SUSPEND();
+
+    ACL_$GET_RE_ALL_SIDS(saved_sids1, saved_sids2, saved_proj1, saved_proj2, &resp->status);
+    if (resp->status != status_$ok) goto cleanup;
+
+    ACL_$GET_PROJ_LIST(saved_proj_list, DAT_00e61718, saved_proj_count, &resp->status);
+    if (resp->status != status_$ok) goto cleanup;
+
+    ACL_$SET_RE_ALL_SIDS(saved_sids1, req->re_sids, saved_proj1, saved_proj2, &resp->status);
+    if (resp->status != status_$ok) goto cleanup;
+    sids_set = -1;
+
+    ACL_$SET_PROJ_LIST(req->proj_list, req->proj_extra, &resp->status);
+    if (resp->status != status_$ok) goto cleanup;
+    proj_set = -1;
+
+    AUDIT_$RESUME();
+    if (req->priv_flag >= 0) {
+        ACL_$EXIT_SUPER();
+    }
+
+    current = req->dir_uid;
+    pos = 0;
+    for (;;) {
+        while (pos < path_len && req->path[pos] == '/') {
+            pos++;
+        }
+        if (pos >= path_len) {
+            resp->consumed = path_len;
+            break;
+        }
+
+        start = pos;
+        while (pos < path_len && req->path[pos] != '/') {
+            pos++;
+        }
+
+        if (pos - start == 1 && req->path[start] == '.') {
+            resp->consumed = pos;
+            continue;
+        }
+        if (pos - start > 32 ||
+            (pos - start == 2 && req->path[start] == '.' && req->path[start + 1] == '.')) {
+            break;
+        }
+
+        comp.name_len = pos - start;
+        for (i = 0; i < comp.name_len; i++) {
+            comp.name[i] = req->path[start + i];
+        }
+        server_unmap_name(&comp, 0, (int)((char *)&comp.name_len - (char *)&comp));
+
+        DIR_$GET_ENTRYU(&current, comp.name, (uint16_t *)&comp.name_len,
+                        &entry, &resp->status);
+        if (resp->status != status_$ok) {
+            break;
+        }
+
+        resp->consumed = pos;
+        resp->entry_type = entry.entry_type;
+        resp->dir_uid = current;
+        resp->entry_uid = entry.entry_uid;
+
+        if (entry.entry_type != RESOLVE_ENTRY_DIRECTORY) {
+            break;
+        }
+
+        /* A directory mounted from another node ends the walk */
+        FILE_$LOCATE(&entry.entry_uid, &location, &status);
+        if (status != status_$ok || (location & 0xFFFFF) != NODE_$ME) {
+            break;
+        }
+
+        current = entry.entry_uid;
+    }
+
+    if (req->priv_flag >= 0) {
+        ACL_$ENTER_SUPER();
+    }
+    AUDIT_$SUSPEND();
+
+cleanup:
+    if (sids_set < 0) {
+        ACL_$SET_RE_ALL_SIDS(saved_sids1, saved_sids2, saved_proj1, saved_proj2, &status);
+    }
+    if (proj_set < 0) {
+        ACL_$SET_PROJ_LIST(saved_proj_list, saved_proj_count, &status);
+    }
+
+    AUDIT_$RESUME();
+    ACL_$EXIT_SUPER();
+}
+
+/*
+ * server_send_reply - Send a reply back to the requesting socket
+ *
+ * The reply carries the request's packet ID, which is what the client
+ * matches it on.
+ */
+static void server_send_reply(uint32_t routing_key, uint32_t node_id,
+                              uint16_t sock, uint16_t pkt_id,
+                              void *reply, uint16_t reply_len)
+{
+    uint16_t len_out;
+    uint16_t extra;
+    status_$t status;
+
+    PKT_$SEND_INTERNET(routing_key, node_id, sock, -1, NODE_$ME, 2,
+                       DAT_00e2e380, pkt_id, reply, reply_len,
+                       NULL, 0, &len_out, &extra, &status);
+}
+
 /*
  * ============================================================================
  * Main Server Dispatcher
@@ -700,9 +871,10 @@ cleanup:
  * Flow:
  * 1. Acquire socket lock
  * 2. Receive request via APP_$RECEIVE
- * 3. Parse request header and dispatch to appropriate handler
- * 4. Format and send response
- * 5. Release socket lock and repeat
+ * 3. Drop or answer from the reply cache if it is a retransmission
+ * 4. Parse request header and dispatch to appropriate handler
+ * 5. Format and send response
+ * 6. Release socket lock and repeat
  *
  * The function is a large dispatcher (~4KB) with inline handling for
  * simple operations and calls to nested helpers for complex ones.
@@ -714,8 +886,15 @@ void REM_FILE_$SERVER(void)
     int8_t has_extra_data = 0;
     uint8_t opcode;
     uint16_t request_len;
-    uint16_t reply_len;
+    uint16_t reply_len = 8;
     uint32_t node_id;
+    uint32_t routing_key;
+    uint16_t reply_sock;
+    uint16_t pkt_id;
+    int16_t data_len;
+    uint32_t hdr_page;
+    int8_t cache_reply = 0;
+    app_receive_result_t recv;
 
     /* Large stack frame for request/response buffers */
     struct {
@@ -741,7 +920,7 @@ void REM_FILE_$SERVER(void)
         uid_t    work_uid;          /* Working UID */
 
         /* Control variables */
-        uint16_t reply_len;         /* -0x4C8: Reply length */
+        uint16_t reply_len;         /* -0x4C8: Reply length (the reply_len local) */
         uint16_t request_len;       /* -0x4CA: Request length */
     } frame;
 
@@ -749,7 +928,7 @@ void REM_FILE_$SERVER(void)
     ML_$EXCLUSION_START(&REM_FILE_$SOCK_LOCK);
 
     /* Receive request */
-    APP_$RECEIVE(2, &frame, &status);
+    APP_$RECEIVE(2, &recv, &status);
 
     if (status == 0x000D0003) {  /* status_$network_buffer_queue_is_empty */
         goto done;
@@ -772,11 +951,37 @@ void REM_FILE_$SERVER(void)
         }
     }
 
+    /*
+     * Where the reply goes, and the packet ID it must carry (read where
+     * SEND_REQUEST reads it from replies)
+     */
+    node_id = ((app_pkt_hdr_t *)recv.hdr_ptr)->src_node;
+    reply_sock = ((app_pkt_hdr_t *)recv.hdr_ptr)->src_sock;
+    routing_key = recv.routing_key;
+    pkt_id = *(uint16_t *)((uint8_t *)recv.hdr_ptr + 6);
+
+    /*
+     * Length of any data pages that came with the request (header offset
+     * 4, where SEND_REQUEST reads it); read before the header goes back
+     */
+    data_len = *(int16_t *)((uint8_t *)recv.hdr_ptr + 4);
+
     /* Validate and copy request data */
+    frame.request_len = *(uint16_t *)((uint8_t *)recv.hdr_ptr + 2);
     request_len = frame.request_len;
     if (request_len > 0x294) {
         request_len = 0x294;
     }
+    OS_$DATA_COPY(recv.data_ptr, (char *)&frame, request_len);
+
+    hdr_page = (uint32_t)recv.data_ptr & 0xFFFFFC00;
+    NETBUF_$RTN_HDR(&hdr_page);
+
+    /*
+     * The request is read from the header page only; give back any data
+     * pages that came with it.
+     */
+    PKT_$DUMP_DATA(recv.data_bufs, data_len);
 
     /* Prepare response header */
     frame.resp_magic = RESPONSE_MAGIC;
@@ -790,6 +995,19 @@ void REM_FILE_$SERVER(void)
         goto send_response;
     }
 
+    /* Packet ID 0 is used by broadcasts, which are never retransmitted */
+    if (pkt_id != 0) {
+        switch (rem_file_$reply_check(node_id, pkt_id, &frame.resp_type, &reply_len)) {
+        case REM_FILE_REPLY_RUNNING:
+            goto done;
+        case REM_FILE_REPLY_CACHED:
+            goto send_response;
+        default:
+            cache_reply = -1;
+            break;
+        }
+    }
+
     /* Release lock for most operations */
     if (frame.opcode != SERVER_OP_NODE_CRASH) {
         ML_$EXCLUSION_STOP(&REM_FILE_$SOCK_LOCK);
@@ -797,7 +1015,6 @@ void REM_FILE_$SERVER(void)
     }
 
     opcode = frame.opcode;
-    node_id = 0;  /* From packet header */
 
     /* Dispatch based on opcode */
     switch (opcode) {
@@ -809,12 +1026,12 @@ void REM_FILE_$SERVER(void)
 
     case SERVER_OP_SET_ATTRIBUTE:
         /* Set file attribute */
-        server_set_attribute((uint8_t *)&frame + sizeof(frame));
+        server_set_attribute((uint8_t *)&frame + sizeof(frame), &reply_len);
         break;
 
     case SERVER_OP_TRUNCATE:
         /* Truncate or delete file */
-        server_truncate_delete((uint8_t *)&frame + sizeof(frame));
+        server_truncate_delete((uint8_t *)&frame + sizeof(frame), &reply_len);
         break;
 
     case SERVER_OP_LOCK:
@@ -941,7 +1158,7 @@ void REM_FILE_$SERVER(void)
 
     case SERVER_OP_GET_ENTRY:
         /* Get directory entry */
-        server_get_entry_sids((uint8_t *)&frame + sizeof(frame));
+        server_get_entry_sids((uint8_t *)&frame + sizeof(frame), &reply_len);
         break;
 
     case SERVER_OP_GET_SEG_MAP:
@@ -987,12 +1204,20 @@ void REM_FILE_$SERVER(void)
 
     case SERVER_OP_GENERATE_UID:
         /* Generate unique UID */
-        server_generate_uid((uint8_t *)&frame + sizeof(frame));
+        server_generate_uid((uint8_t *)&frame + sizeof(frame), &reply_len);
         break;
 
     case SERVER_OP_DROP_HARD_LINK:
         /* Drop hard link */
-        server_drop_link((uint8_t *)&frame + sizeof(frame));
+        server_drop_link((uint8_t *)&frame + sizeof(frame), &reply_len);
+        break;
+
+    case SERVER_OP_RESOLVE_PATH:
+        /* Resolve the rest of a pathname in one reply */
+        server_resolve_path((rem_file_resolve_path_req_t *)&frame,
+                            (rem_file_resolve_path_resp_t *)&frame.resp_type,
+                            request_len);
+        reply_len = REM_FILE_RESOLVE_PATH_REPLY;
         break;
 
     case SERVER_OP_CREATE_PRESR10:
@@ -1029,7 +1254,7 @@ void REM_FILE_$SERVER(void)
     case SERVER_OP_SET_PROT:
     case SERVER_OP_SET_ATTRIB:
         /* Set protection or attribute with SID impersonation */
-        server_set_prot_attrib((uint8_t *)&frame + sizeof(frame));
+        server_set_prot_attrib((uint8_t *)&frame + sizeof(frame), &reply_len);
         break;
 
     case SERVER_OP_CREATE_AREA:
@@ -1071,9 +1296,19 @@ void REM_FILE_$SERVER(void)
 
 send_response:
     /* Send response back to requester */
-    /* (Response sending code would go here - involves SOCK operations) */
+    if (cache_reply < 0) {
+        rem_file_$reply_save(node_id, pkt_id, &frame.resp_type, reply_len);
+        cache_reply = 0;
+    }
+    server_send_reply(routing_key, node_id, reply_sock, pkt_id,
+                      &frame.resp_type, reply_len);
 
 done:
+    /* Executed without a reply: don't leave the entry marked running */
+    if (cache_reply < 0) {
+        rem_file_$reply_forget(node_id, pkt_id);
+    }
+
     /* Release lock if still held */
     if (lock_held < 0) {
         ML_$EXCLUSION_STOP(&REM_FILE_$SOCK_LOCK);
@@ -0,0 +1,310 @@
+/*
+ * RINGLOG_$CAPTURE - Frame capture into a reader-mapped ring
+ *
+ * The ring layout and filter are described in ringlog.h.  The driver
+ * calls RINGLOG_$CAPTURE for each frame while RINGLOG_$CAPTURING; the
+ * rest is called by RINGLOG_$CNTL.
+ *
+ * Frames come from the receive daemons and from every sender, so the
+ * kernel side takes the ringlog spinlock to claim space and copy.  The
+ * reader never takes it: it only reads head and writes tail.
+ *
+ * The ring is written through a global read/write mapping, so starting
+ * a capture needs the caller's own write rights to the object, whatever
+ * its mapping allows.
+ */
+
+#include "ring/ringlog_internal.h"
+#include "file/file.h"
+
+/* Big-endian field of size bytes at hdr + offset */
+static uint32_t ringlog_$cap_load(const uint8_t *p, uint8_t size)
+{
+    uint32_t v = 0;
+
+    while (size-- > 0) {
+        v = (v << 8) | *p++;
+    }
+    return v;
+}
+
+/*
+ * ringlog_$cap_match - Apply the capture filter
+ *
+ * Returns:
+ *   Negative if the frame is to be captured, 0 if not
+ */
+static int8_t ringlog_$cap_match(const ringlog_$cap_filter_t *f, uint8_t flags,
+                                 const uint8_t *hdr, uint16_t hdr_len)
+{
+    const ringlog_$cap_pred_t *p;
+    uint32_t v;
+    int8_t hit;
+    int16_t i;
+
+    if (f->dirs != 0 && (f->dirs & flags) == 0) {
+        return 0;
+    }
+    if (f->n_preds == 0) {
+        return -1;
+    }
+
+    for (i = 0; i < (int16_t)f->n_preds; i++) {
+        p = &f->preds[i];
+        if (p->offset + p->size > hdr_len) {
+            hit = 0;
+        } else {
+            v = ringlog_$cap_load(hdr + p->offset, p->size) & p->mask;
+            switch (p->op) {
+            case RINGLOG_CAP_EQ: hit = (v == p->value); break;
+            case RINGLOG_CAP_NE: hit = (v != p->value); break;
+            case RINGLOG_CAP_LT: hit = (v < p->value); break;
+            default:             hit = (v > p->value); break;
+            }
+        }
+
+        if (f->flags & RINGLOG_CAP_ANY) {
+            if (hit) {
+                return -1;
+            }
+        } else if (!hit) {
+            return 0;
+        }
+    }
+
+    return (f->flags & RINGLOG_CAP_ANY) ? 0 : -1;
+}
+
+void RINGLOG_$CAPTURE(uint16_t unit, uint8_t flags, uint8_t *hdr, uint8_t *data)
+{
+    ringlog_$cap_t *cap = &RINGLOG_$CAP;
+    ringlog_$cap_hdr_t *ch;
+    ringlog_$cap_rec_t *rec;
+    ml_$spin_token_t token;
+    clock_t now;
+    uint16_t hdr_len;
+    uint16_t data_len;
+    uint16_t caplen;
+    uint16_t n;
+    uint32_t reclen;
+    uint32_t head;
+    uint32_t off;
+    uint32_t skip;
+    uint8_t *dst;
+
+    hdr_len = *(uint16_t *)(hdr + RINGLOG_CAP_OFF_HDR_LEN);
+    if (hdr_len > RINGLOG_CAP_HDR_MAX) {
+        hdr_len = RINGLOG_CAP_HDR_MAX;
+    }
+    data_len = 0;
+    if (data != NULL) {
+        data_len = *(uint16_t *)(hdr + RINGLOG_CAP_OFF_DATA_LEN);
+        if (data_len > RINGLOG_CAP_DATA_MAX) {
+            data_len = RINGLOG_CAP_DATA_MAX;
+        }
+    }
+
+    TIME_$CLOCK(&now);
+
+    token = ML_$SPIN_LOCK(&RINGLOG_$CTL.spinlock);
+
+    /* Stopped since the driver looked */
+    if (RINGLOG_$CAPTURING >= 0) {
+        ML_$SPIN_UNLOCK(&RINGLOG_$CTL.spinlock, token);
+        return;
+    }
+
+    ch = cap->hdr;
+    ch->seen++;
+
+    if (ringlog_$cap_match(&cap->filter, flags, hdr, hdr_len) == 0) {
+        ch->filtered++;
+        ML_$SPIN_UNLOCK(&RINGLOG_$CTL.spinlock, token);
+        return;
+    }
+
+    caplen = hdr_len + data_len;
+    if (caplen > cap->snaplen) {
+        caplen = cap->snaplen;
+    }
+    reclen = (sizeof(ringlog_$cap_rec_t) + caplen + 3) & ~3;
+
+    /* A record that would run past the end starts over at the front */
+    head = ch->head;
+    off = head & (cap->size - 1);
+    skip = (cap->size - off < reclen) ? cap->size - off : 0;
+
+    if (skip + reclen > cap->size - (head - ch->tail)) {
+        ch->drops++;
+        ML_$SPIN_UNLOCK(&RINGLOG_$CTL.spinlock, token);
+        return;
+    }
+
+    if (skip != 0) {
+        ((ringlog_$cap_rec_t *)(cap->area + off))->reclen = 0;
+        head += skip;
+        off = 0;
+    }
+
+    rec = (ringlog_$cap_rec_t *)(cap->area + off);
+    rec->reclen = (uint16_t)reclen;
+    rec->caplen = caplen;
+    rec->len = hdr_len + data_len;
+    rec->hdr_len = hdr_len;
+    rec->time_high = now.high;
+    rec->time_low = now.low;
+    rec->unit = (uint8_t)unit;
+    rec->flags = flags;
+
+    dst = (uint8_t *)(rec + 1);
+    n = (caplen < hdr_len) ? caplen : hdr_len;
+    OS_$DATA_COPY((char *)hdr, (char *)dst, n);
+    if (caplen > n) {
+        OS_$DATA_COPY((char *)data, (char *)dst + n, caplen - n);
+    }
+
+    /* Publish only once the record is complete */
+    ch->head = head + reclen;
+
+    ML_$SPIN_UNLOCK(&RINGLOG_$CTL.spinlock, token);
+}
+
+void ringlog_$cap_start(ringlog_$cap_start_t *req, status_$t *status_ret)
+{
+    ringlog_$cap_t *cap = &RINGLOG_$CAP;
+    ringlog_$cap_hdr_t *ch;
+    uint32_t va;
+    uint32_t adjusted;
+    uint32_t start;
+    uint32_t length;
+    uint32_t end;
+    uint32_t size;
+    uint32_t area_size;
+    uint16_t area_id;
+    uint16_t prot_rights;
+    uint8_t rights;
+    int32_t mapped;
+
+    ringlog_$cap_stop();
+
+    length = req->length & ~0x3FF;
+    if (length < RINGLOG_CAP_HDR_SIZE + RINGLOG_CAP_AREA_MIN) {
+        *status_ret = status_$ring_capture_bad_size;
+        return;
+    }
+    if (length > RINGLOG_CAP_PAGES_MAX * 1024) {
+        length = RINGLOG_CAP_PAGES_MAX * 1024;
+    }
+
+    /* The object the caller mapped */
+    va = req->va;
+    MST_$GET_UID(&va, &cap->uid, &adjusted, status_ret);
+    if (*status_ret != status_$ok) {
+        return;
+    }
+
+    /* Write access (mode 2), checked against the ACL: no lock slot */
+    FILE_$CHECK_PROT(&cap->uid, 2, 0, NULL, &prot_rights, status_ret);
+    if (*status_ret != status_$ok) {
+        return;
+    }
+
+    start = 0;
+    area_id = 0;
+    area_size = length;
+    rights = 0x06;              /* Read/write */
+    MST_$MAP_GLOBAL(&cap->uid, &start, &length, &area_id, &area_size,
+                    &rights, &mapped, status_ret);
+    if (*status_ret != status_$ok) {
+        return;
+    }
+
+    /* No page faults in the driver */
+    start = (uint32_t)mapped;
+    end = start + length;
+    cap->wire_count = 0;
+    MST_$WIRE_AREA((void *)(uintptr_t)start, (void *)(uintptr_t)end,
+                   cap->wired_pages, (void *)RINGLOG_CAP_PAGES_MAX,
+                   &cap->wire_count);
+
+    size = RINGLOG_CAP_AREA_MIN;
+    while (size * 2 <= length - RINGLOG_CAP_HDR_SIZE) {
+        size *= 2;
+    }
+
+    ch = (ringlog_$cap_hdr_t *)(uintptr_t)start;
+    ch->magic = RINGLOG_CAP_MAGIC;
+    ch->version = RINGLOG_CAP_VERSION;
+    ch->snaplen = (req->snaplen != 0) ? req->snaplen : RINGLOG_CAP_SNAP_DEFAULT;
+    if (ch->snaplen > RINGLOG_CAP_HDR_MAX + RINGLOG_CAP_DATA_MAX) {
+        ch->snaplen = RINGLOG_CAP_HDR_MAX + RINGLOG_CAP_DATA_MAX;
+    }
+    ch->area = RINGLOG_CAP_HDR_SIZE;
+    ch->size = size;
+    ch->head = 0;
+    ch->tail = 0;
+    ch->seen = 0;
+    ch->filtered = 0;
+    ch->drops = 0;
+
+    cap->hdr = ch;
+    cap->area = (uint8_t *)ch + RINGLOG_CAP_HDR_SIZE;
+    cap->size = size;
+    cap->length = length;
+    cap->snaplen = ch->snaplen;
+
+    RINGLOG_$CAPTURING = (int8_t)0xFF;
+}
+
+void ringlog_$cap_stop(void)
+{
+    ringlog_$cap_t *cap = &RINGLOG_$CAP;
+    ml_$spin_token_t token;
+    status_$t status;
+    int16_t i;
+
+    if (RINGLOG_$CAPTURING >= 0) {
+        return;
+    }
+
+    /* Once this is clear no driver is copying into the ring */
+    token = ML_$SPIN_LOCK(&RINGLOG_$CTL.spinlock);
+    RINGLOG_$CAPTURING = 0;
+    ML_$SPIN_UNLOCK(&RINGLOG_$CTL.spinlock, token);
+
+    for (i = 0; i < cap->wire_count; i++) {
+        WP_$UNWIRE(cap->wired_pages[i]);
+    }
+    cap->wire_count = 0;
+
+    MST_$UNMAP_PRIVI(2, &cap->uid, (uint32_t)(uintptr_t)cap->hdr,
+                     cap->length, 0, &status);
+    cap->hdr = NULL;
+    cap->area = NULL;
+}
+
+void ringlog_$cap_set_filter(ringlog_$cap_filter_t *filter,
+                             status_$t *status_ret)
+{
+    ml_$spin_token_t token;
+    ringlog_$cap_pred_t *p;
+    int16_t i;
+
+    if (filter->n_preds > RINGLOG_CAP_PREDS_MAX) {
+        *status_ret = status_$ring_capture_bad_filter;
+        return;
+    }
+    for (i = 0; i < (int16_t)filter->n_preds; i++) {
+        p = &filter->preds[i];
+        if ((p->size != 1 && p->size != 2 && p->size != 4) ||
+            p->op > RINGLOG_CAP_GT ||
+            p->offset + p->size > RINGLOG_CAP_HDR_MAX) {
+            *status_ret = status_$ring_capture_bad_filter;
+            return;
+        }
+    }
+
+    token = ML_$SPIN_LOCK(&RINGLOG_$CTL.spinlock);
+    RINGLOG_$CAP.filter = *filter;
+    ML_$SPIN_UNLOCK(&RINGLOG_$CTL.spinlock, token);
+}
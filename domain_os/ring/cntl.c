@@ -7,6 +7,8 @@
  */
 
 #include "ring/ringlog_internal.h"
+#include "ring/ring.h"
+#include "acl/acl.h"
 
 /*
  * Wire area descriptors passed to MST_$WIRE_AREA
@@ -26,6 +28,8 @@ static uint32_t ringlog_wire_end = RINGLOG_WIRE_END;
  * Commands 0, 3, 5 initialize and start logging.
  * Commands 1, 4 stop logging.
  * Commands 6, 7, 8 set socket type filters.
+ * Commands 9, 10, 11 control frame capture (capture.c); only the
+ * superuser may start it.
  *
  * Parameters:
  *   cmd_ptr     - Pointer to command code
@@ -122,6 +126,23 @@ void RINGLOG_$CNTL(uint16_t *cmd_ptr, void *param, status_$t *status_ret)
         RINGLOG_$MBX_SOCK = *(int8_t *)param;
         break;
 
+    case RINGLOG_CMD_CAP_START:     /* 9 */
+        /* Sees every frame on the ring, whoever it is for */
+        if (ACL_$IS_SUSER() >= 0) {
+            *status_ret = status_$ring_request_denied;
+            break;
+        }
+        ringlog_$cap_start((ringlog_$cap_start_t *)param, status_ret);
+        break;
+
+    case RINGLOG_CMD_CAP_STOP:      /* 10 */
+        ringlog_$cap_stop();
+        break;
+
+    case RINGLOG_CMD_CAP_FILTER:    /* 11 */
+        ringlog_$cap_set_filter((ringlog_$cap_filter_t *)param, status_ret);
+        break;
+
     default:
         /* Unknown command - do nothing */
         break;
@@ -20,6 +20,11 @@
  */
 ring_global_t RING_$DATA;
 
+/*
+ * Receive polling state for each unit.
+ */
+ring_$rx_poll_t ring_$rx_poll[RING_MAX_UNITS];
+
 /*
  * Network UID for ring interface.
  * This is the public UID that identifies the ring network.
@@ -105,6 +105,8 @@ status_$t RING_$INIT(void *device_info)
     ML_$EXCLUSION_INIT(&unit_data->tx_exclusion);
     ML_$EXCLUSION_INIT(&unit_data->rx_exclusion);
 
+    ring_$xmit_init(unit_num);
+
     /*
      * Clear all channel entries (10 channels, 8 bytes each).
      * The assembly shows a loop clearing byte at offset +0x5A from
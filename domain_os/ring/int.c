@@ -9,6 +9,9 @@
  *   2. Clears the interrupt condition
  *   3. Advances the appropriate event count to wake waiting processes
  *
+ * While a unit's receive daemon is polling, received frames are only
+ * counted on rx_wake_ec; the daemon is running and will see them.
+ *
  * Original address: 0x00E75748
  *
  * Assembly analysis:
@@ -129,6 +132,15 @@ int8_t RING_$INT(void *device_info)
         }
     }
 
+    /*
+     * While the receive daemon is polling it is not waiting: just count
+     * the frame, and leave the waiter scan and the dispatch alone.
+     */
+    if (ec == &unit_data->rx_wake_ec && ring_$rx_poll[unit_num].polling < 0) {
+        ec->value++;
+        return (int8_t)-1;  /* 0xFF */
+    }
+
     /*
      * Advance the event count without calling the dispatcher.
      * This wakes any processes waiting on this event count,
@@ -164,8 +176,9 @@ ec_$eventcount_t *ring_$process_rx_packet(ring_unit_t *unit_data)
      *   3. Determines if packet should be queued or discarded
      *   4. Returns the appropriate event count
      *
-     * For now, return the ready_ec to signal packet arrival.
+     * For now, return rx_wake_ec, which the receive daemon waits on,
+     * to signal packet arrival.
      */
 
-    return &unit_data->ready_ec;
+    return &unit_data->rx_wake_ec;
 }
@@ -2,7 +2,8 @@
  * RING_$IOCTL - I/O control for ring unit
  *
  * Performs I/O control operations on a ring unit.
- * Currently supports command 0: set transmit mask.
+ * The original supports only command 0: set transmit mask.  Commands 1-3
+ * set and report the transmit classes (see ring.h).
  *
  * Original address: 0x00E76B2C
  *
@@ -13,23 +14,25 @@
  */
 
 #include "ring/ring_internal.h"
+#include "os/os.h"
+#include "acl/acl.h"
 
 /*
  * RING_$IOCTL - I/O control
  *
  * @param unit_ptr      Pointer to unit number
  * @param cmd           Pointer to command word
- *                      cmd[0] = command (0 = set tmask)
+ *                      cmd[0] = command (RING_IOCTL_*)
  *                      cmd[1] = parameter (tmask value for cmd 0)
- * @param param         Additional parameter (unused)
+ * @param param         Additional parameter (RING_IOCTL_XMIT_SHAPE and
+ *                      RING_IOCTL_XMIT_STATS)
  * @param status_ret    Output: status code
  */
 void RING_$IOCTL(uint16_t *unit_ptr, int16_t *cmd, void *param,
                  status_$t *status_ret)
 {
     uint16_t unit_num;
-
-    (void)param;
+    uint32_t *shape;
 
     unit_num = *unit_ptr;
 
@@ -45,7 +48,7 @@ void RING_$IOCTL(uint16_t *unit_ptr, int16_t *cmd, void *param,
      * Dispatch based on command.
      */
     switch (cmd[0]) {
-    case 0:
+    case RING_IOCTL_SET_TMASK:
         /*
          * Command 0: Set transmit mask.
          * The new mask value is in cmd[1].
@@ -54,6 +57,39 @@ void RING_$IOCTL(uint16_t *unit_ptr, int16_t *cmd, void *param,
         *status_ret = status_$ok;
         break;
 
+    case RING_IOCTL_XMIT_CLASS:
+        /*
+         * Mark or unmark the caller's address space BULK.  Nothing
+         * else can be asked for: a process may only lower itself.
+         */
+        if (cmd[1] == RING_XMIT_BULK) {
+            ring_$xmit_mark_as(PROC1_$AS_ID, -1);
+        } else if (cmd[1] == RING_XMIT_DEFAULT) {
+            ring_$xmit_mark_as(PROC1_$AS_ID, 0);
+        } else {
+            *status_ret = status_$ring_invalid_ioctl;
+            break;
+        }
+        *status_ret = status_$ok;
+        break;
+
+    case RING_IOCTL_XMIT_SHAPE:
+        /* Sets the rate for every sender on the unit */
+        if (ACL_$IS_SUSER() >= 0) {
+            *status_ret = status_$ring_request_denied;
+            break;
+        }
+        shape = (uint32_t *)param;
+        ring_$xmit_set_shape(unit_num, shape[0], shape[1]);
+        *status_ret = status_$ok;
+        break;
+
+    case RING_IOCTL_XMIT_STATS:
+        OS_$DATA_COPY((char *)ring_$xmit[unit_num].stats, (char *)param,
+                      sizeof(ring_$xmit[unit_num].stats));
+        *status_ret = status_$ok;
+        break;
+
     default:
         /*
          * Unknown command.
@@ -56,6 +56,60 @@ void RING_$RCV1(void)
     /* Never returns */
 }
 
+/*
+ * ring_$rx_wait - Wait for the next received frame
+ *
+ * Sleeping on rx_wake_ec for every frame costs a wakeup and a context
+ * switch per frame.  When the next frame is already in by the time the
+ * daemon has dealt with the last one, the ring is busy: the daemon stops
+ * sleeping and polls rx_wake_ec instead, with RING_$INT no longer waking
+ * it.  A poll that finds nothing for RING_POLL_SPINS goes back to
+ * sleeping on interrupts.  EC_$WAIT checks the count before it sleeps,
+ * so a frame counted while switching back is not lost.
+ *
+ * @param unit          Unit number
+ * @param unit_data     Unit data structure
+ * @param wait_val      rx_wake_ec value that means a frame has arrived
+ */
+static void ring_$rx_wait(uint16_t unit, ring_unit_t *unit_data,
+                          int32_t *wait_val)
+{
+    ring_$rx_poll_t *poll;
+    ring_$stats_t *stats;
+    volatile int32_t *count;
+    int16_t spins;
+
+    poll = &ring_$rx_poll[unit];
+    stats = &RING_$STATS[unit];
+    count = (volatile int32_t *)&unit_data->rx_wake_ec.value;
+
+    if (poll->polling < 0) {
+        for (spins = 0; spins < RING_POLL_SPINS; spins++) {
+            if (*count - *wait_val >= 0) {
+                goto got_frame;
+            }
+        }
+        /* The ring has gone quiet */
+        poll->polling = 0;
+    } else if (*count - *wait_val >= 0) {
+        poll->polling = -1;
+        stats->rx_poll_entries++;
+        goto got_frame;
+    }
+
+    EC_$WAIT((ec_$eventcount_t *[3]){&unit_data->rx_wake_ec, NULL, NULL},
+             wait_val);
+    stats->rx_wakeups++;
+    poll->batch = 0;
+
+got_frame:
+    stats->rx_frames++;
+    poll->batch++;
+    if (poll->batch > stats->rx_max_batch) {
+        stats->rx_max_batch = poll->batch;
+    }
+}
+
 /*
  * RING_$RCV_FROM_UNIT_PRIV - Privileged receive loop
  *
@@ -196,10 +250,10 @@ void RING_$RCV_FROM_UNIT_PRIV(uint16_t unit)
 
         /*
          * Wait for receive event.
-         * This blocks until a packet arrives (interrupt advances rx_wake_ec).
+         * This blocks until a packet arrives (interrupt advances rx_wake_ec),
+         * unless the ring is busy enough that the daemon polls for it.
          */
-        EC_$WAIT((ec_$eventcount_t *[3]){&unit_data->rx_wake_ec, NULL, NULL},
-                 &wait_val);
+        ring_$rx_wait(unit, unit_data, &wait_val);
         wait_val++;
 
         /*
@@ -284,6 +338,12 @@ void RING_$RCV_FROM_UNIT_PRIV(uint16_t unit)
                 data_ptr = (uint32_t)(uintptr_t)unit_data->rx_data_buf;
             }
 
+            if (RINGLOG_$CAPTURING < 0) {
+                RINGLOG_$CAPTURE(unit, RINGLOG_CAP_RCV,
+                                 (uint8_t *)unit_data->rx_hdr_buf,
+                                 (uint8_t *)(uintptr_t)data_ptr);
+            }
+
             /*
              * Dispatch packet to handler.
              */
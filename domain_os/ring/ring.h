@@ -230,7 +230,12 @@ typedef struct ring_$stats_t {
     uint16_t    biphase_count;      /* 0x16: Biphase errors */
     uint16_t    unexpected_count;   /* 0x18: Unexpected status */
     uint16_t    retry_count;        /* 0x1A: Retry attempts */
-    uint8_t     _reserved1[0x18];   /* 0x1C-0x33 */
+    uint8_t     _reserved1[0x04];   /* 0x1C-0x1F */
+    uint32_t    rx_frames;          /* 0x20: Frames taken by receive daemon */
+    uint32_t    rx_wakeups;         /* 0x24: Times receive daemon slept and woke */
+    uint16_t    rx_max_batch;       /* 0x28: Most frames taken per wakeup */
+    uint16_t    rx_poll_entries;    /* 0x2A: Times daemon switched to polling */
+    uint8_t     _reserved1b[0x08];  /* 0x2C-0x33 */
     int8_t      last_success;       /* 0x34: Last transmission succeeded */
     int8_t      _reserved2;         /* 0x35 */
     int8_t      congestion_flag;    /* 0x36: Network congestion */
@@ -356,11 +361,11 @@ void RING_$GET_STATS(uint16_t *unit_ptr, void *stats_buf, uint16_t unused,
 /*
  * RING_$IOCTL - I/O control for ring unit
  *
- * Performs I/O control operations on a ring unit.
- * Currently supports setting the transmit mask.
+ * Performs I/O control operations on a ring unit: setting the transmit
+ * mask, and the transmit class commands below.
  *
  * @param unit_ptr      Pointer to unit number
- * @param cmd           Command (0 = set tmask)
+ * @param cmd           Command (RING_IOCTL_*) and its word argument
  * @param param         Command parameter
  * @param status_ret    Output: status code
  *
@@ -390,6 +395,72 @@ void RING_$SET_TMASK(uint16_t unit, uint16_t mask);
  */
 void RING_$KICK_DRIVER(void);
 
+/*
+ * ============================================================================
+ * Transmit Classes
+ * ============================================================================
+ *
+ * Senders waiting for a unit's transmitter are served by class, highest
+ * first, and in arrival order within a class, so page traffic is never
+ * queued behind a bulk transfer for more than the frame on the wire.
+ * BULK frames are also held to a byte rate with a token bucket: a burst
+ * goes out at once, then the class may run into debt by one frame and
+ * waits for the clock to pay it back.
+ *
+ * Senders take their class from, in order:
+ *   - their address space, if marked BULK with RING_IOCTL_XMIT_CLASS
+ *     (a backup can lower itself; nothing can raise itself)
+ *   - the class they set with RING_$XMIT_SET_CLASS around a send
+ *   - RING_XMIT_NORMAL
+ */
+#define RING_XMIT_DEFAULT       0       /* Class taken from the sender */
+#define RING_XMIT_PAGING        1       /* Page faults and page servers */
+#define RING_XMIT_NORMAL        2
+#define RING_XMIT_BULK          3       /* Rate limited: netlog, backups */
+#define RING_XMIT_CLASSES       3
+
+/* RING_$IOCTL commands */
+#define RING_IOCTL_SET_TMASK    0       /* cmd[1]: transmit mask */
+#define RING_IOCTL_XMIT_CLASS   1       /* cmd[1]: RING_XMIT_BULK or
+                                           RING_XMIT_DEFAULT, for the
+                                           caller's address space */
+#define RING_IOCTL_XMIT_SHAPE   2       /* param: uint32_t[2], BULK bytes
+                                           per second (0 unlimited) and
+                                           burst bytes; superuser only */
+#define RING_IOCTL_XMIT_STATS   3       /* param: ring_$xmit_stats_t
+                                           [RING_XMIT_CLASSES] out, PAGING
+                                           first */
+
+typedef struct ring_$xmit_stats_t {
+    uint32_t    frames;             /* 0x00: Frames sent */
+    uint32_t    bytes;              /* 0x04: Header and data bytes sent */
+    uint32_t    waited;             /* 0x08: Frames queued behind another */
+    uint32_t    shaped;             /* 0x0C: Frames held for the byte rate */
+} ring_$xmit_stats_t;
+
+/*
+ * RING_$XMIT_SET_CLASS - Set the transmit class of the current process
+ *
+ * For kernel code to bracket its sends, restoring the old class after.
+ *
+ * @param xmit_class    RING_XMIT_* (RING_XMIT_DEFAULT to clear)
+ *
+ * Returns:
+ *   The class previously set
+ */
+uint16_t RING_$XMIT_SET_CLASS(uint16_t xmit_class);
+
+/*
+ * RING_$XMIT_UNBIND - Forget a process's transmit class
+ *
+ * Called by PROC1_$UNBIND, so a process or address space reusing the
+ * slot starts out RING_XMIT_NORMAL.
+ *
+ * @param pid           Process being unbound
+ * @param as_id         Its address space ID
+ */
+void RING_$XMIT_UNBIND(uint16_t pid, uint16_t as_id);
+
 /*
  * ============================================================================
  * Service Functions (called via NET_IO dispatch)
@@ -15,6 +15,9 @@
 #include "sock/sock.h"
 #include "pkt/pkt.h"
 #include "fim/fim.h"
+#include "ring/ringlog.h"
+#include "proc1/proc1.h"
+#include "mst/mst.h"
 
 /*
  * ============================================================================
@@ -88,6 +91,58 @@ extern uint16_t ring_dcte_ctype_net;
 extern status_$t No_available_socket_err;
 extern status_$t Network_hardware_error;
 
+/*
+ * Receive polling state, per unit.  While polling is set the receive
+ * daemon looks for frames itself and RING_$INT only counts them on
+ * rx_wake_ec, without waking anyone.
+ */
+typedef struct ring_$rx_poll_t {
+    int8_t      polling;        /* -1 while the daemon is polling */
+    int8_t      _pad;
+    uint16_t    batch;          /* Frames taken since the daemon last slept */
+} ring_$rx_poll_t;
+
+extern ring_$rx_poll_t ring_$rx_poll[RING_MAX_UNITS];
+
+/*
+ * How long the daemon polls for another frame before going back to
+ * sleeping on interrupts: about one full-size frame time.
+ */
+#define RING_POLL_SPINS         0x200
+
+/*
+ * Transmit arbitration and BULK shaping, per unit (see ring.h).
+ *
+ * Each class hands out tickets; a sender with ticket t transmits when
+ * the class's event count reaches t + 1.  The sender leaving the
+ * transmitter advances the highest class with a ticket outstanding, or
+ * marks the transmitter free when none is.
+ */
+#define RING_XMIT_BULK_RATE     0x40000 /* Default BULK bytes per second */
+#define RING_XMIT_BULK_BURST    0x4000  /* Default BULK burst bytes */
+
+/* PROC1_$TYPE of the network processes, which shaping never puts to sleep */
+#define RING_NETWORK_PROC_TYPE  7
+
+typedef struct ring_$xmit_queue_t {
+    ec_$eventcount_t    ec;         /* Advanced once per grant */
+    int32_t             tickets;    /* Tickets handed out */
+} ring_$xmit_queue_t;
+
+typedef struct ring_$xmit_t {
+    ring_$xmit_queue_t  queues[RING_XMIT_CLASSES]; /* PAGING first */
+    int8_t              busy;       /* -1 while a sender has the transmitter */
+    int8_t              _pad;
+    uint16_t            _pad2;
+    int32_t             tokens;     /* BULK byte credit, negative in debt */
+    uint32_t            refilled;   /* TIME_$CLOCKH tokens last added */
+    uint32_t            rate;       /* BULK bytes per tick, 0 unlimited */
+    uint32_t            burst;      /* Most credit saved up */
+    ring_$xmit_stats_t  stats[RING_XMIT_CLASSES];
+} ring_$xmit_t;
+
+extern ring_$xmit_t ring_$xmit[RING_MAX_UNITS];
+
 /* Internal counters */
 #define RING_$RCV_INT_CNT       (RING_$DATA.rcv_int_cnt)
 #define RING_$WAKEUP_CNT        (RING_$DATA.wakeup_cnt)
@@ -282,6 +337,30 @@ void ring_$disable_interrupts(void);
  */
 uint8_t HDR_CHKSUM(void *hdr, void *data);
 
+/* Set up a unit's transmit arbiter, with the default BULK rate */
+void ring_$xmit_init(uint16_t unit);
+
+/*
+ * ring_$xmit_start - Wait for the unit's transmitter
+ *
+ * Classifies the current sender, holds BULK frames to the byte rate,
+ * and returns once the sender has the transmitter.  Every call must be
+ * matched by ring_$xmit_done.
+ *
+ * @param unit          Unit number
+ * @param len           Bytes about to be sent
+ */
+void ring_$xmit_start(uint16_t unit, uint16_t len);
+
+/* Give up the transmitter to the next sender */
+void ring_$xmit_done(uint16_t unit);
+
+/* Set the BULK byte rate (bytes per second, 0 unlimited) and burst */
+void ring_$xmit_set_shape(uint16_t unit, uint32_t rate, uint32_t burst);
+
+/* Mark an address space's frames BULK (bulk negative) or not */
+void ring_$xmit_mark_as(uint16_t as_id, int8_t bulk);
+
 /*
  * ============================================================================
  * External Functions Used by Ring
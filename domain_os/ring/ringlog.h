@@ -11,6 +11,7 @@
  * - Filtering by socket type (NIL, WHO, MBX)
  * - Start/stop control
  * - Buffer retrieval for analysis
+ * - Capture of whole frames into a ring the reader maps
  *
  * Original memory layout (m68k):
  *   - Control data at 0xE2C32C
@@ -49,6 +50,15 @@
 #define RINGLOG_CMD_SET_NIL_SOCK    6   /* Set NIL socket filter */
 #define RINGLOG_CMD_SET_WHO_SOCK    7   /* Set WHO socket filter */
 #define RINGLOG_CMD_SET_MBX_SOCK    8   /* Set MBX socket filter */
+#define RINGLOG_CMD_CAP_START       9   /* Start capturing into a mapped ring */
+#define RINGLOG_CMD_CAP_STOP        10  /* Stop capturing */
+#define RINGLOG_CMD_CAP_FILTER      11  /* Set the capture filter */
+
+/*
+ * Capture status codes (ring subsystem)
+ */
+#define status_$ring_capture_bad_size       0x0031000F
+#define status_$ring_capture_bad_filter     0x00310010
 
 /*
  * Socket type IDs for filtering
@@ -64,6 +74,125 @@
 #define RINGLOG_FLAG_SEND       0x02    /* Entry is for a send (vs receive) */
 #define RINGLOG_FLAG_INBOUND    0x08    /* Packet was inbound */
 
+/*
+ * ============================================================================
+ * Packet Capture
+ * ============================================================================
+ * The log above keeps a few bytes of the last 100 packets.  Capture keeps
+ * whole frames, header and data up to a snap length, in a ring the
+ * reader maps.
+ *
+ * The reader creates and maps a file, then passes the address and length
+ * of its mapping to RINGLOG_CMD_CAP_START.  The kernel maps the same
+ * object in global space and wires it, so a frame is copied once, by
+ * the driver, into pages the reader already sees.
+ *
+ * The first RINGLOG_CAP_HDR_SIZE bytes of the object hold a
+ * ringlog_$cap_hdr_t.  The records follow, in an area of `size` bytes,
+ * a power of two.  `head` and `tail` count bytes ever written and ever
+ * consumed; the kernel only writes head, the reader only writes tail.
+ * The kernel fills a record before it moves head past it, so the reader
+ * needs no lock.  A frame that will not fit between head and tail is
+ * dropped and counted.
+ *
+ * Each record is a ringlog_$cap_rec_t followed by caplen bytes of frame,
+ * padded to 4 bytes.  A record never wraps: where one would, reclen is
+ * left 0 and the rest of the area is skipped.
+ */
+
+#define RINGLOG_CAP_MAGIC       0x52434150  /* "RCAP" */
+#define RINGLOG_CAP_VERSION     1
+#define RINGLOG_CAP_HDR_SIZE    1024        /* Header page */
+#define RINGLOG_CAP_AREA_MIN    0x1000      /* Smallest record area */
+#define RINGLOG_CAP_PAGES_MAX   257         /* Header page and 256K of records */
+#define RINGLOG_CAP_SNAP_DEFAULT 128
+#define RINGLOG_CAP_HDR_MAX     0x3C8       /* Longest frame header */
+#define RINGLOG_CAP_DATA_MAX    0x400       /* Longest frame data */
+
+/* Record flags */
+#define RINGLOG_CAP_SEND        0x01
+#define RINGLOG_CAP_RCV         0x02
+
+typedef struct ringlog_$cap_hdr_t {
+    uint32_t    magic;          /* 0x00: RINGLOG_CAP_MAGIC */
+    uint16_t    version;        /* 0x04: RINGLOG_CAP_VERSION */
+    uint16_t    snaplen;        /* 0x06: Most frame bytes kept */
+    uint32_t    area;           /* 0x08: Offset of the record area */
+    uint32_t    size;           /* 0x0C: Bytes in the record area */
+    volatile uint32_t head;     /* 0x10: Bytes written (kernel) */
+    volatile uint32_t tail;     /* 0x14: Bytes consumed (reader) */
+    uint32_t    seen;           /* 0x18: Frames offered */
+    uint32_t    filtered;       /* 0x1C: Frames the filter refused */
+    uint32_t    drops;          /* 0x20: Frames with no room */
+} ringlog_$cap_hdr_t;
+
+typedef struct ringlog_$cap_rec_t {
+    uint16_t    reclen;         /* 0x00: Record bytes, 0 = skip to start */
+    uint16_t    caplen;         /* 0x02: Frame bytes that follow */
+    uint16_t    len;            /* 0x04: Frame bytes on the wire */
+    uint16_t    hdr_len;        /* 0x06: Of those, header bytes */
+    uint32_t    time_high;      /* 0x08: TIME_$CLOCK when captured */
+    uint16_t    time_low;       /* 0x0C */
+    uint8_t     unit;           /* 0x0E: Ring unit */
+    uint8_t     flags;          /* 0x0F: RINGLOG_CAP_SEND or _RCV */
+} ringlog_$cap_rec_t;
+
+/*
+ * Capture filter
+ *
+ * Up to RINGLOG_CAP_PREDS_MAX predicates on the frame header, evaluated
+ * by the driver before anything is copied.  Each loads a big-endian
+ * field of 1, 2 or 4 bytes at a header offset, masks it and compares it
+ * with a value.  A frame passes if every predicate holds, or with
+ * RINGLOG_CAP_ANY if any one does; with none, every frame passes.  A
+ * predicate on bytes beyond the header does not hold.
+ *
+ * Offsets of the fields usually wanted, for internet headers
+ * (routing type 4 at RINGLOG_CAP_OFF_ROUTING):
+ */
+#define RINGLOG_CAP_OFF_DEST_NODE   0x00    /* 4 bytes, mask 0x000FFFFF */
+#define RINGLOG_CAP_OFF_SRC_NODE    0x08    /* 4 bytes, mask 0x000FFFFF */
+#define RINGLOG_CAP_OFF_HDR_LEN     0x10    /* 2 bytes */
+#define RINGLOG_CAP_OFF_DATA_LEN    0x14    /* 2 bytes */
+#define RINGLOG_CAP_OFF_ROUTING     0x19    /* 1 byte */
+#define RINGLOG_CAP_OFF_TYPE        0x28    /* 2 bytes, packet type */
+#define RINGLOG_CAP_OFF_DEST_SOCK   0x38    /* 2 bytes */
+#define RINGLOG_CAP_OFF_SRC_SOCK    0x44    /* 2 bytes */
+
+#define RINGLOG_CAP_PREDS_MAX   8
+
+/* Comparisons */
+#define RINGLOG_CAP_EQ          0
+#define RINGLOG_CAP_NE          1
+#define RINGLOG_CAP_LT          2       /* Unsigned */
+#define RINGLOG_CAP_GT          3       /* Unsigned */
+
+/* Filter flags */
+#define RINGLOG_CAP_ANY         0x0001  /* Any predicate, not all */
+
+typedef struct ringlog_$cap_pred_t {
+    uint16_t    offset;         /* 0x00: Header offset */
+    uint8_t     size;           /* 0x02: 1, 2 or 4 */
+    uint8_t     op;             /* 0x03: RINGLOG_CAP_EQ etc. */
+    uint32_t    mask;           /* 0x04 */
+    uint32_t    value;          /* 0x08 */
+} ringlog_$cap_pred_t;
+
+typedef struct ringlog_$cap_filter_t {
+    uint16_t    n_preds;        /* 0x00 */
+    uint8_t     flags;          /* 0x02: RINGLOG_CAP_ANY */
+    uint8_t     dirs;           /* 0x03: RINGLOG_CAP_SEND | _RCV, 0 = both */
+    ringlog_$cap_pred_t preds[RINGLOG_CAP_PREDS_MAX];
+} ringlog_$cap_filter_t;
+
+/* Parameter of RINGLOG_CMD_CAP_START */
+typedef struct ringlog_$cap_start_t {
+    uint32_t    va;             /* 0x00: Caller's mapping, object offset 0 */
+    uint32_t    length;         /* 0x04: Bytes mapped */
+    uint16_t    snaplen;        /* 0x08: 0 = RINGLOG_CAP_SNAP_DEFAULT */
+    uint16_t    pad;
+} ringlog_$cap_start_t;
+
 /*
  * ============================================================================
  * Public Functions
@@ -103,6 +232,8 @@ int16_t RINGLOG_$LOGIT(uint8_t *header_info, void *pkt_info);
  *                 - cmd 5: Pointer to network ID filter value
  *                 - cmd 6-8: Pointer to filter enable flag (0 = filter, -1 = don't)
  *                 - cmd 0-2: Receives buffer copy (must be RINGLOG_BUFFER_SIZE+2 bytes)
+ *                 - cmd 9: Pointer to ringlog_$cap_start_t
+ *                 - cmd 11: Pointer to ringlog_$cap_filter_t
  *   status_ret  - Pointer to receive status code
  *
  * Commands:
@@ -115,6 +246,10 @@ int16_t RINGLOG_$LOGIT(uint8_t *header_info, void *pkt_info);
  *   6 - Set NIL socket filter (param = filter flag)
  *   7 - Set WHO socket filter (param = filter flag)
  *   8 - Set MBX socket filter (param = filter flag)
+ *   9 - Start capturing into the caller's mapped ring (superuser only,
+ *       and the caller must be able to write the ring object)
+ *  10 - Stop capturing
+ *  11 - Set the capture filter
  *
  * Original address: 0x00E72226
  */
@@ -130,4 +265,23 @@ void RINGLOG_$CNTL(uint16_t *cmd_ptr, void *param, status_$t *status_ret);
  */
 void RINGLOG_$STOP_LOGGING(void);
 
+/*
+ * RINGLOG_$CAPTURE - Capture a frame
+ *
+ * Called by the driver for each frame sent or received while
+ * RINGLOG_$CAPTURING.  Applies the capture filter and copies the frame
+ * into the capture ring.  The header and data lengths are taken from
+ * the frame header.
+ *
+ * Parameters:
+ *   unit   - Ring unit
+ *   flags  - RINGLOG_CAP_SEND or RINGLOG_CAP_RCV
+ *   hdr    - Frame header
+ *   data   - Frame data, or NULL
+ */
+void RINGLOG_$CAPTURE(uint16_t unit, uint8_t flags, uint8_t *hdr, uint8_t *data);
+
+/* Negative while capturing */
+extern int8_t RINGLOG_$CAPTURING;
+
 #endif /* RINGLOG_H */
@@ -56,3 +56,9 @@ ringlog_buffer_t RINGLOG_$BUF = {
     .current_index = 0,
     .entries = {{0}},
 };
+
+/*
+ * Frame capture state; see capture.c.
+ */
+ringlog_$cap_t RINGLOG_$CAP;
+int8_t RINGLOG_$CAPTURING = 0;
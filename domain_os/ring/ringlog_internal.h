@@ -12,6 +12,8 @@
 #include "ml/ml.h"
 #include "mst/mst.h"
 #include "wp/wp.h"
+#include "time/time.h"
+#include "os/os.h"
 
 /*
  * ============================================================================
@@ -211,6 +213,37 @@ extern ringlog_buffer_t RINGLOG_$BUF;
 #define RINGLOG_$MBX_SOCK       (RINGLOG_$CTL.mbx_sock_filter)
 #define RING_$LOGGING_NOW       (RINGLOG_$CTL.logging_active)
 
+/*
+ * ============================================================================
+ * Capture State
+ * ============================================================================
+ * hdr and area are the kernel's global mapping of the reader's ring
+ * object.  The fields other than active are set while it is 0.
+ */
+typedef struct ringlog_$cap_t {
+    ringlog_$cap_hdr_t *hdr;    /* Shared header */
+    uint8_t     *area;          /* Record area */
+    uint32_t    size;           /* Bytes in the area, a power of two */
+    uint32_t    length;         /* Bytes mapped */
+    uint16_t    snaplen;
+    int16_t     wire_count;
+    uid_t       uid;            /* Ring object */
+    ringlog_$cap_filter_t filter;
+    uint32_t    wired_pages[RINGLOG_CAP_PAGES_MAX];
+} ringlog_$cap_t;
+
+extern ringlog_$cap_t RINGLOG_$CAP;
+
+/*
+ * ringlog_$cap_start - RINGLOG_CMD_CAP_START
+ * ringlog_$cap_stop - RINGLOG_CMD_CAP_STOP; also called on a new start
+ * ringlog_$cap_set_filter - RINGLOG_CMD_CAP_FILTER
+ */
+void ringlog_$cap_start(ringlog_$cap_start_t *req, status_$t *status_ret);
+void ringlog_$cap_stop(void);
+void ringlog_$cap_set_filter(ringlog_$cap_filter_t *filter,
+                             status_$t *status_ret);
+
 /*
  * ============================================================================
  * Wire area parameters (passed to MST_$WIRE_AREA)
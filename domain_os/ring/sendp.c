@@ -31,6 +31,7 @@
  *
  * Transmits a packet on the specified ring unit. Handles:
  *   - Hardware busy/congestion conditions
+ *   - Turns at the transmitter by class (see xmit.c)
  *   - DMA setup for header and data
  *   - Retry logic for transient failures
  *   - Statistics updates
@@ -111,6 +112,12 @@ void RING_$SENDP(uint16_t *unit_ptr, uint32_t hdr_pa, void *hdr_va,
     /* Get hardware registers */
     hw_regs = (int16_t *)unit_data->hw_regs;
 
+    /*
+     * Wait for this sender's turn at the transmitter; released after
+     * transmit_done.
+     */
+    ring_$xmit_start(unit, (uint16_t)(data_info & 0xFFFF) + data_len);
+
     /*
      * Check if hardware is busy.
      * hw_regs[3] & 0x2000 indicates busy state.
@@ -118,6 +125,7 @@ void RING_$SENDP(uint16_t *unit_ptr, uint32_t hdr_pa, void *hdr_va,
     if ((hw_regs[3] & RING_HW_STATUS_BUSY) == 0) {
         /* Hardware is busy - set flag */
         result_bytes[1] |= 0x10;
+        ring_$xmit_done(unit);
         return;
     }
 
@@ -158,6 +166,22 @@ void RING_$SENDP(uint16_t *unit_ptr, uint32_t hdr_pa, void *hdr_va,
         *((uint8_t *)hdr_va + 0xd) = 1;
     }
 
+    /*
+     * Capture the frame once, not per retry.  The data is known here only
+     * by its physical address; network buffers are globally mapped.
+     */
+    if (RINGLOG_$CAPTURING < 0) {
+        uint8_t *data_va = NULL;
+
+        if (data_len != 0) {
+            uint32_t va = MMU_$PTOV(local_data_pa >> 10);
+            if (va != 0) {
+                data_va = (uint8_t *)(uintptr_t)(va + (local_data_pa & 0x3FF));
+            }
+        }
+        RINGLOG_$CAPTURE(unit, RINGLOG_CAP_SEND, (uint8_t *)hdr_va, data_va);
+    }
+
     /*
      * Main transmit loop with retry logic.
      */
@@ -471,4 +495,6 @@ transmit_done:
 
     /* Store send flag byte */
     stats->biphase_flag = ((uint8_t *)send_flags)[1];
+
+    ring_$xmit_done(unit);
 }
@@ -0,0 +1,533 @@
+/*
+ * Unit tests for ring frame capture (RINGLOG_$CAPTURE)
+ *
+ * Tests that captured frames reach the reader's ring whole and in
+ * order across wraps, that frames with no room are counted as drops,
+ * the snap length, the filter predicates, and that a caller without
+ * write rights to the object cannot start one.  Linked against
+ * capture.c; the mapping, wiring and rights calls, clock and copy are
+ * mocked,
+ * and the tests read the ring back the way a reader does, from head
+ * and tail.
+ *
+ * The ring object is addressed by 32-bit virtual addresses, so the
+ * tests map it at a fixed low address (TEST_OBJ_MAP) before use.
+ */
+
+#include "ring/ringlog_internal.h"
+#include "file/file.h"
+
+#define TEST_OBJ_MAP    0x31000000
+#define TEST_OBJ_SIZE   (RINGLOG_CAP_PAGES_MAX * 1024)
+
+/*
+ * Host mmap; <sys/mman.h> clashes with base.h's size_t.  Flags are the
+ * Linux values (PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_FIXED|MAP_ANONYMOUS).
+ */
+extern void *mmap(void *addr, unsigned long len, int prot, int flags,
+                  int fd, long off);
+#define TEST_PROT_RW    0x03
+#define TEST_MAP_FLAGS  0x32
+
+/* Storage normally defined in ringlog_data.c */
+ringlog_ctl_t RINGLOG_$CTL;
+ringlog_$cap_t RINGLOG_$CAP;
+int8_t RINGLOG_$CAPTURING;
+
+/* Mock state tracking */
+static uint8_t *object = (uint8_t *)TEST_OBJ_MAP;
+static uint32_t ticks;
+static int unmaps;
+static int maps;
+static uint16_t prot_mode;              /* Access FILE_$CHECK_PROT was asked for */
+static status_$t prot_status;           /* What it answers */
+
+ml_$spin_token_t ML_$SPIN_LOCK(void *lockp) { (void)lockp; return 0; }
+void ML_$SPIN_UNLOCK(void *lockp, ml_$spin_token_t token) { (void)lockp; (void)token; }
+void WP_$UNWIRE(uint32_t wired_addr) { (void)wired_addr; }
+
+void TIME_$CLOCK(clock_t *clock)
+{
+    clock->high = ticks >> 16;
+    clock->low = (uint16_t)ticks++;
+}
+
+void OS_$DATA_COPY(const void *src, void *dst, uint32_t len)
+{
+    memcpy(dst, src, len);
+}
+
+void MST_$GET_UID(uint32_t *va_ptr, uid_t *uid_out, uint32_t *adjusted_va,
+                  status_$t *status_ret)
+{
+    uid_out->high = 0x1234;
+    uid_out->low = *va_ptr;
+    *adjusted_va = *va_ptr;
+    *status_ret = status_$ok;
+}
+
+/* The global mapping is the same pages as the reader's */
+void MST_$MAP_GLOBAL(uid_t *uid, uint32_t *start_va_ptr, uint32_t *length_ptr,
+                     uint16_t *area_id_ptr, uint32_t *area_size_ptr,
+                     uint8_t *rights_ptr, int32_t *mapped_len,
+                     status_$t *status_ret)
+{
+    maps++;
+    *mapped_len = (int32_t)uid->low;
+    *status_ret = status_$ok;
+}
+
+int16_t FILE_$CHECK_PROT(uid_t *file_uid, uint16_t access_mask, uint32_t slot_num,
+                         void *unused, uint16_t *rights_out, status_$t *status_ret)
+{
+    (void)file_uid; (void)slot_num; (void)unused;
+    prot_mode = access_mask;
+    *rights_out = 0;
+    *status_ret = prot_status;
+    return 0;
+}
+
+void MST_$WIRE_AREA(void *start, void *end, void *buf1, void *param4, void *buf2)
+{
+    uint32_t *pages = buf1;
+    uint32_t a;
+    int16_t n = 0;
+
+    for (a = (uint32_t)(uintptr_t)start; a < (uint32_t)(uintptr_t)end; a += 1024) {
+        pages[n++] = a;
+    }
+    *(int16_t *)buf2 = n;
+}
+
+void MST_$UNMAP_PRIVI(int16_t mode, uid_t *uid, uint32_t start, uint32_t size,
+                      uint16_t asid, status_$t *status_ret)
+{
+    unmaps++;
+    *status_ret = status_$ok;
+}
+
+#define HDR_LEN 0x48
+
+static uint8_t frame_hdr[RINGLOG_CAP_HDR_MAX];
+static uint8_t frame_data[RINGLOG_CAP_DATA_MAX];
+
+static void put16(uint8_t *p, uint16_t v) { p[0] = v >> 8; p[1] = (uint8_t)v; }
+static void put32(uint8_t *p, uint32_t v) { put16(p, v >> 16); put16(p + 2, (uint16_t)v); }
+
+/*
+ * A frame from src to dest; the lengths are in host order, as capture.c
+ * reads them natively, the rest big-endian as on the wire.  Every byte
+ * of the data carries seq so a reader can check it.
+ */
+static void make_frame(uint32_t seq, uint32_t dest, uint32_t src, uint16_t type,
+                       uint16_t sock, uint16_t data_len)
+{
+    memset(frame_hdr, 0, sizeof(frame_hdr));
+    put32(frame_hdr + RINGLOG_CAP_OFF_DEST_NODE, dest);
+    put32(frame_hdr + RINGLOG_CAP_OFF_SRC_NODE, src);
+    *(uint16_t *)(frame_hdr + RINGLOG_CAP_OFF_HDR_LEN) = HDR_LEN;
+    *(uint16_t *)(frame_hdr + RINGLOG_CAP_OFF_DATA_LEN) = data_len;
+    put16(frame_hdr + RINGLOG_CAP_OFF_TYPE, type);
+    put16(frame_hdr + RINGLOG_CAP_OFF_DEST_SOCK, sock);
+    put32(frame_hdr + 0x40, seq);
+    memset(frame_data, (uint8_t)seq, data_len);
+}
+
+static void start(uint32_t length, uint16_t snaplen)
+{
+    static int mapped;
+    ringlog_$cap_start_t req;
+    ringlog_$cap_filter_t none;
+    status_$t st;
+
+    if (!mapped) {
+        mmap(object, TEST_OBJ_SIZE, TEST_PROT_RW, TEST_MAP_FLAGS, -1, 0);
+        mapped = 1;
+    }
+    memset(object, 0xEE, TEST_OBJ_SIZE);
+    req.va = (uint32_t)(uintptr_t)object;
+    req.length = length;
+    req.snaplen = snaplen;
+    req.pad = 0;
+    ringlog_$cap_start(&req, &st);
+
+    memset(&none, 0, sizeof(none));
+    ringlog_$cap_set_filter(&none, &st);
+}
+
+/*
+ * The reader: the next record at tail, or NULL if the ring is empty.
+ * consume() then moves tail past it.
+ */
+static ringlog_$cap_rec_t *next_rec(ringlog_$cap_hdr_t *h)
+{
+    ringlog_$cap_rec_t *r;
+
+    for (;;) {
+        if (h->tail == h->head) {
+            return NULL;
+        }
+        r = (ringlog_$cap_rec_t *)(object + h->area + (h->tail & (h->size - 1)));
+        if (r->reclen != 0) {
+            return r;
+        }
+        h->tail += h->size - (h->tail & (h->size - 1));
+    }
+}
+
+static void consume(ringlog_$cap_hdr_t *h, ringlog_$cap_rec_t *r)
+{
+    h->tail += r->reclen;
+}
+
+/*
+ * Test: Ring sizes
+ * Expected: The record area is the largest power of two that fits after
+ * the header, the snap length is clamped, and every page is wired
+ */
+void test_capture_start_sizes_area(void)
+{
+    ringlog_$cap_hdr_t *h = (ringlog_$cap_hdr_t *)object;
+
+    start(1024 + 0x1000, 0);
+    ASSERT_EQ(RINGLOG_$CAPTURING < 0, 1);
+    ASSERT_EQ(h->magic, RINGLOG_CAP_MAGIC);
+    ASSERT_EQ(h->area, RINGLOG_CAP_HDR_SIZE);
+    ASSERT_EQ(h->size, 0x1000);
+    ASSERT_EQ(h->snaplen, RINGLOG_CAP_SNAP_DEFAULT);
+    ASSERT_EQ(RINGLOG_$CAP.wire_count, 5);
+
+    start(70 * 1024 + 100, 2000);
+    ASSERT_EQ(h->size, 0x10000);
+    ASSERT_EQ(h->snaplen, RINGLOG_CAP_HDR_MAX + RINGLOG_CAP_DATA_MAX);
+
+    start(1000 * 1024, 64);
+    ASSERT_EQ(h->size, 0x40000);
+    ASSERT_EQ(RINGLOG_$CAP.wire_count, RINGLOG_CAP_PAGES_MAX);
+}
+
+/*
+ * Test: Ring too small
+ * Expected: status_$ring_capture_bad_size, and capture stays off
+ */
+void test_capture_start_rejects_small_ring(void)
+{
+    ringlog_$cap_start_t req;
+    status_$t st;
+
+    req.va = (uint32_t)(uintptr_t)object;
+    req.length = 4096;
+    req.snaplen = 0;
+    ringlog_$cap_start(&req, &st);
+    ASSERT_EQ(st, status_$ring_capture_bad_size);
+    ASSERT_EQ(RINGLOG_$CAPTURING >= 0, 1);
+}
+
+/*
+ * Test: Caller without write rights to the ring object
+ * Expected: The check asks for write access and its status is returned;
+ * the object is not mapped and capture stays off
+ */
+void test_capture_start_needs_write_rights(void)
+{
+    ringlog_$cap_start_t req;
+    status_$t st;
+    int before;
+
+    ringlog_$cap_stop();
+    before = maps;
+    prot_status = 0x00230002;           /* Insufficient rights */
+    req.va = (uint32_t)(uintptr_t)object;
+    req.length = 8 * 1024;
+    req.snaplen = 0;
+    req.pad = 0;
+    ringlog_$cap_start(&req, &st);
+    prot_status = status_$ok;
+
+    ASSERT_EQ(st, 0x00230002);
+    ASSERT_EQ(prot_mode, 2);
+    ASSERT_EQ(maps, before);
+    ASSERT_EQ(RINGLOG_$CAPTURING >= 0, 1);
+}
+
+/*
+ * Test: Stop
+ * Expected: The object is unmapped and later frames are not recorded
+ */
+void test_capture_stop_unmaps_and_ignores_frames(void)
+{
+    ringlog_$cap_hdr_t *h = (ringlog_$cap_hdr_t *)object;
+    int before;
+
+    start(8 * 1024, 0);
+    before = unmaps;
+    ringlog_$cap_stop();
+    ASSERT_EQ(unmaps, before + 1);
+    ASSERT_EQ(RINGLOG_$CAPTURING >= 0, 1);
+
+    make_frame(1, 2, 3, 4, 5, 10);
+    RINGLOG_$CAPTURE(0, RINGLOG_CAP_RCV, frame_hdr, frame_data);
+    ASSERT_EQ(h->seen, 0);
+    ASSERT_EQ(h->head, 0);
+}
+
+/*
+ * Test: One frame
+ * Expected: The record holds the header and data, lengths and direction
+ */
+void test_capture_record_holds_frame(void)
+{
+    ringlog_$cap_hdr_t *h = (ringlog_$cap_hdr_t *)object;
+    ringlog_$cap_rec_t *r;
+    uint8_t *bytes;
+
+    start(8 * 1024, 512);
+    make_frame(7, 0x11, 0x22, 0x33, 0x44, 100);
+    RINGLOG_$CAPTURE(1, RINGLOG_CAP_SEND, frame_hdr, frame_data);
+
+    r = next_rec(h);
+    ASSERT_EQ(r != NULL, 1);
+    ASSERT_EQ(r->caplen, HDR_LEN + 100);
+    ASSERT_EQ(r->len, HDR_LEN + 100);
+    ASSERT_EQ(r->hdr_len, HDR_LEN);
+    ASSERT_EQ(r->unit, 1);
+    ASSERT_EQ(r->flags, RINGLOG_CAP_SEND);
+    ASSERT_EQ(r->reclen, ((sizeof(*r) + HDR_LEN + 100 + 3) & ~3));
+    bytes = (uint8_t *)(r + 1);
+    ASSERT_EQ(memcmp(bytes, frame_hdr, HDR_LEN), 0);
+    ASSERT_EQ(memcmp(bytes + HDR_LEN, frame_data, 100), 0);
+    consume(h, r);
+    ASSERT_EQ(next_rec(h), NULL);
+}
+
+/*
+ * Test: Snap length
+ * Expected: Records stop at the snap length; len is the frame's length
+ */
+void test_capture_snaplen_truncates(void)
+{
+    ringlog_$cap_hdr_t *h = (ringlog_$cap_hdr_t *)object;
+    ringlog_$cap_rec_t *r;
+
+    start(8 * 1024, 0x40);
+    make_frame(1, 2, 3, 4, 5, 200);
+    RINGLOG_$CAPTURE(0, RINGLOG_CAP_RCV, frame_hdr, frame_data);
+    r = next_rec(h);
+    ASSERT_EQ(r != NULL, 1);
+    ASSERT_EQ(r->caplen, 0x40);
+    ASSERT_EQ(r->len, HDR_LEN + 200);
+
+    /* Header only: the data length in the header is not counted */
+    consume(h, r);
+    RINGLOG_$CAPTURE(0, RINGLOG_CAP_RCV, frame_hdr, NULL);
+    r = next_rec(h);
+    ASSERT_EQ(r != NULL, 1);
+    ASSERT_EQ(r->len, HDR_LEN);
+}
+
+/*
+ * Test: Reader not reading
+ * Expected: Frames with no room are counted as drops, never overwrite
+ * unread records, and the rest arrive in order
+ */
+void test_capture_full_ring_drops(void)
+{
+    ringlog_$cap_hdr_t *h = (ringlog_$cap_hdr_t *)object;
+    uint32_t i;
+    uint32_t got = 0;
+    ringlog_$cap_rec_t *r;
+
+    start(1024 + 0x1000, 512);
+    for (i = 0; i < 100; i++) {
+        make_frame(i, 2, 3, 4, 5, 200);
+        RINGLOG_$CAPTURE(0, RINGLOG_CAP_RCV, frame_hdr, frame_data);
+    }
+    ASSERT_EQ(h->seen, 100);
+    ASSERT_EQ(h->drops > 0, 1);
+    ASSERT_EQ(h->head - h->tail <= h->size, 1);
+
+    while ((r = next_rec(h)) != NULL) {
+        ASSERT_EQ(((uint8_t *)(r + 1))[HDR_LEN], (uint8_t)got);
+        consume(h, r);
+        got++;
+    }
+    ASSERT_EQ(got + h->drops, 100);
+}
+
+/*
+ * Test: Reader keeping up in fits and starts, frames of every size
+ * Expected: The ring wraps at every alignment and each record the reader
+ * finds is whole and later than the one before
+ */
+void test_capture_reader_sees_every_frame_in_order(void)
+{
+    ringlog_$cap_hdr_t *h = (ringlog_$cap_hdr_t *)object;
+    ringlog_$cap_rec_t *r;
+    uint32_t seq = 0;
+    uint32_t next = 0;
+    uint32_t rnd = 12345;
+    uint16_t len;
+    int round;
+    int k;
+
+    start(1024 + 0x1000, 0x200);
+    for (round = 0; round < 2000; round++) {
+        rnd = rnd * 1103515245 + 12345;
+        for (k = (rnd >> 16) % 6; k > 0; k--) {
+            rnd = rnd * 1103515245 + 12345;
+            len = (uint16_t)((rnd >> 8) % 0x300);
+            make_frame(seq, 2, 3, 4, 5, len);
+            RINGLOG_$CAPTURE(0, RINGLOG_CAP_RCV, frame_hdr, frame_data);
+            seq++;
+        }
+        rnd = rnd * 1103515245 + 12345;
+        for (k = (rnd >> 16) % 6; k > 0 && (r = next_rec(h)) != NULL; k--) {
+            uint8_t *b = (uint8_t *)(r + 1);
+            uint32_t s = (uint32_t)b[0x40] << 24 | b[0x41] << 16 |
+                         b[0x42] << 8 | b[0x43];
+            ASSERT_EQ(s >= next, 1);
+            next = s + 1;
+            ASSERT_EQ(r->caplen <= 0x200, 1);
+            ASSERT_EQ((uint8_t *)r + r->reclen <= object + h->area + h->size, 1);
+            consume(h, r);
+        }
+    }
+    while ((r = next_rec(h)) != NULL) {
+        consume(h, r);
+    }
+    ASSERT_EQ(h->seen, seq);
+    ASSERT_EQ(h->drops > 0, 1);
+    ASSERT_EQ(h->drops < seq, 1);
+}
+
+/*
+ * Test: All predicates must hold
+ * Expected: Masked compares select the frame; others are counted filtered
+ */
+void test_capture_filter_all_predicates(void)
+{
+    ringlog_$cap_hdr_t *h = (ringlog_$cap_hdr_t *)object;
+    ringlog_$cap_filter_t f;
+    status_$t st = status_$ok;
+
+    start(8 * 1024, 0);
+    memset(&f, 0, sizeof(f));
+    f.n_preds = 2;
+    f.preds[0] = (ringlog_$cap_pred_t){RINGLOG_CAP_OFF_SRC_NODE, 4,
+                                       RINGLOG_CAP_EQ, 0x000FFFFF, 0x1234};
+    f.preds[1] = (ringlog_$cap_pred_t){RINGLOG_CAP_OFF_DEST_SOCK, 2,
+                                       RINGLOG_CAP_NE, 0xFFFF, 5};
+    ringlog_$cap_set_filter(&f, &st);
+    ASSERT_EQ(st, status_$ok);
+
+    make_frame(1, 9, 0x7001234, 4, 6, 0);     /* High bits masked off */
+    RINGLOG_$CAPTURE(0, RINGLOG_CAP_RCV, frame_hdr, NULL);
+    make_frame(2, 9, 0x1234, 4, 5, 0);        /* Socket 5 */
+    RINGLOG_$CAPTURE(0, RINGLOG_CAP_RCV, frame_hdr, NULL);
+    make_frame(3, 9, 0x1235, 4, 6, 0);        /* Other node */
+    RINGLOG_$CAPTURE(0, RINGLOG_CAP_RCV, frame_hdr, NULL);
+
+    ASSERT_EQ(h->seen, 3);
+    ASSERT_EQ(h->filtered, 2);
+}
+
+/*
+ * Test: Any predicate may hold, with range compares
+ * Expected: Only a frame matching neither is filtered
+ */
+void test_capture_filter_any_and_ranges(void)
+{
+    ringlog_$cap_hdr_t *h = (ringlog_$cap_hdr_t *)object;
+    ringlog_$cap_filter_t f;
+    status_$t st = status_$ok;
+
+    start(8 * 1024, 0);
+    memset(&f, 0, sizeof(f));
+    f.flags = RINGLOG_CAP_ANY;
+    f.n_preds = 2;
+    f.preds[0] = (ringlog_$cap_pred_t){RINGLOG_CAP_OFF_TYPE, 2,
+                                       RINGLOG_CAP_LT, 0xFFFF, 3};
+    f.preds[1] = (ringlog_$cap_pred_t){RINGLOG_CAP_OFF_TYPE, 2,
+                                       RINGLOG_CAP_GT, 0xFFFF, 0x100};
+    ringlog_$cap_set_filter(&f, &st);
+
+    make_frame(1, 9, 1, 2, 6, 0);
+    RINGLOG_$CAPTURE(0, RINGLOG_CAP_RCV, frame_hdr, NULL);
+    make_frame(2, 9, 1, 0x200, 6, 0);
+    RINGLOG_$CAPTURE(0, RINGLOG_CAP_RCV, frame_hdr, NULL);
+    make_frame(3, 9, 1, 0x50, 6, 0);
+    RINGLOG_$CAPTURE(0, RINGLOG_CAP_RCV, frame_hdr, NULL);
+    ASSERT_EQ(h->filtered, 1);
+}
+
+/*
+ * Test: Predicate past the frame's header
+ * Expected: The frame is filtered
+ */
+void test_capture_filter_beyond_header_fails(void)
+{
+    ringlog_$cap_hdr_t *h = (ringlog_$cap_hdr_t *)object;
+    ringlog_$cap_filter_t f;
+    status_$t st = status_$ok;
+
+    start(8 * 1024, 0);
+    memset(&f, 0, sizeof(f));
+    f.n_preds = 1;
+    f.preds[0] = (ringlog_$cap_pred_t){HDR_LEN, 1, RINGLOG_CAP_EQ, 0xFF, 0};
+    ringlog_$cap_set_filter(&f, &st);
+
+    make_frame(1, 9, 1, 2, 6, 0);
+    RINGLOG_$CAPTURE(0, RINGLOG_CAP_RCV, frame_hdr, NULL);
+    ASSERT_EQ(h->filtered, 1);
+}
+
+/*
+ * Test: Direction filter
+ * Expected: Only sends are captured
+ */
+void test_capture_filter_direction(void)
+{
+    ringlog_$cap_hdr_t *h = (ringlog_$cap_hdr_t *)object;
+    ringlog_$cap_filter_t f;
+    status_$t st = status_$ok;
+
+    start(8 * 1024, 0);
+    memset(&f, 0, sizeof(f));
+    f.dirs = RINGLOG_CAP_SEND;
+    ringlog_$cap_set_filter(&f, &st);
+
+    make_frame(1, 9, 1, 2, 6, 0);
+    RINGLOG_$CAPTURE(0, RINGLOG_CAP_RCV, frame_hdr, NULL);
+    RINGLOG_$CAPTURE(0, RINGLOG_CAP_SEND, frame_hdr, NULL);
+    ASSERT_EQ(h->filtered, 1);
+    ASSERT_EQ(h->seen, 2);
+}
+
+/*
+ * Test: Bad filters
+ * Expected: Too many predicates, bad sizes and offsets past the largest
+ * header give status_$ring_capture_bad_filter
+ */
+void test_capture_bad_filters_rejected(void)
+{
+    ringlog_$cap_filter_t f;
+    status_$t st;
+
+    memset(&f, 0, sizeof(f));
+    f.n_preds = RINGLOG_CAP_PREDS_MAX + 1;
+    st = status_$ok;
+    ringlog_$cap_set_filter(&f, &st);
+    ASSERT_EQ(st, status_$ring_capture_bad_filter);
+
+    f.n_preds = 1;
+    f.preds[0] = (ringlog_$cap_pred_t){0, 3, RINGLOG_CAP_EQ, 0, 0};
+    st = status_$ok;
+    ringlog_$cap_set_filter(&f, &st);
+    ASSERT_EQ(st, status_$ring_capture_bad_filter);
+
+    f.preds[0] = (ringlog_$cap_pred_t){RINGLOG_CAP_HDR_MAX - 1, 2,
+                                       RINGLOG_CAP_EQ, 0, 0};
+    st = status_$ok;
+    ringlog_$cap_set_filter(&f, &st);
+    ASSERT_EQ(st, status_$ring_capture_bad_filter);
+}
@@ -0,0 +1,268 @@
+/*
+ * Unit tests for ring transmit arbitration and BULK shaping
+ *
+ * Tests that a held transmitter is passed on by class, PAGING first and
+ * in arrival order within a class, how a sender's class is chosen and
+ * forgotten at unbind, that BULK frames are held to the byte rate except
+ * in a network process, and that only the superuser may set the rate.
+ * Linked against xmit.c and ioctl.c; the spin lock, event counts, ACL
+ * check and hardware mask are mocked.
+ *
+ * The event count mocks never block: a sender that would wait is
+ * counted and carries on, and waiting on TIME_$CLOCKH moves the clock
+ * to the value waited for.
+ */
+
+#include "ring/ring_internal.h"
+#include "acl/acl.h"
+
+#define TEST_PID        5
+#define TEST_ASID       3
+
+/* Storage normally defined in ring/data.c and the time and proc1 data */
+ring_global_t RING_$DATA;
+uint32_t TIME_$CLOCKH;
+uint16_t PROC1_$AS_ID;
+uint16_t PROC1_$CURRENT;
+uint16_t PROC1_$TYPE[PROC1_MAX_PROCESSES];
+
+/* Mock state tracking */
+static int mock_queue_waits;    /* EC_$WAITN calls on a class queue */
+static int mock_clock_waits;    /* EC_$WAITN calls on TIME_$CLOCKH */
+static int8_t mock_suser;
+
+ml_$spin_token_t ML_$SPIN_LOCK(void *lockp) { (void)lockp; return 0; }
+void ML_$SPIN_UNLOCK(void *lockp, ml_$spin_token_t token) { (void)lockp; (void)token; }
+void EC_$INIT(ec_$eventcount_t *ec) { ec->value = 0; }
+void EC_$ADVANCE(ec_$eventcount_t *ec) { ec->value++; }
+void OS_$DATA_COPY(const void *src, void *dst, uint32_t len) { memcpy(dst, src, len); }
+void ring_$set_hw_mask(uint16_t unit, uint16_t mask) { (void)unit; (void)mask; }
+int8_t ACL_$IS_SUSER(void) { return mock_suser; }
+
+uint16_t EC_$WAITN(ec_$eventcount_t **ecs, int32_t *wait_val, int16_t num_ecs)
+{
+    (void)num_ecs;
+    if ((void *)ecs[0] == (void *)&TIME_$CLOCKH) {
+        mock_clock_waits++;
+        TIME_$CLOCKH = (uint32_t)wait_val[0];
+    } else {
+        mock_queue_waits++;
+    }
+    return 1;
+}
+
+static ring_$xmit_t *x = &ring_$xmit[0];
+
+static void reset_mocks(void)
+{
+    TIME_$CLOCKH = 1000;
+    PROC1_$CURRENT = TEST_PID;
+    PROC1_$AS_ID = TEST_ASID;
+    PROC1_$TYPE[TEST_PID] = 0;
+    mock_queue_waits = 0;
+    mock_clock_waits = 0;
+    mock_suser = 0;
+
+    RING_$XMIT_UNBIND(TEST_PID, TEST_ASID);
+    memset(x, 0, sizeof(*x));
+    ring_$xmit_init(0);
+}
+
+/* Send one frame of len bytes */
+static void send_frame(uint16_t len)
+{
+    ring_$xmit_start(0, len);
+    ring_$xmit_done(0);
+}
+
+/*
+ * Test: A free transmitter
+ * Expected: Taken without waiting, counted as NORMAL, and free again
+ * once given up
+ */
+void test_xmit_free_transmitter(void)
+{
+    reset_mocks();
+
+    ring_$xmit_start(0, 100);
+    ASSERT_EQ(mock_queue_waits, 0);
+    ASSERT_EQ(x->busy, -1);
+    ASSERT_EQ(x->stats[RING_XMIT_NORMAL - 1].frames, 1);
+    ASSERT_EQ(x->stats[RING_XMIT_NORMAL - 1].bytes, 100);
+    ASSERT_EQ(x->stats[RING_XMIT_NORMAL - 1].waited, 0);
+
+    ring_$xmit_done(0);
+    ASSERT_EQ(x->busy, 0);
+}
+
+/*
+ * Test: Senders queued behind a busy transmitter
+ * Expected: Passed on PAGING first, then NORMAL in arrival order, then
+ * BULK; the transmitter stays busy until the last gives it up
+ */
+void test_xmit_priority_order(void)
+{
+    ring_$xmit_queue_t *paging = &x->queues[RING_XMIT_PAGING - 1];
+    ring_$xmit_queue_t *normal = &x->queues[RING_XMIT_NORMAL - 1];
+    ring_$xmit_queue_t *bulk = &x->queues[RING_XMIT_BULK - 1];
+
+    reset_mocks();
+
+    ring_$xmit_start(0, 100);
+    RING_$XMIT_SET_CLASS(RING_XMIT_BULK);
+    ring_$xmit_start(0, 100);
+    RING_$XMIT_SET_CLASS(RING_XMIT_NORMAL);
+    ring_$xmit_start(0, 100);
+    ring_$xmit_start(0, 100);
+    RING_$XMIT_SET_CLASS(RING_XMIT_PAGING);
+    ring_$xmit_start(0, 100);
+    ASSERT_EQ(mock_queue_waits, 4);
+    ASSERT_EQ(normal->tickets, 2);
+
+    ring_$xmit_done(0);
+    ASSERT_EQ(paging->ec.value, 1);
+    ASSERT_EQ(normal->ec.value, 0);
+
+    ring_$xmit_done(0);
+    ring_$xmit_done(0);
+    ASSERT_EQ(normal->ec.value, 2);
+    ASSERT_EQ(bulk->ec.value, 0);
+
+    ring_$xmit_done(0);
+    ASSERT_EQ(bulk->ec.value, 1);
+    ASSERT_EQ(x->busy, -1);
+
+    ring_$xmit_done(0);
+    ASSERT_EQ(x->busy, 0);
+}
+
+/*
+ * Test: Choosing the sender's class
+ * Expected: NORMAL by default; the class set around a send; a BULK
+ * address space overrides a paging bracket; unbinding forgets both
+ */
+void test_xmit_class_and_unbind(void)
+{
+    reset_mocks();
+    ring_$xmit_set_shape(0, 0, 0);
+
+    ASSERT_EQ(RING_$XMIT_SET_CLASS(RING_XMIT_PAGING), RING_XMIT_DEFAULT);
+    send_frame(10);
+    ASSERT_EQ(x->stats[RING_XMIT_PAGING - 1].frames, 1);
+
+    ring_$xmit_mark_as(TEST_ASID, -1);
+    send_frame(10);
+    ASSERT_EQ(x->stats[RING_XMIT_BULK - 1].frames, 1);
+
+    /* Out of range classes are ignored */
+    ASSERT_EQ(RING_$XMIT_SET_CLASS(7), RING_XMIT_PAGING);
+
+    RING_$XMIT_UNBIND(TEST_PID, TEST_ASID);
+    ASSERT_EQ(RING_$XMIT_SET_CLASS(RING_XMIT_DEFAULT), RING_XMIT_DEFAULT);
+    send_frame(10);
+    ASSERT_EQ(x->stats[RING_XMIT_NORMAL - 1].frames, 1);
+
+    /* Address space 0 is the system's: a system process leaving keeps it */
+    ring_$xmit_mark_as(0, -1);
+    RING_$XMIT_UNBIND(TEST_PID, 0);
+    PROC1_$AS_ID = 0;
+    send_frame(10);
+    ASSERT_EQ(x->stats[RING_XMIT_BULK - 1].frames, 2);
+    ring_$xmit_mark_as(0, 0);
+}
+
+/*
+ * Test: BULK frames over the rate
+ * Expected: 64 1K frames at ~16K a tick with a 4K burst wait out four
+ * ticks; NORMAL frames and an unlimited rate never wait
+ */
+void test_xmit_bulk_held_to_rate(void)
+{
+    int i;
+
+    reset_mocks();
+    ring_$xmit_mark_as(TEST_ASID, -1);
+    ring_$xmit_set_shape(0, 16384 * 4, 4096);
+    for (i = 0; i < 64; i++) {
+        send_frame(1024);
+    }
+    ASSERT_EQ(x->stats[RING_XMIT_BULK - 1].frames, 64);
+    ASSERT_EQ(x->stats[RING_XMIT_BULK - 1].shaped, 4);
+    ASSERT_EQ(mock_clock_waits, 4);
+    ASSERT_EQ(TIME_$CLOCKH, 1004);
+
+    reset_mocks();
+    ring_$xmit_mark_as(TEST_ASID, -1);
+    ring_$xmit_set_shape(0, 0, 0);
+    for (i = 0; i < 1000; i++) {
+        send_frame(1024);
+    }
+    ASSERT_EQ(mock_clock_waits, 0);
+
+    reset_mocks();
+    ring_$xmit_set_shape(0, 1024, 1024);
+    for (i = 0; i < 100; i++) {
+        send_frame(1024);
+    }
+    ASSERT_EQ(mock_clock_waits, 0);
+}
+
+/*
+ * Test: BULK frames from a network process
+ * Expected: Never put to sleep; the debt they leave holds the next BULK
+ * sender that is not a network process
+ */
+void test_xmit_network_process_not_held(void)
+{
+    int i;
+
+    reset_mocks();
+    RING_$XMIT_SET_CLASS(RING_XMIT_BULK);
+    ring_$xmit_set_shape(0, 16384 * 4, 4096);
+
+    PROC1_$TYPE[TEST_PID] = RING_NETWORK_PROC_TYPE;
+    for (i = 0; i < 64; i++) {
+        send_frame(1024);
+    }
+    ASSERT_EQ(mock_clock_waits, 0);
+    ASSERT_EQ(TIME_$CLOCKH, 1000);
+    ASSERT_EQ(x->tokens < 0, 1);
+
+    PROC1_$TYPE[TEST_PID] = 0;
+    send_frame(1024);
+    ASSERT_EQ(mock_clock_waits > 0, 1);
+}
+
+/*
+ * Test: RING_IOCTL_XMIT_SHAPE
+ * Expected: Refused with status_$ring_request_denied unless the caller
+ * is the superuser; the rate is then set
+ */
+void test_xmit_shape_ioctl_privileged(void)
+{
+    uint16_t unit = 0;
+    int16_t cmd[2] = { RING_IOCTL_XMIT_SHAPE, 0 };
+    uint32_t shape[2] = { 0, 2048 };
+    status_$t status;
+
+    reset_mocks();
+
+    RING_$IOCTL(&unit, cmd, shape, &status);
+    ASSERT_EQ(status, status_$ring_request_denied);
+    ASSERT_EQ(x->rate != 0, 1);
+
+    mock_suser = -1;
+    RING_$IOCTL(&unit, cmd, shape, &status);
+    ASSERT_EQ(status, status_$ok);
+    ASSERT_EQ(x->rate, 0);
+    ASSERT_EQ(x->burst, 2048);
+
+    /* Any process may still lower itself */
+    mock_suser = 0;
+    cmd[0] = RING_IOCTL_XMIT_CLASS;
+    cmd[1] = RING_XMIT_BULK;
+    RING_$IOCTL(&unit, cmd, NULL, &status);
+    ASSERT_EQ(status, status_$ok);
+    send_frame(10);
+    ASSERT_EQ(x->stats[RING_XMIT_BULK - 1].frames, 1);
+}
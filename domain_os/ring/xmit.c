@@ -0,0 +1,263 @@
+/*
+ * Ring transmit arbitration and BULK shaping
+ *
+ * RING_$SENDP calls ring_$xmit_start before it touches the transmitter
+ * and ring_$xmit_done when it is finished with it, so the senders of a
+ * unit take turns by class (see ring.h) instead of in whatever order
+ * they happen to run.  The spinlock is held only to take a ticket or
+ * pass the transmitter on; senders wait on their class's event count
+ * and, for BULK frames short of credit, on TIME_$CLOCKH.
+ */
+
+#include "ring/ring_internal.h"
+
+ring_$xmit_t ring_$xmit[RING_MAX_UNITS];
+
+/* RING_XMIT_* set with RING_$XMIT_SET_CLASS, per process */
+static uint8_t ring_$xmit_proc_class[PROC1_MAX_PROCESSES];
+
+/* Non-zero for address spaces marked with RING_IOCTL_XMIT_CLASS */
+static uint8_t ring_$xmit_as_bulk[MST_MAX_ASIDS];
+
+static uint16_t ring_$xmit_lock;
+
+/* Bytes per second to bytes per TIME_$CLOCKH tick (65536 x 4 us) */
+static uint32_t ring_$xmit_per_tick(uint32_t rate)
+{
+    uint32_t per_tick;
+
+    per_tick = (rate >> 8) * 67 + (((rate & 0xFF) * 67) >> 8);
+    if (per_tick == 0 && rate != 0) {
+        per_tick = 1;
+    }
+    return per_tick;
+}
+
+/* RING_XMIT_* class of the current sender */
+static uint16_t ring_$xmit_class(void)
+{
+    uint16_t xmit_class;
+
+    if (ring_$xmit_as_bulk[PROC1_$AS_ID] != 0) {
+        return RING_XMIT_BULK;
+    }
+    xmit_class = ring_$xmit_proc_class[PROC1_$CURRENT];
+    return (xmit_class != RING_XMIT_DEFAULT) ? xmit_class : RING_XMIT_NORMAL;
+}
+
+/*
+ * Add the credit earned since the last refill.  Called locked.
+ *
+ * Credit is saved up to the burst, but never less than a tick's worth:
+ * the clock is coarse, and a smaller cap would lower the rate.
+ */
+static void ring_$xmit_refill(ring_$xmit_t *x, uint32_t now)
+{
+    uint32_t ticks;
+    uint32_t limit;
+
+    ticks = now - x->refilled;
+    x->refilled = now;
+    if (ticks == 0) {
+        return;
+    }
+
+    limit = (x->burst > x->rate) ? x->burst : x->rate;
+    if (ticks > limit / x->rate) {
+        x->tokens = (int32_t)limit;
+        return;
+    }
+    x->tokens += (int32_t)(ticks * x->rate);
+    if (x->tokens > (int32_t)limit) {
+        x->tokens = (int32_t)limit;
+    }
+}
+
+/*
+ * ring_$xmit_shape - Hold a BULK frame until the class has credit
+ *
+ * Any credit at all lets the frame go; the class then owes what it
+ * overdrew, which keeps one large frame from waiting for a full burst.
+ * A network process (netlog ships its pages from one) is never held:
+ * its frame goes at once and the debt delays the next BULK sender.
+ */
+static void ring_$xmit_shape(ring_$xmit_t *x, uint16_t len)
+{
+    ec_$eventcount_t *ecs[1];
+    int32_t wait_val;
+    ml_$spin_token_t token;
+    uint32_t now;
+    int8_t held = 0;
+
+    ecs[0] = (ec_$eventcount_t *)&TIME_$CLOCKH;
+
+    for (;;) {
+        token = ML_$SPIN_LOCK(&ring_$xmit_lock);
+        if (x->rate == 0) {
+            ML_$SPIN_UNLOCK(&ring_$xmit_lock, token);
+            return;
+        }
+        now = TIME_$CLOCKH;
+        ring_$xmit_refill(x, now);
+        if (x->tokens > 0 ||
+            PROC1_$TYPE[PROC1_$CURRENT] == RING_NETWORK_PROC_TYPE) {
+            x->tokens -= len;
+            if (held < 0) {
+                x->stats[RING_XMIT_BULK - 1].shaped++;
+            }
+            ML_$SPIN_UNLOCK(&ring_$xmit_lock, token);
+            return;
+        }
+        ML_$SPIN_UNLOCK(&ring_$xmit_lock, token);
+
+        held = -1;
+        wait_val = (int32_t)(now + 1);
+        EC_$WAITN(ecs, &wait_val, 1);
+    }
+}
+
+/*
+ * ring_$xmit_take - Take the transmitter, or a ticket for it.  Called
+ * locked.
+ *
+ * Returns:
+ *   Negative if the transmitter was free, otherwise 0 with *wait_val
+ *   set to the value of the queue's event count to wait for
+ */
+static int8_t ring_$xmit_take(ring_$xmit_t *x, uint16_t q, int32_t *wait_val)
+{
+    if (x->busy >= 0) {
+        x->busy = -1;
+        return -1;
+    }
+    *wait_val = ++x->queues[q].tickets;
+    x->stats[q].waited++;
+    return 0;
+}
+
+/*
+ * ring_$xmit_next - Choose who gets the transmitter next.  Called
+ * locked.
+ *
+ * Returns:
+ *   The queue whose event count is to be advanced, or -1 if no one is
+ *   waiting and the transmitter is now free
+ */
+static int16_t ring_$xmit_next(ring_$xmit_t *x)
+{
+    int16_t q;
+
+    for (q = 0; q < RING_XMIT_CLASSES; q++) {
+        if (x->queues[q].tickets - x->queues[q].ec.value > 0) {
+            return q;
+        }
+    }
+    x->busy = 0;
+    return -1;
+}
+
+void ring_$xmit_init(uint16_t unit)
+{
+    ring_$xmit_t *x = &ring_$xmit[unit];
+    int16_t q;
+
+    for (q = 0; q < RING_XMIT_CLASSES; q++) {
+        EC_$INIT(&x->queues[q].ec);
+        x->queues[q].tickets = 0;
+    }
+    x->busy = 0;
+    x->rate = ring_$xmit_per_tick(RING_XMIT_BULK_RATE);
+    x->burst = RING_XMIT_BULK_BURST;
+    x->tokens = RING_XMIT_BULK_BURST;
+    x->refilled = TIME_$CLOCKH;
+}
+
+void ring_$xmit_start(uint16_t unit, uint16_t len)
+{
+    ring_$xmit_t *x = &ring_$xmit[unit];
+    ec_$eventcount_t *ecs[1];
+    int32_t wait_val;
+    ml_$spin_token_t token;
+    uint16_t q;
+    int8_t got;
+
+    q = ring_$xmit_class() - 1;
+    if (q == RING_XMIT_BULK - 1) {
+        ring_$xmit_shape(x, len);
+    }
+
+    token = ML_$SPIN_LOCK(&ring_$xmit_lock);
+    x->stats[q].frames++;
+    x->stats[q].bytes += len;
+    got = ring_$xmit_take(x, q, &wait_val);
+    ML_$SPIN_UNLOCK(&ring_$xmit_lock, token);
+
+    if (got >= 0) {
+        ecs[0] = &x->queues[q].ec;
+        EC_$WAITN(ecs, &wait_val, 1);
+    }
+}
+
+void ring_$xmit_done(uint16_t unit)
+{
+    ring_$xmit_t *x = &ring_$xmit[unit];
+    ml_$spin_token_t token;
+    int16_t q;
+
+    token = ML_$SPIN_LOCK(&ring_$xmit_lock);
+    q = ring_$xmit_next(x);
+    ML_$SPIN_UNLOCK(&ring_$xmit_lock, token);
+
+    /* The transmitter stays busy until the chosen sender gives it up */
+    if (q >= 0) {
+        EC_$ADVANCE(&x->queues[q].ec);
+    }
+}
+
+void ring_$xmit_set_shape(uint16_t unit, uint32_t rate, uint32_t burst)
+{
+    ring_$xmit_t *x = &ring_$xmit[unit];
+    ml_$spin_token_t token;
+
+    if (burst == 0) {
+        burst = RING_XMIT_BULK_BURST;
+    }
+
+    token = ML_$SPIN_LOCK(&ring_$xmit_lock);
+    x->rate = ring_$xmit_per_tick(rate);
+    x->burst = burst;
+    if (x->tokens > (int32_t)burst) {
+        x->tokens = (int32_t)burst;
+    }
+    x->refilled = TIME_$CLOCKH;
+    ML_$SPIN_UNLOCK(&ring_$xmit_lock, token);
+}
+
+void ring_$xmit_mark_as(uint16_t as_id, int8_t bulk)
+{
+    if (as_id < MST_MAX_ASIDS) {
+        ring_$xmit_as_bulk[as_id] = (bulk < 0) ? 1 : 0;
+    }
+}
+
+uint16_t RING_$XMIT_SET_CLASS(uint16_t xmit_class)
+{
+    uint16_t old;
+
+    old = ring_$xmit_proc_class[PROC1_$CURRENT];
+    if (xmit_class <= RING_XMIT_BULK) {
+        ring_$xmit_proc_class[PROC1_$CURRENT] = (uint8_t)xmit_class;
+    }
+    return old;
+}
+
+void RING_$XMIT_UNBIND(uint16_t pid, uint16_t as_id)
+{
+    if (pid < PROC1_MAX_PROCESSES) {
+        ring_$xmit_proc_class[pid] = RING_XMIT_DEFAULT;
+    }
+    /* Address space 0 is shared by the system processes */
+    if (as_id != 0) {
+        ring_$xmit_mark_as(as_id, 0);
+    }
+}
@@ -6,6 +6,9 @@
  *
  *   VALID -> AGING -> EXPIRED -> UNUSED
  *
+ * Routes are kept on a timer wheel by expiration, so each call looks
+ * only at the routes falling due since the last.
+ *
  * After aging, routing updates are sent to propagate changes.
  *
  * Original address: 0x00E155C0
@@ -13,18 +16,84 @@
 
 #include "rip/rip_internal.h"
 
+/*
+ * Move one route that has passed its expiration on to its next state.
+ */
+static void rip_$age_route(uint16_t entry_idx, int route_idx,
+                           uint32_t current_time)
+{
+    rip_$entry_t *entry;
+    rip_$route_t *route;
+    uint8_t other_state;
+
+    entry = &RIP_$INFO[entry_idx];
+    route = &entry->routes[route_idx];
+
+    /* Handle based on current state */
+    switch ((route->flags >> RIP_STATE_SHIFT) & 0x03) {
+    case RIP_STATE_VALID:
+        /*
+         * Valid route expired - transition to AGING if metric is non-zero.
+         * Routes with metric 0 are direct routes that shouldn't age.
+         */
+        if (route->metric != 0) {
+            /* Set new expiration time */
+            rip_$schedule(route, current_time + RIP_ROUTE_TIMEOUT);
+            /* Transition to AGING state */
+            route->flags = (route->flags & ~RIP_STATE_MASK) |
+                           (RIP_STATE_AGING << RIP_STATE_SHIFT);
+        }
+        break;
+
+    case RIP_STATE_AGING:
+        /*
+         * Aging route expired - transition to EXPIRED.
+         * Set metric to infinity and mark that we have changes to advertise.
+         */
+        route->metric = RIP_INFINITY;
+
+        /* Mark recent changes flag based on route type */
+        if (route_idx == 1) {
+            /* Non-standard route (index 1) */
+            RIP_$DATA.std_recent_changes = 0xFF;
+        } else {
+            /* Standard route (index 0) */
+            RIP_$DATA.recent_changes = 0xFF;
+        }
+
+        /* Set new expiration time */
+        rip_$schedule(route, current_time + RIP_ROUTE_TIMEOUT);
+        /* Transition to EXPIRED state */
+        route->flags |= RIP_STATE_MASK;  /* State 3 = 0xC0 */
+        break;
+
+    case RIP_STATE_EXPIRED:
+        /*
+         * Expired route expired again - clear the entry.
+         * Set state to UNUSED so the slot can be reused, and free the
+         * entry once neither route is in use.
+         */
+        route->flags &= ~RIP_STATE_MASK;  /* State 0 = unused */
+        other_state = (entry->routes[route_idx ^ 1].flags >> RIP_STATE_SHIFT) & 0x03;
+        if (other_state == RIP_STATE_UNUSED) {
+            rip_$free_entry(entry_idx);
+        }
+        break;
+    }
+}
+
 /*
  * RIP_$AGE - Age routing table entries
  *
  * Algorithm:
  * 1. Acquire RIP lock
- * 2. For each entry in the routing table (64 entries):
- *    For each route slot (2 per entry: standard and non-standard):
- *      - If state is non-zero (not unused) and time has expired:
- *        - State 1 (VALID): If metric != 0, transition to AGING
- *        - State 2 (AGING): Set metric to infinity (0x11), mark recent changes,
- *                           transition to EXPIRED
- *        - State 3 (EXPIRED): Transition to UNUSED
+ * 2. Run the timer wheel from the last tick aged to now.  For each
+ *    route in each slot passed that is past its expiration:
+ *      - State 1 (VALID): If metric != 0, transition to AGING
+ *      - State 2 (AGING): Set metric to infinity (0x11), mark recent changes,
+ *                         transition to EXPIRED
+ *      - State 3 (EXPIRED): Transition to UNUSED
+ *    Only routes falling due are looked at, not the whole table.
  * 3. Release RIP lock
  * 4. Send routing updates for both standard and non-standard routes
  *
@@ -32,12 +101,12 @@
  */
 void RIP_$AGE(void)
 {
-    int entry_idx;          /* Current entry index (0-63) */
-    int route_idx;          /* Current route index (0=standard, 1=non-standard) */
-    rip_$entry_t *entry;    /* Current entry pointer */
-    rip_$route_t *route;    /* Current route pointer */
-    uint8_t state;          /* Route state (top 2 bits of flags) */
     uint32_t current_time;  /* Current clock value */
+    uint32_t tick;
+    uint32_t ticks;
+    uint16_t id;
+    uint16_t next_id;
+    uint16_t slot;
 
     /* Acquire RIP lock */
     RIP_$LOCK();
@@ -45,79 +114,31 @@ void RIP_$AGE(void)
     /* Get current time once for consistency */
     current_time = TIME_$CLOCKH;
 
-    /* Iterate through all entries */
-    entry = &RIP_$DATA.entries[0];
-    for (entry_idx = RIP_TABLE_SIZE - 1; entry_idx >= 0; entry_idx--) {
+    /* A full turn of the wheel visits every route */
+    ticks = current_time - rip_$table.aged_to;
+    if ((int32_t)ticks > RIP_WHEEL_SLOTS) {
+        ticks = RIP_WHEEL_SLOTS;
+    }
 
-        /* Iterate through both route slots */
-        for (route_idx = 0; route_idx < RIP_ROUTES_PER_ENTRY; route_idx++) {
-            /* Get route pointer (slot 0 at offset 0x04, slot 1 at offset 0x18) */
-            route = &entry->routes[route_idx];
+    for (tick = 1; (int32_t)tick <= (int32_t)ticks; tick++) {
+        slot = (uint16_t)(rip_$table.aged_to + tick) & RIP_WHEEL_MASK;
 
-            /* Get state from top 2 bits of flags */
-            state = (route->flags >> RIP_STATE_SHIFT) & 0x03;
+        for (id = rip_$table.wheel[slot]; id != RIP_NIL; id = next_id) {
+            next_id = rip_$table.wheel_next[id];
 
-            /* Skip unused routes */
-            if (state == RIP_STATE_UNUSED) {
+            /* Not due yet: a later turn of the wheel */
+            if ((int32_t)current_time <=
+                (int32_t)RIP_$INFO[id >> 1].routes[id & 1].expiration) {
                 continue;
             }
 
-            /* Check if route has expired */
-            if ((int32_t)current_time <= (int32_t)route->expiration) {
-                continue;  /* Not expired yet */
-            }
-
-            /* Handle based on current state */
-            switch (state) {
-            case RIP_STATE_VALID:
-                /*
-                 * Valid route expired - transition to AGING if metric is non-zero.
-                 * Routes with metric 0 are direct routes that shouldn't age.
-                 */
-                if (route->metric != 0) {
-                    /* Set new expiration time */
-                    route->expiration = current_time + RIP_ROUTE_TIMEOUT;
-                    /* Transition to AGING state */
-                    route->flags = (route->flags & ~RIP_STATE_MASK) |
-                                   (RIP_STATE_AGING << RIP_STATE_SHIFT);
-                }
-                break;
-
-            case RIP_STATE_AGING:
-                /*
-                 * Aging route expired - transition to EXPIRED.
-                 * Set metric to infinity and mark that we have changes to advertise.
-                 */
-                route->metric = RIP_INFINITY;
-
-                /* Mark recent changes flag based on route type */
-                if (route_idx == 1) {
-                    /* Non-standard route (index 1) */
-                    RIP_$DATA.std_recent_changes = 0xFF;
-                } else {
-                    /* Standard route (index 0) */
-                    RIP_$DATA.recent_changes = 0xFF;
-                }
-
-                /* Set new expiration time */
-                route->expiration = current_time + RIP_ROUTE_TIMEOUT;
-                /* Transition to EXPIRED state */
-                route->flags |= RIP_STATE_MASK;  /* State 3 = 0xC0 */
-                break;
-
-            case RIP_STATE_EXPIRED:
-                /*
-                 * Expired route expired again - clear the entry.
-                 * Set state to UNUSED so the slot can be reused.
-                 */
-                route->flags &= ~RIP_STATE_MASK;  /* State 0 = unused */
-                break;
-            }
+            rip_$unschedule(&RIP_$INFO[id >> 1].routes[id & 1]);
+            rip_$age_route(id >> 1, id & 1, current_time);
         }
-
-        entry++;  /* Move to next entry */
     }
 
+    rip_$table.aged_to = current_time;
+
     /* Release RIP lock */
     RIP_$UNLOCK();
 
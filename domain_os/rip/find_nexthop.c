@@ -3,7 +3,8 @@
  *
  * This function determines how to route a packet to a destination address.
  * It first checks local ports (direct connectivity), then falls back to
- * the routing table for indirect routes.
+ * the routing table for indirect routes.  Every forwarded packet comes
+ * here, so the table is normally read without taking the RIP lock.
  *
  * Original address: 0x00E15696
  */
@@ -54,7 +55,9 @@ static void copy_xns_addr(void *dst, const void *src)
  * 3. Check local port table for direct connectivity:
  *    - Scan 8 ports, looking for matching network with active flags
  *    - If found: set port number, increment direct hits, return 0
- * 4. Look up in routing table:
+ * 4. Look up in routing table without the lock, retrying if the table
+ *    changed under the lookup (see RIP_$LOCK); if it keeps changing,
+ *    or is being changed now, look up under the lock:
  *    - Acquire exclusion lock
  *    - Call RIP_$NET_LOOKUP with inc_refcount=0xFF, create=0
  *    - If entry found:
@@ -77,6 +80,11 @@ uint8_t RIP_$FIND_NEXTHOP(void *addr_info, int8_t flags, uint16_t *port_ret,
     rip_$route_t *route;
     uint8_t metric;
     uint8_t state;
+    rip_$route_t route_copy;
+    uint32_t seq;
+    uint16_t idx;
+    int8_t found;
+    int16_t tries;
 
     /* Initialize outputs */
     *port_ret = 0;
@@ -112,7 +120,47 @@ uint8_t RIP_$FIND_NEXTHOP(void *addr_info, int8_t flags, uint16_t *port_ret,
     }
 
     /*
-     * No direct route - look up in routing table.
+     * No direct route - look up in routing table, first without the
+     * lock.  The route is copied out and used only if the table did not
+     * change while we looked (rip_$table.seq even and the same after).
+     */
+    for (tries = 0; tries < RIP_READ_TRIES; tries++) {
+        seq = rip_$table.seq;
+        if ((seq & 1) != 0) {
+            /* Being changed: wait for it on the lock */
+            break;
+        }
+
+        idx = rip_$find(dest_network);
+        if (idx == RIP_NIL) {
+            found = 0;
+        } else {
+            found = -1;
+            route_copy = RIP_$INFO[idx].routes[(flags < 0) ? 1 : 0];
+        }
+
+        if (rip_$table.seq != seq) {
+            continue;
+        }
+
+        if (found < 0) {
+            metric = route_copy.metric;
+            state = (route_copy.flags >> RIP_STATE_SHIFT) & 0x03;
+            if (metric < 0x10 &&
+                (state == RIP_STATE_VALID || state == RIP_STATE_AGING)) {
+                *port_ret = route_copy.port;
+                if (metric != 0) {
+                    copy_xns_addr(nexthop_ret, &route_copy.nexthop);
+                }
+                return metric;
+            }
+        }
+
+        *status_ret = RIP_$STATUS_NO_ROUTE;
+        return 0;
+    }
+
+    /*
      * Need to hold exclusion lock while accessing routing table.
      */
     ML_$EXCLUSION_START(&RIP_$DATA.exclusion);
@@ -72,6 +72,7 @@ void RIP_$INIT(void)
     ML_$EXCLUSION_INIT(&RIP_$DATA.exclusion);
     ML_$EXCLUSION_INIT(&RIP_$DATA.route_service_mutex);
     ML_$EXCLUSION_INIT(&RIP_$DATA.xns_error_mutex);
+    rip_$table_init();
 
     /*
      * Step 2: Check if diskless boot
@@ -5,6 +5,10 @@
  * They use a combination of priority locking (PROC1_$SET_LOCK) and
  * exclusion locks (ML_$EXCLUSION_START/STOP).
  *
+ * Holding the lock is what allows the table to change, so rip_$table.seq
+ * is made odd on taking it and even again on release; readers that do
+ * not take the lock use it to see whether they raced a change.
+ *
  * Original addresses:
  *   RIP_$LOCK:   0x00E154A4
  *   RIP_$UNLOCK: 0x00E154C4
@@ -25,6 +29,8 @@ void RIP_$LOCK(void)
 
     /* Acquire exclusion lock */
     ML_$EXCLUSION_START(&RIP_$DATA.exclusion);
+
+    rip_$table.seq++;
 }
 
 /*
@@ -34,6 +40,8 @@ void RIP_$LOCK(void)
  */
 void RIP_$UNLOCK(void)
 {
+    rip_$table.seq++;
+
     /* Release exclusion lock */
     ML_$EXCLUSION_STOP(&RIP_$DATA.exclusion);
 
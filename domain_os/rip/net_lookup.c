@@ -1,98 +1,291 @@
 /*
  * RIP_$NET_LOOKUP - Look up network in routing table
  *
- * This function implements a hash table lookup for routing table entries.
- * The table has 64 entries with linear probing for collision resolution.
+ * The original table was 64 entries with linear probing from
+ * (network & 0x3F).  Entries now live in a pool of RIP_TABLE_MAX and are
+ * found through hash chains whose bucket count doubles as the table
+ * fills, so a lookup stays a few probes however many networks there are.
+ *
+ * Also here are the rest of the table index helpers: chain maintenance
+ * and the timer wheel that RIP_$AGE runs.
  *
  * Original address: 0x00E154E4
  */
 
 #include "rip/rip_internal.h"
 
+rip_$table_t rip_$table;
+
+static uint16_t rip_$hash(uint32_t network, uint16_t mask)
+{
+    return (uint16_t)(network ^ (network >> 9) ^ (network >> 18)) & mask;
+}
+
+/* Route number on the wheel: entry * 2 + route slot */
+static uint16_t rip_$route_id(rip_$route_t *route)
+{
+    uint16_t idx;
+
+    idx = (uint16_t)(((uint8_t *)route - (uint8_t *)RIP_$INFO) /
+                     sizeof(rip_$entry_t));
+    return idx * 2 + (route == &RIP_$INFO[idx].routes[1] ? 1 : 0);
+}
+
+void rip_$table_init(void)
+{
+    int i;
+
+    rip_$table.mask = RIP_HASH_MIN - 1;
+    rip_$table.count = 0;
+    rip_$table.alloc_hint = 0;
+    rip_$table.aged_to = TIME_$CLOCKH;
+
+    for (i = 0; i < RIP_HASH_MAX; i++) {
+        rip_$table.buckets[i] = RIP_NIL;
+    }
+    for (i = 0; i < RIP_WHEEL_SLOTS; i++) {
+        rip_$table.wheel[i] = RIP_NIL;
+    }
+    for (i = 0; i < RIP_TABLE_MAX * 2; i++) {
+        rip_$table.wheel_slot[i] = RIP_NIL;
+    }
+}
+
+/*
+ * rip_$find - Find a network's entry
+ *
+ * Safe without the lock: the walk is bounded, so a chain being relinked
+ * underneath it gives a wrong answer (which the caller detects from
+ * rip_$table.seq) rather than a loop.
+ */
+uint16_t rip_$find(uint32_t network)
+{
+    uint16_t idx;
+    int16_t steps;
+
+    idx = rip_$table.buckets[rip_$hash(network, rip_$table.mask)];
+    for (steps = RIP_TABLE_MAX; idx < RIP_TABLE_MAX && steps > 0; steps--) {
+        if (RIP_$INFO[idx].network == network) {
+            return idx;
+        }
+        idx = rip_$table.next[idx];
+    }
+    return RIP_NIL;
+}
+
+/*
+ * The new entry is complete before the bucket head is pointed at it, so
+ * a reader never sees half an entry.
+ */
+void rip_$link(uint16_t idx)
+{
+    uint16_t bucket;
+
+    bucket = rip_$hash(RIP_$INFO[idx].network, rip_$table.mask);
+    rip_$table.next[idx] = rip_$table.buckets[bucket];
+    rip_$table.buckets[bucket] = idx;
+    rip_$table.count++;
+}
+
+void rip_$unlink(uint16_t idx)
+{
+    uint16_t *link;
+
+    link = &rip_$table.buckets[rip_$hash(RIP_$INFO[idx].network,
+                                         rip_$table.mask)];
+    while (*link != RIP_NIL) {
+        if (*link == idx) {
+            *link = rip_$table.next[idx];
+            rip_$table.count--;
+            return;
+        }
+        link = &rip_$table.next[*link];
+    }
+}
+
+void rip_$free_entry(uint16_t idx)
+{
+    rip_$unschedule(&RIP_$INFO[idx].routes[0]);
+    rip_$unschedule(&RIP_$INFO[idx].routes[1]);
+    rip_$unlink(idx);
+    RIP_$INFO[idx].network = 0;
+    RIP_$INFO[idx].routes[0].flags &= ~RIP_STATE_MASK;
+    RIP_$INFO[idx].routes[1].flags &= ~RIP_STATE_MASK;
+}
+
+/*
+ * Double the bucket count once there are more entries than buckets.
+ */
+static void rip_$grow(void)
+{
+    uint16_t mask;
+    int i;
+
+    if (rip_$table.count <= rip_$table.mask ||
+        rip_$table.mask == RIP_HASH_MAX - 1) {
+        return;
+    }
+
+    mask = rip_$table.mask * 2 + 1;
+    for (i = 0; i <= mask; i++) {
+        rip_$table.buckets[i] = RIP_NIL;
+    }
+    rip_$table.mask = mask;
+    rip_$table.count = 0;
+
+    for (i = 0; i < RIP_TABLE_MAX; i++) {
+        if (RIP_$INFO[i].network != 0) {
+            rip_$link((uint16_t)i);
+        }
+    }
+}
+
+/*
+ * Find an entry to use: a free one if there is one, else (as the
+ * original table did) one whose routes have both expired.
+ */
+static uint16_t rip_$alloc_entry(void)
+{
+    uint16_t idx;
+    uint8_t state0, state1;
+    int i;
+
+    idx = rip_$table.alloc_hint;
+    for (i = 0; i < RIP_TABLE_MAX; i++) {
+        if (RIP_$INFO[idx].network == 0) {
+            rip_$table.alloc_hint = (idx + 1) & RIP_TABLE_MASK;
+            return idx;
+        }
+        idx = (idx + 1) & RIP_TABLE_MASK;
+    }
+
+    for (i = 0; i < RIP_TABLE_MAX; i++) {
+        state0 = (RIP_$INFO[i].routes[0].flags >> RIP_STATE_SHIFT) & 0x03;
+        state1 = (RIP_$INFO[i].routes[1].flags >> RIP_STATE_SHIFT) & 0x03;
+        if ((state0 == RIP_STATE_UNUSED || state0 == RIP_STATE_EXPIRED) &&
+            (state1 == RIP_STATE_UNUSED || state1 == RIP_STATE_EXPIRED)) {
+            rip_$free_entry((uint16_t)i);
+            return (uint16_t)i;
+        }
+    }
+
+    return RIP_NIL;
+}
+
+/*
+ * A route is due at the first tick after its expiration.  One already
+ * overdue goes in the next slot to be run.
+ */
+void rip_$schedule(rip_$route_t *route, uint32_t expiration)
+{
+    uint16_t id;
+    uint16_t slot;
+    uint32_t due;
+
+    rip_$unschedule(route);
+    route->expiration = expiration;
+
+    due = expiration + 1;
+    if ((int32_t)(due - rip_$table.aged_to) <= 0) {
+        due = rip_$table.aged_to + 1;
+    }
+
+    id = rip_$route_id(route);
+    slot = (uint16_t)due & RIP_WHEEL_MASK;
+    rip_$table.wheel_slot[id] = slot;
+    rip_$table.wheel_prev[id] = RIP_NIL;
+    rip_$table.wheel_next[id] = rip_$table.wheel[slot];
+    if (rip_$table.wheel[slot] != RIP_NIL) {
+        rip_$table.wheel_prev[rip_$table.wheel[slot]] = id;
+    }
+    rip_$table.wheel[slot] = id;
+}
+
+void rip_$unschedule(rip_$route_t *route)
+{
+    uint16_t id;
+    uint16_t next;
+    uint16_t prev;
+
+    id = rip_$route_id(route);
+    if (rip_$table.wheel_slot[id] == RIP_NIL) {
+        return;
+    }
+
+    next = rip_$table.wheel_next[id];
+    prev = rip_$table.wheel_prev[id];
+    if (prev == RIP_NIL) {
+        rip_$table.wheel[rip_$table.wheel_slot[id]] = next;
+    } else {
+        rip_$table.wheel_next[prev] = next;
+    }
+    if (next != RIP_NIL) {
+        rip_$table.wheel_prev[next] = prev;
+    }
+    rip_$table.wheel_slot[id] = RIP_NIL;
+}
+
 /*
  * RIP_$NET_LOOKUP - Look up network in routing table
  *
  * Algorithm:
- * 1. Compute hash index as (network & 0x3F)
- * 2. Linear probe through the table looking for matching network
- * 3. While probing, track first "free" slot (state 0 or 3 for both routes)
- * 4. If found:
+ * 1. Walk the network's hash chain
+ * 2. If found:
  *    - If inc_refcount < 0, increment reference count
  *    - Return pointer to entry
- * 5. If not found and create_if_missing < 0:
- *    - Use tracked free slot (if any)
- *    - Initialize network and mark routes as expired (state 3)
+ * 3. If not found and create_if_missing < 0:
+ *    - Take a free entry (or one with both routes expired)
+ *    - Initialize network and mark routes as expired (state 3), due to
+ *      be cleared at the next tick unless an update makes them valid
  *    - Set reference count based on inc_refcount flag
+ *    - Link it in, growing the hash if the table has filled
  *    - Return pointer to new entry
- * 6. If not found and no creation, return NULL
+ * 4. If not found and no creation, or the table is full, return NULL
  *
- * Note: The function does NOT acquire locks - callers must hold the RIP lock.
+ * Note: The function does NOT acquire locks - callers must hold the RIP lock
+ * to create entries.
  */
 rip_$entry_t *RIP_$NET_LOOKUP(uint32_t network, int8_t inc_refcount,
                                int16_t create_if_missing)
 {
-    uint16_t start_idx;     /* Starting hash index */
-    uint16_t idx;           /* Current probe index */
-    uint16_t free_idx;      /* First free slot found */
-    rip_$entry_t *entry;    /* Current entry pointer */
-    uint8_t state0, state1; /* Route states */
-
-    /* Compute hash */
-    start_idx = (uint16_t)network & RIP_TABLE_MASK;
-    free_idx = 0xFFFF;  /* Sentinel: no free slot found yet */
-    idx = start_idx;
-
-    /* Linear probe through the table */
-    do {
-        entry = &RIP_$DATA.entries[idx];
-
-        /* Check for match */
-        if (entry->network == network) {
-            /* Found matching entry */
-            if (inc_refcount < 0) {
-                /* Increment reference count */
-                RIP_$DATA.ref_counts[idx]++;
-            }
-            return entry;
-        }
-
-        /* Track first free slot for potential insertion */
-        if (free_idx == 0xFFFF) {
-            /* Check if both route slots are unused (state 0) or expired (state 3) */
-            state0 = (entry->routes[0].flags >> RIP_STATE_SHIFT) & 0x03;
-            state1 = (entry->routes[1].flags >> RIP_STATE_SHIFT) & 0x03;
+    uint16_t idx;
+    rip_$entry_t *entry;
 
-            if ((state0 == RIP_STATE_UNUSED || state0 == RIP_STATE_EXPIRED) &&
-                (state1 == RIP_STATE_UNUSED || state1 == RIP_STATE_EXPIRED)) {
-                free_idx = idx;
-            }
+    idx = rip_$find(network);
+    if (idx != RIP_NIL) {
+        if (inc_refcount < 0) {
+            rip_$table.ref_counts[idx]++;
         }
+        return &RIP_$INFO[idx];
+    }
 
-        /* Move to next slot (with wrap) */
-        idx = (idx + 1) & RIP_TABLE_MASK;
-    } while (idx != start_idx);
-
-    /* Not found - create new entry if requested */
-    if (create_if_missing < 0 && free_idx != 0xFFFF) {
-        entry = &RIP_$DATA.entries[free_idx];
+    if (create_if_missing >= 0) {
+        return NULL;
+    }
 
-        /* Initialize the entry */
-        entry->network = network;
+    idx = rip_$alloc_entry();
+    if (idx == RIP_NIL) {
+        return NULL;
+    }
 
-        /* Mark both routes as expired (state 3) */
-        entry->routes[0].flags |= RIP_STATE_MASK;  /* 0xC0 = state 3 */
-        entry->routes[1].flags |= RIP_STATE_MASK;
+    entry = &RIP_$INFO[idx];
+    entry->network = network;
 
-        /* Set reference count */
-        if (inc_refcount < 0) {
-            RIP_$DATA.ref_counts[free_idx] = 0;
-        } else {
-            RIP_$DATA.ref_counts[free_idx] = 1;
-        }
+    entry->routes[0].metric = RIP_INFINITY;
+    entry->routes[0].flags |= RIP_STATE_MASK;  /* 0xC0 = state 3 */
+    rip_$schedule(&entry->routes[0], TIME_$CLOCKH);
+    entry->routes[1].metric = RIP_INFINITY;
+    entry->routes[1].flags |= RIP_STATE_MASK;
+    rip_$schedule(&entry->routes[1], TIME_$CLOCKH);
 
-        return entry;
+    if (inc_refcount < 0) {
+        rip_$table.ref_counts[idx] = 0;
+    } else {
+        rip_$table.ref_counts[idx] = 1;
     }
 
-    /* Not found and not created */
-    return NULL;
+    rip_$link(idx);
+    rip_$grow();
+
+    return entry;
 }
@@ -240,8 +240,8 @@ void RIP_$PORT_CLOSE(uint16_t port_index, int8_t flags, int8_t force)
     RIP_$LOCK();
 
     /* Iterate through all routing table entries */
-    for (i = 0; i < RIP_TABLE_SIZE; i++) {
-        entry = &RIP_$DATA.entries[i];
+    for (i = 0; i < RIP_TABLE_MAX; i++) {
+        entry = &RIP_$INFO[i];
 
         /* Select standard or non-standard route based on flags */
         if (flags < 0) {
@@ -278,7 +278,7 @@ void RIP_$PORT_CLOSE(uint16_t port_index, int8_t flags, int8_t force)
         route->flags |= RIP_STATE_MASK;  /* Set both state bits = EXPIRED */
 
         /* Set expiration time (allow some time for route update propagation) */
-        route->expiration = TIME_$CLOCKH + RIP_ROUTE_TIMEOUT;
+        rip_$schedule(route, TIME_$CLOCKH + RIP_ROUTE_TIMEOUT);
 
         /* Signal that routes have changed */
         if (flags < 0) {
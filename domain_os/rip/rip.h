@@ -38,7 +38,8 @@ typedef struct rip_$stats_t {
  * RIP_$NET_LOOKUP - Look up network in routing table
  *
  * Searches the routing table for an entry matching the given network.
- * Uses a hash table with linear probing (64 entries, hash = network & 0x3F).
+ * Uses a chained hash table over up to RIP_TABLE_MAX entries, whose bucket
+ * count grows with the table.
  *
  * Behavior depends on flags:
  * - If entry found and inc_refcount < 0: increments reference count
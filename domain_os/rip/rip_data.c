@@ -3,8 +3,11 @@
 /* Main RIP data structure at 0xE26258 */
 rip_$data_t RIP_$DATA;
 
-/* RIP_$INFO - Base of routing table entries (separate from RIP_$DATA.entries) */
-rip_$entry_t *RIP_$INFO;
+/* Routing table entries, RIP_TABLE_MAX of them; network 0 = free */
+static rip_$entry_t rip_$entries[RIP_TABLE_MAX];
+
+/* RIP_$INFO - Base of routing table entries */
+rip_$entry_t *RIP_$INFO = rip_$entries;
 
 /* RIP_$STATS - Protocol statistics at 0xE262AC */
 rip_$stats_t RIP_$STATS;
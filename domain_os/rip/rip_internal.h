@@ -21,9 +21,30 @@
  * =============================================================================
  */
 
-/* Number of entries in the routing table (hash table size) */
-#define RIP_TABLE_SIZE          64
-#define RIP_TABLE_MASK          0x3F
+/*
+ * Routing table sizes.  Entries live in a pool of RIP_TABLE_MAX (RIP_$INFO,
+ * indexed as before by RIP_$TABLE_D); they are found through a chained
+ * hash whose bucket count starts at RIP_HASH_MIN and doubles, up to
+ * RIP_HASH_MAX, as the table fills.
+ */
+#define RIP_TABLE_MAX           512
+#define RIP_TABLE_MASK          (RIP_TABLE_MAX - 1)
+#define RIP_HASH_MIN            64
+#define RIP_HASH_MAX            512
+
+/* End of a hash chain or timer wheel list */
+#define RIP_NIL                 0xFFFF
+
+/*
+ * Timer wheel for route expiry, one slot per tick.  It must span more
+ * than RIP_ROUTE_TIMEOUT so that a route is never put in a slot before
+ * the one it is due in.
+ */
+#define RIP_WHEEL_SLOTS         512
+#define RIP_WHEEL_MASK          (RIP_WHEEL_SLOTS - 1)
+
+/* Tries RIP_$FIND_NEXTHOP makes without the lock before taking it */
+#define RIP_READ_TRIES          2
 
 /* Route timeout value in clock ticks (360 = 6 minutes at 1 tick/sec) */
 #define RIP_ROUTE_TIMEOUT       0x168
@@ -115,8 +136,8 @@ typedef struct rip_$data_t {
     uint8_t             _pad1[0x0A];        /* 0x52: Padding to offset 0x5C */
     uint32_t            _reserved1;         /* 0x5C: Reserved */
     uint32_t            direct_hits;        /* 0x60: Direct route hit counter */
-    uint32_t            ref_counts[RIP_TABLE_SIZE]; /* 0x64: Per-entry reference counts */
-    rip_$entry_t        entries[RIP_TABLE_SIZE];    /* 0x164: Routing table entries */
+    uint32_t            _ref_counts[64];    /* 0x64: Original reference counts (now in rip_$table) */
+    rip_$entry_t        _entries[64];       /* 0x164: Original 64-entry table (now RIP_$INFO) */
     uint8_t             _reserved2[0x862];  /* Padding to 0xC68 */
     uint8_t             bcast_control[30];  /* 0xC68: Broadcast control params */
     uint8_t             _pad3[0x1C];        /* Padding to 0xC86 */
@@ -125,6 +146,29 @@ typedef struct rip_$data_t {
     uint8_t             recent_changes;     /* 0xC88: Non-standard route changes flag */
 } rip_$data_t;
 
+/*
+ * Routing table index: hash chains and expiry timer wheel over the
+ * entries in RIP_$INFO.  Routes are numbered entry * 2 + route slot.
+ *
+ * seq is odd while the table is being changed (see RIP_$LOCK) so that
+ * RIP_$FIND_NEXTHOP can read without the lock and check that nothing
+ * moved underneath it.
+ */
+typedef struct rip_$table_t {
+    volatile uint32_t   seq;                            /* Change count */
+    uint16_t            mask;                           /* Hash buckets - 1 */
+    uint16_t            count;                          /* Entries in use */
+    uint16_t            alloc_hint;                     /* Where to look for a free entry */
+    uint32_t            aged_to;                        /* Last tick the wheel was run to */
+    uint16_t            buckets[RIP_HASH_MAX];          /* Hash chain heads */
+    uint16_t            next[RIP_TABLE_MAX];            /* Hash chain links */
+    uint16_t            wheel[RIP_WHEEL_SLOTS];         /* Wheel slot list heads */
+    uint16_t            wheel_next[RIP_TABLE_MAX * 2];  /* Wheel list links */
+    uint16_t            wheel_prev[RIP_TABLE_MAX * 2];
+    uint16_t            wheel_slot[RIP_TABLE_MAX * 2];  /* Slot, or RIP_NIL if not on wheel */
+    uint32_t            ref_counts[RIP_TABLE_MAX];      /* Per-entry reference counts */
+} rip_$table_t;
+
 /*
  * =============================================================================
  * Global Data (m68k addresses)
@@ -133,6 +177,7 @@ typedef struct rip_$data_t {
 
 extern rip_$data_t RIP_$DATA;
 extern rip_$entry_t *RIP_$INFO;
+extern rip_$table_t rip_$table;
 extern rip_$stats_t RIP_$STATS;
 extern int16_t ROUTE_$STD_N_ROUTING_PORTS;
 extern int16_t ROUTE_$N_ROUTING_PORTS;
@@ -173,7 +218,7 @@ void RIP_$UNLOCK(void);
 /*
  * RIP_$AGE - Age routing table entries
  *
- * Scans all routing table entries and ages them:
+ * Runs the route timer wheel up to now and ages the routes falling due:
  * - VALID routes past expiration become AGING
  * - AGING routes past expiration become EXPIRED (metric set to infinity)
  * - EXPIRED routes are cleared (UNUSED)
@@ -184,6 +229,35 @@ void RIP_$UNLOCK(void);
  */
 void RIP_$AGE(void);
 
+/*
+ * Routing table index (rip/net_lookup.c).  All but rip_$find must be
+ * called with the RIP lock held.
+ */
+
+/* Set up an empty table */
+void rip_$table_init(void);
+
+/* Index of the entry for network, or RIP_NIL */
+uint16_t rip_$find(uint32_t network);
+
+/* Take an entry off its hash chain and free it */
+void rip_$free_entry(uint16_t idx);
+
+/* Put an entry whose network has been set on its hash chain */
+void rip_$link(uint16_t idx);
+
+/* Take an entry off its hash chain */
+void rip_$unlink(uint16_t idx);
+
+/*
+ * Set a route's expiration and put it on the timer wheel to be aged
+ * when it passes.
+ */
+void rip_$schedule(rip_$route_t *route, uint32_t expiration);
+
+/* Take a route off the timer wheel */
+void rip_$unschedule(rip_$route_t *route);
+
 /*
  * RIP_$SEND_UPDATES - Send routing updates
  *
@@ -331,6 +331,28 @@ void RIP_$SEND(void *addr_info, int16_t port_index, void *route_data,
     }
 }
 
+/*
+ * Send one packet of RIP_$BROADCAST's routes to all ports.
+ */
+static void rip_$broadcast_send(uint8_t *response_buf, int16_t entry_count,
+                                uint8_t flags)
+{
+    /* Broadcast address buffer: network + host + socket */
+    uint8_t addr_buf[12];
+    int16_t i;
+
+    /* Calculate total packet length: cmd (2 bytes) + entries (6 bytes each) */
+    uint16_t packet_len = entry_count * 6 + 2;
+
+    /* Clear address buffer */
+    for (i = 0; i < 12; i++) {
+        addr_buf[i] = 0;
+    }
+
+    /* Send to all ports (port_index = -1) */
+    RIP_$SEND(addr_buf, -1, response_buf, packet_len, flags);
+}
+
 /*
  * =============================================================================
  * RIP_$BROADCAST
@@ -338,8 +360,9 @@ void RIP_$SEND(void *addr_info, int16_t port_index, void *route_data,
  *
  * Build and broadcast the full routing table.
  *
- * This function iterates through all routing table entries, builds a RIP
- * response packet containing all valid routes, and sends it to all ports.
+ * This function iterates through all routing table entries, builds RIP
+ * response packets containing all valid routes, and sends them to all
+ * ports, RIP_MAX_ENTRIES routes to a packet.
  *
  * @param flags     If < 0: broadcast non-standard routes (cap metric at 16)
  *                  If >= 0: broadcast standard routes
@@ -365,17 +388,14 @@ void RIP_$BROADCAST(uint8_t flags)
     uint16_t metric;
     int route_offset;
 
-    /* Broadcast address buffer: network + host + socket */
-    uint8_t addr_buf[12];
-
     /* Set response command = 2 */
     cmd_ptr = (uint16_t *)response_buf;
     *cmd_ptr = 2;
 
     entry_count = 0;
 
-    /* Iterate through all 64 routing table entries */
-    for (i = 0; i < RIP_TABLE_SIZE; i++) {
+    /* Iterate through all routing table entries */
+    for (i = 0; i < RIP_TABLE_MAX; i++) {
         entry = &RIP_$INFO[i];
 
         /* Select route based on flags */
@@ -436,23 +456,15 @@ void RIP_$BROADCAST(uint8_t flags)
         }
         *(uint16_t *)(response_buf + route_offset - 2 + 4) = metric;
 
-        /* Maximum 90 entries per packet */
+        /* Maximum 90 entries per packet: send this one, start another */
         if (entry_count >= RIP_MAX_ENTRIES) {
-            break;
+            rip_$broadcast_send(response_buf, entry_count, flags);
+            entry_count = 0;
         }
     }
 
     /* If we have entries, send the packet */
     if (entry_count > 0) {
-        /* Calculate total packet length: cmd (2 bytes) + entries (6 bytes each) */
-        uint16_t packet_len = entry_count * 6 + 2;
-
-        /* Clear address buffer */
-        for (i = 0; i < 12; i++) {
-            addr_buf[i] = 0;
-        }
-
-        /* Send to all ports (port_index = -1) */
-        RIP_$SEND(addr_buf, -1, response_buf, packet_len, flags);
+        rip_$broadcast_send(response_buf, entry_count, flags);
     }
 }
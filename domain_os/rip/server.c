@@ -295,7 +295,7 @@ static void RIP_$PROCESS_REQUEST_INTERNAL(int8_t flags, uint8_t *frame_ptr)
         *(int16_t *)(frame_ptr - 0x512) = 0;
 
         /* Enumerate all routing table entries */
-        for (i = 0; i < RIP_TABLE_SIZE; i++) {
+        for (i = 0; i < RIP_TABLE_MAX; i++) {
             entry = &RIP_$INFO[i];
 
             if (flags < 0) {
@@ -518,7 +518,7 @@ uint16_t RIP_$SERVER(void)
                 if (net == 0xFFFFFFFF) {
                     /* Full table request - enumerate all routes */
                     int j;
-                    for (j = 0; j < RIP_TABLE_SIZE && response_count < RIP_MAX_ENTRIES; j++) {
+                    for (j = 0; j < RIP_TABLE_MAX && response_count < RIP_MAX_ENTRIES; j++) {
                         entry = &RIP_$INFO[j];
                         rip_$route_t *route = &entry->routes[1];
                         uint8_t state = (route->flags >> RIP_STATE_SHIFT) & 0x03;
@@ -596,7 +596,7 @@ uint16_t RIP_$SERVER(void)
                 if (net == 0xFFFFFFFF) {
                     /* Full table request */
                     int j;
-                    for (j = 0; j < RIP_TABLE_SIZE && response_count < RIP_MAX_ENTRIES; j++) {
+                    for (j = 0; j < RIP_TABLE_MAX && response_count < RIP_MAX_ENTRIES; j++) {
                         entry = &RIP_$INFO[j];
                         rip_$route_t *route = &entry->routes[0];
                         uint8_t state = (route->flags >> RIP_STATE_SHIFT) & 0x03;
@@ -22,7 +22,7 @@
  * Parameters:
  *   op_flag    - If *op_flag < 0, read; else write
  *   route_type - If *route_type < 0, non-standard route; else standard route
- *   index      - Pointer to entry index (0-63, masked to 6 bits)
+ *   index      - Pointer to entry index (masked to RIP_TABLE_MASK)
  *   buffer     - Data buffer for read/write
  *   status_ret - Status return (0 = success)
  *
@@ -51,7 +51,7 @@ void RIP_$TABLE_D(int8_t *op_flag, int8_t *route_type, uint16_t *index,
         /*
          * READ OPERATION
          *
-         * 1. Mask index to valid range (0-63)
+         * 1. Mask index to valid range
          * 2. Copy entire entry to local buffer
          * 3. Select route based on route_type
          * 4. Copy route data to output buffer
@@ -156,8 +156,25 @@ void RIP_$TABLE_D(int8_t *op_flag, int8_t *route_type, uint16_t *index,
         route_ptr->flags = (route_ptr->flags & 0x3F) |
                            ((buffer->state & 0x03) << RIP_STATE_SHIFT);
 
-        /* Write entry back to table */
+        /*
+         * Write entry back to table, taking it off its hash chain and the
+         * timer wheel while it changes and putting it back after.
+         */
+        RIP_$LOCK();
+        if (RIP_$INFO[masked_index].network != 0) {
+            rip_$free_entry(masked_index);
+        }
         memcpy(&RIP_$INFO[masked_index], &local_entry, sizeof(rip_$entry_t));
+        if (local_entry.network != 0) {
+            rip_$link(masked_index);
+            for (i = 0; i < RIP_ROUTES_PER_ENTRY; i++) {
+                if ((local_entry.routes[i].flags & RIP_STATE_MASK) != 0) {
+                    rip_$schedule(&RIP_$INFO[masked_index].routes[i],
+                                  local_entry.routes[i].expiration);
+                }
+            }
+        }
+        RIP_$UNLOCK();
     }
 }
 
@@ -160,7 +160,7 @@ static void rip_$apply_update(rip_$route_t *route,
             route->flags = (route->flags & ~RIP_STATE_MASK) |
                            (RIP_STATE_AGING << RIP_STATE_SHIFT);
             /* Set short timeout */
-            route->expiration = TIME_$CLOCKH + RIP_AGING_TIMEOUT;
+            rip_$schedule(route, TIME_$CLOCKH + RIP_AGING_TIMEOUT);
             return;
         }
     }
@@ -187,7 +187,7 @@ static void rip_$apply_update(rip_$route_t *route,
                    (RIP_STATE_VALID << RIP_STATE_SHIFT);
 
     /* Set normal timeout */
-    route->expiration = TIME_$CLOCKH + RIP_ROUTE_TIMEOUT;
+    rip_$schedule(route, TIME_$CLOCKH + RIP_ROUTE_TIMEOUT);
 }
 
 /*
@@ -238,13 +238,13 @@ void RIP_$UPDATE_INT(uint32_t network, rip_$xns_addr_t *source,
     if (network == (uint32_t)-1) {
         /*
          * Update all entries mode:
-         * Walk through all 64 entries and update routes where:
+         * Walk through all entries and update routes where:
          * - Source matches the provided source
          * - State is not UNUSED
          */
-        entry = &RIP_$DATA.entries[0];
+        entry = &RIP_$INFO[0];
 
-        for (i = RIP_TABLE_SIZE - 1; i >= 0; i--) {
+        for (i = RIP_TABLE_MAX - 1; i >= 0; i--) {
             /* Select standard or non-standard route based on flags */
             if (flags < 0) {
                 route = &entry->routes[1];  /* Non-standard at offset 0x18 */
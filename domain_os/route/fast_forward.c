@@ -0,0 +1,166 @@
+/*
+ * ROUTE_$FAST_FORWARD - Forward a transit packet without the routing process
+ *
+ * Every transit packet used to be queued to the routing socket to wait
+ * for ROUTE_$PROCESS to be scheduled, look up its next hop and send it
+ * on.  The routing process now remembers where it sent packets in a
+ * small flow cache keyed by destination network and host, and the
+ * receive side offers each transit packet here before queueing it: a
+ * packet for a remembered flow has its hop count and checksum updated
+ * and goes straight to the outgoing port's driver from the receiving
+ * process.
+ *
+ * A flow is good only while the RIP table is as it was when the flow was
+ * filled (rip_$table.seq), so any change to the routes sends the next
+ * packet of every flow back through the routing process.  Only normal
+ * routing to local ports is cached; user routing ports and standard
+ * routing always go the long way.
+ */
+
+#include "route/route_internal.h"
+#include "rip/rip_internal.h"
+#include "ml/ml.h"
+#include "netbuf/netbuf.h"
+#include "pkt/pkt.h"
+#include "net_io/net_io.h"
+#include "xns/xns.h"
+
+#define NET_IO_LOCK_ID          0x18
+
+/* Largest packet ROUTE_$PROCESS forwards to a local port */
+#define MAX_FORWARD_SIZE        0x400
+
+/* Hop count past which ROUTE_$PROCESS drops a packet */
+#define MAX_HOP_COUNT           0x10
+
+/* IDP header follows the internet header in the header buffer */
+#define ROUTE_IDP_OFFSET        0x28
+
+/* Internet header fields ROUTE_$PROCESS sends with */
+#define ROUTE_HDR_LEN_OFFSET    0x10
+#define ROUTE_DATA_LEN_OFFSET   0x14
+
+#if defined(ARCH_M68K)
+#define ROUTE_$FWD_TIMEOUT      (*(uint16_t *)0xE88224)
+#define NODE_$ME                (*(uint32_t *)0xE245A4)
+#else
+extern uint16_t ROUTE_$FWD_TIMEOUT;
+extern uint32_t NODE_$ME;
+#endif
+
+static route_$flow_t route_$flows[ROUTE_FLOW_SLOTS];
+static uint32_t route_$flow_hits;
+static uint32_t route_$flow_misses;
+
+static uint16_t route_$flow_hash(uint32_t network, uint32_t host_lo)
+{
+    uint32_t h;
+
+    h = network ^ host_lo;
+    return (uint16_t)(h ^ (h >> 5) ^ (h >> 16)) & ROUTE_FLOW_MASK;
+}
+
+/*
+ * route_$flow_fill - Remember where a flow's packets go
+ *
+ * Called by ROUTE_$PROCESS after it has sent a packet to a local port.
+ * seq is rip_$table.seq from before the next hop was looked up; a flow
+ * filled from a lookup that raced a table change never matches.  The
+ * entry is marked unusable while it is rewritten so that a receive
+ * process running in between does not see half of it.
+ */
+void route_$flow_fill(uint32_t network, uint16_t host_hi, uint32_t host_lo,
+                      uint16_t port, uint32_t seq)
+{
+    route_$flow_t *flow;
+
+    if ((seq & 1) != 0) {
+        return;
+    }
+
+    flow = &route_$flows[route_$flow_hash(network, host_lo)];
+    flow->seq = 1;
+    flow->network = network;
+    flow->host_hi = host_hi;
+    flow->host_lo = host_lo;
+    flow->port = port;
+    flow->seq = seq;
+}
+
+int8_t ROUTE_$FAST_FORWARD(uint32_t *packet_buffer, uint32_t *data_bufs)
+{
+    uint8_t *idp;
+    route_$flow_t *flow;
+    route_$port_t *dest_port;
+    uint32_t network;
+    uint16_t host_hi;
+    uint32_t host_lo;
+    uint16_t port;
+    uint32_t seq;
+    uint16_t checksum;
+    uint16_t data_len;
+    uint32_t pkt_array[1];
+    uint32_t flags;
+    status_$t status;
+
+    data_len = *(uint16_t *)((uint8_t *)packet_buffer + ROUTE_DATA_LEN_OFFSET);
+    if (ROUTE_$ROUTING == 0 || data_len > MAX_FORWARD_SIZE) {
+        return 0;
+    }
+
+    idp = (uint8_t *)packet_buffer + ROUTE_IDP_OFFSET;
+    network = *(uint32_t *)(idp + 0x06);
+    host_hi = *(uint16_t *)(idp + 0x0A);
+    host_lo = *(uint32_t *)(idp + 0x0C);
+
+    seq = rip_$table.seq;
+    flow = &route_$flows[route_$flow_hash(network, host_lo)];
+    port = flow->port;
+    if (flow->seq != seq || flow->network != network ||
+        flow->host_hi != host_hi || flow->host_lo != host_lo ||
+        port >= ROUTE_MAX_PORTS) {
+        route_$flow_misses++;
+        return 0;
+    }
+
+    /* Same checks as ROUTE_$PROCESS: still a normal routing port */
+    dest_port = &ROUTE_$PORT_ARRAY[port];
+    if (dest_port->port_type == ROUTE_PORT_TYPE_ROUTING ||
+        ((1 << (dest_port->active & 0x1f)) & 0x28) == 0 ||
+        idp[4] >= MAX_HOP_COUNT) {
+        route_$flow_misses++;
+        return 0;
+    }
+
+    idp[4]++;
+    checksum = *(uint16_t *)idp;
+    if (checksum != 0xFFFF) {
+        *(uint16_t *)idp = XNS_IDP_$HOP_AND_SUM(checksum,
+                                                *(uint16_t *)(idp + 0x02));
+    }
+    *(uint32_t *)((uint8_t *)packet_buffer + 8) = NODE_$ME;
+
+    flags = *(uint32_t *)(((uint32_t)packet_buffer & ~0x3FF) + 0x3FC);
+
+    ML_$LOCK(NET_IO_LOCK_ID);
+
+    pkt_array[0] = (uint32_t)packet_buffer;
+    NET_IO_$SEND((int16_t)port, pkt_array, flags,
+                 *(uint16_t *)((uint8_t *)packet_buffer + ROUTE_HDR_LEN_OFFSET),
+                 0, NULL, data_len, ROUTE_$FWD_TIMEOUT, NULL, &status);
+
+    ML_$UNLOCK(NET_IO_LOCK_ID);
+
+    /* Sent or not, the packet is done with, as in ROUTE_$PROCESS */
+    NETBUF_$RTN_HDR(pkt_array);
+    PKT_$DUMP_DATA(data_bufs, (int16_t)data_len);
+
+    route_$flow_hits++;
+    return -1;
+}
+
+void ROUTE_$FLOW_STATS(uint32_t *hits, uint32_t *misses)
+{
+    *hits = route_$flow_hits;
+    *misses = route_$flow_misses;
+}
@@ -154,6 +154,9 @@ void ROUTE_$PROCESS(void)
     status_$t status;
     uint32_t *packet_buffer;
     void *packet_ptr;
+    uint32_t batch[SOCK_BATCH_MAX][SOCK_PKT_INFO_SIZE / 4];
+    int16_t n_batch;
+    int16_t batch_index;
     idp_header_t *idp_hdr;
     int16_t next_hop_port;
     uint8_t next_hop_addr[6];
@@ -166,6 +169,7 @@ void ROUTE_$PROCESS(void)
     int32_t port_index;
     uint16_t packet_size;
     uint32_t packet_network;
+    uint32_t rip_seq;
 
     /*
      * Wait for initialization to complete
@@ -240,208 +244,227 @@ void ROUTE_$PROCESS(void)
 
         case 1:
             /*
-             * Packet received on routing socket
+             * Packets received on routing socket.  Take everything that
+             * is queued, not just the packet this advance was for, and
+             * wake the user ports forwarded to once for the burst.
              */
-            if (SOCK_$GET(ROUTE_$SOCK, &packet_ptr) >= 0) {
-                /* SOCK_$GET should return negative on success */
+            n_batch = SOCK_$GET_BATCH(ROUTE_$SOCK, batch, SOCK_BATCH_MAX);
+            if (n_batch == 0) {
+                /* The socket EC said there was a packet */
                 CRASH_SYSTEM(&status_$route_sock_get_failed);
             }
 
-            packet_buffer = (uint32_t *)packet_ptr;
+            for (batch_index = 0; batch_index < n_batch; batch_index++) {
+                packet_ptr = (void *)batch[batch_index][0];
+                packet_buffer = (uint32_t *)packet_ptr;
 
-            /*
-             * Update packet size statistics
-             * Index is capped at 0x80 (128)
-             */
-            {
-                uint8_t size_index = ((uint8_t *)socket_ec)[0x15];
-                if (size_index > 0x80) {
-                    size_index = 0x80;
+                /*
+                 * Update packet size statistics
+                 * Index is capped at 0x80 (128)
+                 */
+                {
+                    uint8_t size_index = ((uint8_t *)socket_ec)[0x15];
+                    if (size_index > 0x80) {
+                        size_index = 0x80;
+                    }
+                    ROUTE_$PACKET_STATS[size_index]++;
                 }
-                ROUTE_$PACKET_STATS[size_index]++;
-            }
-
-            /*
-             * Determine routing type from packet flags
-             * Bit 1 of flags at offset -0x9F indicates standard routing
-             */
-            is_std_routing = 0;  /* Will be set based on packet flags */
 
-            /*
-             * Get IDP header pointer
-             * If standard routing, header is at packet start
-             * Otherwise, header is at packet + 0x28 (after MAC header)
-             */
-            if (is_std_routing) {
-                idp_hdr = (idp_header_t *)packet_buffer;
-            } else {
-                idp_hdr = (idp_header_t *)((uint8_t *)packet_buffer + 0x28);
-            }
+                /*
+                 * Determine routing type from packet flags
+                 * Bit 1 of flags at offset -0x9F indicates standard routing
+                 */
+                is_std_routing = 0;  /* Will be set based on packet flags */
 
-            should_forward = 0xFF;
+                /*
+                 * Get IDP header pointer
+                 * If standard routing, header is at packet start
+                 * Otherwise, header is at packet + 0x28 (after MAC header)
+                 */
+                if (is_std_routing) {
+                    idp_hdr = (idp_header_t *)packet_buffer;
+                } else {
+                    idp_hdr = (idp_header_t *)((uint8_t *)packet_buffer + 0x28);
+                }
 
-            /*
-             * Check for broadcast with non-zero source socket
-             * (should not be forwarded)
-             */
-            /* Complex condition from original - simplified */
+                should_forward = 0xFF;
 
-            /*
-             * Increment transport control (hop count)
-             */
-            idp_hdr->transport_ctl++;
+                /*
+                 * Check for broadcast with non-zero source socket
+                 * (should not be forwarded)
+                 */
+                /* Complex condition from original - simplified */
 
-            /*
-             * Recalculate checksum if not disabled
-             */
-            if (idp_hdr->checksum != 0xFFFF) {
-                idp_hdr->checksum = XNS_IDP_$HOP_AND_SUM(idp_hdr->checksum, idp_hdr->length);
-            }
+                /*
+                 * Increment transport control (hop count)
+                 */
+                idp_hdr->transport_ctl++;
 
-            /*
-             * Check hop count limit
-             */
-            if (should_forward && idp_hdr->transport_ctl > MAX_HOP_COUNT) {
-                if (is_std_routing) {
-                    STAT_DROPPED_STD_HOP++;
-                } else {
-                    STAT_DROPPED_N_HOP++;
+                /*
+                 * Recalculate checksum if not disabled
+                 */
+                if (idp_hdr->checksum != 0xFFFF) {
+                    idp_hdr->checksum = XNS_IDP_$HOP_AND_SUM(idp_hdr->checksum, idp_hdr->length);
                 }
-                should_forward = 0;
-            }
-
-            /*
-             * Find next hop for destination
-             */
-            if (should_forward) {
-                RIP_$FIND_NEXTHOP(&idp_hdr->dst_network, 0, &next_hop_port,
-                                  next_hop_addr, &status);
 
-                if (status != status_$ok) {
+                /*
+                 * Check hop count limit
+                 */
+                if (should_forward && idp_hdr->transport_ctl > MAX_HOP_COUNT) {
                     if (is_std_routing) {
-                        STAT_DROPPED_STD_ROUTE++;
+                        STAT_DROPPED_STD_HOP++;
                     } else {
-                        STAT_DROPPED_N_ROUTE++;
+                        STAT_DROPPED_N_HOP++;
                     }
                     should_forward = 0;
                 }
-            }
-
-            was_forwarded = 0;
-
-            if (should_forward) {
-                port_index = (int32_t)next_hop_port;
-                dest_port = &ROUTE_$PORT_ARRAY[port_index];
 
                 /*
-                 * Validate destination port is in appropriate routing mode
+                 * Find next hop for destination
                  */
-                if (is_std_routing) {
-                    if (((1 << (dest_port->active & 0x1f)) & 0x30) == 0) {
-                        STAT_DROPPED_STD_ROUTE++;
-                        should_forward = 0;
-                    }
-                } else {
-                    if (((1 << (dest_port->active & 0x1f)) & 0x28) == 0) {
-                        STAT_DROPPED_N_ROUTE++;
+                if (should_forward) {
+                    rip_seq = rip_$table.seq;
+                    RIP_$FIND_NEXTHOP(&idp_hdr->dst_network, 0, &next_hop_port,
+                                      next_hop_addr, &status);
+
+                    if (status != status_$ok) {
+                        if (is_std_routing) {
+                            STAT_DROPPED_STD_ROUTE++;
+                        } else {
+                            STAT_DROPPED_N_ROUTE++;
+                        }
                         should_forward = 0;
                     }
-
-                    /* Set source node and network for outgoing */
-                    *(uint32_t *)((uint8_t *)packet_buffer + 8) = NODE_$ME;
-                    *packet_buffer = packet_network & 0xFFFFF;
                 }
 
-                /*
-                 * Forward based on destination port type
-                 */
-                if (dest_port->port_type == ROUTE_PORT_TYPE_ROUTING) {
+                was_forwarded = 0;
+
+                if (should_forward) {
+                    port_index = (int32_t)next_hop_port;
+                    dest_port = &ROUTE_$PORT_ARRAY[port_index];
+
                     /*
-                     * Type 2: User/routing port - send via socket
+                     * Validate destination port is in appropriate routing mode
                      */
-                    if (RING_$LOGGING_NOW < 0) {
-                        RINGLOG_$LOGIT(&RINGLOG_$ROUTE_FORWARD, packet_buffer);
-                    }
-
-                    if (SOCK_$PUT(dest_port->socket, &packet_ptr, 0, 2,
-                                  dest_port->socket) < 0) {
-                        was_forwarded = 0xFF;
-                        /* Update port-specific statistics */
+                    if (is_std_routing) {
+                        if (((1 << (dest_port->active & 0x1f)) & 0x30) == 0) {
+                            STAT_DROPPED_STD_ROUTE++;
+                            should_forward = 0;
+                        }
                     } else {
-                        /* Update error statistics */
-                    }
+                        if (((1 << (dest_port->active & 0x1f)) & 0x28) == 0) {
+                            STAT_DROPPED_N_ROUTE++;
+                            should_forward = 0;
+                        }
 
-                    /* Update port forward counter */
-                    *(uint32_t *)((uint8_t *)dest_port + 0x58) += 1;
+                        /* Set source node and network for outgoing */
+                        *(uint32_t *)((uint8_t *)packet_buffer + 8) = NODE_$ME;
+                        *packet_buffer = packet_network & 0xFFFFF;
+                    }
 
-                } else if (packet_size <= MAX_FORWARD_SIZE) {
                     /*
-                     * Type 1: Local network port
+                     * Forward based on destination port type
                      */
-                    if (is_std_routing) {
+                    if (dest_port->port_type == ROUTE_PORT_TYPE_ROUTING) {
                         /*
-                         * Standard routing - use MAC_OS_$SEND
+                         * Type 2: User/routing port - send via socket
                          */
-                        uint8_t hw_addr[6];
-                        uint8_t arp_info[4];
-
-                        MAC_OS_$ARP(next_hop_addr, next_hop_port, hw_addr, arp_info, &status);
-
-                        if (status == status_$ok) {
-                            /* Build and send ethernet frame */
-                            /* ... complex packet construction ... */
-                            MAC_OS_$SEND(NULL, hw_addr, NULL, &status);
+                        if (RING_$LOGGING_NOW < 0) {
+                            RINGLOG_$LOGIT(&RINGLOG_$ROUTE_FORWARD, packet_buffer);
                         }
-                    } else {
-                        /*
-                         * Normal routing - use NET_IO_$SEND
-                         */
-                        void *pkt_array[1];
-                        uint32_t flags;
-
-                        /* Get flags from packet buffer page */
-                        flags = *(uint32_t *)(((uint32_t)packet_buffer & ~0x3FF) + 0x3FC);
 
-                        ML_$LOCK(NET_IO_LOCK_ID);
+                        /* Its reader is woken once the burst is done */
+                        if (SOCK_$PUT_DEFERRED(dest_port->socket, &packet_ptr,
+                                               0, 2, dest_port->socket) < 0) {
+                            was_forwarded = 0xFF;
+                            /* Update port-specific statistics */
+                        } else {
+                            /* Update error statistics */
+                        }
 
-                        pkt_array[0] = packet_buffer;
-                        NET_IO_$SEND(next_hop_port, pkt_array, flags,
-                                     *(int16_t *)((uint8_t *)packet_buffer + 0x10), 0,
-                                     NULL,
-                                     *(int16_t *)((uint8_t *)packet_buffer + 0x14),
-                                     ROUTE_$FWD_TIMEOUT, NULL, &status);
+                        /* Update port forward counter */
+                        *(uint32_t *)((uint8_t *)dest_port + 0x58) += 1;
 
-                        ML_$UNLOCK(NET_IO_LOCK_ID);
-                    }
-                } else {
-                    /* Packet too large to forward */
-                    if (is_std_routing) {
-                        STAT_OVERSIZED_STD++;
+                    } else if (packet_size <= MAX_FORWARD_SIZE) {
+                        /*
+                         * Type 1: Local network port
+                         */
+                        if (is_std_routing) {
+                            /*
+                             * Standard routing - use MAC_OS_$SEND
+                             */
+                            uint8_t hw_addr[6];
+                            uint8_t arp_info[4];
+
+                            MAC_OS_$ARP(next_hop_addr, next_hop_port, hw_addr, arp_info, &status);
+
+                            if (status == status_$ok) {
+                                /* Build and send ethernet frame */
+                                /* ... complex packet construction ... */
+                                MAC_OS_$SEND(NULL, hw_addr, NULL, &status);
+                            }
+                        } else {
+                            /*
+                             * Normal routing - use NET_IO_$SEND
+                             */
+                            void *pkt_array[1];
+                            uint32_t flags;
+
+                            /* Get flags from packet buffer page */
+                            flags = *(uint32_t *)(((uint32_t)packet_buffer & ~0x3FF) + 0x3FC);
+
+                            ML_$LOCK(NET_IO_LOCK_ID);
+
+                            pkt_array[0] = packet_buffer;
+                            NET_IO_$SEND(next_hop_port, pkt_array, flags,
+                                         *(int16_t *)((uint8_t *)packet_buffer + 0x10), 0,
+                                         NULL,
+                                         *(int16_t *)((uint8_t *)packet_buffer + 0x14),
+                                         ROUTE_$FWD_TIMEOUT, NULL, &status);
+
+                            ML_$UNLOCK(NET_IO_LOCK_ID);
+
+                            /* Let the receive side send the rest itself */
+                            if (status == status_$ok && should_forward) {
+                                route_$flow_fill(idp_hdr->dst_network,
+                                                 idp_hdr->dst_host_hi,
+                                                 idp_hdr->dst_host_lo,
+                                                 next_hop_port, rip_seq);
+                            }
+                        }
                     } else {
-                        STAT_OVERSIZED_N++;
+                        /* Packet too large to forward */
+                        if (is_std_routing) {
+                            STAT_OVERSIZED_STD++;
+                        } else {
+                            STAT_OVERSIZED_N++;
+                        }
                     }
-                }
 
-                /* Update forwarding statistics */
-                if (should_forward) {
-                    if (is_std_routing) {
-                        STAT_FORWARDED_STD++;
-                    } else {
-                        STAT_FORWARDED_N++;
+                    /* Update forwarding statistics */
+                    if (should_forward) {
+                        if (is_std_routing) {
+                            STAT_FORWARDED_STD++;
+                        } else {
+                            STAT_FORWARDED_N++;
+                        }
                     }
                 }
-            }
 
-            /*
-             * Return packet buffer if not successfully forwarded
-             */
-            if (!was_forwarded) {
-                NETBUF_$RTN_HDR(&packet_ptr);
-                PKT_$DUMP_DATA(NULL, packet_size);
+                /*
+                 * Return packet buffer if not successfully forwarded
+                 */
+                if (!was_forwarded) {
+                    NETBUF_$RTN_HDR(&packet_ptr);
+                    PKT_$DUMP_DATA(NULL, packet_size);
+                }
+
             }
 
-            /* Advance socket EC for next packet */
-            ROUTE_$SOCK_ECVAL++;
+            SOCK_$ADVANCE_DEFERRED();
+
+            /* One socket EC advance was made for each packet taken */
+            ROUTE_$SOCK_ECVAL += n_batch;
             break;
 
         case 2:
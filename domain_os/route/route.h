@@ -207,6 +207,33 @@ void ROUTE_$READ_USER_STATS(uint16_t *socket_ptr, uint8_t *stats_buf,
  */
 void ROUTE_$PROCESS(void);
 
+/*
+ * ROUTE_$FAST_FORWARD - Forward a transit packet from the receive side
+ *
+ * Offered each transit packet before it is queued to the routing socket.
+ * If ROUTE_$PROCESS has recently routed the packet's destination and the
+ * routing table has not changed since, the packet's hop count and
+ * checksum are updated and it is sent on the same port from here, and
+ * its buffers are returned.  Otherwise nothing is done.
+ *
+ * The data length is taken from the internet header, as ROUTE_$PROCESS
+ * sends it.
+ *
+ * @param packet_buffer Header buffer (internet header, IDP at +0x28)
+ * @param data_bufs     Data buffer list
+ *
+ * @return -1 if the packet was taken, 0 to queue it as before
+ */
+int8_t ROUTE_$FAST_FORWARD(uint32_t *packet_buffer, uint32_t *data_bufs);
+
+/*
+ * ROUTE_$FLOW_STATS - Read the flow cache counters
+ *
+ * @param hits      Output: packets sent by ROUTE_$FAST_FORWARD
+ * @param misses    Output: packets it left for the routing process
+ */
+void ROUTE_$FLOW_STATS(uint32_t *hits, uint32_t *misses);
+
 /*
  * ROUTE_$INCOMING - Handle incoming routed packets
  *
@@ -26,6 +26,22 @@
 /* Port size in bytes */
 #define ROUTE_PORT_SIZE 0x5C
 
+/* Flow cache size for ROUTE_$FAST_FORWARD (power of 2) */
+#define ROUTE_FLOW_SLOTS 32
+#define ROUTE_FLOW_MASK  (ROUTE_FLOW_SLOTS - 1)
+
+/*
+ * Flow cache entry: the port packets for a destination went out on,
+ * and rip_$table.seq when that was looked up (odd = being filled).
+ */
+typedef struct route_$flow_t {
+    uint32_t    seq;            /* 0x00: RIP table change count */
+    uint32_t    network;        /* 0x04: Destination network */
+    uint32_t    host_lo;        /* 0x08: Destination host (low) */
+    uint16_t    host_hi;        /* 0x0C: Destination host (high) */
+    uint16_t    port;           /* 0x0E: Outgoing port */
+} route_$flow_t;
+
 /*
  * =============================================================================
  * Global Data (m68k addresses)
@@ -214,6 +230,21 @@ void ROUTE_$ANNOUNCE_NET(uint32_t network);
 void RTWIRED_PROC_START(int16_t port_index, uint16_t packet_id,
                         void *route_data, uint16_t route_len);
 
+/*
+ * route_$flow_fill - Remember the port a destination's packets go out on
+ *
+ * Called by ROUTE_$PROCESS after sending a packet to a local port, so
+ * that ROUTE_$FAST_FORWARD can send the rest of the flow itself.
+ *
+ * @param network   Destination network
+ * @param host_hi   Destination host (high)
+ * @param host_lo   Destination host (low)
+ * @param port      Port the packet was sent on
+ * @param seq       rip_$table.seq read before the next hop lookup
+ */
+void route_$flow_fill(uint32_t network, uint16_t host_hi, uint32_t host_lo,
+                      uint16_t port, uint32_t seq);
+
 /*
  * =============================================================================
  * Additional Global Data for Wired Pages
@@ -56,6 +56,9 @@ int8_t SOCK_$ALLOCATE(uint16_t *sock_ret, uint32_t proto_bufpages, uint32_t max_
         /* Set protocol */
         sock_view->protocol = protocol;
 
+        /* Default buffer quota, no reservation */
+        sock_$acct_open(SOCK_GET_NUMBER(sock_view->flags), protocol);
+
         /* Release spinlock */
         ML_$SPIN_UNLOCK(SOCK_GET_LOCK(), token);
 
@@ -74,6 +74,9 @@ void SOCK_$CLOSE(uint16_t sock_num)
     /* Clear protocol */
     sock_view->protocol = 0;
 
+    /* Give back its buffer reservation */
+    sock_$acct_close(sock_num);
+
     /* For dynamic sockets (>= 32), return to free list */
     if (sock_num >= SOCK_DYNAMIC_MIN) {
         free_list_head = SOCK_GET_FREE_LIST();
@@ -7,21 +7,69 @@
  * The packet data is copied from the network buffer header (at high offsets
  * in the 1KB buffer) to the output pkt_info structure.
  *
+ * SOCK_$GET_BATCH takes up to SOCK_BATCH_MAX packets off the queue in one
+ * hold of the socket lock, for consumers that drain a socket per wakeup.
+ *
  * Original address: 0x00E16070
  * Original source: Pascal, converted to C
  */
 
 #include "sock_internal.h"
 
+/*
+ * Copy packet info from a dequeued network buffer to the output
+ * structure.  The layout mirrors the sock_pkt_info_t structure.
+ */
+static void sock_$unpack(uint8_t *netbuf, uint32_t *out)
+{
+    int16_t i;
+    uint16_t hop_count;
+
+    /* +0x04: Source address (from netbuf + 0x3BC) */
+    out[1] = *(uint32_t *)(netbuf + NETBUF_OFFSET_SRC_ADDR);
+
+    /* +0x08: Source port (from netbuf + 0x3C0) */
+    *(uint16_t *)&out[2] = *(uint16_t *)(netbuf + NETBUF_OFFSET_SRC_PORT);
+
+    /* +0x0C: Destination address (from netbuf + 0x3C4) */
+    out[3] = *(uint32_t *)(netbuf + NETBUF_OFFSET_DST_ADDR);
+
+    /* +0x10: Destination port (from netbuf + 0x3C8) */
+    *(uint16_t *)&out[4] = *(uint16_t *)(netbuf + NETBUF_OFFSET_DST_PORT);
+
+    /* +0x00: Header pointer (from netbuf + 0x3B8) */
+    out[0] = *(uint32_t *)(netbuf + NETBUF_OFFSET_HDR_PTR);
+
+    /* +0x2A: Data length (from netbuf + 0x3E8) */
+    *(uint32_t *)((uint8_t *)out + 0x2A) = *(uint32_t *)(netbuf + NETBUF_OFFSET_DATA_LEN);
+
+    /* +0x30: Data pointers (from netbuf + 0x3EC, 16 bytes) */
+    out[0x0C] = *(uint32_t *)(netbuf + NETBUF_OFFSET_DATA_PTRS);
+    out[0x0D] = *(uint32_t *)(netbuf + NETBUF_OFFSET_DATA_PTRS + 4);
+    out[0x0E] = *(uint32_t *)(netbuf + NETBUF_OFFSET_DATA_PTRS + 8);
+    out[0x0F] = *(uint32_t *)(netbuf + NETBUF_OFFSET_DATA_PTRS + 12);
+
+    /* +0x12: Hop count (from netbuf + 0x3CA) */
+    hop_count = *(uint16_t *)(netbuf + NETBUF_OFFSET_HOP_COUNT);
+    *(uint16_t *)((uint8_t *)out + 0x12) = hop_count;
+
+    /* +0x14: Hop array (from netbuf + 0x3CC, variable length) */
+    if (hop_count > 0) {
+        uint16_t *hop_out = (uint16_t *)((uint8_t *)out + 0x14);
+        uint16_t *hop_in = (uint16_t *)(netbuf + NETBUF_OFFSET_HOP_ARRAY);
+
+        for (i = hop_count - 1; i >= 0; i--) {
+            *hop_out++ = *hop_in++;
+        }
+    }
+}
+
 int8_t SOCK_$GET(uint16_t sock_num, void *pkt_info)
 {
     sock_ec_view_t *sock_view;
     ml_$spin_token_t token;
     int8_t result;
     uint8_t *netbuf;
-    uint32_t *out = (uint32_t *)pkt_info;
-    int16_t i;
-    uint16_t hop_count;
 
     /* Acquire spinlock */
     token = ML_$SPIN_LOCK(SOCK_GET_LOCK());
@@ -41,6 +89,10 @@ int8_t SOCK_$GET(uint16_t sock_num, void *pkt_info)
         /* Get pointer to first packet in queue */
         netbuf = (uint8_t *)sock_view->queue_head;
 
+        /* Its buffers are no longer the socket's */
+        sock_$acct_release(sock_num,
+                           *(uint16_t *)(netbuf + NETBUF_OFFSET_DATA_LEN));
+
         /* Update queue head to next packet */
         sock_view->queue_head = *(uint32_t *)(netbuf + NETBUF_OFFSET_NEXT);
 
@@ -52,51 +104,52 @@ int8_t SOCK_$GET(uint16_t sock_num, void *pkt_info)
         /* Release spinlock */
         ML_$SPIN_UNLOCK(SOCK_GET_LOCK(), token);
 
-        /*
-         * Copy packet info from network buffer to output structure.
-         * The layout mirrors the sock_pkt_info_t structure.
-         */
-
-        /* +0x04: Source address (from netbuf + 0x3BC) */
-        out[1] = *(uint32_t *)(netbuf + NETBUF_OFFSET_SRC_ADDR);
+        sock_$unpack(netbuf, (uint32_t *)pkt_info);
 
-        /* +0x08: Source port (from netbuf + 0x3C0) */
-        *(uint16_t *)&out[2] = *(uint16_t *)(netbuf + NETBUF_OFFSET_SRC_PORT);
-
-        /* +0x0C: Destination address (from netbuf + 0x3C4) */
-        out[3] = *(uint32_t *)(netbuf + NETBUF_OFFSET_DST_ADDR);
+        result = -1;  /* 0xFF = success */
+    }
 
-        /* +0x10: Destination port (from netbuf + 0x3C8) */
-        *(uint16_t *)&out[4] = *(uint16_t *)(netbuf + NETBUF_OFFSET_DST_PORT);
+    return result;
+}
 
-        /* +0x00: Header pointer (from netbuf + 0x3B8) */
-        out[0] = *(uint32_t *)(netbuf + NETBUF_OFFSET_HDR_PTR);
+int16_t SOCK_$GET_BATCH(uint16_t sock_num, void *pkt_infos, int16_t max)
+{
+    sock_ec_view_t *sock_view;
+    ml_$spin_token_t token;
+    uint8_t *netbufs[SOCK_BATCH_MAX];
+    int16_t count;
+    int16_t i;
 
-        /* +0x2A: Data length (from netbuf + 0x3E8) */
-        *(uint32_t *)((uint8_t *)out + 0x2A) = *(uint32_t *)(netbuf + NETBUF_OFFSET_DATA_LEN);
+    if (max > SOCK_BATCH_MAX) {
+        max = SOCK_BATCH_MAX;
+    }
 
-        /* +0x30: Data pointers (from netbuf + 0x3EC, 16 bytes) */
-        out[0x0C] = *(uint32_t *)(netbuf + NETBUF_OFFSET_DATA_PTRS);
-        out[0x0D] = *(uint32_t *)(netbuf + NETBUF_OFFSET_DATA_PTRS + 4);
-        out[0x0E] = *(uint32_t *)(netbuf + NETBUF_OFFSET_DATA_PTRS + 8);
-        out[0x0F] = *(uint32_t *)(netbuf + NETBUF_OFFSET_DATA_PTRS + 12);
+    token = ML_$SPIN_LOCK(SOCK_GET_LOCK());
 
-        /* +0x12: Hop count (from netbuf + 0x3CA) */
-        hop_count = *(uint16_t *)(netbuf + NETBUF_OFFSET_HOP_COUNT);
-        *(uint16_t *)((uint8_t *)out + 0x12) = hop_count;
+    sock_view = SOCK_GET_VIEW_PTR(sock_num);
 
-        /* +0x14: Hop array (from netbuf + 0x3CC, variable length) */
-        if (hop_count > 0) {
-            uint16_t *hop_out = (uint16_t *)((uint8_t *)out + 0x14);
-            uint16_t *hop_in = (uint16_t *)(netbuf + NETBUF_OFFSET_HOP_ARRAY);
+    /* Unlink as many as are queued, up to max */
+    count = 0;
+    while (count < max && sock_view->queue_count != 0) {
+        sock_view->queue_count--;
+        netbufs[count] = (uint8_t *)sock_view->queue_head;
+        sock_view->queue_head =
+            *(uint32_t *)(netbufs[count] + NETBUF_OFFSET_NEXT);
+        sock_$acct_release(sock_num,
+                           *(uint16_t *)(netbufs[count] + NETBUF_OFFSET_DATA_LEN));
+        count++;
+    }
+    if (sock_view->queue_head == 0) {
+        sock_view->queue_tail = 0;
+    }
 
-            for (i = hop_count - 1; i >= 0; i--) {
-                *hop_out++ = *hop_in++;
-            }
-        }
+    ML_$SPIN_UNLOCK(SOCK_GET_LOCK(), token);
 
-        result = -1;  /* 0xFF = success */
+    /* The packets are ours now; unpack them without the lock */
+    for (i = 0; i < count; i++) {
+        sock_$unpack(netbufs[i],
+                     (uint32_t *)((uint8_t *)pkt_infos + i * SOCK_PKT_INFO_SIZE));
     }
 
-    return result;
+    return count;
 }
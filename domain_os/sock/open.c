@@ -68,6 +68,9 @@ int8_t SOCK_$OPEN(uint16_t sock_num, uint32_t proto_bufpages, uint32_t max_queue
         /* Set protocol */
         sock_view->protocol = protocol;
 
+        /* Default buffer quota, no reservation */
+        sock_$acct_open(sock_num, protocol);
+
         /* Release spinlock */
         ML_$SPIN_UNLOCK(SOCK_GET_LOCK(), token);
 
@@ -6,6 +6,9 @@
  * - SOCK_$PUT_INT: Mid-level, validates socket and returns EC pointer
  * - SOCK_$PUT_INT_INT: Low-level, performs actual queue insertion
  *
+ * and SOCK_$PUT_DEFERRED / SOCK_$ADVANCE_DEFERRED, which queue a burst of
+ * packets and then advance each socket's event count once for the lot.
+ *
  * Original addresses:
  *   SOCK_$PUT:         0x00E1614E
  *   SOCK_$PUT_INT:     0x00E16190
@@ -28,7 +31,8 @@
  * @param ec_param1  Event count parameter 1 (stored in netbuf)
  * @param ec_param2  Event count parameter 2 (stored in netbuf)
  *
- * @return 0 on success, 1 if queue full, 2 if socket not open
+ * @return 0 on success, 1 if queue full (or over the socket's buffer
+ *         quota, see quota.c), 2 if socket not open
  */
 int16_t SOCK_$PUT_INT_INT(sock_ec_view_t *sock_view, void **pkt_ptr,
                           int8_t flags, uint16_t ec_param1, uint16_t ec_param2)
@@ -57,6 +61,11 @@ int16_t SOCK_$PUT_INT_INT(sock_ec_view_t *sock_view, void **pkt_ptr,
         result = 2;  /* Socket not ready or data too large */
     } else if (sock_view->queue_count >= sock_view->protocol) {
         /* Queue is full (protocol field doubles as max queue depth here) */
+        sock_$acct[SOCK_GET_NUMBER(sock_view->flags)].drops_full++;
+        result = 1;
+    } else if (sock_$acct_admit(SOCK_GET_NUMBER(sock_view->flags),
+                                data_len) != 0) {
+        /* Over its buffer quota, or dropped early with the pool low */
         result = 1;
     } else {
         /* Increment queue count */
@@ -208,3 +217,91 @@ int8_t SOCK_$PUT(uint16_t sock_num, void **pkt_ptr, uint8_t flags,
 
     return result;
 }
+
+/*
+ * Sockets with packets queued but not yet advanced, and how many.
+ * Protected by the socket spinlock.
+ */
+static uint16_t sock_$deferred_sock[SOCK_DEFER_MAX];
+static uint16_t sock_$deferred_count[SOCK_DEFER_MAX];
+static int16_t sock_$n_deferred;
+
+/*
+ * SOCK_$PUT_DEFERRED - Queue a packet, advancing the event count later
+ *
+ * Like SOCK_$PUT, but the socket's event count is not advanced until
+ * SOCK_$ADVANCE_DEFERRED.  If too many sockets are already waiting for
+ * their advance the packet is advanced at once, as SOCK_$PUT would.
+ *
+ * @return Negative (0xFF) if packet queued, 0 on error
+ */
+int8_t SOCK_$PUT_DEFERRED(uint16_t sock_num, void **pkt_ptr, uint8_t flags,
+                          uint16_t ec_param1, uint16_t ec_param2)
+{
+    ec_$eventcount_t *ec;
+    ml_$spin_token_t token;
+    int16_t i;
+
+    if (SOCK_$PUT_INT(sock_num, pkt_ptr, flags, ec_param1, ec_param2,
+                      &ec) >= 0) {
+        return 0;
+    }
+
+    token = ML_$SPIN_LOCK(SOCK_GET_LOCK());
+    for (i = 0; i < sock_$n_deferred; i++) {
+        if (sock_$deferred_sock[i] == sock_num) {
+            break;
+        }
+    }
+    if (i == sock_$n_deferred && i < SOCK_DEFER_MAX) {
+        sock_$deferred_sock[i] = sock_num;
+        sock_$deferred_count[i] = 0;
+        sock_$n_deferred++;
+    }
+    if (i < sock_$n_deferred) {
+        sock_$deferred_count[i]++;
+        ec = NULL;
+    }
+    ML_$SPIN_UNLOCK(SOCK_GET_LOCK(), token);
+
+    /* No room to defer it */
+    if (ec != NULL) {
+        EC_$ADVANCE(ec);
+    }
+
+    return -1;
+}
+
+/*
+ * SOCK_$ADVANCE_DEFERRED - Advance event counts for deferred packets
+ *
+ * Each socket with deferred packets has its event count raised by the
+ * number of them, so a consumer counting one per packet sees them all,
+ * but its waiters are woken by a single advance.  The quiet part of
+ * the raise is done under the socket spinlock, with interrupts masked,
+ * as ADVANCE_INT does its own.  Only the last advance dispatches, so the
+ * caller is not preempted until every socket has been signalled.
+ */
+void SOCK_$ADVANCE_DEFERRED(void)
+{
+    ec_$eventcount_t *ecs[SOCK_DEFER_MAX];
+    ml_$spin_token_t token;
+    int16_t n;
+    int16_t i;
+
+    token = ML_$SPIN_LOCK(SOCK_GET_LOCK());
+    n = sock_$n_deferred;
+    for (i = 0; i < n; i++) {
+        ecs[i] = &SOCK_GET_VIEW_PTR(sock_$deferred_sock[i])->ec;
+        ecs[i]->value += sock_$deferred_count[i] - 1;
+    }
+    sock_$n_deferred = 0;
+    ML_$SPIN_UNLOCK(SOCK_GET_LOCK(), token);
+
+    for (i = 0; i < n - 1; i++) {
+        EC_$ADVANCE_WITHOUT_DISPATCH(ecs[i]);
+    }
+    if (n > 0) {
+        EC_$ADVANCE(ecs[n - 1]);
+    }
+}
@@ -0,0 +1,206 @@
+/*
+ * SOCK_$SET_QUOTA / SOCK_$GET_DROPS - Receive buffer accounting
+ *
+ * SOCK_$PUT_INT_INT only refused a packet when the queue was as deep as
+ * the socket allows, however large its packets, so a socket whose reader
+ * had stopped could hold a large share of the NETBUF pool while other
+ * sockets' packets found no buffers.  Each socket now counts the pages
+ * and data bytes on its queue and is held to a quota of each.
+ *
+ * A socket may also reserve pages: up to its reservation its packets are
+ * never dropped for want of buffers.  Past it, the free pool less the
+ * unused part of every other socket's reservation is what it may draw
+ * on, and when that runs low its packets are dropped early - a low
+ * priority socket's first, then those of a normal socket already
+ * holding more than SOCK_FAIR_PAGES.
+ *
+ * Messages held for a socket off its queue (MSG's same-node rings) are
+ * charged with SOCK_$CHARGE and SOCK_$CREDIT against the same quotas.
+ *
+ * All of this is protected by the socket spinlock.
+ */
+
+#include "sock_internal.h"
+
+sock_$acct_t sock_$acct[SOCK_MAX_NUMBER + 1];
+
+/* Pages reserved by all sockets, and how many of those are not in use */
+static uint16_t sock_$reserve_total;
+static uint16_t sock_$reserve_unused;
+
+static uint16_t sock_$unused(sock_$acct_t *a)
+{
+    return (a->pages < a->reserve) ? (uint16_t)(a->reserve - a->pages) : 0;
+}
+
+void sock_$acct_open(uint16_t sock_num, uint8_t depth)
+{
+    sock_$acct_t *a = &sock_$acct[sock_num];
+
+    a->pages = 0;
+    a->bytes = 0;
+    a->page_quota = SOCK_PAGE_QUOTA_DEFAULT(depth);
+    a->byte_quota = 0;
+    a->reserve = 0;
+    a->priority = SOCK_PRI_NORMAL;
+    a->drops_full = 0;
+    a->drops_quota = 0;
+    a->drops_early = 0;
+}
+
+void sock_$acct_close(uint16_t sock_num)
+{
+    sock_$acct_t *a = &sock_$acct[sock_num];
+
+    sock_$reserve_unused -= sock_$unused(a);
+    sock_$reserve_total -= a->reserve;
+    a->reserve = 0;
+}
+
+/*
+ * Whether a packet of data_len bytes may be charged to a socket: NULL
+ * if so, else the drop counter it would go on
+ */
+static uint32_t *sock_$acct_check(sock_$acct_t *a, uint16_t data_len)
+{
+    uint16_t pages;
+    int16_t hdr_free;
+    int16_t dat_free;
+    uint32_t grows;
+    int32_t spare;
+
+    pages = SOCK_PKT_PAGES(data_len);
+
+    if ((a->page_quota != 0 && a->pages + pages > a->page_quota) ||
+        (a->byte_quota != 0 && a->bytes + data_len > a->byte_quota)) {
+        return &a->drops_quota;
+    }
+
+    /* Past its reservation it competes for what is left of the pool */
+    if (a->pages + pages > a->reserve) {
+        NETBUF_$GET_DEPTH(&hdr_free, &dat_free, &grows);
+        spare = (int32_t)hdr_free + dat_free -
+                (sock_$reserve_unused - sock_$unused(a));
+        if ((spare < SOCK_EARLY_DROP_LOW && a->priority == SOCK_PRI_LOW) ||
+            (spare < SOCK_EARLY_DROP_NORMAL && a->pages >= SOCK_FAIR_PAGES)) {
+            return &a->drops_early;
+        }
+    }
+
+    return NULL;
+}
+
+static void sock_$acct_charge(sock_$acct_t *a, uint16_t data_len)
+{
+    sock_$reserve_unused -= sock_$unused(a);
+    a->pages += SOCK_PKT_PAGES(data_len);
+    a->bytes += data_len;
+    sock_$reserve_unused += sock_$unused(a);
+}
+
+int16_t sock_$acct_admit(uint16_t sock_num, uint16_t data_len)
+{
+    sock_$acct_t *a = &sock_$acct[sock_num];
+    uint32_t *drops;
+
+    drops = sock_$acct_check(a, data_len);
+    if (drops != NULL) {
+        (*drops)++;
+        return 1;
+    }
+
+    sock_$acct_charge(a, data_len);
+    return 0;
+}
+
+void sock_$acct_release(uint16_t sock_num, uint16_t data_len)
+{
+    sock_$acct_t *a = &sock_$acct[sock_num];
+
+    sock_$reserve_unused -= sock_$unused(a);
+    a->pages -= SOCK_PKT_PAGES(data_len);
+    a->bytes -= data_len;
+    sock_$reserve_unused += sock_$unused(a);
+}
+
+int8_t SOCK_$SET_QUOTA(uint16_t sock_num, uint16_t page_quota,
+                       uint32_t byte_quota, uint16_t reserve, uint8_t priority)
+{
+    sock_$acct_t *a;
+    ml_$spin_token_t token;
+
+    if (sock_num < 1 || sock_num > SOCK_MAX_NUMBER) {
+        return 0;
+    }
+    a = &sock_$acct[sock_num];
+
+    token = ML_$SPIN_LOCK(SOCK_GET_LOCK());
+
+    if (sock_$reserve_total - a->reserve + reserve > SOCK_RESERVE_MAX) {
+        ML_$SPIN_UNLOCK(SOCK_GET_LOCK(), token);
+        return 0;
+    }
+
+    sock_$reserve_unused -= sock_$unused(a);
+    sock_$reserve_total = sock_$reserve_total - a->reserve + reserve;
+    a->reserve = reserve;
+    sock_$reserve_unused += sock_$unused(a);
+
+    a->page_quota = page_quota;
+    a->byte_quota = byte_quota;
+    a->priority = priority;
+
+    ML_$SPIN_UNLOCK(SOCK_GET_LOCK(), token);
+
+    return -1;
+}
+
+int8_t SOCK_$CHARGE(uint16_t sock_num, uint16_t data_len)
+{
+    sock_$acct_t *a;
+    ml_$spin_token_t token;
+    int8_t charged;
+
+    if (sock_num < 1 || sock_num > SOCK_MAX_NUMBER) {
+        return 0;
+    }
+    a = &sock_$acct[sock_num];
+
+    token = ML_$SPIN_LOCK(SOCK_GET_LOCK());
+    charged = 0;
+    if (sock_$acct_check(a, data_len) == NULL) {
+        sock_$acct_charge(a, data_len);
+        charged = -1;
+    }
+    ML_$SPIN_UNLOCK(SOCK_GET_LOCK(), token);
+
+    return charged;
+}
+
+void SOCK_$CREDIT(uint16_t sock_num, uint16_t data_len)
+{
+    ml_$spin_token_t token;
+
+    if (sock_num < 1 || sock_num > SOCK_MAX_NUMBER) {
+        return;
+    }
+
+    token = ML_$SPIN_LOCK(SOCK_GET_LOCK());
+    sock_$acct_release(sock_num, data_len);
+    ML_$SPIN_UNLOCK(SOCK_GET_LOCK(), token);
+}
+
+void SOCK_$GET_DROPS(uint16_t sock_num, sock_$drops_t *drops)
+{
+    sock_$acct_t *a = &sock_$acct[sock_num];
+    ml_$spin_token_t token;
+
+    token = ML_$SPIN_LOCK(SOCK_GET_LOCK());
+    drops->pages = a->pages;
+    drops->pad = 0;
+    drops->bytes = a->bytes;
+    drops->full = a->drops_full;
+    drops->quota = a->drops_quota;
+    drops->early = a->drops_early;
+    ML_$SPIN_UNLOCK(SOCK_GET_LOCK(), token);
+}
@@ -31,6 +31,45 @@
  */
 #define SOCK_MAX_NUMBER         0xDF    /* 223 */
 
+/*
+ * Size of the packet information SOCK_$GET fills in, and the most
+ * packets SOCK_$GET_BATCH takes in one call
+ */
+#define SOCK_PKT_INFO_SIZE      0x40
+#define SOCK_BATCH_MAX          8
+
+/*
+ * Most sockets that can have event count advances deferred at once
+ */
+#define SOCK_DEFER_MAX          8
+
+/*
+ * Receive buffer accounting (SOCK_$SET_QUOTA)
+ *
+ * A socket holds the NETBUF pages of every packet on its queue: one
+ * header page and a data page per 1KB.  Unless set otherwise a socket
+ * may hold a full queue of the largest packets, reserves none and is of
+ * normal priority.
+ */
+#define SOCK_PKT_MAX_PAGES      5       /* Header page and 4 data pages */
+#define SOCK_PAGE_QUOTA_DEFAULT(depth)  ((uint16_t)((depth) * SOCK_PKT_MAX_PAGES))
+#define SOCK_RESERVE_MAX        64      /* Pages reservable by all sockets */
+
+#define SOCK_PRI_LOW            0       /* Dropped first when buffers run low */
+#define SOCK_PRI_NORMAL         1
+
+/*
+ * Per-socket receive counters returned by SOCK_$GET_DROPS
+ */
+typedef struct sock_$drops_t {
+    uint16_t    pages;          /* Pages now queued */
+    uint16_t    pad;
+    uint32_t    bytes;          /* Data bytes now queued */
+    uint32_t    full;           /* Dropped: queue depth reached */
+    uint32_t    quota;          /* Dropped: page or byte quota reached */
+    uint32_t    early;          /* Dropped: buffer pool running low */
+} sock_$drops_t;
+
 /*
  * SOCK_$INIT - Initialize socket subsystem
  *
@@ -136,6 +175,21 @@ void SOCK_$CLOSE(uint16_t sock_num);
  */
 int8_t SOCK_$GET(uint16_t sock_num, void *pkt_info);
 
+/*
+ * SOCK_$GET_BATCH - Get several packets from socket receive queue
+ *
+ * Takes up to max packets (at most SOCK_BATCH_MAX) off the queue in one
+ * hold of the socket lock and fills in one packet information buffer
+ * for each, SOCK_PKT_INFO_SIZE bytes apart.
+ *
+ * @param sock_num      Socket number
+ * @param pkt_infos     Output: array of packet information buffers
+ * @param max           Most packets to take
+ *
+ * @return Number of packets retrieved, 0 if queue empty
+ */
+int16_t SOCK_$GET_BATCH(uint16_t sock_num, void *pkt_infos, int16_t max);
+
 /*
  * SOCK_$PUT - Put packet on socket receive queue
  *
@@ -155,6 +209,84 @@ int8_t SOCK_$GET(uint16_t sock_num, void *pkt_info);
 int8_t SOCK_$PUT(uint16_t sock_num, void **pkt_ptr, uint8_t flags,
                  uint16_t ec_param1, uint16_t ec_param2);
 
+/*
+ * SOCK_$PUT_DEFERRED - Put packet on socket queue without waking anyone
+ *
+ * As SOCK_$PUT, but the event count advance is held back until
+ * SOCK_$ADVANCE_DEFERRED, so that a burst of packets to one socket wakes
+ * its reader once.  Callers must call SOCK_$ADVANCE_DEFERRED before they
+ * next wait.
+ *
+ * @return Negative (0xFF) if packet queued, 0 on error
+ */
+int8_t SOCK_$PUT_DEFERRED(uint16_t sock_num, void **pkt_ptr, uint8_t flags,
+                          uint16_t ec_param1, uint16_t ec_param2);
+
+/*
+ * SOCK_$ADVANCE_DEFERRED - Advance event counts held back by PUT_DEFERRED
+ *
+ * Raises each such socket's event count by the number of packets put
+ * on it and wakes its waiters once.
+ */
+void SOCK_$ADVANCE_DEFERRED(void);
+
+/*
+ * SOCK_$SET_QUOTA - Set a socket's receive buffer limits
+ *
+ * Holds the socket to page_quota NETBUF pages and byte_quota data bytes
+ * queued (0 for no limit), and reserves pages for it from the pool: up
+ * to its reservation a socket's packets are not dropped for want of
+ * buffers.  Past it, packets are dropped early when the free pool not
+ * promised to other reservations runs low, low priority first.  The
+ * settings last until the socket is closed.
+ *
+ * @param sock_num      Socket number
+ * @param page_quota    Most pages queued at once, 0 for no limit
+ * @param byte_quota    Most data bytes queued at once, 0 for no limit
+ * @param reserve       Pages to reserve
+ * @param priority      SOCK_PRI_LOW or SOCK_PRI_NORMAL
+ *
+ * @return Negative (0xFF) on success, 0 if the reservation would take
+ *         the total past SOCK_RESERVE_MAX (nothing is changed)
+ */
+int8_t SOCK_$SET_QUOTA(uint16_t sock_num, uint16_t page_quota,
+                       uint32_t byte_quota, uint16_t reserve, uint8_t priority);
+
+/*
+ * SOCK_$CHARGE - Charge pages held outside the queue to a socket
+ *
+ * For messages waiting for a socket somewhere other than its queue
+ * (MSG's same-node rings): charges the pages a packet of data_len
+ * bytes would hold against the socket's quotas, as if it were queued.
+ * A refusal is not counted as a drop; the caller is expected to fall
+ * back to queueing the message, which is judged again.
+ *
+ * @param sock_num      Socket number
+ * @param data_len      Data bytes
+ *
+ * @return Negative (0xFF) if charged, 0 if the quotas do not allow it
+ */
+int8_t SOCK_$CHARGE(uint16_t sock_num, uint16_t data_len);
+
+/*
+ * SOCK_$CREDIT - Give back a charge made by SOCK_$CHARGE
+ *
+ * @param sock_num      Socket number
+ * @param data_len      Data bytes, as charged
+ */
+void SOCK_$CREDIT(uint16_t sock_num, uint16_t data_len);
+
+/*
+ * SOCK_$GET_DROPS - Get a socket's queued buffers and drop counts
+ *
+ * Drop counts run from when the socket was opened, and can still be
+ * read after it is closed.
+ *
+ * @param sock_num      Socket number
+ * @param drops         Output: counters
+ */
+void SOCK_$GET_DROPS(uint16_t sock_num, sock_$drops_t *drops);
+
  /*
   * SOCK_$EVENT_COUNTERS - Socket event counter array
   *
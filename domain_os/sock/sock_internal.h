@@ -196,6 +196,55 @@ extern uint8_t sock_table_base[];
 /* Check if socket is user-mode */
 #define SOCK_IS_USER_MODE(flags) (((flags) & SOCK_FLAG_USER_MODE) != 0)
 
+/*
+ * Receive Buffer Accounting (quota.c)
+ *
+ * Kept apart from the descriptors, whose layout is fixed, and indexed by
+ * socket number.  Protected by the socket spinlock.
+ */
+typedef struct sock_$acct_t {
+    uint16_t    pages;          /* Pages queued */
+    uint16_t    page_quota;     /* 0 = no limit */
+    uint32_t    bytes;          /* Data bytes queued */
+    uint32_t    byte_quota;     /* 0 = no limit */
+    uint16_t    reserve;        /* Pages reserved */
+    uint8_t     priority;       /* SOCK_PRI_* */
+    uint8_t     pad;
+    uint32_t    drops_full;
+    uint32_t    drops_quota;
+    uint32_t    drops_early;
+} sock_$acct_t;
+
+/* Pages a packet with data_len bytes of data holds */
+#define SOCK_PKT_PAGES(data_len)    (1 + (((data_len) + 0x3FF) >> 10))
+
+/*
+ * Early drop thresholds, in free pool pages not promised to other
+ * sockets' reservations.  Below SOCK_EARLY_DROP_LOW a low priority
+ * socket gets nothing past its reservation; below SOCK_EARLY_DROP_NORMAL
+ * neither does a normal one already holding SOCK_FAIR_PAGES.
+ */
+#define SOCK_EARLY_DROP_LOW     32
+#define SOCK_EARLY_DROP_NORMAL  8
+#define SOCK_FAIR_PAGES         8
+
+extern sock_$acct_t sock_$acct[SOCK_MAX_NUMBER + 1];
+
+/*
+ * Set defaults when a socket is opened or allocated, for a queue depth
+ * of depth packets; call with lock held
+ */
+void sock_$acct_open(uint16_t sock_num, uint8_t depth);
+
+/* Give back a closed socket's reservation; call with lock held */
+void sock_$acct_close(uint16_t sock_num);
+
+/* Charge a packet to a socket, 0 if it may be queued; call with lock held */
+int16_t sock_$acct_admit(uint16_t sock_num, uint16_t data_len);
+
+/* Credit a dequeued packet back; call with lock held */
+void sock_$acct_release(uint16_t sock_num, uint16_t data_len);
+
 /*
  * Internal Function Prototypes
  */
@@ -125,7 +125,7 @@
 #define status_$fault_invalid_SVC_code              0x00120007
 
 /* Protection boundary violation (user pointer in kernel space) */
-#define status_$fault_protection_boundary_violation 0x0012000b
+#define status_$fault_protection_boundary_violation 0x0012000B
 
 /* Unimplemented syscall */
 #define status_$fault_unimplemented_SVC             0x0012001c
@@ -214,6 +214,9 @@
 /* Syscall 28 (0x1c): PROC2_$GET_UPIDS - Get user PIDs */
 #define SVC_PROC2_GET_UPIDS         0x1c
 
+/* Syscall 29 (0x1d): VTOC_$GET_UIDS - Get all UIDs on a volume */
+#define SVC_VTOC_GET_UIDS           0x1d
+
 /* Syscall 35 (0x23): MST_$GET_UID_ASID - Get UID/ASID */
 #define SVC_MST_GET_UID_ASID        0x23
 
@@ -223,6 +226,9 @@
 /* Syscall 37 (0x25): FILE_$INVALIDATE - Invalidate file cache */
 #define SVC_FILE_INVALIDATE         0x25
 
+/* Syscall 38 (0x26): ASKNODE_$QUERY_CNTL - Query many nodes at once */
+#define SVC_ASKNODE_QUERY_CNTL      0x26
+
 /* Syscall 41 (0x29): MST_$SET_TOUCH_AHEAD_CNT */
 #define SVC_MST_SET_TOUCH_AHEAD     0x29
 
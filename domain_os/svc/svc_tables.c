@@ -701,7 +701,7 @@ void *SVC_$TRAP5_TABLE[SVC_TRAP5_TABLE_SIZE] = {
     /* 0x1A */ VTOC_$GET_UID,
     /* 0x1B */ NETLOG_$CNTL,
     /* 0x1C */ PROC2_$GET_UPIDS,
-    /* 0x1D */ SVC_$INVALID_SYSCALL,
+    /* 0x1D */ VTOC_$GET_UIDS,
     /* 0x1E */ SVC_$INVALID_SYSCALL,
     /* 0x1F */ SVC_$UNIMPLEMENTED,
     /* 0x20 */ SVC_$UNIMPLEMENTED,
@@ -710,7 +710,7 @@ void *SVC_$TRAP5_TABLE[SVC_TRAP5_TABLE_SIZE] = {
     /* 0x23 */ MST_$GET_UID_ASID,
     /* 0x24 */ MST_$INVALIDATE,
     /* 0x25 */ FILE_$INVALIDATE,
-    /* 0x26 */ SVC_$INVALID_SYSCALL,
+    /* 0x26 */ ASKNODE_$QUERY_CNTL,
     /* 0x27 */ SVC_$INVALID_SYSCALL,
     /* 0x28 */ SVC_$INVALID_SYSCALL,
     /* 0x29 */ MST_$SET_TOUCH_AHEAD_CNT,
@@ -0,0 +1,65 @@
+/*
+ * VTOC_$GET_UIDS - Get the UIDs of every object on a volume
+ *
+ * Whole-volume enumeration for salvage-style tools. Walking a volume
+ * with VTOC_$GET_UID costs one system call and one DBUF_$GET_BLOCK per
+ * entry position, most of them empty; this walks the volume once with
+ * VTOC_$SCAN_* and returns only the entries in use.
+ */
+
+#include "vtoc/vtoc_internal.h"
+
+/*
+ * VTOC_$GET_UIDS
+ *
+ * Parameters:
+ *   vol_idx - Pointer to volume index
+ *   uids    - Output: receives up to *max UIDs, in scan order
+ *   max     - Pointer to capacity of uids
+ *   count   - Output: number of objects on the volume
+ *   status  - Output: status code
+ *
+ * *count may exceed *max; the caller can retry with a larger buffer.
+ */
+void VTOC_$GET_UIDS(int16_t *vol_idx, uid_t *uids, uint16_t *max,
+                    uint32_t *count, status_$t *status)
+{
+    vtoc_$scan_t scan;
+    vtoce_$result_t vtoce;
+    uid_t uid;
+    uint32_t vtoce_loc;
+    uint32_t n;
+    uint16_t limit;
+    status_$t local_status;
+
+    *count = 0;
+
+    if ((uint16_t)*vol_idx >= sizeof(vtoc_$data.mounted)) {
+        *status = status_$VTOC_not_mounted;
+        return;
+    }
+
+    limit = *max;
+
+    VTOC_$SCAN_OPEN(*vol_idx, &scan, status);
+    if (*status != status_$ok) {
+        return;
+    }
+
+    n = 0;
+    for (;;) {
+        VTOC_$SCAN_NEXT(&scan, &uid, &vtoce_loc, &vtoce, &local_status);
+        if (local_status != status_$ok) {
+            break;
+        }
+        if (n < limit) {
+            uids[n] = uid;
+        }
+        n++;
+    }
+
+    VTOC_$SCAN_CLOSE(&scan);
+
+    *count = n;
+    *status = (local_status == status_$end_of_file) ? status_$ok : local_status;
+}
@@ -0,0 +1,486 @@
+/*
+ * VTOC_$SCAN_* - Streaming VTOCE iterator for whole-volume walks
+ *
+ * Walks every VTOCE on a volume without going through DBUF_$GET_BLOCK
+ * for each block. Blocks are fetched VTOC_SCAN_WINDOW at a time with a
+ * single DISK_$READ_MULTI into private pages, and entries are copied
+ * out of those pages, so a scan never pins DBUF buffers and does not
+ * push the working set of other VTOC users out of the DBUF cache.
+ *
+ * Old format volumes:
+ *   The partition runs hold the VTOC blocks themselves. Each block
+ *   holds 5 entries after its 4-byte next-block header. Chain blocks
+ *   outside the runs are queued and read in later batches.
+ *
+ * New format volumes:
+ *   The partition runs hold the hash bucket blocks. Bucket slots are
+ *   harvested one bucket block at a time, sorted by VTOCE location, and
+ *   the referenced VTOCE blocks are then read in ascending batches into
+ *   a second window. Overflow buckets outside the runs are queued the
+ *   same way as old format chain blocks.
+ */
+
+#include "vtoc/vtoc_internal.h"
+#include "mmap/mmap.h"
+#include "mmu/mmu.h"
+#include "wp/wp.h"
+
+/* Window page virtual addresses */
+#define SCAN_WIN_VA(n)  (VTOC_SCAN_VA_BASE + (n) * 0x400)
+#define SCAN_VWIN_VA(n) (VTOC_SCAN_VA_BASE + (VTOC_SCAN_WINDOW + (n)) * 0x400)
+
+/* Offset of the first VTOCE in a VTOC block */
+#define VTOCE_OLD_BLOCK_HDR 4
+#define VTOCE_NEW_BLOCK_HDR 8
+
+/* Longs copied out of a new format VTOCE (matches VTOCE_$READ) */
+#define VTOCE_NEW_COPY_LONGS 0x24
+
+/* External variables */
+extern uint32_t VTOC_CACH_LOOKUPS;       /* 0xE78736 */
+
+/*
+ * vtoc_$scan_read - Read a batch of blocks into scan window pages
+ *
+ * Issues one multi-block request for all blocks. Dirty DBUF copies are
+ * flushed first so the raw read sees current contents.
+ */
+static void vtoc_$scan_read(int16_t vol_idx, uint32_t *blocks, uint16_t count,
+                            uint32_t *ppn, uid_t *block_uid, status_$t *status)
+{
+    int32_t qblk_head;
+    uint32_t qblk_tail;
+    int32_t qblk;
+    int16_t pages_read;
+    int16_t i;
+
+    ML_$LOCK(VTOC_LOCK_ID);
+    DBUF_$UPDATE_VOL(vol_idx, &UID_$NIL);
+
+    DISK_$GET_QBLKS(count, &qblk_head, &qblk_tail);
+
+    qblk = qblk_head;
+    for (i = 0; i < (int16_t)count; i++) {
+        QBLK_FIELD(qblk, QBLK_DADDR, uint32_t) = blocks[i];
+        QBLK_FIELD(qblk, QBLK_PPN, uint32_t) = ppn[i];
+        QBLK_FIELD(qblk, QBLK_UID_HIGH, uint32_t) = block_uid->high;
+        QBLK_FIELD(qblk, QBLK_UID_LOW, uint32_t) = block_uid->low;
+        QBLK_FIELD(qblk, QBLK_HINT, uint32_t) = blocks[i];
+        QBLK_FIELD(qblk, QBLK_FLAGS, uint8_t) = 0;
+        qblk = QBLK_FIELD(qblk, QBLK_NEXT, int32_t);
+    }
+
+    DISK_$READ_MULTI(vol_idx, -1, -1, qblk_head, qblk_tail, &pages_read, status);
+
+    DISK_$RTN_QBLKS(count, qblk_head, qblk_tail);
+
+    ML_$UNLOCK(VTOC_LOCK_ID);
+
+    if (*status == status_$ok && pages_read != (int16_t)count) {
+        *status = status_$VTOC_not_found;
+    }
+}
+
+/*
+ * vtoc_$scan_in_runs - Check whether a block lies in a partition run
+ *
+ * Blocks inside a run are visited in run order anyway, so only chain
+ * pointers that leave the runs need to be queued.
+ */
+static int8_t vtoc_$scan_in_runs(int16_t vol_idx, uint32_t block)
+{
+    int16_t i;
+    uint8_t *part;
+    uint16_t count;
+    uint32_t start;
+
+    for (i = 0; i < VTOC_MAX_PARTITIONS; i++) {
+        part = VTOC_PART_ENTRY(vol_idx, i);
+        count = *(uint16_t *)part;
+        if (count == 0) {
+            break;
+        }
+        start = *(uint32_t *)(part + 2);
+        if (block >= start && block < start + count) {
+            return (int8_t)0xFF;
+        }
+    }
+    return 0;
+}
+
+/*
+ * vtoc_$scan_chain - Queue a chain block found outside the runs
+ *
+ * The refill policy in vtoc_$scan_fill keeps chain_count below
+ * VTOC_SCAN_CHAIN_MAX; the check here is defensive only.
+ */
+static void vtoc_$scan_chain(vtoc_$scan_t *scan, uint32_t block, int16_t sel)
+{
+    if (block == 0 || vtoc_$scan_in_runs(scan->vol_idx, block) < 0) {
+        return;
+    }
+    if (scan->chain_count < VTOC_SCAN_CHAIN_MAX) {
+        scan->chain_block[scan->chain_count] = block;
+        scan->chain_sel[scan->chain_count] = sel;
+        scan->chain_count++;
+    }
+}
+
+/*
+ * vtoc_$scan_fill - Load the next batch into the primary window
+ *
+ * Chain blocks take priority once a full window of them is pending, or
+ * when the runs are exhausted. This bounds chain_count: a window of run
+ * blocks adds at most VTOC_BUCKETS_PER_BLOCK chains per block, and a
+ * window of chain blocks adds at most one per block.
+ *
+ * Returns the number of blocks loaded (0 = nothing left).
+ */
+static uint16_t vtoc_$scan_fill(vtoc_$scan_t *scan, status_$t *status)
+{
+    uint16_t n = 0;
+    uint16_t i;
+    uint8_t *part;
+
+    *status = status_$ok;
+    scan->win_count = 0;
+    scan->win_next = 0;
+    scan->win_sub = 0;
+
+    if (scan->chain_count < VTOC_SCAN_WINDOW) {
+        while (n < VTOC_SCAN_WINDOW) {
+            if (scan->part_left == 0) {
+                if (scan->part_idx >= VTOC_MAX_PARTITIONS) {
+                    break;
+                }
+                part = VTOC_PART_ENTRY(scan->vol_idx, scan->part_idx);
+                scan->part_left = *(uint16_t *)part;
+                if (scan->part_left == 0) {
+                    scan->part_idx = VTOC_MAX_PARTITIONS;
+                    break;
+                }
+                scan->part_block = *(uint32_t *)(part + 2);
+                scan->part_idx++;
+            }
+            scan->win_block[n] = scan->part_block;
+            scan->win_sel[n] = -1;
+            scan->part_block++;
+            scan->part_left--;
+            n++;
+        }
+    }
+
+    if (n == 0 && scan->chain_count != 0) {
+        n = scan->chain_count < VTOC_SCAN_WINDOW ? scan->chain_count
+                                                 : VTOC_SCAN_WINDOW;
+        for (i = 0; i < n; i++) {
+            scan->win_block[i] = scan->chain_block[i];
+            scan->win_sel[i] = scan->chain_sel[i];
+        }
+        for (i = n; i < scan->chain_count; i++) {
+            scan->chain_block[i - n] = scan->chain_block[i];
+            scan->chain_sel[i - n] = scan->chain_sel[i];
+        }
+        scan->chain_count -= n;
+    }
+
+    if (n == 0) {
+        return 0;
+    }
+
+    vtoc_$scan_read(scan->vol_idx, scan->win_block, n, vtoc_$scan_ppn,
+                    scan->new_format < 0 ? &VTOC_BKT_$UID : &VTOC_$UID,
+                    status);
+    if (*status != status_$ok) {
+        return 0;
+    }
+
+    scan->win_count = n;
+    return n;
+}
+
+/*
+ * vtoc_$scan_harvest - Collect bucket slots for the next VTOCE batch
+ *
+ * Gathers whole bucket entries until another would not fit, then sorts
+ * the slots by VTOCE location so the VTOCE blocks are read in ascending
+ * disk order.
+ */
+static void vtoc_$scan_harvest(vtoc_$scan_t *scan, status_$t *status)
+{
+    vtoc_$bucket_entry_t *bucket;
+    vtoc_$scan_slot_t tmp;
+    uint16_t page;
+    int16_t bkt_idx;
+    int16_t i;
+    int16_t j;
+
+    *status = status_$ok;
+    scan->slot_count = 0;
+    scan->slot_next = 0;
+    scan->vwin_count = 0;
+
+    while (scan->slot_count + VTOCE_BUCKET_SLOTS <= VTOC_SCAN_MAX_SLOTS) {
+        if (scan->win_next >= scan->win_count) {
+            if (vtoc_$scan_fill(scan, status) == 0) {
+                break;
+            }
+        }
+
+        page = scan->win_next;
+        if (scan->win_sel[page] >= 0) {
+            /* Chained bucket: only the selected entry belongs to us */
+            bkt_idx = scan->win_sel[page];
+            scan->win_next++;
+        } else {
+            bkt_idx = scan->win_sub++;
+            if (scan->win_sub >= VTOC_BUCKETS_PER_BLOCK) {
+                scan->win_next++;
+                scan->win_sub = 0;
+            }
+        }
+
+        bucket = (vtoc_$bucket_entry_t *)(SCAN_WIN_VA(page) +
+                                          bkt_idx * VTOC_BUCKET_ENTRY_SIZE);
+
+        for (i = 0; i < VTOCE_BUCKET_SLOTS; i++) {
+            if (bucket->slots[i].block_info != 0) {
+                scan->slots[scan->slot_count].uid = bucket->slots[i].uid;
+                scan->slots[scan->slot_count].block_info = bucket->slots[i].block_info;
+                scan->slot_count++;
+            }
+        }
+
+        /* Next bucket in chain: block and bucket index (as VTOC_$LOOKUP) */
+        vtoc_$scan_chain(scan, bucket->next_bucket, (int16_t)bucket->slot_index);
+    }
+
+    /* Insertion sort by VTOCE location */
+    for (i = 1; i < (int16_t)scan->slot_count; i++) {
+        tmp = scan->slots[i];
+        for (j = i - 1; j >= 0 && scan->slots[j].block_info > tmp.block_info; j--) {
+            scan->slots[j + 1] = scan->slots[j];
+        }
+        scan->slots[j + 1] = tmp;
+    }
+}
+
+/*
+ * vtoc_$scan_vwin_find - Locate a VTOCE block in the VTOCE window
+ *
+ * Refills the window with the next distinct blocks referenced by the
+ * sorted slots when the block is not present.
+ *
+ * Returns the window page index, or -1 on I/O error.
+ */
+static int16_t vtoc_$scan_vwin_find(vtoc_$scan_t *scan, uint32_t block,
+                                    status_$t *status)
+{
+    int16_t i;
+    uint16_t n;
+    uint32_t blk;
+
+    *status = status_$ok;
+
+    for (i = 0; i < (int16_t)scan->vwin_count; i++) {
+        if (scan->vwin_block[i] == block) {
+            return i;
+        }
+    }
+
+    n = 0;
+    for (i = scan->slot_next; i < (int16_t)scan->slot_count && n < VTOC_SCAN_WINDOW; i++) {
+        blk = VTOCE_LOC_BLOCK(scan->slots[i].block_info);
+        if (n == 0 || scan->vwin_block[n - 1] != blk) {
+            scan->vwin_block[n++] = blk;
+        }
+    }
+
+    scan->vwin_count = 0;
+    vtoc_$scan_read(scan->vol_idx, scan->vwin_block, n,
+                    &vtoc_$scan_ppn[VTOC_SCAN_WINDOW], &VTOC_$UID, status);
+    if (*status != status_$ok) {
+        return -1;
+    }
+    scan->vwin_count = n;
+    return 0;
+}
+
+/*
+ * VTOC_$SCAN_INIT
+ */
+void VTOC_$SCAN_INIT(void)
+{
+    ML_$EXCLUSION_INIT(&vtoc_$scan_lock);
+}
+
+/*
+ * VTOC_$SCAN_OPEN
+ *
+ * Takes the scan window and wires its pages. The window is held until
+ * VTOC_$SCAN_CLOSE.
+ */
+void VTOC_$SCAN_OPEN(int16_t vol_idx, vtoc_$scan_t *scan, status_$t *status)
+{
+    int16_t i;
+
+    scan->open = 0;
+
+    if (vtoc_$data.mounted[vol_idx] >= 0) {
+        *status = status_$VTOC_not_mounted;
+        return;
+    }
+
+    *status = status_$ok;
+
+    ML_$EXCLUSION_START(&vtoc_$scan_lock);
+
+    WP_$CALLOC_LIST(VTOC_SCAN_PAGES, vtoc_$scan_ppn);
+    for (i = 0; i < VTOC_SCAN_PAGES; i++) {
+        MMU_$INSTALL(vtoc_$scan_ppn[i], VTOC_SCAN_VA_BASE + i * 0x400, 0x16);
+        MMU_$CACHE_INHIBIT_VA(VTOC_SCAN_VA_BASE + i * 0x400);
+    }
+
+    scan->vol_idx = vol_idx;
+    scan->new_format = vtoc_$data.format[vol_idx] < 0 ? (int8_t)0xFF : 0;
+    scan->open = (int8_t)0xFF;
+    scan->part_idx = 0;
+    scan->part_left = 0;
+    scan->part_block = 0;
+    scan->chain_count = 0;
+    scan->win_count = 0;
+    scan->win_next = 0;
+    scan->win_sub = 0;
+    scan->slot_count = 0;
+    scan->slot_next = 0;
+    scan->vwin_count = 0;
+}
+
+/*
+ * VTOC_$SCAN_NEXT
+ */
+void VTOC_$SCAN_NEXT(vtoc_$scan_t *scan, uid_t *uid, uint32_t *vtoce_loc,
+                     vtoce_$result_t *result, status_$t *status)
+{
+    uint8_t *buf;
+    uint8_t *entry;
+    uint32_t *src;
+    uint32_t *dst;
+    vtoc_$scan_slot_t *slot;
+    int16_t page;
+    int16_t i;
+
+    if (scan->open >= 0) {
+        *status = status_$VTOC_not_mounted;
+        return;
+    }
+
+    if (scan->new_format < 0) {
+        for (;;) {
+            if (scan->slot_next >= scan->slot_count) {
+                vtoc_$scan_harvest(scan, status);
+                if (*status != status_$ok) {
+                    return;
+                }
+                if (scan->slot_count == 0) {
+                    *status = status_$end_of_file;
+                    return;
+                }
+            }
+
+            slot = &scan->slots[scan->slot_next];
+            page = vtoc_$scan_vwin_find(scan, VTOCE_LOC_BLOCK(slot->block_info), status);
+            if (page < 0) {
+                return;
+            }
+            scan->slot_next++;
+
+            entry = (uint8_t *)SCAN_VWIN_VA(page) + VTOCE_NEW_BLOCK_HDR +
+                    VTOCE_LOC_ENTRY(slot->block_info) * VTOCE_NEW_SIZE;
+
+            /* Skip stale slots whose VTOCE was freed or reused */
+            if (*(int16_t *)(entry + 2) >= 0 ||
+                *(uint32_t *)(entry + 4) != slot->uid.high ||
+                *(uint32_t *)(entry + 8) != slot->uid.low) {
+                continue;
+            }
+
+            src = (uint32_t *)entry;
+            dst = (uint32_t *)result;
+            for (i = VTOCE_NEW_COPY_LONGS - 1; i >= 0; i--) {
+                *dst++ = *src++;
+            }
+            *uid = slot->uid;
+            *vtoce_loc = slot->block_info;
+            break;
+        }
+    } else {
+        for (;;) {
+            if (scan->win_next >= scan->win_count) {
+                if (vtoc_$scan_fill(scan, status) == 0) {
+                    if (*status == status_$ok) {
+                        *status = status_$end_of_file;
+                    }
+                    return;
+                }
+            }
+
+            buf = (uint8_t *)SCAN_WIN_VA(scan->win_next);
+
+            if (scan->win_sub == 0) {
+                vtoc_$scan_chain(scan, *(uint32_t *)buf, -1);
+            }
+
+            entry = NULL;
+            while (scan->win_sub < VTOCE_OLD_ENTRIES_PER_BLOCK) {
+                entry = buf + VTOCE_OLD_BLOCK_HDR + scan->win_sub * VTOCE_OLD_SIZE;
+                scan->win_sub++;
+                if (*(int16_t *)(entry + 2) < 0) {
+                    break;
+                }
+                entry = NULL;
+            }
+
+            if (entry != NULL) {
+                VTOCE_$OLD_TO_NEW(entry, result);
+                uid->high = *(uint32_t *)(entry + 4);
+                uid->low = *(uint32_t *)(entry + 8);
+                *vtoce_loc = VTOCE_LOC_MAKE(scan->win_block[scan->win_next],
+                                            scan->win_sub - 1);
+                break;
+            }
+
+            scan->win_next++;
+            scan->win_sub = 0;
+        }
+    }
+
+    /* Set write-protect flag in result based on cache flag (as VTOCE_$READ) */
+    {
+        char cache_flag = ((char *)&VTOC_CACH_LOOKUPS)[scan->vol_idx + 3];
+        uint8_t *result_byte = (uint8_t *)result + 3;
+        *result_byte = (*result_byte & 0xFD) | ((cache_flag >> 7) * 2);
+    }
+
+    *status = status_$ok;
+}
+
+/*
+ * VTOC_$SCAN_CLOSE
+ */
+void VTOC_$SCAN_CLOSE(vtoc_$scan_t *scan)
+{
+    int16_t i;
+
+    if (scan->open >= 0) {
+        return;
+    }
+    scan->open = 0;
+
+    for (i = 0; i < VTOC_SCAN_PAGES; i++) {
+        MMU_$REMOVE(vtoc_$scan_ppn[i]);
+        MMAP_$FREE(vtoc_$scan_ppn[i]);
+    }
+
+    ML_$EXCLUSION_STOP(&vtoc_$scan_lock);
+}
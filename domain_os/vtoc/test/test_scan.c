@@ -0,0 +1,397 @@
+/*
+ * Unit tests for VTOC_$SCAN_* and VTOC_$GET_UIDS
+ *
+ * Tests that a scan returns every VTOCE in use on old and new format
+ * volumes, follows chain blocks that leave the partition runs, skips
+ * stale bucket slots, reads a window of blocks per disk request with
+ * VTOCE blocks in ascending order, and gives the window back at close.
+ * Linked against scan.c and get_uids.c; the disk queue, page allocation,
+ * MMU and locks are mocked over a small in-memory disk.
+ *
+ * The scan window (VTOC_SCAN_VA_BASE) is at a fixed m68k address and
+ * queue blocks are passed around as 32-bit addresses, so the tests map
+ * a region holding both before touching them.
+ */
+
+#include "vtoc/vtoc_internal.h"
+#include "mmap/mmap.h"
+#include "mmu/mmu.h"
+#include "wp/wp.h"
+
+#define TEST_OLD_VOL    1
+#define TEST_NEW_VOL    2
+#define TEST_IDLE_VOL   3
+
+#define TEST_DISK_BLOCKS 64
+#define TEST_PPN_BASE   0x100
+#define TEST_QBLK_BASE  0xD58000
+#define TEST_QBLK_SIZE  0x40
+#define TEST_MAP_BASE   0xD58000
+#define TEST_MAP_SIZE   0xD000
+#define TEST_MAX_READS  8
+
+/*
+ * Host mmap; <sys/mman.h> clashes with base.h's size_t.  Flags are the
+ * Linux values (PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_FIXED|MAP_ANONYMOUS).
+ */
+extern void *mmap(void *addr, unsigned long len, int prot, int flags,
+                  int fd, long off);
+#define TEST_PROT_RW    0x03
+#define TEST_MAP_FLAGS  0x32
+
+/* Storage normally defined in vtoc_data.c and the uid and mount data */
+vtoc_$data_t vtoc_$data;
+uint8_t OS_DISK_DATA[0x300];
+ml_$exclusion_t vtoc_$scan_lock;
+uint32_t vtoc_$scan_ppn[VTOC_SCAN_PAGES];
+uid_t VTOC_$UID = { 0x00000201, 0 };
+uid_t VTOC_BKT_$UID = { 0x00000202, 0 };
+uid_t UID_$NIL;
+int8_t VTOC_CACH_LOOKUPS[16];   /* Lookup count, then per-volume flags */
+
+/* Mock state tracking */
+static uint8_t mock_disk[TEST_DISK_BLOCKS][0x400];
+static uint32_t mock_page_va[VTOC_SCAN_PAGES];
+static int mock_installed;
+static int mock_excl_held;
+static int mock_converted;
+static int mock_reads;
+static uint16_t mock_read_count[TEST_MAX_READS];
+static uint32_t mock_read_block[TEST_MAX_READS][VTOC_SCAN_WINDOW];
+
+void ML_$LOCK(int16_t resource_id) { (void)resource_id; }
+void ML_$UNLOCK(int16_t resource_id) { (void)resource_id; }
+void ML_$EXCLUSION_INIT(ml_$exclusion_t *excl) { (void)excl; }
+void ML_$EXCLUSION_START(ml_$exclusion_t *excl) { (void)excl; mock_excl_held++; }
+void ML_$EXCLUSION_STOP(ml_$exclusion_t *excl) { (void)excl; mock_excl_held--; }
+void DBUF_$UPDATE_VOL(uint16_t vol_idx, void *uid_p) { (void)vol_idx; (void)uid_p; }
+void MMU_$CACHE_INHIBIT_VA(uint32_t va) { (void)va; }
+void MMU_$REMOVE(uint32_t ppn) { (void)ppn; mock_installed--; }
+void MMAP_$FREE(uint32_t vpn) { (void)vpn; }
+void VTOCE_$OLD_TO_NEW(void *old_vtoce, void *new_vtoce) { (void)old_vtoce; (void)new_vtoce; mock_converted++; }
+
+void WP_$CALLOC_LIST(int16_t count, uint32_t *ppn_arr)
+{
+    int16_t i;
+
+    for (i = 0; i < count; i++) {
+        ppn_arr[i] = TEST_PPN_BASE + i;
+    }
+}
+
+void MMU_$INSTALL(uint32_t ppn, uint32_t va, uint32_t flags)
+{
+    (void)flags;
+    mock_page_va[ppn - TEST_PPN_BASE] = va;
+    mock_installed++;
+}
+
+void DISK_$GET_QBLKS(int16_t count, int32_t *qblk_head, uint32_t *qblk_tail)
+{
+    int16_t i;
+    uint32_t q = TEST_QBLK_BASE;
+
+    for (i = 0; i < count; i++, q += TEST_QBLK_SIZE) {
+        QBLK_FIELD(q, QBLK_NEXT, int32_t) = (int32_t)(q + TEST_QBLK_SIZE);
+    }
+    *qblk_head = TEST_QBLK_BASE;
+    *qblk_tail = q - TEST_QBLK_SIZE;
+}
+
+void DISK_$RTN_QBLKS(int16_t count, int32_t qblk_head, uint32_t qblk_tail)
+{
+    (void)count; (void)qblk_head; (void)qblk_tail;
+}
+
+void DISK_$READ_MULTI(uint16_t vol_idx, int16_t flags1, int16_t flags2,
+                      int32_t qblk_head, uint32_t qblk_tail,
+                      int16_t *pages_read, status_$t *status)
+{
+    uint32_t q = (uint32_t)qblk_head;
+    uint32_t daddr;
+    int16_t n = 0;
+
+    (void)vol_idx; (void)flags1; (void)flags2;
+    for (;;) {
+        daddr = QBLK_FIELD(q, QBLK_DADDR, uint32_t);
+        memcpy((void *)(uintptr_t)mock_page_va[QBLK_FIELD(q, QBLK_PPN, uint32_t) - TEST_PPN_BASE],
+               mock_disk[daddr], 0x400);
+        if (mock_reads < TEST_MAX_READS) {
+            mock_read_block[mock_reads][n] = daddr;
+        }
+        n++;
+        if (q == qblk_tail) {
+            break;
+        }
+        q = QBLK_FIELD(q, QBLK_NEXT, uint32_t);
+    }
+    if (mock_reads < TEST_MAX_READS) {
+        mock_read_count[mock_reads] = (uint16_t)n;
+    }
+    mock_reads++;
+    *pages_read = n;
+    *status = status_$ok;
+}
+
+/* Add a partition run to a volume's table */
+static void set_run(int16_t vol_idx, int16_t n, uint32_t start, uint16_t count)
+{
+    uint8_t *part = VTOC_PART_ENTRY(vol_idx, n);
+
+    memcpy(part, &count, sizeof(count));
+    memcpy(part + 2, &start, sizeof(start));
+}
+
+/* Mark an old format VTOCE in use */
+static void put_old_entry(uint32_t block, int16_t entry, uint32_t uid_low)
+{
+    uint8_t *e = mock_disk[block] + 4 + entry * VTOCE_OLD_SIZE;
+
+    *(int16_t *)(e + 2) = -1;
+    *(uint32_t *)(e + 4) = 0x1000;
+    *(uint32_t *)(e + 8) = uid_low;
+}
+
+/* Mark a new format VTOCE in use */
+static void put_new_entry(uint32_t block, int16_t entry, uint32_t uid_low)
+{
+    uint8_t *e = mock_disk[block] + 8 + entry * VTOCE_NEW_SIZE;
+
+    *(int16_t *)(e + 2) = -1;
+    *(uint32_t *)(e + 4) = 0x1000;
+    *(uint32_t *)(e + 8) = uid_low;
+}
+
+/* Point a bucket slot at a VTOCE */
+static void put_slot(uint32_t block, int16_t bucket, int16_t slot,
+                     uint32_t uid_low, uint32_t loc)
+{
+    vtoc_$bucket_entry_t *b = (vtoc_$bucket_entry_t *)
+        (mock_disk[block] + bucket * VTOC_BUCKET_ENTRY_SIZE);
+
+    b->slots[slot].uid.high = 0x1000;
+    b->slots[slot].uid.low = uid_low;
+    b->slots[slot].block_info = loc;
+}
+
+/*
+ * Old format volume: one run of blocks 20-29; block 25 chains to block
+ * 40 outside the run and block 21 to block 22 inside it.
+ * New format volume: one bucket block at 10; bucket 1 chains to bucket 2
+ * of block 50; VTOCEs in blocks 30-33, with a stale slot for block 32.
+ */
+static void reset_mocks(void)
+{
+    static int mapped;
+
+    if (!mapped) {
+        mmap((void *)TEST_MAP_BASE, TEST_MAP_SIZE, TEST_PROT_RW,
+             TEST_MAP_FLAGS, -1, 0);
+        mapped = 1;
+    }
+    memset(mock_disk, 0, sizeof(mock_disk));
+    memset(OS_DISK_DATA, 0, sizeof(OS_DISK_DATA));
+    memset(&vtoc_$data, 0, sizeof(vtoc_$data));
+    mock_installed = 0;
+    mock_excl_held = 0;
+    mock_converted = 0;
+    mock_reads = 0;
+
+    vtoc_$data.mounted[TEST_OLD_VOL] = -1;
+    set_run(TEST_OLD_VOL, 0, 20, 10);
+    put_old_entry(20, 0, 1);
+    put_old_entry(20, 4, 2);
+    put_old_entry(27, 2, 3);
+    put_old_entry(40, 1, 4);
+    *(uint32_t *)mock_disk[21] = 22;
+    *(uint32_t *)mock_disk[25] = 40;
+
+    vtoc_$data.mounted[TEST_NEW_VOL] = -1;
+    vtoc_$data.format[TEST_NEW_VOL] = -1;
+    set_run(TEST_NEW_VOL, 0, 10, 1);
+    put_slot(10, 0, 0, 0xA, VTOCE_LOC_MAKE(33, 1));
+    put_slot(10, 0, 5, 0xB, VTOCE_LOC_MAKE(31, 0));
+    put_slot(10, 3, 0, 0xC, VTOCE_LOC_MAKE(32, 2));
+    ((vtoc_$bucket_entry_t *)(mock_disk[10] + VTOC_BUCKET_ENTRY_SIZE))->next_bucket = 50;
+    ((vtoc_$bucket_entry_t *)(mock_disk[10] + VTOC_BUCKET_ENTRY_SIZE))->slot_index = 2;
+    put_slot(50, 2, 0, 0xD, VTOCE_LOC_MAKE(30, 0));
+    put_slot(50, 1, 0, 0xE, VTOCE_LOC_MAKE(34, 0));     /* Not ours */
+    put_new_entry(30, 0, 0xD);
+    put_new_entry(31, 0, 0xB);
+    put_new_entry(32, 2, 0xF);
+    put_new_entry(33, 1, 0xA);
+    put_new_entry(34, 0, 0xE);
+
+    VTOC_$SCAN_INIT();
+}
+
+/* Scan a volume, recording the UID low words and locations seen */
+static int16_t scan_all(int16_t vol_idx, uint32_t *uid_low, uint32_t *loc,
+                        int16_t max, status_$t *status)
+{
+    vtoc_$scan_t scan;
+    vtoce_$result_t result;
+    uid_t uid;
+    uint32_t vtoce_loc;
+    int16_t n = 0;
+
+    VTOC_$SCAN_OPEN(vol_idx, &scan, status);
+    if (*status != status_$ok) {
+        return 0;
+    }
+    for (;;) {
+        VTOC_$SCAN_NEXT(&scan, &uid, &vtoce_loc, &result, status);
+        if (*status != status_$ok) {
+            break;
+        }
+        if (n < max) {
+            uid_low[n] = uid.low;
+            loc[n] = vtoce_loc;
+        }
+        n++;
+    }
+    VTOC_$SCAN_CLOSE(&scan);
+    return n;
+}
+
+/*
+ * Test: Scanning an old format volume
+ * Expected: Every entry in use, in block order, with the chain block
+ * outside the run last; 11 blocks in three disk requests
+ */
+void test_scan_old_format(void)
+{
+    uint32_t uid_low[8];
+    uint32_t loc[8];
+    status_$t status;
+    int16_t n;
+
+    reset_mocks();
+
+    n = scan_all(TEST_OLD_VOL, uid_low, loc, 8, &status);
+    ASSERT_EQ(status, status_$end_of_file);
+    ASSERT_EQ(n, 4);
+    ASSERT_EQ(uid_low[0], 1);
+    ASSERT_EQ(loc[0], VTOCE_LOC_MAKE(20, 0));
+    ASSERT_EQ(uid_low[1], 2);
+    ASSERT_EQ(loc[1], VTOCE_LOC_MAKE(20, 4));
+    ASSERT_EQ(uid_low[2], 3);
+    ASSERT_EQ(loc[2], VTOCE_LOC_MAKE(27, 2));
+    ASSERT_EQ(uid_low[3], 4);
+    ASSERT_EQ(loc[3], VTOCE_LOC_MAKE(40, 1));
+    ASSERT_EQ(mock_converted, 4);
+
+    ASSERT_EQ(mock_reads, 3);
+    ASSERT_EQ(mock_read_count[0], VTOC_SCAN_WINDOW);
+    ASSERT_EQ(mock_read_block[0][0], 20);
+    ASSERT_EQ(mock_read_count[1], 2);
+    ASSERT_EQ(mock_read_count[2], 1);
+    ASSERT_EQ(mock_read_block[2][0], 40);
+}
+
+/*
+ * Test: Scanning a new format volume
+ * Expected: The VTOCEs the buckets point at, in disk order, including
+ * the chained bucket but not its neighbours and not the stale slot;
+ * the VTOCE blocks are read in one ascending request
+ */
+void test_scan_new_format(void)
+{
+    uint32_t uid_low[8];
+    uint32_t loc[8];
+    status_$t status;
+    int16_t n;
+
+    reset_mocks();
+
+    n = scan_all(TEST_NEW_VOL, uid_low, loc, 8, &status);
+    ASSERT_EQ(status, status_$end_of_file);
+    ASSERT_EQ(n, 3);
+    ASSERT_EQ(uid_low[0], 0xD);
+    ASSERT_EQ(loc[0], VTOCE_LOC_MAKE(30, 0));
+    ASSERT_EQ(uid_low[1], 0xB);
+    ASSERT_EQ(uid_low[2], 0xA);
+    ASSERT_EQ(loc[2], VTOCE_LOC_MAKE(33, 1));
+    ASSERT_EQ(mock_converted, 0);
+
+    ASSERT_EQ(mock_reads, 3);
+    ASSERT_EQ(mock_read_block[0][0], 10);
+    ASSERT_EQ(mock_read_block[1][0], 50);
+    ASSERT_EQ(mock_read_count[2], 4);
+    ASSERT_EQ(mock_read_block[2][0], 30);
+    ASSERT_EQ(mock_read_block[2][1], 31);
+    ASSERT_EQ(mock_read_block[2][2], 32);
+    ASSERT_EQ(mock_read_block[2][3], 33);
+}
+
+/*
+ * Test: Opening and closing scans
+ * Expected: An unmounted volume is refused without taking the window;
+ * a finished scan unmaps and releases it
+ */
+void test_scan_window_released(void)
+{
+    vtoc_$scan_t scan;
+    uint32_t uid_low[8];
+    uint32_t loc[8];
+    status_$t status;
+
+    reset_mocks();
+
+    VTOC_$SCAN_OPEN(TEST_IDLE_VOL, &scan, &status);
+    ASSERT_EQ(status, status_$VTOC_not_mounted);
+    ASSERT_EQ(mock_excl_held, 0);
+    ASSERT_EQ(mock_installed, 0);
+
+    scan_all(TEST_OLD_VOL, uid_low, loc, 8, &status);
+    ASSERT_EQ(mock_excl_held, 0);
+    ASSERT_EQ(mock_installed, 0);
+
+    /* Closing twice is harmless */
+    VTOC_$SCAN_CLOSE(&scan);
+    ASSERT_EQ(mock_excl_held, 0);
+}
+
+/*
+ * Test: VTOC_$GET_UIDS
+ * Expected: All UIDs when they fit; the first *max and the full count
+ * when they do not; unmounted and out of range volumes refused
+ */
+void test_scan_get_uids(void)
+{
+    uid_t uids[4];
+    int16_t vol_idx;
+    uint16_t max;
+    uint32_t count;
+    status_$t status;
+
+    reset_mocks();
+
+    vol_idx = TEST_NEW_VOL;
+    max = 4;
+    VTOC_$GET_UIDS(&vol_idx, uids, &max, &count, &status);
+    ASSERT_EQ(status, status_$ok);
+    ASSERT_EQ(count, 3);
+    ASSERT_EQ(uids[0].high, 0x1000);
+    ASSERT_EQ(uids[0].low, 0xD);
+    ASSERT_EQ(uids[2].low, 0xA);
+
+    memset(uids, 0, sizeof(uids));
+    vol_idx = TEST_OLD_VOL;
+    max = 2;
+    VTOC_$GET_UIDS(&vol_idx, uids, &max, &count, &status);
+    ASSERT_EQ(status, status_$ok);
+    ASSERT_EQ(count, 4);
+    ASSERT_EQ(uids[1].low, 2);
+    ASSERT_EQ(uids[2].low, 0);
+    ASSERT_EQ(mock_excl_held, 0);
+
+    vol_idx = TEST_IDLE_VOL;
+    VTOC_$GET_UIDS(&vol_idx, uids, &max, &count, &status);
+    ASSERT_EQ(status, status_$VTOC_not_mounted);
+    ASSERT_EQ(count, 0);
+
+    vol_idx = 9;
+    VTOC_$GET_UIDS(&vol_idx, uids, &max, &count, &status);
+    ASSERT_EQ(status, status_$VTOC_not_mounted);
+}
@@ -39,6 +39,67 @@ typedef struct vtoc_$lookup_req_t {
     uint8_t     vol_idx;            /* 0x0C: Volume index */
 } vtoc_$lookup_req_t;
 
+/*
+ * VTOC scan read-ahead window (blocks per DISK_$READ_MULTI batch)
+ */
+#define VTOC_SCAN_WINDOW        8
+
+/*
+ * Harvested bucket slots held by a scan at one time
+ * (4 bucket entries of 20 slots each = one bucket block)
+ */
+#define VTOC_SCAN_MAX_SLOTS     80
+
+/*
+ * Out-of-run chain blocks a scan can have pending. Each bucket entry
+ * in a window can contribute one chained bucket, so this is bounded
+ * by (4 + 1) * VTOC_SCAN_WINDOW.
+ */
+#define VTOC_SCAN_CHAIN_MAX     40
+
+/*
+ * VTOC scan state
+ *
+ * Caller-allocated cursor for VTOC_$SCAN_OPEN / VTOC_$SCAN_NEXT.
+ * Treat as opaque outside the VTOC subsystem.
+ */
+typedef struct vtoc_$scan_slot_t {
+    uid_t       uid;                /* 0x00: UID from bucket slot */
+    uint32_t    block_info;         /* 0x08: VTOCE location (block << 4 | entry) */
+} vtoc_$scan_slot_t;
+
+typedef struct vtoc_$scan_t {
+    int16_t     vol_idx;            /* Volume being scanned */
+    int8_t      new_format;         /* 0xFF = new (bucket) format volume */
+    int8_t      open;               /* 0xFF = scan window held */
+
+    /* Partition run cursor */
+    int16_t     part_idx;           /* Current partition table entry */
+    uint16_t    part_left;          /* Blocks left in current run */
+    uint32_t    part_block;         /* Next block in current run */
+
+    /* Chain blocks that fall outside the partition runs */
+    uint16_t    chain_count;
+    uint32_t    chain_block[VTOC_SCAN_CHAIN_MAX];
+    int16_t     chain_sel[VTOC_SCAN_CHAIN_MAX];
+
+    /* Primary window: VTOC blocks (old) or bucket blocks (new) */
+    uint16_t    win_count;
+    uint16_t    win_next;           /* Window block being consumed */
+    uint16_t    win_sub;            /* Next entry/bucket within that block */
+    uint32_t    win_block[VTOC_SCAN_WINDOW];
+    int16_t     win_sel[VTOC_SCAN_WINDOW];  /* -1 = whole block, else one bucket */
+
+    /* New format: slots harvested from buckets, sorted by location */
+    uint16_t    slot_count;
+    uint16_t    slot_next;
+    vtoc_$scan_slot_t slots[VTOC_SCAN_MAX_SLOTS];
+
+    /* New format: VTOCE block window */
+    uint16_t    vwin_count;
+    uint32_t    vwin_block[VTOC_SCAN_WINDOW];
+} vtoc_$scan_t;
+
 /*
  * ============================================================================
  * Volume Management Functions
@@ -294,4 +355,70 @@ void VTOCE_$TRUNCATE(void *vtoce_loc, uint32_t flags, int32_t new_length,
                      int32_t param_4, uint32_t *blocks_freed,
                      status_$t *status);
 
+/*
+ * ============================================================================
+ * Volume Scan Functions
+ * ============================================================================
+ *
+ * Streaming iterator over every VTOCE on a volume. Blocks are read in
+ * batches of VTOC_SCAN_WINDOW through DISK_$READ_MULTI into a private
+ * window instead of one DBUF_$GET_BLOCK round trip per block, so bulk
+ * metadata walks run at disk bandwidth and do not churn the DBUF cache.
+ *
+ * Only one scan may be open at a time; VTOC_$SCAN_OPEN blocks until the
+ * scan window is free. Entries are a snapshot: dirty DBUF blocks are
+ * flushed before each batch, but changes made while the scan is open
+ * may or may not be seen.
+ */
+
+/*
+ * VTOC_$SCAN_INIT - Initialize the volume scan window lock
+ *
+ * Called once at boot after DBUF_$INIT.
+ */
+void VTOC_$SCAN_INIT(void);
+
+/*
+ * VTOC_$SCAN_OPEN - Begin a scan of all VTOCEs on a volume
+ *
+ * @param vol_idx   Volume index
+ * @param scan      Caller-allocated scan state
+ * @param status    Output status code
+ */
+void VTOC_$SCAN_OPEN(int16_t vol_idx, vtoc_$scan_t *scan, status_$t *status);
+
+/*
+ * VTOC_$SCAN_NEXT - Return the next VTOCE on the volume
+ *
+ * @param scan      Scan state from VTOC_$SCAN_OPEN
+ * @param uid       Receives the object UID
+ * @param vtoce_loc Receives the VTOCE location (block << 4 | entry)
+ * @param result    Receives the VTOCE (always new format)
+ * @param status    Output status code (status_$end_of_file when done)
+ */
+void VTOC_$SCAN_NEXT(vtoc_$scan_t *scan, uid_t *uid, uint32_t *vtoce_loc,
+                     vtoce_$result_t *result, status_$t *status);
+
+/*
+ * VTOC_$SCAN_CLOSE - End a scan and release the scan window
+ *
+ * @param scan      Scan state from VTOC_$SCAN_OPEN
+ */
+void VTOC_$SCAN_CLOSE(vtoc_$scan_t *scan);
+
+/*
+ * VTOC_$GET_UIDS - Get the UIDs of every object on a volume
+ *
+ * Walks the volume with VTOC_$SCAN_* and stores up to *max UIDs.
+ * *count receives the number of objects found, which may exceed *max.
+ *
+ * @param vol_idx   Volume index
+ * @param uids      Receives the UIDs
+ * @param max       Capacity of uids
+ * @param count     Receives the number of objects on the volume
+ * @param status    Output status code
+ */
+void VTOC_$GET_UIDS(int16_t *vol_idx, uid_t *uids, uint16_t *max,
+                    uint32_t *count, status_$t *status);
+
 #endif /* VTOC_H */
@@ -72,3 +72,12 @@ vtoc_$uid_cache_bucket_t vtoc_$uid_cache[VTOC_UID_CACHE_BUCKETS];
  * Used to accumulate blocks to free during VTOCE_$TRUNCATE.
  */
 uint32_t vtoc_$free_list[64];
+
+/*
+ * Volume scan window
+ *
+ * Serializes VTOC_$SCAN_* users of the fixed scan VA window and holds
+ * the physical pages wired for it while a scan is open.
+ */
+ml_$exclusion_t vtoc_$scan_lock;
+uint32_t vtoc_$scan_ppn[VTOC_SCAN_PAGES];
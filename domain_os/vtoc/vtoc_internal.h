@@ -293,6 +293,54 @@ extern vtoc_$uid_cache_bucket_t vtoc_$uid_cache[VTOC_UID_CACHE_BUCKETS];
 #define VTOCE_LOC_MAKE(block, entry) \
     (((block) << 4) | ((entry) & 0x0F))
 
+/*
+ * Per-volume partition table
+ *
+ * Follows the fixed fields of the per-volume data (at -0x40 from the
+ * per-volume base). Each 6-byte entry describes one contiguous run of
+ * VTOC blocks (old format) or hash bucket blocks (new format):
+ *   +0x00: uint16_t block count (0 = end of table)
+ *   +0x02: uint32_t start block
+ */
+#define VTOC_PART_TABLE_OFFSET  0x14    /* From per-volume data start (-0x54) */
+#define VTOC_PART_ENTRY_SIZE    6
+#define VTOC_MAX_PARTITIONS     13
+
+/* Get partition table entry for a volume */
+#define VTOC_PART_ENTRY(vol_idx, n) \
+    (OS_DISK_DATA + (vol_idx) * 100 - 0x54 + VTOC_PART_TABLE_OFFSET + \
+     (n) * VTOC_PART_ENTRY_SIZE)
+
+/*
+ * Bucket entries per bucket block (new format), 4 * 0xF8 = 0x3E0 bytes
+ */
+#define VTOC_BUCKETS_PER_BLOCK  4
+
+/*
+ * Volume scan window
+ *
+ * VTOC_$SCAN_* reads blocks into private pages mapped just above the
+ * DBUF buffer range (DBUF_VA_BASE + DBUF_MAX_BUFFERS * 0x400). The
+ * first VTOC_SCAN_WINDOW pages hold VTOC/bucket blocks, the next
+ * VTOC_SCAN_WINDOW hold VTOCE blocks (new format only).
+ */
+#define VTOC_SCAN_VA_BASE       0xD60400
+#define VTOC_SCAN_PAGES         (2 * VTOC_SCAN_WINDOW)
+
+extern ml_$exclusion_t vtoc_$scan_lock;
+extern uint32_t vtoc_$scan_ppn[VTOC_SCAN_PAGES];
+
+/* Disk queue block field offsets used by the scan (see ast_$read_area_pages) */
+#define QBLK_DADDR      0x04    /* Disk address */
+#define QBLK_NEXT       0x08    /* Next queue block */
+#define QBLK_PPN        0x14    /* Physical page to transfer */
+#define QBLK_UID_HIGH   0x20    /* Expected block UID */
+#define QBLK_UID_LOW    0x24
+#define QBLK_HINT       0x28    /* Block hint */
+#define QBLK_FLAGS      0x30
+
+#define QBLK_FIELD(q, off, type) (*(type *)((uintptr_t)(q) + (off)))
+
 /*
  * Internal function prototypes
  */
@@ -3,7 +3,9 @@
  *
  * Implementation of the XNS IDP checksum algorithm. The XNS checksum
  * uses one's complement addition with end-around carry, followed by
- * a left rotation of the result after each word is added.
+ * a left rotation of the result after each word is added.  The sum is
+ * computed 16 words at a time; the word-at-a-time original is kept as
+ * xns_$checksum_ref.
  *
  * Original addresses:
  *   XNS_IDP_$CHECKSUM:   0x00E2B850
@@ -13,7 +15,7 @@
 #include "xns/xns_internal.h"
 
 /*
- * XNS_IDP_$CHECKSUM - Calculate IDP checksum
+ * xns_$checksum_ref - IDP checksum, one word at a time
  *
  * Computes the XNS IDP checksum using the following algorithm:
  *   1. Initialize sum to 0
@@ -22,6 +24,9 @@
  *      b. Rotate sum left by 1 bit
  *   3. If result is 0xFFFF, return 0 (0xFFFF means "no checksum")
  *
+ * This is the original routine, kept as the reference for
+ * XNS_IDP_$CHECKSUM and for the odd word counts it does not handle.
+ *
  * Assembly analysis (0x00E2B850):
  *   moveq #0x0,D0              ; sum = 0
  *   movea.l (0x4,SP),A0        ; A0 = data pointer
@@ -39,13 +44,8 @@
  *   moveq #0x0,D0              ; sum = 0
  * done:
  *   rts
- *
- * @param data          Pointer to data (must be word-aligned)
- * @param word_count    Number of 16-bit words to checksum
- *
- * @return Checksum value, or 0 if computed checksum is 0xFFFF
  */
-uint16_t XNS_IDP_$CHECKSUM(uint16_t *data, int16_t word_count)
+static uint16_t xns_$checksum_ref(uint16_t *data, int16_t word_count)
 {
     uint16_t sum = 0;
     int16_t count = word_count - 1;
@@ -72,6 +72,77 @@ uint16_t XNS_IDP_$CHECKSUM(uint16_t *data, int16_t word_count)
     return sum;
 }
 
+/*
+ * XNS_IDP_$CHECKSUM - Calculate IDP checksum
+ *
+ * The same sum as xns_$checksum_ref without the carry test and rotate
+ * on every word.  In one's complement (modulo 0xFFFF) arithmetic a left
+ * rotate is a doubling, so the word i places from the end of the data
+ * simply counts 2^i times; and since 2^16 is 1, the weights repeat every
+ * 16 words.  Each group of 16 words is therefore summed with plain
+ * shifts into a 32-bit accumulator (16 words shifted by at most 15 bits
+ * cannot overflow it), the group folded to 17 bits and added in, and the
+ * total folded to 16 bits once at the end.  The result is identical to
+ * the reference, including 0 for a sum of 0xFFFF.
+ *
+ * Any words over a multiple of 16 come first, as the front of a group.
+ *
+ * @param data          Pointer to data (must be word-aligned)
+ * @param word_count    Number of 16-bit words to checksum
+ *
+ * @return Checksum value, or 0 if computed checksum is 0xFFFF
+ *
+ * Original address: 0x00E2B850
+ */
+uint16_t XNS_IDP_$CHECKSUM(uint16_t *data, int16_t word_count)
+{
+    uint32_t sum;
+    uint32_t group;
+    int16_t groups;
+    int16_t shift;
+
+    if (word_count < 1) {
+        return xns_$checksum_ref(data, word_count);
+    }
+
+    sum = 0;
+
+    /* Leading words: weights 2^n .. 2^1 */
+    shift = word_count & 0x0F;
+    if (shift != 0) {
+        group = 0;
+        for (; shift > 0; shift--) {
+            group += (uint32_t)*data++ << shift;
+        }
+        sum += (group & 0xFFFF) + (group >> 16);
+    }
+
+    /* Whole groups: weights 2^0, 2^15 .. 2^1 */
+    for (groups = word_count >> 4; groups > 0; groups--) {
+        group = (uint32_t)data[0]
+              + ((uint32_t)data[1] << 15) + ((uint32_t)data[2] << 14)
+              + ((uint32_t)data[3] << 13) + ((uint32_t)data[4] << 12)
+              + ((uint32_t)data[5] << 11) + ((uint32_t)data[6] << 10)
+              + ((uint32_t)data[7] << 9)  + ((uint32_t)data[8] << 8)
+              + ((uint32_t)data[9] << 7)  + ((uint32_t)data[10] << 6)
+              + ((uint32_t)data[11] << 5) + ((uint32_t)data[12] << 4)
+              + ((uint32_t)data[13] << 3) + ((uint32_t)data[14] << 2)
+              + ((uint32_t)data[15] << 1);
+        sum += (group & 0xFFFF) + (group >> 16);
+        data += 16;
+    }
+
+    /* Fold to 16 bits with end-around carry */
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+
+    if (sum == 0xFFFF) {
+        sum = 0;
+    }
+
+    return (uint16_t)sum;
+}
+
 /*
  * XNS_IDP_$HOP_AND_SUM - Calculate hop count contribution to checksum
  *
@@ -183,6 +183,15 @@ void XNS_IDP_$OS_DEMUX(void *packet_info, int16_t *port_ptr, void *param3, statu
             return;
         }
 
+        /*
+         * A destination the routing process has already routed is sent
+         * on from here without waiting for it
+         */
+        if (ROUTE_$FAST_FORWARD((uint32_t *)((uint8_t *)header - 0x28),
+                                (uint32_t *)(pkt + 0x3C)) < 0) {
+            return;
+        }
+
         /* Forward packet via routing socket */
         {
             struct {
@@ -0,0 +1,271 @@
+/*
+ * xns/test/test_idp_checksum.c - Tests for XNS_IDP_$CHECKSUM
+ *
+ * Checks the 16-word block checksum against the word-at-a-time
+ * reference (xns_$checksum_ref) over edge cases and random buffers of
+ * every length a packet can have, then times the two.
+ *
+ * Build with:
+ *   gcc -O2 -I../.. test_idp_checksum.c -o test_idp_checksum
+ *
+ * Run:
+ *   ./test_idp_checksum [benchmark iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+/* Keep the kernel headers out: the checksum needs only stdint types */
+#ifndef XNS_INTERNAL_H
+#define XNS_INTERNAL_H
+#endif
+
+#include "../idp_checksum.c"
+
+/* Largest IDP packet in words */
+#define MAX_WORDS   288
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) static void test_##name(void)
+#define RUN_TEST(name) do { \
+    int _failed = tests_failed; \
+    printf("  Running %s... ", #name); \
+    test_##name(); \
+    if (tests_failed == _failed) { \
+        tests_passed++; \
+        printf("PASSED\n"); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        printf("FAILED\n    Expected: 0x%lx, Got: 0x%lx at line %d\n", \
+               (unsigned long)(expected), (unsigned long)(actual), __LINE__); \
+        tests_failed++; \
+        return; \
+    } \
+} while(0)
+
+static uint16_t buf[MAX_WORDS * 4];
+
+/* Small, repeatable generator so a failure can be reproduced */
+static uint32_t rand_state = 0x1234567;
+
+static uint16_t next_word(void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return (uint16_t)(rand_state >> 8);
+}
+
+static void fill(uint16_t *p, int n, uint16_t value)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        p[i] = value;
+    }
+}
+
+/* Both versions must agree on p[0 .. n-1] */
+static int same(uint16_t *p, int16_t n)
+{
+    return XNS_IDP_$CHECKSUM(p, n) == xns_$checksum_ref(p, n);
+}
+
+TEST(all_zero)
+{
+    int16_t n;
+
+    fill(buf, MAX_WORDS, 0);
+    for (n = 1; n <= MAX_WORDS; n++) {
+        ASSERT_EQ(0, XNS_IDP_$CHECKSUM(buf, n));
+        ASSERT_EQ(xns_$checksum_ref(buf, n), XNS_IDP_$CHECKSUM(buf, n));
+    }
+}
+
+TEST(all_ones)
+{
+    int16_t n;
+
+    /* Sums to 0xFFFF, which is reported as 0 */
+    fill(buf, MAX_WORDS, 0xFFFF);
+    for (n = 1; n <= MAX_WORDS; n++) {
+        ASSERT_EQ(0, XNS_IDP_$CHECKSUM(buf, n));
+        ASSERT_EQ(xns_$checksum_ref(buf, n), XNS_IDP_$CHECKSUM(buf, n));
+    }
+}
+
+TEST(single_word)
+{
+    uint32_t w;
+
+    for (w = 0; w <= 0xFFFF; w++) {
+        buf[0] = (uint16_t)w;
+        ASSERT_EQ(xns_$checksum_ref(buf, 1), XNS_IDP_$CHECKSUM(buf, 1));
+    }
+}
+
+TEST(one_bit_each_position)
+{
+    int16_t n;
+    int16_t i;
+    int16_t bit;
+
+    /* Every word position with every bit: checks each weight alone */
+    for (n = 1; n <= 40; n++) {
+        for (i = 0; i < n; i++) {
+            for (bit = 0; bit < 16; bit++) {
+                fill(buf, n, 0);
+                buf[i] = (uint16_t)(1 << bit);
+                ASSERT_EQ(xns_$checksum_ref(buf, n), XNS_IDP_$CHECKSUM(buf, n));
+            }
+        }
+    }
+}
+
+TEST(random_every_length)
+{
+    int16_t n;
+    int round;
+    int i;
+
+    for (round = 0; round < 200; round++) {
+        for (i = 0; i < MAX_WORDS; i++) {
+            buf[i] = next_word();
+        }
+        for (n = 1; n <= MAX_WORDS; n++) {
+            if (!same(buf, n)) {
+                ASSERT_EQ(xns_$checksum_ref(buf, n), XNS_IDP_$CHECKSUM(buf, n));
+            }
+        }
+    }
+}
+
+TEST(random_mostly_ones)
+{
+    int16_t n;
+    int round;
+    int i;
+
+    /* Large words make the carries and folds work hardest */
+    for (round = 0; round < 200; round++) {
+        for (i = 0; i < MAX_WORDS; i++) {
+            buf[i] = 0xFFFF ^ (next_word() & 0x0101);
+        }
+        for (n = 1; n <= MAX_WORDS; n++) {
+            if (!same(buf, n)) {
+                ASSERT_EQ(xns_$checksum_ref(buf, n), XNS_IDP_$CHECKSUM(buf, n));
+            }
+        }
+    }
+}
+
+TEST(long_buffer)
+{
+    static uint16_t big[0x7FFF];
+    int i;
+
+    /* Most words the 16-bit count allows: the accumulators must not wrap */
+    fill(big, 0x7FFF, 0xFFFE);
+    ASSERT_EQ(xns_$checksum_ref(big, 0x7FFF), XNS_IDP_$CHECKSUM(big, 0x7FFF));
+
+    for (i = 0; i < 0x7FFF; i++) {
+        big[i] = next_word();
+    }
+    ASSERT_EQ(xns_$checksum_ref(big, 0x7FFF), XNS_IDP_$CHECKSUM(big, 0x7FFF));
+}
+
+TEST(after_hop_increment)
+{
+    int16_t n;
+    int i;
+    uint16_t sum;
+
+    /* Forwarding path: the packet is summed again after the hop count
+     * (byte 4) is bumped */
+    for (n = 15; n <= MAX_WORDS; n++) {
+        for (i = 0; i < n; i++) {
+            buf[i] = next_word();
+        }
+        sum = XNS_IDP_$CHECKSUM(buf, n);
+        ASSERT_EQ(xns_$checksum_ref(buf, n), sum);
+        ((uint8_t *)buf)[4]++;
+        ASSERT_EQ(xns_$checksum_ref(buf, n), XNS_IDP_$CHECKSUM(buf, n));
+    }
+}
+
+/*
+ * Time both versions over random full-size packets.  Not a pass/fail
+ * test; the numbers are for comparing the two on the build host.
+ */
+static void benchmark(long iterations)
+{
+    static uint16_t packets[64][MAX_WORDS];
+    volatile uint16_t sink = 0;
+    clock_t start;
+    double ref_secs;
+    double blk_secs;
+    double mbytes;
+    long i;
+    int p;
+    int w;
+
+    for (p = 0; p < 64; p++) {
+        for (w = 0; w < MAX_WORDS; w++) {
+            packets[p][w] = next_word();
+        }
+    }
+
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        sink ^= xns_$checksum_ref(packets[i & 63], MAX_WORDS);
+    }
+    ref_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        sink ^= XNS_IDP_$CHECKSUM(packets[i & 63], MAX_WORDS);
+    }
+    blk_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    mbytes = (double)iterations * MAX_WORDS * 2 / (1024.0 * 1024.0);
+    printf("\nBenchmark: %ld packets of %d bytes\n", iterations, MAX_WORDS * 2);
+    printf("  reference: %8.3f s  %9.1f MB/s\n", ref_secs,
+           ref_secs > 0 ? mbytes / ref_secs : 0.0);
+    printf("  blocked:   %8.3f s  %9.1f MB/s\n", blk_secs,
+           blk_secs > 0 ? mbytes / blk_secs : 0.0);
+    (void)sink;
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = 200000;
+
+    if (argc > 1) {
+        iterations = atol(argv[1]);
+    }
+
+    printf("XNS_IDP_$CHECKSUM tests:\n");
+
+    RUN_TEST(all_zero);
+    RUN_TEST(all_ones);
+    RUN_TEST(single_word);
+    RUN_TEST(one_bit_each_position);
+    RUN_TEST(random_every_length);
+    RUN_TEST(random_mostly_ones);
+    RUN_TEST(long_buffer);
+    RUN_TEST(after_hop_increment);
+
+    printf("\nResults: %d passed, %d failed\n", tests_passed, tests_failed);
+
+    if (tests_failed == 0 && iterations > 0) {
+        benchmark(iterations);
+    }
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,398 @@
+// ringcap - capture ring frames to a file
+//
+//   ringcap pathname [-node n] [-sock n] [-type n] [-send | -rcv]
+//                    [-snap bytes] [-size kbytes] [-c count] [-ring pathname]
+//
+// Creates and maps a ring object, has the ring driver capture into it
+// (RINGLOG_$CNTL commands 9-11, see ring/ringlog.h), and copies what it
+// captures to pathname as a standard capture file (libpcap format, link
+// type USER0) until count frames have been written or the program is
+// stopped.  Node, socket and type numbers are hex; -node matches either
+// end of a frame.
+//
+// Each frame in the file is a 4 byte pseudo-header - unit, direction
+// (1 send, 2 receive) and the length of the ring header that follows -
+// then the ring header and as much of the data as the snap length left.
+
+#include <apollo/base.h>
+#include <apollo/error.h>
+#include <apollo/streams.h>
+#include <apollo/pgm.h>
+#include <apollo/ms.h>
+#include <apollo/pfm.h>
+#include <apollo/time.h>
+
+// The capture ring, as in the kernel's ring/ringlog.h
+
+#define RINGLOG_CMD_CAP_START   9
+#define RINGLOG_CMD_CAP_STOP    10
+#define RINGLOG_CMD_CAP_FILTER  11
+
+#define RINGLOG_CAP_MAGIC       0x52434150
+#define RINGLOG_CAP_SEND        0x01
+#define RINGLOG_CAP_RCV         0x02
+#define RINGLOG_CAP_EQ          0
+#define RINGLOG_CAP_ANY         0x0001
+#define RINGLOG_CAP_PREDS_MAX   8
+
+#define OFF_DEST_NODE   0x00
+#define OFF_SRC_NODE    0x08
+#define OFF_TYPE        0x28
+#define OFF_DEST_SOCK   0x38
+#define OFF_SRC_SOCK    0x44
+
+typedef struct {
+  unsigned long magic;
+  unsigned short version;
+  unsigned short snaplen;
+  unsigned long area;
+  unsigned long size;
+  volatile unsigned long head;
+  volatile unsigned long tail;
+  unsigned long seen;
+  unsigned long filtered;
+  unsigned long drops;
+} cap_hdr_t;
+
+typedef struct {
+  unsigned short reclen;
+  unsigned short caplen;
+  unsigned short len;
+  unsigned short hdr_len;
+  unsigned long time_high;
+  unsigned short time_low;
+  unsigned char unit;
+  unsigned char flags;
+} cap_rec_t;
+
+typedef struct {
+  unsigned short offset;
+  unsigned char size;
+  unsigned char op;
+  unsigned long mask;
+  unsigned long value;
+} cap_pred_t;
+
+typedef struct {
+  unsigned short n_preds;
+  unsigned char flags;
+  unsigned char dirs;
+  cap_pred_t preds[RINGLOG_CAP_PREDS_MAX];
+} cap_filter_t;
+
+typedef struct {
+  unsigned long va;
+  unsigned long length;
+  unsigned short snaplen;
+  unsigned short pad;
+} cap_start_t;
+
+extern void ringlog_$cntl(short *cmd, void *param, status_$t *status);
+
+// Capture file format
+
+#define PCAP_MAGIC      0xa1b2c3d4
+#define PCAP_LINK_USER0 147
+
+typedef struct {
+  unsigned long magic;
+  unsigned short version_major;
+  unsigned short version_minor;
+  long thiszone;
+  unsigned long sigfigs;
+  unsigned long snaplen;
+  unsigned long network;
+} pcap_hdr_t;
+
+typedef struct {
+  unsigned long ts_sec;
+  unsigned long ts_usec;
+  unsigned long incl_len;
+  unsigned long orig_len;
+  unsigned char unit;
+  unsigned char dir;
+  unsigned short hdr_len;
+} pcap_rec_t;
+
+#define PSEUDO_LEN      4
+
+// Seconds from the Unix epoch to the Domain epoch, 1 Jan 1980
+#define EPOCH_1980      315532800
+
+static short argc;
+static pgm_$argv_ptr argv;
+
+static char* progname = "ringcap";
+static short progname_len = 7;
+
+static char* default_ring = "/tmp/ringcap_ring";
+
+static cap_filter_t filter;
+static cap_filter_t node_filter;
+
+static status_$t hex_arg(short i, unsigned long *value)
+{
+  short n;
+  unsigned long v = 0;
+  char c;
+
+  if (i >= argc || argv[i].len == 0) {
+    return pgm_$bad_args;
+  }
+  for (n = 0; n < argv[i].len; n++) {
+    c = argv[i].chars[n];
+    if (c >= '0' && c <= '9') v = v * 16 + (c - '0');
+    else if (c >= 'a' && c <= 'f') v = v * 16 + (c - 'a' + 10);
+    else if (c >= 'A' && c <= 'F') v = v * 16 + (c - 'A' + 10);
+    else return pgm_$bad_args;
+  }
+  *value = v;
+  return status_$ok;
+}
+
+static unsigned long dec_arg(short i, status_$t *status)
+{
+  short n;
+  unsigned long v = 0;
+  char c;
+
+  *status = (i < argc && argv[i].len > 0) ? status_$ok : pgm_$bad_args;
+  for (n = 0; *status == status_$ok && n < argv[i].len; n++) {
+    c = argv[i].chars[n];
+    if (c < '0' || c > '9') *status = pgm_$bad_args;
+    else v = v * 10 + (c - '0');
+  }
+  return v;
+}
+
+static short is_opt(short i, char *opt)
+{
+  short n;
+
+  for (n = 0; n < argv[i].len; n++) {
+    if (opt[n] == 0 || opt[n] != argv[i].chars[n]) return 0;
+  }
+  return opt[n] == 0;
+}
+
+static void add_pred(cap_filter_t *f, unsigned short offset, unsigned char size,
+                     unsigned long mask, unsigned long value)
+{
+  cap_pred_t *p;
+
+  if (f->n_preds == RINGLOG_CAP_PREDS_MAX) {
+    error_$std_format(0, " Too many filter options %$");
+    pgm_$set_severity(pgm_$error);
+    pgm_$exit();
+  }
+  p = &f->preds[f->n_preds++];
+  p->offset = offset;
+  p->size = size;
+  p->op = RINGLOG_CAP_EQ;
+  p->mask = mask;
+  p->value = value;
+}
+
+// Domain clock (4us ticks since 1980) to Unix seconds and microseconds
+static void clock_to_unix(unsigned long high, unsigned short low,
+                          unsigned long *sec, unsigned long *usec)
+{
+  // 64us units are high * 4096 + low / 16; 15625 of them make a second
+  unsigned long a = high / 15625;
+  unsigned long b = (high % 15625) * 4096 + (low >> 4);
+
+  *sec = a * 4096 + b / 15625 + EPOCH_1980;
+  *usec = (b % 15625) * 64 + (low & 15) * 4;
+}
+
+static void put(stream_$id_t sid, void *buf, long len)
+{
+  status_$t status;
+  long seek_key;
+
+  stream_$put_chr(sid, buf, len, &seek_key, &status);
+  if (status != status_$ok) {
+    error_$std_format(status, " Unable to write capture file %$");
+    pfm_$signal(status);
+  }
+}
+
+void entry(void)
+{
+  short i;
+  short cmd;
+  status_$t status;
+  status_$t cleanup;
+  pfm_$cleanup_rec crec;
+  char *out_name = 0;
+  short out_len = 0;
+  char *ring_name = default_ring;
+  short ring_len = 17;
+  unsigned long value;
+  unsigned long count = 0;
+  unsigned long written = 0;
+  unsigned long kbytes = 129;
+  unsigned long snap = 0;
+  cap_start_t start;
+  cap_hdr_t *ring;
+  cap_rec_t *rec;
+  pcap_hdr_t fh;
+  pcap_rec_t ph;
+  stream_$id_t sid;
+  time_$clock_t tenth;
+  unsigned long len;
+
+  error_$init_std_format(stream_$stderr, '?', progname, progname_len);
+  pgm_$get_args(&argc, &argv);
+
+  for (i = 1; i < argc; i++) {
+    status = status_$ok;
+    if (is_opt(i, "-node")) {
+      status = hex_arg(++i, &value);
+      // Either end: a filter of its own, tried as "any"
+      node_filter.flags = RINGLOG_CAP_ANY;
+      add_pred(&node_filter, OFF_DEST_NODE, 4, 0x000FFFFF, value);
+      add_pred(&node_filter, OFF_SRC_NODE, 4, 0x000FFFFF, value);
+    }
+    else if (is_opt(i, "-sock")) {
+      status = hex_arg(++i, &value);
+      add_pred(&filter, OFF_DEST_SOCK, 2, 0xFFFF, value);
+    }
+    else if (is_opt(i, "-type")) {
+      status = hex_arg(++i, &value);
+      add_pred(&filter, OFF_TYPE, 2, 0xFFFF, value);
+    }
+    else if (is_opt(i, "-send")) filter.dirs |= RINGLOG_CAP_SEND;
+    else if (is_opt(i, "-rcv")) filter.dirs |= RINGLOG_CAP_RCV;
+    else if (is_opt(i, "-snap")) snap = dec_arg(++i, &status);
+    else if (is_opt(i, "-size")) kbytes = dec_arg(++i, &status);
+    else if (is_opt(i, "-c")) count = dec_arg(++i, &status);
+    else if (is_opt(i, "-ring")) {
+      if (++i >= argc) status = pgm_$bad_args;
+      else { ring_name = argv[i].chars; ring_len = argv[i].len; }
+    }
+    else if (out_name == 0 && argv[i].chars[0] != '-') {
+      out_name = argv[i].chars;
+      out_len = argv[i].len;
+    }
+    else status = pgm_$bad_args;
+
+    if (status != status_$ok) {
+      error_$std_format(status, " Bad option \"%a\"%$", argv[i - 1].chars, argv[i - 1].len);
+      pgm_$set_severity(pgm_$error);
+      pgm_$exit();
+    }
+  }
+
+  if (out_name == 0) {
+    error_$std_format(0, " Capture file pathname expected %$");
+    pgm_$set_severity(pgm_$error);
+    pgm_$exit();
+  }
+
+  // The kernel has one filter, all of whose predicates must hold; a
+  // node alone can use the "any" pair, anything more checks the node here
+  if (filter.n_preds == 0 && node_filter.n_preds != 0) {
+    node_filter.dirs = filter.dirs;
+    filter = node_filter;
+    node_filter.n_preds = 0;
+  }
+
+  ring = (cap_hdr_t *)ms_$crmapl(ring_name, ring_len, 0, kbytes * 1024,
+                                 ms_$nr_xor_1w, &status);
+  if (status != status_$ok) {
+    error_$std_format(status, " Unable to create ring \"%a\"%$", ring_name, ring_len);
+    pgm_$set_severity(pgm_$error);
+    pgm_$exit();
+  }
+
+  stream_$create(out_name, out_len, stream_$overwrite, stream_$no_conc_write,
+                 &sid, &status);
+  if (status != status_$ok) {
+    error_$std_format(status, " Unable to create \"%a\"%$", out_name, out_len);
+    pgm_$set_severity(pgm_$error);
+    pgm_$exit();
+  }
+
+  cmd = RINGLOG_CMD_CAP_FILTER;
+  ringlog_$cntl(&cmd, &filter, &status);
+  if (status == status_$ok) {
+    cmd = RINGLOG_CMD_CAP_START;
+    start.va = (unsigned long)ring;
+    start.length = kbytes * 1024;
+    start.snaplen = (unsigned short)snap;
+    start.pad = 0;
+    ringlog_$cntl(&cmd, &start, &status);
+  }
+  if (status != status_$ok) {
+    error_$std_format(status, " Unable to start capture %$");
+    pgm_$set_severity(pgm_$error);
+    pgm_$exit();
+  }
+
+  // Stopped by a quit or an error: stop the driver before the ring goes
+  cleanup = pfm_$cleanup(&crec);
+  if (cleanup != pfm_$cleanup_set) {
+    cmd = RINGLOG_CMD_CAP_STOP;
+    ringlog_$cntl(&cmd, 0, &status);
+    stream_$close(sid, &status);
+    ms_$unmap(ring, kbytes * 1024, &status);
+    pfm_$signal(cleanup);
+  }
+
+  fh.magic = PCAP_MAGIC;
+  fh.version_major = 2;
+  fh.version_minor = 4;
+  fh.thiszone = 0;
+  fh.sigfigs = 0;
+  fh.snaplen = ring->snaplen + PSEUDO_LEN;
+  fh.network = PCAP_LINK_USER0;
+  put(sid, &fh, sizeof(fh));
+
+  tenth.high = 0;
+  tenth.low = 25000;
+
+  while (count == 0 || written < count) {
+    if (ring->tail == ring->head) {
+      time_$wait(time_$relative, tenth, &status);
+      continue;
+    }
+
+    rec = (cap_rec_t *)((char *)ring + ring->area + (ring->tail & (ring->size - 1)));
+    if (rec->reclen == 0) {
+      // The rest of the area was skipped
+      ring->tail += ring->size - (ring->tail & (ring->size - 1));
+      continue;
+    }
+
+    if (node_filter.n_preds == 0 ||
+        ((*(unsigned long *)((char *)(rec + 1) + OFF_DEST_NODE) & 0x000FFFFF) ==
+             node_filter.preds[0].value ||
+         (*(unsigned long *)((char *)(rec + 1) + OFF_SRC_NODE) & 0x000FFFFF) ==
+             node_filter.preds[0].value)) {
+      clock_to_unix(rec->time_high, rec->time_low, &ph.ts_sec, &ph.ts_usec);
+      ph.incl_len = rec->caplen + PSEUDO_LEN;
+      ph.orig_len = rec->len + PSEUDO_LEN;
+      ph.unit = rec->unit;
+      ph.dir = rec->flags;
+      ph.hdr_len = rec->hdr_len;
+      put(sid, &ph, sizeof(ph));
+      put(sid, rec + 1, rec->caplen);
+      written++;
+    }
+
+    // Give the space back only once the frame is written out
+    len = rec->reclen;
+    ring->tail += len;
+  }
+
+  cmd = RINGLOG_CMD_CAP_STOP;
+  ringlog_$cntl(&cmd, 0, &status);
+
+  error_$std_format(0, " %ld frames written, %ld filtered, %ld dropped %$",
+                    written, ring->filtered, ring->drops);
+
+  pfm_$rls_cleanup(&crec, &status);
+  stream_$close(sid, &status);
+  ms_$unmap(ring, kbytes * 1024, &status);
+}